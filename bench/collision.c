@@ -0,0 +1,77 @@
+#include "collision.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/memory.h"
+#include "../src/collision.h"
+
+#include <stdlib.h>
+
+#define BOX_COUNT 4096
+#define QUERIES 1024
+
+static collision_box boxes[BOX_COUNT];
+static collision_box queries[QUERIES];
+static u32 indices[BOX_COUNT];
+static u64 mask[BOX_COUNT / 64];
+
+static const char *backend_names[] = { "scalar", "sse2", "avx2" };
+
+static void bench_backend(ecollision_store *store, ecollision_backend backend, u64 *scalar_ns) {
+    if(!ecollision_set_backend(backend)) {
+        EINFO("%-6s: not supported", backend_names[backend]);
+        return;
+    }
+
+    u64 hits = 0;
+    u64 start = eclock_now_ns();
+    for(u32 q = 0; q < QUERIES; ++q) {
+        hits += ecollision_test_range(store, queries[q], 0, BOX_COUNT, mask);
+    }
+    u64 range_ns = eclock_now_ns() - start;
+
+    start = eclock_now_ns();
+    for(u32 q = 0; q < QUERIES; ++q) {
+        hits += ecollision_test_indices(store, queries[q], indices, BOX_COUNT, mask);
+    }
+    u64 indices_ns = eclock_now_ns() - start;
+
+    if(backend == ECOLLISION_BACKEND_SCALAR) {
+        *scalar_ns = range_ns;
+    }
+    EINFO("%-6s: range %6.2f ns/box (x%.1f) | indices %6.2f ns/box | %llu hits",
+            backend_names[backend], (f64)range_ns / (QUERIES * BOX_COUNT), (f64)*scalar_ns / range_ns,
+            (f64)indices_ns / (QUERIES * BOX_COUNT), hits);
+}
+
+void collision_bench() {
+    EINFO("-- collision_bench");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+
+    srand(31);
+    for(u32 i = 0; i < BOX_COUNT; ++i) {
+        i32 x = rand() % 2048, y = rand() % 2048;
+        boxes[i] = (collision_box){ .x1 = x, .x2 = x + 24, .y1 = y, .y2 = y + 24 };
+        indices[i] = rand() % BOX_COUNT;
+    }
+    for(u32 q = 0; q < QUERIES; ++q) {
+        i32 x = rand() % 2048, y = rand() % 2048;
+        queries[q] = (collision_box){ .x1 = x, .x2 = x + 64, .y1 = y, .y2 = y + 64 };
+    }
+
+    ecollision_store store;
+    EASSERT(ecollision_store_create(BOX_COUNT, &store));
+    ecollision_store_load(&store, boxes, BOX_COUNT);
+
+    ecollision_backend best = ecollision_get_backend();
+    u64 scalar_ns = 1;
+    for(u32 backend = ECOLLISION_BACKEND_SCALAR; backend <= ECOLLISION_BACKEND_AVX2; ++backend) {
+        bench_backend(&store, backend, &scalar_ns);
+    }
+    ecollision_set_backend(best);
+
+    ecollision_store_destroy(&store);
+    ememory_uninit();
+}
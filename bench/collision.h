@@ -0,0 +1,6 @@
+#ifndef COLLISION_BENCH_H
+#define COLLISION_BENCH_H
+
+void collision_bench();
+
+#endif // COLLISION_BENCH_H
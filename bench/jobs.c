@@ -0,0 +1,75 @@
+#include "jobs.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/memory.h"
+#include "../src/thread.h"
+#include "../src/jobs.h"
+
+#include <math.h>
+
+#define ITEM_COUNT (1 << 18)
+#define EMPTY_JOBS 100000
+#define ITERATIONS 8
+
+static ejobs jobs;
+static f32 results[ITEM_COUNT];
+
+// uneven on purpose: later items cost more, stealing has to balance it
+static void heavy_range(void *arg, u32 first, u32 count) {
+    for(u32 i = first; i < first + count; ++i) {
+        f32 x = i;
+        for(u32 k = 0; k < 16 + (i >> 13); ++k) {
+            x = sqrtf(x + k);
+        }
+        results[i] = x;
+    }
+}
+
+static void empty_job(void *arg, u32 first, u32 count) {
+}
+
+static void bench_workers(u32 worker_count, u64 *single_ns) {
+    // worker_count includes the calling thread
+    ejobs_create(worker_count - 1, &jobs);
+
+    u64 start = eclock_now_ns();
+    for(u32 it = 0; it < ITERATIONS; ++it) {
+        ejob_counter counter = {0};
+        ejobs_parallel_for(&jobs, heavy_range, 0, ITEM_COUNT, 0, &counter);
+        ejobs_wait(&jobs, &counter);
+    }
+    u64 for_ns = (eclock_now_ns() - start) / ITERATIONS;
+    if(worker_count == 1) {
+        *single_ns = for_ns;
+    }
+
+    start = eclock_now_ns();
+    ejob_counter counter = {0};
+    for(u32 i = 0; i < EMPTY_JOBS; ++i) {
+        ejobs_submit(&jobs, empty_job, 0, &counter);
+    }
+    ejobs_wait(&jobs, &counter);
+    u64 empty_ns = eclock_now_ns() - start;
+
+    EINFO("%2u workers: parallel_for %9llu ns (x%.2f) | %6.1f ns per empty job | %llu steals",
+            worker_count, for_ns, (f64)*single_ns / for_ns, (f64)empty_ns / EMPTY_JOBS, jobs.stolen);
+
+    ejobs_destroy(&jobs);
+}
+
+void jobs_bench() {
+    EINFO("-- jobs_bench");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+
+    u32 cores = ethread_core_count();
+    EINFO("%u cores", cores);
+    u64 single_ns = 1;
+    for(u32 workers = 1; workers <= cores; ++workers) {
+        bench_workers(workers, &single_ns);
+    }
+
+    ememory_uninit();
+}
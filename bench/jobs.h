@@ -0,0 +1,6 @@
+#ifndef JOBS_BENCH_H
+#define JOBS_BENCH_H
+
+void jobs_bench();
+
+#endif // JOBS_BENCH_H
@@ -0,0 +1,115 @@
+#include "logger.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/logger.h"
+#include "../src/log_binary.h"
+
+#include <string.h>
+
+#define MESSAGES 100000
+// small enough for the ring, flushed between batches
+#define BATCH 256
+
+static u64 written;
+
+static void discard_output(void *user, u8 is_error, const char *text, u64 length) {
+    written += length;
+}
+
+// time spent in the logging calls only, what the game loop would see
+static u64 bench_calls() {
+    u64 calls_ns = 0;
+    for(u32 i = 0; i < MESSAGES; i += BATCH) {
+        u64 start = eclock_now_ns();
+        for(u32 j = i; j < i + BATCH; ++j) {
+            EINFO("<- wl_output@%u.mode: flags=%u width=%d height=%d refresh=%d name=%s", j, 3, 1920, 1080, 60000, "eDP-1");
+        }
+        calls_ns += eclock_now_ns() - start;
+        elog_flush();
+    }
+    return calls_ns;
+}
+
+static u64 bench_trace() {
+    u64 start = eclock_now_ns();
+    for(u32 i = 0; i < MESSAGES; ++i) {
+        ETRACE("<- wl_output@%u.mode: flags=%u width=%d height=%d refresh=%d name=%s", i, 3, 1920, 1080, 60000, "eDP-1");
+    }
+    return eclock_now_ns() - start;
+}
+
+#define EVENTS 1024
+#define ROUNDS 200
+
+// wl_output.mode events as they come off the wire: object, flags, width, height, refresh
+static u32 events[EVENTS][5];
+static u64 checksum;
+
+// a protocol handler decoding each event into some state, traced like the window's handlers
+static u64 bench_dispatch() {
+    i32 modes[8][4] = {0};
+    u64 best = -1;
+    for(u32 round = 0; round < ROUNDS; ++round) {
+        u64 start = eclock_now_ns();
+        for(u32 i = 0; i < EVENTS; ++i) {
+            const u32 *event = events[i];
+            ETRACE("<- wl_output@%u.mode: flags=%u width=%d height=%d refresh=%d", event[0], event[1], (i32)event[2], (i32)event[3], (i32)event[4]);
+            i32 *mode = modes[event[0] & 7];
+            mode[0] = event[1];
+            mode[1] = event[2];
+            mode[2] = event[3];
+            mode[3] = event[4];
+            checksum += mode[1] * mode[2] + mode[3];
+        }
+        u64 elapsed = eclock_now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    return best;
+}
+
+// the same loop traced and not, as production runs it: debug logs off
+static void bench_trace_overhead() {
+    for(u32 i = 0; i < EVENTS; ++i) {
+        u32 event[5] = { 3 + i % 5, i & 3, 1920 + i, 1080 - i, 60000 + i };
+        memcpy(events[i], event, sizeof(event));
+    }
+    log_level level = elog_levels[ELOG_MODULE_CORE];
+    elog_set_level(ELOG_MODULE_CORE, LOG_LEVEL_INFO);
+    u64 untraced_ns = bench_dispatch();
+    EASSERT(elog_binary_open("build/bench_log.blog", 0));
+    u64 traced_ns = bench_dispatch();
+    EASSERT(elog_binary_dropped() == 0);
+    elog_binary_close();
+    elog_set_level(ELOG_MODULE_CORE, level);
+
+    f64 overhead = (f64)(traced_ns - untraced_ns) / EVENTS;
+    EINFO("dispatch: %5.1f ns per event untraced, %5.1f traced: +%.1f ns (+%.0f%%), %.3f%% of a 60 Hz frame per 100 events",
+          (f64)untraced_ns / EVENTS, (f64)traced_ns / EVENTS, overhead, 100.0 * (traced_ns - untraced_ns) / untraced_ns,
+          100.0 * overhead * 100 / (1000000000.0 / 60));
+    EINFO("(checksum %llu)", checksum);
+}
+
+void logger_bench() {
+    EINFO("-- logger_bench");
+    elog_set_output(discard_output, 0);
+    u64 sync_ns = bench_calls();
+    EASSERT(elog_async_start());
+    u64 dropped = elog_dropped();
+    u64 async_ns = bench_calls();
+    dropped = elog_dropped() - dropped;
+    elog_async_stop();
+    elog_set_output(0, 0);
+
+    EASSERT(elog_binary_open("build/bench_log.blog", 0));
+    u64 binary_ns = bench_trace();
+    EASSERT(elog_binary_dropped() == 0);
+    elog_binary_close();
+
+    EINFO("sync : %6.1f ns per call", (f64)sync_ns / MESSAGES);
+    EINFO("async: %6.1f ns per call (x%.2f) | %llu dropped", (f64)async_ns / MESSAGES, (f64)sync_ns / async_ns, dropped);
+    EINFO("binary: %5.1f ns per call (x%.2f)", (f64)binary_ns / MESSAGES, (f64)sync_ns / binary_ns);
+
+    bench_trace_overhead();
+}
@@ -0,0 +1,6 @@
+#ifndef LOGGER_BENCH_H
+#define LOGGER_BENCH_H
+
+void logger_bench();
+
+#endif // LOGGER_BENCH_H
@@ -0,0 +1,23 @@
+#include "../src/logger.h"
+
+#include "spatial_hash.h"
+#include "collision.h"
+#include "jobs.h"
+#include "logger.h"
+#include "renderer.h"
+#include "wl_objects.h"
+
+int main(void) {
+    EINFO("Starting benchmarks");
+
+    spatial_hash_bench();
+    collision_bench();
+    jobs_bench();
+    logger_bench();
+    renderer_bench();
+    wl_objects_bench();
+
+    EINFO("Finished benchmarks");
+
+    return 0;
+}
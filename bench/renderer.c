@@ -0,0 +1,139 @@
+#include "renderer.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/asset.h"
+#include "../src/clock.h"
+#include "../src/jobs.h"
+#include "../src/logger.h"
+#include "../src/memory.h"
+#include "../src/renderer.h"
+#include "../src/window.h"
+
+#include <stdlib.h>
+
+#define TARGET_WIDTH 1920
+#define TARGET_HEIGHT 1080
+#define SPRITE_SIZE 64
+#define SPRITES 2000
+#define MAX_SPRITES 8000
+#define FRAMES 20
+
+static u32 target_pixels[TARGET_WIDTH * TARGET_HEIGHT];
+static u32 sprite_pixels[SPRITE_SIZE * SPRITE_SIZE];
+static i32 positions[MAX_SPRITES][2];
+static ejobs jobs;
+
+static const char *backend_names[] = { "scalar", "sse2", "avx2" };
+
+// a disc with a soft edge: opaque center, translucent ring, transparent corners
+static void make_sprite() {
+    for(u32 y = 0; y < SPRITE_SIZE; ++y) {
+        for(u32 x = 0; x < SPRITE_SIZE; ++x) {
+            i32 dx = (i32)x - SPRITE_SIZE / 2, dy = (i32)y - SPRITE_SIZE / 2;
+            i32 d = dx * dx + dy * dy;
+            u32 a = d < 24 * 24 ? 255 : d < 32 * 32 ? 255 - (d - 24 * 24) * 255 / (32 * 32 - 24 * 24) : 0;
+            u32 c = a * 3 / 4;
+            sprite_pixels[y * SPRITE_SIZE + x] = (a << 24) | (c << 16) | (c / 2 << 8) | (a / 4);
+        }
+    }
+}
+
+static u64 bench_frames(const eimage *sprite, u32 sprites, i32 size) {
+    u64 start = eclock_now_ns();
+    for(u32 frame = 0; frame < FRAMES; ++frame) {
+        renderer_clear();
+        for(u32 i = 0; i < sprites; ++i) {
+            renderer_draw_image(sprite, positions[i][0], positions[i][1], size, size);
+        }
+        renderer_flush();
+    }
+    return (eclock_now_ns() - start) / FRAMES;
+}
+
+// frame time against workers and sprites, best backend
+static void bench_threads(const eimage *sprite) {
+    static const u32 worker_counts[] = { 1, 2, 4 };
+    static const u32 sprite_counts[] = { 500, 2000, MAX_SPRITES };
+    for(u32 w = 0; w < sizeof(worker_counts) / sizeof(u32); ++w) {
+        ejobs_create(worker_counts[w] - 1, &jobs);
+        renderer_set_jobs(&jobs);
+        u64 times[3];
+        for(u32 s = 0; s < 3; ++s) {
+            times[s] = bench_frames(sprite, sprite_counts[s], SPRITE_SIZE);
+        }
+        EINFO("%u workers: %5u sprites %6.2f ms | %5u sprites %6.2f ms | %5u sprites %6.2f ms",
+                worker_counts[w], sprite_counts[0], times[0] / 1e6, sprite_counts[1], times[1] / 1e6, sprite_counts[2], times[2] / 1e6);
+        renderer_set_jobs(0);
+        ejobs_destroy(&jobs);
+    }
+}
+
+// a frame per target, one sprite moving over the others, pixels age frames old
+static u64 bench_damage(const eimage *sprite, u32 age, u64 *damaged) {
+    erender_target target = { .pixels = target_pixels, .width = TARGET_WIDTH, .height = TARGET_HEIGHT, .stride = TARGET_WIDTH, .age = age };
+    *damaged = 0;
+    u64 start = eclock_now_ns();
+    for(u32 frame = 0; frame < FRAMES; ++frame) {
+        renderer_set_target(&target);
+        renderer_clear();
+        for(u32 i = 0; i < SPRITES; ++i) {
+            renderer_draw_image(sprite, positions[i][0], positions[i][1], SPRITE_SIZE, SPRITE_SIZE);
+        }
+        renderer_draw_image(sprite, frame * 16, TARGET_HEIGHT / 2, SPRITE_SIZE, SPRITE_SIZE);
+        renderer_set_target(0);
+        const ewindow_rect *rects;
+        u32 count = renderer_damage(&rects);
+        for(u32 i = 0; i < count; ++i) {
+            *damaged += (u64)rects[i].width * rects[i].height;
+        }
+    }
+    *damaged /= FRAMES;
+    return (eclock_now_ns() - start) / FRAMES;
+}
+
+void renderer_bench() {
+    EINFO("-- renderer_bench");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+    make_sprite();
+    eimage sprite = { .width = SPRITE_SIZE, .height = SPRITE_SIZE, .pixels = sprite_pixels, .opaque = false };
+    srand(7);
+    for(u32 i = 0; i < MAX_SPRITES; ++i) {
+        // some sprites are clipped by the edges
+        positions[i][0] = rand() % (TARGET_WIDTH + SPRITE_SIZE) - SPRITE_SIZE / 2;
+        positions[i][1] = rand() % (TARGET_HEIGHT + SPRITE_SIZE) - SPRITE_SIZE / 2;
+    }
+    erender_target target = { .pixels = target_pixels, .width = TARGET_WIDTH, .height = TARGET_HEIGHT, .stride = TARGET_WIDTH };
+    renderer_set_target(&target);
+
+    erender_backend best = renderer_get_backend();
+    u64 scalar_ns = 1;
+    for(u32 backend = ERENDER_BACKEND_SCALAR; backend <= ERENDER_BACKEND_AVX2; ++backend) {
+        if(!renderer_set_backend(backend)) {
+            EINFO("%-6s: not supported", backend_names[backend]);
+            continue;
+        }
+        u64 unscaled_ns = bench_frames(&sprite, SPRITES, SPRITE_SIZE);
+        u64 integer_ns = bench_frames(&sprite, SPRITES, 2 * SPRITE_SIZE);
+        u64 nearest_ns = bench_frames(&sprite, SPRITES, 3 * SPRITE_SIZE / 2);
+        if(backend == ERENDER_BACKEND_SCALAR) {
+            scalar_ns = unscaled_ns;
+        }
+        EINFO("%-6s: %u sprites %6.2f ms/frame (x%.1f, %.0f Mpx/s) | x2 %6.2f ms | x1.5 %6.2f ms",
+                backend_names[backend], SPRITES, unscaled_ns / 1e6, (f64)scalar_ns / unscaled_ns,
+                (f64)SPRITES * SPRITE_SIZE * SPRITE_SIZE / unscaled_ns * 1e3, integer_ns / 1e6, nearest_ns / 1e6);
+    }
+    renderer_set_backend(best);
+    bench_threads(&sprite);
+    renderer_set_target(0);
+
+    // the previous frame, double and triple buffering against redrawing everything
+    for(u32 age = 0; age <= 3; ++age) {
+        u64 damaged;
+        u64 ns = bench_damage(&sprite, age, &damaged);
+        EINFO("damage, age %u: %6.2f ms/frame, %5.1f%% of the target damaged", age, ns / 1e6, 100.0 * damaged / (TARGET_WIDTH * TARGET_HEIGHT));
+    }
+    renderer_shutdown();
+    ememory_uninit();
+}
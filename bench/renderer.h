@@ -0,0 +1,6 @@
+#ifndef RENDERER_BENCH_H
+#define RENDERER_BENCH_H
+
+void renderer_bench();
+
+#endif // RENDERER_BENCH_H
@@ -0,0 +1,91 @@
+#include "spatial_hash.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/memory.h"
+#include "../src/spatial_hash.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define MAX_BOXES 8192
+#define BOX_SIZE 24
+#define ITERATIONS 16
+
+static collision_box boxes[MAX_BOXES];
+static espatial_pair pairs[1 << 20];
+
+static u32 brute_force_pairs(u32 count) {
+    u32 found = 0;
+    for(u32 a = 0; a < count; ++a) {
+        for(u32 b = a + 1; b < count; ++b) {
+            found += collision_box_overlap(&boxes[a], &boxes[b]);
+        }
+    }
+    return found;
+}
+
+// density: total box area over world area
+static void bench_case(u32 count, f64 density) {
+    i32 world = sqrt(count * BOX_SIZE * BOX_SIZE / density);
+    srand(count);
+    for(u32 i = 0; i < count; ++i) {
+        i32 x = rand() % world, y = rand() % world;
+        boxes[i] = (collision_box){ .x1 = x, .x2 = x + BOX_SIZE, .y1 = y, .y2 = y + BOX_SIZE };
+    }
+
+    espatial_hash hash;
+    espatial_hash_create(BOX_SIZE * 2, count * 2, count, &hash);
+    for(u32 i = 0; i < count; ++i) {
+        espatial_hash_insert(&hash, i, boxes[i]);
+    }
+
+    u64 start = eclock_now_ns();
+    u32 expected = 0;
+    for(u32 it = 0; it < ITERATIONS; ++it) {
+        expected = brute_force_pairs(count);
+    }
+    u64 brute_ns = (eclock_now_ns() - start) / ITERATIONS;
+
+    start = eclock_now_ns();
+    u32 found = 0;
+    for(u32 it = 0; it < ITERATIONS; ++it) {
+        found = espatial_hash_pairs(&hash, pairs, sizeof(pairs) / sizeof(pairs[0]));
+    }
+    u64 pairs_ns = (eclock_now_ns() - start) / ITERATIONS;
+    EASSERT_MSG(found == expected, "spatial hash found %u pairs, brute force %u", found, expected);
+
+    // every box moves a little each frame, most stay in their cells
+    start = eclock_now_ns();
+    for(u32 it = 0; it < ITERATIONS; ++it) {
+        for(u32 i = 0; i < count; ++i) {
+            i32 dx = (i + it) % 5 - 2, dy = (i * 7 + it) % 5 - 2;
+            boxes[i].x1 += dx; boxes[i].x2 += dx;
+            boxes[i].y1 += dy; boxes[i].y2 += dy;
+            espatial_hash_update(&hash, i, boxes[i]);
+        }
+    }
+    u64 update_ns = (eclock_now_ns() - start) / ITERATIONS;
+
+    EINFO("%5u boxes, density %4.2f: %7u pairs | brute force %9llu ns (%9llu tests) | hash %8llu ns (%7llu tests) | update all %7llu ns | speedup x%.1f",
+            count, density, found, brute_ns, (u64)count * (count - 1) / 2, pairs_ns, hash.tests, update_ns, (f64)brute_ns / pairs_ns);
+
+    espatial_hash_destroy(&hash);
+}
+
+void spatial_hash_bench() {
+    EINFO("-- spatial_hash_bench");
+    eheap heap = {0};
+    ememory_init(64 * 1024 * 1024, &heap);
+
+    u32 counts[] = { 256, 1024, 2048, 8192 };
+    f64 densities[] = { 0.05, 0.25, 1.0 };
+    for(u32 c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        for(u32 d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d) {
+            bench_case(counts[c], densities[d]);
+        }
+    }
+
+    ememory_uninit();
+}
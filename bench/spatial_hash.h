@@ -0,0 +1,6 @@
+#ifndef SPATIAL_HASH_BENCH_H
+#define SPATIAL_HASH_BENCH_H
+
+void spatial_hash_bench();
+
+#endif // SPATIAL_HASH_BENCH_H
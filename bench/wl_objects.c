@@ -0,0 +1,292 @@
+#include "wl_objects.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/logger.h"
+#include "../src/memory.h"
+#include "../src/wl_objects.h"
+
+#include <string.h>
+
+#define MAX_WINDOWS 64
+#define BUFFERS 3
+#define FRAMES 600
+#define REPLAYS 20
+// the old dispatch kept this many destroyed pools around
+#define OLD_CHUNKS 255
+
+// what a compositor sends a client drawing every frame: per window and frame a
+// buffer release, the frame callback done and its delete_id, now and then
+// configures, key presses and pings
+typedef struct bench_window {
+    u32 wl_surface;
+    u32 xdg_surface;
+    u32 xdg_toplevel;
+    u32 wl_buffers[BUFFERS];
+    u32 wl_callback;
+    u32 released;
+} bench_window;
+
+static struct {
+    ewl_objects objects;
+    bench_window windows[MAX_WINDOWS];
+    u32 window_count;
+    u32 wl_registry;
+    u32 wl_shm;
+    u32 xdg_wm_base;
+    u32 wl_output;
+    u32 wl_seat;
+    u32 wl_keyboard;
+    struct {
+        u32 wl_object;
+        u32 wl_buffers[4];
+    } old_chunks[OLD_CHUNKS];
+    u64 sink;
+} bench;
+
+static u32 stream[MAX_WINDOWS * FRAMES * 16];
+static u32 stream_words;
+
+static void record(u32 object_id, u16 opcode, const u32 *args, u32 arg_count) {
+    stream[stream_words++] = object_id;
+    stream[stream_words++] = ((8 + arg_count * 4) << 16) | opcode;
+    for(u32 i = 0; i < arg_count; ++i) {
+        stream[stream_words++] = args[i];
+    }
+}
+
+static void record_session() {
+    stream_words = 0;
+    for(u32 frame = 0; frame < FRAMES; ++frame) {
+        for(u32 w = 0; w < bench.window_count; ++w) {
+            bench_window *window = &bench.windows[w];
+            if(frame % 60 == 0) {
+                u32 configure[] = { 800, 600, 0 };
+                record(window->xdg_toplevel, 0, configure, 3);
+                u32 serial = frame + w;
+                record(window->xdg_surface, 0, &serial, 1);
+            }
+            record(window->wl_buffers[frame % BUFFERS], 0, 0, 0);
+            u32 time = frame * 16;
+            record(window->wl_callback, 0, &time, 1);
+            record(1, 1, &window->wl_callback, 1);
+        }
+        if(frame % 8 == 0) {
+            u32 key[] = { frame, frame * 16, 30, frame % 16 == 0 };
+            record(bench.wl_keyboard, 3, key, 4);
+        }
+        if(frame % 240 == 0) {
+            record(bench.xdg_wm_base, 0, &frame, 1);
+        }
+    }
+}
+
+// table handlers, the same work as the chain below
+
+static u8 on_delete_id(void *owner, const ewl_message *message) {
+    u32 id = *(u32 *)message->args;
+    ewl_object *object = ewl_objects_get(&bench.objects, id);
+    const ewl_interface *interface = object->interface;
+    void *callback_owner = object->owner;
+    ewl_objects_remove(&bench.objects, id);
+    // the next frame's callback, the same id comes back
+    u32 next = ewl_objects_add(&bench.objects, interface, callback_owner);
+    EASSERT(next == id);
+    return true;
+}
+
+static u8 on_release(void *owner, const ewl_message *message) {
+    bench_window *window = owner;
+    ++window->released;
+    return true;
+}
+
+static u8 on_done(void *owner, const ewl_message *message) {
+    bench.sink += *(u32 *)message->args;
+    return true;
+}
+
+static u8 on_configure(void *owner, const ewl_message *message) {
+    bench.sink += *(u32 *)message->args;
+    return true;
+}
+
+static u8 on_key(void *owner, const ewl_message *message) {
+    bench.sink += ((u32 *)message->args)[2];
+    return true;
+}
+
+static const ewl_event_handler display_events[] = { 0, on_delete_id };
+static const ewl_interface display_interface = { "wl_display", display_events, 2 };
+static const ewl_interface global_interface = { "global", 0, 0 };
+static const ewl_event_handler ping_events[] = { on_configure };
+static const ewl_interface wm_base_interface = { "xdg_wm_base", ping_events, 1 };
+static const ewl_event_handler key_events[] = { 0, 0, 0, on_key };
+static const ewl_interface keyboard_interface = { "wl_keyboard", key_events, 4 };
+static const ewl_event_handler release_events[] = { on_release };
+static const ewl_interface buffer_interface = { "wl_buffer", release_events, 1 };
+static const ewl_event_handler done_events[] = { on_done };
+static const ewl_interface callback_interface = { "wl_callback", done_events, 1 };
+static const ewl_event_handler configure_events[] = { on_configure };
+static const ewl_interface configure_interface = { "xdg_surface", configure_events, 1 };
+static const ewl_interface surface_interface = { "wl_surface", 0, 0 };
+
+static void create_objects(u32 window_count) {
+    ewl_objects_init(&bench.objects);
+    ewl_objects *objects = &bench.objects;
+    ewl_objects_add(objects, &display_interface, 0);
+    bench.wl_registry = ewl_objects_add(objects, &global_interface, 0);
+    bench.wl_shm = ewl_objects_add(objects, &global_interface, 0);
+    bench.xdg_wm_base = ewl_objects_add(objects, &wm_base_interface, 0);
+    bench.wl_output = ewl_objects_add(objects, &global_interface, 0);
+    bench.wl_seat = ewl_objects_add(objects, &global_interface, 0);
+    bench.wl_keyboard = ewl_objects_add(objects, &keyboard_interface, 0);
+    bench.window_count = window_count;
+    for(u32 w = 0; w < window_count; ++w) {
+        bench_window *window = &bench.windows[w];
+        *window = (bench_window){0};
+        window->wl_surface = ewl_objects_add(objects, &surface_interface, window);
+        window->xdg_surface = ewl_objects_add(objects, &configure_interface, window);
+        window->xdg_toplevel = ewl_objects_add(objects, &configure_interface, window);
+        for(u32 i = 0; i < BUFFERS; ++i) {
+            window->wl_buffers[i] = ewl_objects_add(objects, &buffer_interface, window);
+        }
+        window->wl_callback = ewl_objects_add(objects, &callback_interface, window);
+    }
+    // slots of pools already freed, none match
+    memset(bench.old_chunks, 0, sizeof(bench.old_chunks));
+}
+
+// the dispatch the table replaced: globals compared in turn, destroyed pools
+// scanned, then each window asked
+static u8 chain_window(bench_window *window, u32 object_id, u16 opcode, const u32 *args) {
+    if(opcode == 0) {
+        for(u32 i = 0; i < BUFFERS; ++i) {
+            if(window->wl_buffers[i] == object_id) {
+                ++window->released;
+                return true;
+            }
+        }
+    }
+    if(object_id == window->wl_callback && opcode == 0) {
+        bench.sink += args[0];
+        return true;
+    }
+    if(object_id == window->xdg_toplevel && opcode == 3) {
+        return true;
+    }
+    if(object_id == window->xdg_surface && opcode == 0) {
+        bench.sink += args[0];
+        return true;
+    }
+    if(object_id == window->xdg_toplevel && opcode == 0) {
+        bench.sink += args[0];
+        return true;
+    }
+    if(object_id == window->wl_surface && opcode == 2) {
+        return true;
+    }
+    return false;
+}
+
+static u8 chain_dispatch(u32 object_id, u16 opcode, const u32 *args) {
+    if(object_id == bench.wl_registry && opcode == 0) return true;
+    if(object_id == bench.wl_seat && opcode == 1) return true;
+    if(object_id == bench.wl_seat && opcode == 0) return true;
+    if(object_id == bench.wl_keyboard && opcode == 0) return true;
+    if(object_id == bench.wl_keyboard && opcode == 5) return true;
+    if(object_id == bench.wl_keyboard && opcode == 1) return true;
+    if(object_id == bench.wl_keyboard && opcode == 4) return true;
+    if(object_id == bench.wl_keyboard && opcode == 2) return true;
+    if(object_id == bench.wl_keyboard && opcode == 3) {
+        bench.sink += args[2];
+        return true;
+    }
+    if(object_id == bench.wl_shm && opcode == 0) return true;
+    if(object_id == bench.xdg_wm_base && opcode == 0) {
+        bench.sink += args[0];
+        return true;
+    }
+    for(u16 event = 0; event < 6; ++event) {
+        if(object_id == bench.wl_output && opcode == event) return true;
+    }
+    if(object_id == 1 && opcode == 1) {
+        u32 i = 0;
+        while(i < OLD_CHUNKS && bench.old_chunks[i].wl_object != args[0]) ++i;
+        bench.sink += i;
+        return true;
+    }
+    if(opcode == 0) {
+        u8 old = false;
+        for(u32 i = 0; i < OLD_CHUNKS && !old; ++i) {
+            for(u32 j = 0; j < 4 && !old; ++j) {
+                old = bench.old_chunks[i].wl_buffers[j] == object_id;
+            }
+        }
+        if(old) {
+            return true;
+        }
+    }
+    for(u32 w = 0; w < bench.window_count; ++w) {
+        if(chain_window(&bench.windows[w], object_id, opcode, args)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static u64 replay_table() {
+    u64 start = eclock_now_ns();
+    for(u32 replay = 0; replay < REPLAYS; ++replay) {
+        for(u32 at = 0; at < stream_words;) {
+            ewl_message message = { .object_id = stream[at], .opcode = stream[at + 1] & 0xFFFF, .size = stream[at + 1] >> 16, .args = (u8 *)&stream[at + 2] };
+            u8 dispatched = ewl_objects_dispatch(&bench.objects, &message);
+            EASSERT(dispatched);
+            at += message.size / 4;
+        }
+    }
+    return eclock_now_ns() - start;
+}
+
+static u64 replay_chain() {
+    u64 start = eclock_now_ns();
+    for(u32 replay = 0; replay < REPLAYS; ++replay) {
+        for(u32 at = 0; at < stream_words;) {
+            u16 size = stream[at + 1] >> 16;
+            u8 dispatched = chain_dispatch(stream[at], stream[at + 1] & 0xFFFF, &stream[at + 2]);
+            EASSERT(dispatched);
+            at += size / 4;
+        }
+    }
+    return eclock_now_ns() - start;
+}
+
+static u32 count_events() {
+    u32 events = 0;
+    for(u32 at = 0; at < stream_words; at += (stream[at + 1] >> 16) / 4) {
+        ++events;
+    }
+    return events;
+}
+
+void wl_objects_bench() {
+    EINFO("-- wl_objects_bench");
+    eheap heap = {0};
+    ememory_init(4 * 1024 * 1024, &heap);
+
+    static const u32 window_counts[] = { 1, 4, 16, 64 };
+    for(u32 i = 0; i < sizeof(window_counts) / sizeof(u32); ++i) {
+        create_objects(window_counts[i]);
+        record_session();
+        u64 events = (u64)count_events() * REPLAYS;
+        u64 table_ns = replay_table();
+        u64 chain_ns = replay_chain();
+        EINFO("%2u windows, %7llu events: table %5.1f ns per event | if-chain %6.1f ns per event (x%.1f) | %llu objects",
+                window_counts[i], events, (f64)table_ns / events, (f64)chain_ns / events, (f64)chain_ns / table_ns, bench.objects.live);
+        ewl_objects_destroy(&bench.objects);
+    }
+    EINFO("(sink %llu)", bench.sink);
+
+    ememory_uninit();
+}
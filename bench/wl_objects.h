@@ -0,0 +1,6 @@
+#ifndef WL_OBJECTS_BENCH_H
+#define WL_OBJECTS_BENCH_H
+
+void wl_objects_bench();
+
+#endif // WL_OBJECTS_BENCH_H
@@ -3,14 +3,53 @@
 
 #include "defines.h"
 #include "window.h"
+#include "timestep.h"
+
+struct escene;
+struct ecs_scheduler;
+struct ejobs;
+struct erender_snapshot;
+struct eframe_stats;
 
 typedef struct eapp {
     u64 window;
 
+    // one worker per core, created before init
+    struct ejobs *jobs;
+
+    // optional: when both are set, the scheduler runs the scene systems after update
+    struct escene *scene;
+    struct ecs_scheduler *scheduler;
+
+    // pump, update and render times, for eframe_stats_percentile
+    // (src/frame_stats.h), the budget is timestep.frame_ns
+    struct eframe_stats *frame_stats;
+
+    // zeroed fields are set to their defaults by engine_run
+    etimestep_config timestep;
+
+    // log calls are formatted and written by a background thread unless set,
+    // useful when the last messages before a crash matter
+    u8 sync_logging;
+
+    // optional: update and the scheduler run on a simulation thread while the
+    // main thread renders the last snapshot extracted from scene, the
+    // allocator is shared by both threads then
+    u8 pipelined;
+    // pipelined: state to render, only valid during render
+    const struct erender_snapshot *snapshot;
+
+    // window buffers: 0 for the default, and what to do when the compositor
+    // holds them all, see src/swapchain.h
+    u32 buffer_count;
+    eswap_policy swap_policy;
+
     u8 (*init)(struct eapp *app);
 
+    // called every timestep.step_ns of simulated time
     u8 (*update)(struct eapp* app);
-    u8 (*render)(struct eapp* app);
+    // alpha: position between the last two updates, to interpolate with
+    u8 (*render)(struct eapp* app, f32 alpha);
 } eapp;
 
 #endif // APP_H
@@ -0,0 +1,51 @@
+#define ELOG_MODULE MEMORY
+
+#include "arena.h"
+
+#include "assert.h"
+#include "memory.h"
+
+u8 earena_create(u64 size, earena *arena) {
+    EASSERT(arena != 0);
+    void *memory = ealloc(size);
+    if(!memory) {
+        return false;
+    }
+    earena_init(memory, size, arena);
+    arena->owned = true;
+    return true;
+}
+
+void earena_init(void *memory, u64 size, earena *arena) {
+    EASSERT(memory != 0);
+    arena->memory = memory;
+    arena->size = size;
+    arena->used = 0;
+    arena->owned = false;
+}
+
+void earena_destroy(earena *arena) {
+    if(arena->owned) {
+        efree(arena->memory);
+    }
+    *arena = (earena){0};
+}
+
+void *earena_alloc(earena *arena, u64 size, u64 align) {
+    // align should be a power of 2
+    EASSERT_DBG((align & (align - 1)) == 0);
+    u64 used = __atomic_load_n(&arena->used, __ATOMIC_RELAXED);
+    u64 start;
+    do {
+        start = ((u64)arena->memory + used + align - 1) & ~(align - 1);
+        start -= (u64)arena->memory;
+        if(start + size > arena->size) {
+            return 0;
+        }
+    } while(!__atomic_compare_exchange_n(&arena->used, &used, start + size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return arena->memory + start;
+}
+
+void earena_reset(earena *arena) {
+    __atomic_store_n(&arena->used, 0, __ATOMIC_RELAXED);
+}
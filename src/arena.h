@@ -0,0 +1,23 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "defines.h"
+
+// bump allocator, reset as a whole (typically once per frame)
+// allocations are lock-free and can be made from any thread
+typedef struct earena {
+    u8 *memory;
+    u64 size;
+    u64 used;
+    // memory was allocated by earena_create
+    u8 owned;
+} earena;
+
+EAPI u8 earena_create(u64 size, earena *arena);
+EAPI void earena_init(void *memory, u64 size, earena *arena);
+EAPI void earena_destroy(earena *arena);
+// returns 0 when the arena is full
+EAPI void *earena_alloc(earena *arena, u64 size, u64 align);
+EAPI void earena_reset(earena *arena);
+
+#endif // ARENA_H
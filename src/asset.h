@@ -9,8 +9,20 @@ typedef enum easset_type {
     ASSET_TEXTURE = 2,
 } easset_type;
 
+// native backend: what asset_get_data returns for images and textures alike,
+// loaded from binary PPM (P6) or PAM (P7) files
+typedef struct eimage {
+    u32 width;
+    u32 height;
+    // premultiplied 0xAARRGGBB, row after row
+    u32 *pixels;
+    // no translucent pixel, blits are plain copies
+    u8 opaque;
+} eimage;
+
 EAPI u32 asset_register(const char *path, easset_type type);
 EAPI void asset_load(u32 id);
+EAPI void asset_unload(u32 id);
 void *asset_get_data(u32 id);
  
 #endif // ASSET_H
@@ -0,0 +1,431 @@
+#include "bvh.h"
+
+#include "assert.h"
+#include "memory.h"
+
+static u32 alloc_node(ebvh *tree);
+static void free_node(ebvh *tree, u32 node);
+static void insert_leaf(ebvh *tree, u32 leaf);
+static void remove_leaf(ebvh *tree, u32 leaf);
+static u32 balance(ebvh *tree, u32 node);
+static void refit_up(ebvh *tree, u32 node);
+static u8 validate_node(ebvh *tree, u32 node);
+
+static inline collision_box box_union(collision_box a, collision_box b) {
+    return (collision_box){
+        .x1 = a.x1 < b.x1 ? a.x1 : b.x1,
+        .x2 = a.x2 > b.x2 ? a.x2 : b.x2,
+        .y1 = a.y1 < b.y1 ? a.y1 : b.y1,
+        .y2 = a.y2 > b.y2 ? a.y2 : b.y2,
+    };
+}
+
+static inline i64 box_perimeter(collision_box a) {
+    return 2 * ((i64)(a.x2 - a.x1) + (a.y2 - a.y1));
+}
+
+static inline u8 box_contains(collision_box outer, collision_box inner) {
+    return outer.x1 <= inner.x1 && outer.y1 <= inner.y1 && inner.x2 <= outer.x2 && inner.y2 <= outer.y2;
+}
+
+static inline u8 box_overlap(collision_box a, collision_box b) {
+    return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+static inline i32 max_i32(i32 a, i32 b) {
+    return a > b ? a : b;
+}
+
+u8 ebvh_create(u32 capacity, i32 margin, ebvh *tree) {
+    EASSERT(tree != 0);
+    EASSERT(capacity > 0);
+    *tree = (ebvh){0};
+    tree->root = EBVH_NIL;
+    tree->margin = margin;
+    // a tree of n leaves has 2n - 1 nodes
+    tree->capacity = capacity * 2;
+    tree->nodes = ealloc(tree->capacity * sizeof(ebvh_node));
+    if(!tree->nodes) {
+        EERROR("couldn't allocate bvh");
+        return false;
+    }
+    for(u32 i = 0; i < tree->capacity; ++i) {
+        tree->nodes[i].next_free = i + 1 < tree->capacity ? i + 1 : EBVH_NIL;
+        tree->nodes[i].height = -1;
+    }
+    tree->free_node = 0;
+    return true;
+}
+
+void ebvh_destroy(ebvh *tree) {
+    efree(tree->nodes);
+    *tree = (ebvh){0};
+}
+
+u32 ebvh_insert(ebvh *tree, collision_box bounds, u32 user) {
+    u32 proxy = alloc_node(tree);
+    ebvh_node *node = &tree->nodes[proxy];
+    node->bounds = (collision_box){
+        .x1 = bounds.x1 - tree->margin, .x2 = bounds.x2 + tree->margin,
+        .y1 = bounds.y1 - tree->margin, .y2 = bounds.y2 + tree->margin,
+    };
+    node->tight = bounds;
+    node->user = user;
+    node->height = 0;
+    insert_leaf(tree, proxy);
+    return proxy;
+}
+
+void ebvh_remove(ebvh *tree, u32 proxy) {
+    EASSERT(proxy < tree->capacity);
+    EASSERT(tree->nodes[proxy].height == 0);
+    remove_leaf(tree, proxy);
+    free_node(tree, proxy);
+}
+
+u8 ebvh_move(ebvh *tree, u32 proxy, collision_box bounds) {
+    EASSERT(proxy < tree->capacity);
+    EASSERT(tree->nodes[proxy].height == 0);
+
+    tree->nodes[proxy].tight = bounds;
+    if(box_contains(tree->nodes[proxy].bounds, bounds)) {
+        // still inside the fat bounds
+        return false;
+    }
+
+    remove_leaf(tree, proxy);
+    tree->nodes[proxy].bounds = (collision_box){
+        .x1 = bounds.x1 - tree->margin, .x2 = bounds.x2 + tree->margin,
+        .y1 = bounds.y1 - tree->margin, .y2 = bounds.y2 + tree->margin,
+    };
+    insert_leaf(tree, proxy);
+    return true;
+}
+
+u32 ebvh_query(ebvh *tree, collision_box region, u32 *users, u32 capacity) {
+    u32 count = 0;
+    tree->visited = 0;
+    if(tree->root == EBVH_NIL) {
+        return 0;
+    }
+
+    u32 stack[EBVH_STACK_SIZE];
+    u32 top = 0;
+    stack[top++] = tree->root;
+    while(top > 0) {
+        ebvh_node *node = &tree->nodes[stack[--top]];
+        ++tree->visited;
+        if(!box_overlap(node->bounds, region)) {
+            continue;
+        }
+        if(node->height == 0) {
+            if(!box_overlap(node->tight, region)) {
+                continue;
+            }
+            if(count < capacity) {
+                users[count] = node->user;
+            }
+            ++count;
+        } else {
+            EASSERT_DBG(top + 2 <= EBVH_STACK_SIZE);
+            stack[top++] = node->child1;
+            stack[top++] = node->child2;
+        }
+    }
+    return count;
+}
+
+u32 ebvh_query_point(ebvh *tree, i32 x, i32 y, u32 *users, u32 capacity) {
+    collision_box point = { .x1 = x, .x2 = x + 1, .y1 = y, .y2 = y + 1 };
+    return ebvh_query(tree, point, users, capacity);
+}
+
+// slab test, returns the entry t or -1
+static f32 ray_box(collision_box box, f32 ox, f32 oy, f32 inv_dx, f32 inv_dy, f32 max_t) {
+    f32 tx1 = (box.x1 - ox) * inv_dx, tx2 = (box.x2 - ox) * inv_dx;
+    f32 ty1 = (box.y1 - oy) * inv_dy, ty2 = (box.y2 - oy) * inv_dy;
+    f32 tmin = tx1 < tx2 ? tx1 : tx2, tmax = tx1 < tx2 ? tx2 : tx1;
+    f32 tymin = ty1 < ty2 ? ty1 : ty2, tymax = ty1 < ty2 ? ty2 : ty1;
+    tmin = tmin > tymin ? tmin : tymin;
+    tmax = tmax < tymax ? tmax : tymax;
+    if(tmin < 0.0f) {
+        tmin = 0.0f;
+    }
+    if(tmin > tmax || tmin > max_t) {
+        return -1.0f;
+    }
+    return tmin;
+}
+
+u8 ebvh_raycast(ebvh *tree, f32 ox, f32 oy, f32 dx, f32 dy, f32 max_t, u32 *user, f32 *t) {
+    tree->visited = 0;
+    if(tree->root == EBVH_NIL) {
+        return false;
+    }
+
+    // divisions by 0 give infinities, which the slab test handles
+    f32 inv_dx = 1.0f / dx, inv_dy = 1.0f / dy;
+    f32 best = max_t;
+    u8 hit = false;
+
+    u32 stack[EBVH_STACK_SIZE];
+    u32 top = 0;
+    stack[top++] = tree->root;
+    while(top > 0) {
+        ebvh_node *node = &tree->nodes[stack[--top]];
+        ++tree->visited;
+        // prune with the closest hit so far
+        f32 node_t = ray_box(node->bounds, ox, oy, inv_dx, inv_dy, best);
+        if(node_t < 0.0f) {
+            continue;
+        }
+        if(node->height == 0) {
+            node_t = ray_box(node->tight, ox, oy, inv_dx, inv_dy, best);
+            if(node_t < 0.0f) {
+                continue;
+            }
+            best = node_t;
+            *user = node->user;
+            hit = true;
+        } else {
+            EASSERT_DBG(top + 2 <= EBVH_STACK_SIZE);
+            // visit the closest child first
+            f32 t1 = ray_box(tree->nodes[node->child1].bounds, ox, oy, inv_dx, inv_dy, best);
+            f32 t2 = ray_box(tree->nodes[node->child2].bounds, ox, oy, inv_dx, inv_dy, best);
+            u32 near = t1 <= t2 ? node->child1 : node->child2;
+            u32 far = t1 <= t2 ? node->child2 : node->child1;
+            f32 far_t = t1 <= t2 ? t2 : t1;
+            f32 near_t = t1 <= t2 ? t1 : t2;
+            if(far_t >= 0.0f) {
+                stack[top++] = far;
+            }
+            if(near_t >= 0.0f) {
+                stack[top++] = near;
+            }
+        }
+    }
+    if(hit) {
+        *t = best;
+    }
+    return hit;
+}
+
+i32 ebvh_height(ebvh *tree) {
+    return tree->root == EBVH_NIL ? 0 : tree->nodes[tree->root].height;
+}
+
+u8 ebvh_validate(ebvh *tree) {
+    if(tree->root == EBVH_NIL) {
+        return true;
+    }
+    if(tree->nodes[tree->root].parent != EBVH_NIL) {
+        return false;
+    }
+    return validate_node(tree, tree->root);
+}
+
+static u8 validate_node(ebvh *tree, u32 index) {
+    ebvh_node *node = &tree->nodes[index];
+    if(node->height == 0) {
+        return true;
+    }
+    ebvh_node *child1 = &tree->nodes[node->child1];
+    ebvh_node *child2 = &tree->nodes[node->child2];
+    if(child1->parent != index || child2->parent != index) {
+        return false;
+    }
+    if(node->height != 1 + max_i32(child1->height, child2->height)) {
+        return false;
+    }
+    collision_box bounds = box_union(child1->bounds, child2->bounds);
+    if(bounds.x1 != node->bounds.x1 || bounds.x2 != node->bounds.x2 || bounds.y1 != node->bounds.y1 || bounds.y2 != node->bounds.y2) {
+        return false;
+    }
+    return validate_node(tree, node->child1) && validate_node(tree, node->child2);
+}
+
+static u32 alloc_node(ebvh *tree) {
+    if(tree->free_node == EBVH_NIL) {
+        u32 old_capacity = tree->capacity;
+        tree->capacity *= 2;
+        tree->nodes = erealloc(tree->nodes, tree->capacity * sizeof(ebvh_node));
+        EASSERT_MSG(tree->nodes != 0, "couldn't grow bvh");
+        for(u32 i = old_capacity; i < tree->capacity; ++i) {
+            tree->nodes[i].next_free = i + 1 < tree->capacity ? i + 1 : EBVH_NIL;
+            tree->nodes[i].height = -1;
+        }
+        tree->free_node = old_capacity;
+    }
+    u32 index = tree->free_node;
+    ebvh_node *node = &tree->nodes[index];
+    tree->free_node = node->next_free;
+    node->parent = EBVH_NIL;
+    node->child1 = EBVH_NIL;
+    node->child2 = EBVH_NIL;
+    node->height = 0;
+    node->user = 0;
+    ++tree->count;
+    return index;
+}
+
+static void free_node(ebvh *tree, u32 index) {
+    tree->nodes[index].next_free = tree->free_node;
+    tree->nodes[index].height = -1;
+    tree->free_node = index;
+    --tree->count;
+}
+
+static void insert_leaf(ebvh *tree, u32 leaf) {
+    if(tree->root == EBVH_NIL) {
+        tree->root = leaf;
+        tree->nodes[leaf].parent = EBVH_NIL;
+        return;
+    }
+
+    // descend towards the sibling that grows the tree surface the least
+    collision_box leaf_bounds = tree->nodes[leaf].bounds;
+    u32 index = tree->root;
+    while(tree->nodes[index].height > 0) {
+        ebvh_node *node = &tree->nodes[index];
+        i64 area = box_perimeter(node->bounds);
+        i64 combined = box_perimeter(box_union(node->bounds, leaf_bounds));
+        // cost of making a new parent for this node and the leaf
+        i64 cost = 2 * combined;
+        // minimum cost of pushing the leaf further down
+        i64 inheritance = 2 * (combined - area);
+
+        i64 costs[2];
+        u32 children[2] = { node->child1, node->child2 };
+        for(u32 c = 0; c < 2; ++c) {
+            ebvh_node *child = &tree->nodes[children[c]];
+            i64 grown = box_perimeter(box_union(child->bounds, leaf_bounds));
+            costs[c] = child->height == 0 ? grown + inheritance : grown - box_perimeter(child->bounds) + inheritance;
+        }
+
+        if(cost < costs[0] && cost < costs[1]) {
+            break;
+        }
+        index = costs[0] < costs[1] ? children[0] : children[1];
+    }
+
+    u32 sibling = index;
+    u32 old_parent = tree->nodes[sibling].parent;
+    u32 new_parent = alloc_node(tree);
+    ebvh_node *parent = &tree->nodes[new_parent];
+    parent->parent = old_parent;
+    parent->bounds = box_union(leaf_bounds, tree->nodes[sibling].bounds);
+    parent->height = tree->nodes[sibling].height + 1;
+    parent->child1 = sibling;
+    parent->child2 = leaf;
+    tree->nodes[sibling].parent = new_parent;
+    tree->nodes[leaf].parent = new_parent;
+
+    if(old_parent == EBVH_NIL) {
+        tree->root = new_parent;
+    } else if(tree->nodes[old_parent].child1 == sibling) {
+        tree->nodes[old_parent].child1 = new_parent;
+    } else {
+        tree->nodes[old_parent].child2 = new_parent;
+    }
+
+    refit_up(tree, tree->nodes[leaf].parent);
+}
+
+static void remove_leaf(ebvh *tree, u32 leaf) {
+    if(leaf == tree->root) {
+        tree->root = EBVH_NIL;
+        return;
+    }
+
+    u32 parent = tree->nodes[leaf].parent;
+    u32 grand_parent = tree->nodes[parent].parent;
+    u32 sibling = tree->nodes[parent].child1 == leaf ? tree->nodes[parent].child2 : tree->nodes[parent].child1;
+
+    if(grand_parent == EBVH_NIL) {
+        tree->root = sibling;
+        tree->nodes[sibling].parent = EBVH_NIL;
+        free_node(tree, parent);
+        return;
+    }
+
+    // the sibling takes the place of the parent
+    if(tree->nodes[grand_parent].child1 == parent) {
+        tree->nodes[grand_parent].child1 = sibling;
+    } else {
+        tree->nodes[grand_parent].child2 = sibling;
+    }
+    tree->nodes[sibling].parent = grand_parent;
+    free_node(tree, parent);
+
+    refit_up(tree, grand_parent);
+}
+
+// walks up to the root, fixing bounds and heights and rotating unbalanced nodes
+static void refit_up(ebvh *tree, u32 index) {
+    while(index != EBVH_NIL) {
+        index = balance(tree, index);
+        ebvh_node *node = &tree->nodes[index];
+        ebvh_node *child1 = &tree->nodes[node->child1];
+        ebvh_node *child2 = &tree->nodes[node->child2];
+        node->height = 1 + max_i32(child1->height, child2->height);
+        node->bounds = box_union(child1->bounds, child2->bounds);
+        index = node->parent;
+    }
+}
+
+// if a is unbalanced, promotes its higher child and returns the new subtree root
+static u32 balance(ebvh *tree, u32 ia) {
+    ebvh_node *a = &tree->nodes[ia];
+    if(a->height < 2) {
+        return ia;
+    }
+
+    u32 ib = a->child1;
+    u32 ic = a->child2;
+    ebvh_node *b = &tree->nodes[ib];
+    ebvh_node *c = &tree->nodes[ic];
+    i32 diff = c->height - b->height;
+    if(diff >= -1 && diff <= 1) {
+        return ia;
+    }
+
+    // rotate the higher child (hi) up, lo stays under a
+    u32 ihi = diff > 1 ? ic : ib;
+    u32 ilo = diff > 1 ? ib : ic;
+    ebvh_node *hi = &tree->nodes[ihi];
+    ebvh_node *lo = &tree->nodes[ilo];
+    u32 if_ = hi->child1;
+    u32 ig = hi->child2;
+    ebvh_node *f = &tree->nodes[if_];
+    ebvh_node *g = &tree->nodes[ig];
+
+    // hi replaces a
+    hi->child1 = ia;
+    hi->parent = a->parent;
+    a->parent = ihi;
+    if(hi->parent == EBVH_NIL) {
+        tree->root = ihi;
+    } else if(tree->nodes[hi->parent].child1 == ia) {
+        tree->nodes[hi->parent].child1 = ihi;
+    } else {
+        tree->nodes[hi->parent].child2 = ihi;
+    }
+
+    // the higher grand child stays under hi, the other one goes under a
+    u32 ikeep = f->height > g->height ? if_ : ig;
+    u32 imove = f->height > g->height ? ig : if_;
+    hi->child2 = ikeep;
+    if(diff > 1) {
+        a->child2 = imove;
+    } else {
+        a->child1 = imove;
+    }
+    tree->nodes[imove].parent = ia;
+
+    a->bounds = box_union(lo->bounds, tree->nodes[imove].bounds);
+    a->height = 1 + max_i32(lo->height, tree->nodes[imove].height);
+    hi->bounds = box_union(a->bounds, tree->nodes[ikeep].bounds);
+    hi->height = 1 + max_i32(a->height, tree->nodes[ikeep].height);
+
+    return ihi;
+}
@@ -0,0 +1,60 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "defines.h"
+#include "scene.h"
+
+// Dynamic AABB tree. Leaves store fattened bounds so that small moves
+// don't touch the tree, and the tree is kept balanced with rotations.
+
+#define EBVH_NIL 0xFFFFFFFF
+#define EBVH_STACK_SIZE 256
+
+typedef struct ebvh_node {
+    // fattened for leaves
+    collision_box bounds;
+    // leaves only: exact bounds, tested by queries
+    collision_box tight;
+    union {
+        u32 parent;
+        u32 next_free;
+    };
+    u32 child1;
+    u32 child2;
+    // leaf = 0, free = -1
+    i32 height;
+    u32 user;
+} ebvh_node;
+
+typedef struct ebvh {
+    ebvh_node *nodes;
+    u32 capacity;
+    u32 count;
+    u32 root;
+    u32 free_node;
+    // added on each side of the leaves bounds
+    i32 margin;
+    // nodes visited by the last query
+    u64 visited;
+} ebvh;
+
+EAPI u8 ebvh_create(u32 capacity, i32 margin, ebvh *tree);
+EAPI void ebvh_destroy(ebvh *tree);
+
+// returns a proxy id, user is given back by queries
+EAPI u32 ebvh_insert(ebvh *tree, collision_box bounds, u32 user);
+EAPI void ebvh_remove(ebvh *tree, u32 proxy);
+// returns true if the proxy had to be reinserted
+EAPI u8 ebvh_move(ebvh *tree, u32 proxy, collision_box bounds);
+
+// queries write up to capacity user values and return the number found
+EAPI u32 ebvh_query(ebvh *tree, collision_box region, u32 *users, u32 capacity);
+EAPI u32 ebvh_query_point(ebvh *tree, i32 x, i32 y, u32 *users, u32 capacity);
+// closest leaf hit by the segment origin + t * direction, t in [0, max_t]
+EAPI u8 ebvh_raycast(ebvh *tree, f32 ox, f32 oy, f32 dx, f32 dy, f32 max_t, u32 *user, f32 *t);
+
+EAPI i32 ebvh_height(ebvh *tree);
+// debug: checks parent links, heights and bounds
+EAPI u8 ebvh_validate(ebvh *tree);
+
+#endif // BVH_H
@@ -0,0 +1,13 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "defines.h"
+
+// monotonic, nanoseconds since an arbitrary point
+EAPI u64 eclock_now_ns();
+EAPI void eclock_sleep_ns(u64 ns);
+// sleeps until spin_ns before the deadline, then yields until it is reached:
+// sleeps alone can overshoot by a scheduler tick
+EAPI void eclock_wait_until_ns(u64 deadline_ns, u64 spin_ns);
+
+#endif // CLOCK_H
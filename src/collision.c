@@ -0,0 +1,286 @@
+#include "collision.h"
+
+#include "assert.h"
+#include "memory.h"
+
+#include <limits.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define ECOLLISION_X86
+    #include <immintrin.h>
+#endif
+
+typedef u32 (*test_range_fn)(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask);
+typedef u32 (*test_indices_fn)(ecollision_store *store, collision_box box, const u32 *indices, u32 count, u64 *mask);
+
+static u32 test_range_scalar(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask);
+static u32 test_indices_scalar(ecollision_store *store, collision_box box, const u32 *indices, u32 count, u64 *mask);
+#ifdef ECOLLISION_X86
+static u32 test_range_sse2(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask);
+static u32 test_range_avx2(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask);
+static u32 test_indices_avx2(ecollision_store *store, collision_box box, const u32 *indices, u32 count, u64 *mask);
+#endif
+
+static struct {
+    ecollision_backend backend;
+    test_range_fn test_range;
+    test_indices_fn test_indices;
+    u8 init;
+} collision_state;
+
+static void init_backend() {
+    if(collision_state.init) {
+        return;
+    }
+    ecollision_backend best = ECOLLISION_BACKEND_SCALAR;
+#ifdef ECOLLISION_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        best = ECOLLISION_BACKEND_AVX2;
+    } else if(__builtin_cpu_supports("sse2")) {
+        best = ECOLLISION_BACKEND_SSE2;
+    }
+#endif
+    collision_state.init = true;
+    ecollision_set_backend(best);
+}
+
+u8 ecollision_store_create(u32 capacity, ecollision_store *store) {
+    EASSERT(store != 0);
+    *store = (ecollision_store){0};
+    store->capacity = (capacity + ECOLLISION_LANES - 1) / ECOLLISION_LANES * ECOLLISION_LANES;
+    u64 size = store->capacity * sizeof(i32);
+    store->x1 = ealloc_align(size, 64);
+    store->x2 = ealloc_align(size, 64);
+    store->y1 = ealloc_align(size, 64);
+    store->y2 = ealloc_align(size, 64);
+    if(!store->x1 || !store->x2 || !store->y1 || !store->y2) {
+        EERROR("couldn't allocate collision store");
+        return false;
+    }
+    ecollision_store_load(store, 0, 0);
+    return true;
+}
+
+void ecollision_store_destroy(ecollision_store *store) {
+    efree(store->x1);
+    efree(store->x2);
+    efree(store->y1);
+    efree(store->y2);
+    *store = (ecollision_store){0};
+}
+
+void ecollision_store_set(ecollision_store *store, u32 index, collision_box box) {
+    EASSERT_DBG(index < store->capacity);
+    store->x1[index] = box.x1;
+    store->x2[index] = box.x2;
+    store->y1[index] = box.y1;
+    store->y2[index] = box.y2;
+    if(index >= store->count) {
+        store->count = index + 1;
+    }
+}
+
+void ecollision_store_load(ecollision_store *store, const collision_box *boxes, u32 count) {
+    EASSERT(count <= store->capacity);
+    for(u32 i = 0; i < count; ++i) {
+        store->x1[i] = boxes[i].x1;
+        store->x2[i] = boxes[i].x2;
+        store->y1[i] = boxes[i].y1;
+        store->y2[i] = boxes[i].y2;
+    }
+    // padding: inverted boxes never overlap anything
+    for(u32 i = count; i < store->capacity; ++i) {
+        store->x1[i] = INT_MAX;
+        store->x2[i] = INT_MIN;
+        store->y1[i] = INT_MAX;
+        store->y2[i] = INT_MIN;
+    }
+    store->count = count;
+}
+
+ecollision_backend ecollision_get_backend() {
+    init_backend();
+    return collision_state.backend;
+}
+
+u8 ecollision_set_backend(ecollision_backend backend) {
+    init_backend();
+    switch(backend) {
+        case ECOLLISION_BACKEND_SCALAR:
+            collision_state.test_range = test_range_scalar;
+            collision_state.test_indices = test_indices_scalar;
+            break;
+#ifdef ECOLLISION_X86
+        case ECOLLISION_BACKEND_SSE2:
+            if(!__builtin_cpu_supports("sse2")) {
+                return false;
+            }
+            collision_state.test_range = test_range_sse2;
+            // no gather before AVX2
+            collision_state.test_indices = test_indices_scalar;
+            break;
+        case ECOLLISION_BACKEND_AVX2:
+            if(!__builtin_cpu_supports("avx2")) {
+                return false;
+            }
+            collision_state.test_range = test_range_avx2;
+            collision_state.test_indices = test_indices_avx2;
+            break;
+#endif
+        default:
+            return false;
+    }
+    collision_state.backend = backend;
+    return true;
+}
+
+u32 ecollision_test_range(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask) {
+    EASSERT_DBG((first & 63) == 0);
+    EASSERT_DBG(first + count <= store->capacity);
+    init_backend();
+    return collision_state.test_range(store, box, first, count, mask);
+}
+
+u32 ecollision_test_indices(ecollision_store *store, collision_box box, const u32 *indices, u32 count, u64 *mask) {
+    init_backend();
+    return collision_state.test_indices(store, box, indices, count, mask);
+}
+
+// clears the bits past count in the last word and counts the hits
+static u32 finish_mask(u64 *mask, u32 count) {
+    u32 words = (count + 63) / 64;
+    if(count & 63) {
+        mask[words - 1] &= (1ull << (count & 63)) - 1;
+    }
+    u32 hits = 0;
+    for(u32 w = 0; w < words; ++w) {
+        hits += __builtin_popcountll(mask[w]);
+    }
+    return hits;
+}
+
+static u32 test_range_scalar(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask) {
+    u32 words = (count + 63) / 64;
+    for(u32 w = 0; w < words; ++w) {
+        mask[w] = 0;
+    }
+    for(u32 i = 0; i < count; ++i) {
+        u32 b = first + i;
+        u64 hit = box.x1 < store->x2[b] && store->x1[b] < box.x2 && box.y1 < store->y2[b] && store->y1[b] < box.y2;
+        mask[i >> 6] |= hit << (i & 63);
+    }
+    return finish_mask(mask, count);
+}
+
+static u32 test_indices_scalar(ecollision_store *store, collision_box box, const u32 *indices, u32 count, u64 *mask) {
+    u32 words = (count + 63) / 64;
+    for(u32 w = 0; w < words; ++w) {
+        mask[w] = 0;
+    }
+    for(u32 i = 0; i < count; ++i) {
+        u32 b = indices[i];
+        u64 hit = box.x1 < store->x2[b] && store->x1[b] < box.x2 && box.y1 < store->y2[b] && store->y1[b] < box.y2;
+        mask[i >> 6] |= hit << (i & 63);
+    }
+    return finish_mask(mask, count);
+}
+
+#ifdef ECOLLISION_X86
+
+// 8 boxes per iteration, 2 x 4 lanes
+static u32 test_range_sse2(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask) {
+    const __m128i bx1 = _mm_set1_epi32(box.x1);
+    const __m128i bx2 = _mm_set1_epi32(box.x2);
+    const __m128i by1 = _mm_set1_epi32(box.y1);
+    const __m128i by2 = _mm_set1_epi32(box.y2);
+
+    u32 words = (count + 63) / 64;
+    for(u32 w = 0; w < words; ++w) {
+        u64 bits = 0;
+        // padding makes reading up to the next multiple of 16 safe
+        u32 end = count - w * 64 < 64 ? count - w * 64 : 64;
+        for(u32 i = 0; i < end; i += 8) {
+            u32 b = first + w * 64 + i;
+            __m128i lo = _mm_and_si128(
+                _mm_and_si128(_mm_cmpgt_epi32(_mm_load_si128((__m128i *)(store->x2 + b)), bx1),
+                              _mm_cmplt_epi32(_mm_load_si128((__m128i *)(store->x1 + b)), bx2)),
+                _mm_and_si128(_mm_cmpgt_epi32(_mm_load_si128((__m128i *)(store->y2 + b)), by1),
+                              _mm_cmplt_epi32(_mm_load_si128((__m128i *)(store->y1 + b)), by2)));
+            __m128i hi = _mm_and_si128(
+                _mm_and_si128(_mm_cmpgt_epi32(_mm_load_si128((__m128i *)(store->x2 + b + 4)), bx1),
+                              _mm_cmplt_epi32(_mm_load_si128((__m128i *)(store->x1 + b + 4)), bx2)),
+                _mm_and_si128(_mm_cmpgt_epi32(_mm_load_si128((__m128i *)(store->y2 + b + 4)), by1),
+                              _mm_cmplt_epi32(_mm_load_si128((__m128i *)(store->y1 + b + 4)), by2)));
+            u64 m = _mm_movemask_ps(_mm_castsi128_ps(lo)) | (_mm_movemask_ps(_mm_castsi128_ps(hi)) << 4);
+            bits |= m << i;
+        }
+        mask[w] = bits;
+    }
+    return finish_mask(mask, count);
+}
+
+// 16 boxes per iteration, 2 x 8 lanes
+__attribute__((target("avx2")))
+static u32 test_range_avx2(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask) {
+    const __m256i bx1 = _mm256_set1_epi32(box.x1);
+    const __m256i bx2 = _mm256_set1_epi32(box.x2);
+    const __m256i by1 = _mm256_set1_epi32(box.y1);
+    const __m256i by2 = _mm256_set1_epi32(box.y2);
+
+    u32 words = (count + 63) / 64;
+    for(u32 w = 0; w < words; ++w) {
+        u64 bits = 0;
+        u32 end = count - w * 64 < 64 ? count - w * 64 : 64;
+        for(u32 i = 0; i < end; i += 16) {
+            u32 b = first + w * 64 + i;
+            __m256i lo = _mm256_and_si256(
+                _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_load_si256((__m256i *)(store->x2 + b)), bx1),
+                                 _mm256_cmpgt_epi32(bx2, _mm256_load_si256((__m256i *)(store->x1 + b)))),
+                _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_load_si256((__m256i *)(store->y2 + b)), by1),
+                                 _mm256_cmpgt_epi32(by2, _mm256_load_si256((__m256i *)(store->y1 + b)))));
+            __m256i hi = _mm256_and_si256(
+                _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_load_si256((__m256i *)(store->x2 + b + 8)), bx1),
+                                 _mm256_cmpgt_epi32(bx2, _mm256_load_si256((__m256i *)(store->x1 + b + 8)))),
+                _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_load_si256((__m256i *)(store->y2 + b + 8)), by1),
+                                 _mm256_cmpgt_epi32(by2, _mm256_load_si256((__m256i *)(store->y1 + b + 8)))));
+            u64 m = (u32)_mm256_movemask_ps(_mm256_castsi256_ps(lo)) | ((u32)_mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8);
+            bits |= m << i;
+        }
+        mask[w] = bits;
+    }
+    return finish_mask(mask, count);
+}
+
+// gathers 8 candidates per iteration
+__attribute__((target("avx2")))
+static u32 test_indices_avx2(ecollision_store *store, collision_box box, const u32 *indices, u32 count, u64 *mask) {
+    const __m256i bx1 = _mm256_set1_epi32(box.x1);
+    const __m256i bx2 = _mm256_set1_epi32(box.x2);
+    const __m256i by1 = _mm256_set1_epi32(box.y1);
+    const __m256i by2 = _mm256_set1_epi32(box.y2);
+
+    u32 words = (count + 63) / 64;
+    for(u32 w = 0; w < words; ++w) {
+        mask[w] = 0;
+    }
+    u32 i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i idx = _mm256_loadu_si256((__m256i *)(indices + i));
+        __m256i hit = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_i32gather_epi32(store->x2, idx, 4), bx1),
+                             _mm256_cmpgt_epi32(bx2, _mm256_i32gather_epi32(store->x1, idx, 4))),
+            _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_i32gather_epi32(store->y2, idx, 4), by1),
+                             _mm256_cmpgt_epi32(by2, _mm256_i32gather_epi32(store->y1, idx, 4))));
+        u64 m = (u32)_mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        mask[i >> 6] |= m << (i & 63);
+    }
+    for(; i < count; ++i) {
+        u32 b = indices[i];
+        u64 hit = box.x1 < store->x2[b] && store->x1[b] < box.x2 && box.y1 < store->y2[b] && store->y1[b] < box.y2;
+        mask[i >> 6] |= hit << (i & 63);
+    }
+    return finish_mask(mask, count);
+}
+
+#endif // ECOLLISION_X86
@@ -0,0 +1,47 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "defines.h"
+#include "scene.h"
+
+// Narrowphase: collision boxes stored as structure of arrays so that one
+// box can be tested against 8 (SSE2) or 16 (AVX2) boxes per loop iteration.
+// Results are bit masks, bit i of word i / 64 set when box i overlaps.
+
+// arrays are padded to this many boxes with boxes that never overlap
+#define ECOLLISION_LANES 16
+
+typedef enum ecollision_backend {
+    ECOLLISION_BACKEND_SCALAR = 0,
+    ECOLLISION_BACKEND_SSE2   = 1,
+    ECOLLISION_BACKEND_AVX2   = 2,
+} ecollision_backend;
+
+typedef struct ecollision_store {
+    // 64 bytes aligned
+    i32 *x1;
+    i32 *x2;
+    i32 *y1;
+    i32 *y2;
+    u32 count;
+    u32 capacity;
+} ecollision_store;
+
+EAPI u8 ecollision_store_create(u32 capacity, ecollision_store *store);
+EAPI void ecollision_store_destroy(ecollision_store *store);
+EAPI void ecollision_store_set(ecollision_store *store, u32 index, collision_box box);
+// replaces the content of the store (AoS to SoA)
+EAPI void ecollision_store_load(ecollision_store *store, const collision_box *boxes, u32 count);
+
+// best backend supported by the CPU is picked by default
+EAPI ecollision_backend ecollision_get_backend();
+// returns false if the CPU doesn't support it
+EAPI u8 ecollision_set_backend(ecollision_backend backend);
+
+// tests box against boxes [first, first + count), first must be a multiple of 64
+// mask must hold (count + 63) / 64 words, returns the number of overlaps
+EAPI u32 ecollision_test_range(ecollision_store *store, collision_box box, u32 first, u32 count, u64 *mask);
+// tests box against the listed boxes (e.g. broadphase candidates), bit i is for indices[i]
+EAPI u32 ecollision_test_indices(ecollision_store *store, collision_box box, const u32 *indices, u32 count, u64 *mask);
+
+#endif // COLLISION_H
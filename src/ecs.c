@@ -0,0 +1,251 @@
+#define ELOG_MODULE ECS
+
+#include "scene.h"
+
+#include "assert.h"
+#include "memory.h"
+
+#include <string.h>
+
+
+static void grow_array(void **array, u32 element_size, u32 old_count, u32 new_count);
+
+void scene_add_entity(escene *scene, u32 entity) {
+    // ids reserved by command buffers can be past the capacity
+    if(entity >= scene->entity_capacity) {
+        ecs_scene_reserve(scene, entity + 1);
+    }
+    if(!scene->entities[entity]) {
+        ++scene->entity_count;
+    }
+    scene->entities[entity] = 1;
+}
+
+void ecs_scene_reserve(escene *scene, u32 entity_count) {
+    if(entity_count <= scene->entity_capacity) {
+        return;
+    }
+    u32 old_capacity = scene->entity_capacity;
+    u32 capacity = old_capacity ? old_capacity : ECS_INITIAL_ENTITIES;
+    while(capacity < entity_count) {
+        capacity *= 2;
+    }
+
+    grow_array((void **)&scene->entities, sizeof(u32), old_capacity, capacity);
+    grow_array((void **)&scene->query_buffer, sizeof(u32), old_capacity, capacity);
+    grow_array((void **)&scene->bvh_proxies, sizeof(u32), old_capacity, capacity);
+
+    for(u32 i = 0; i < ECS_MAX_COMPONENTS; ++i) {
+        ecs_component_pool *pool = &scene->components[i];
+        if(!pool->data) {
+            continue;
+        }
+        u64 old_size = (u64)old_capacity * pool->stride;
+        u64 size = ((u64)capacity * pool->stride + ECS_PAGE_SIZE - 1) & ~(u64)(ECS_PAGE_SIZE - 1);
+        void *data = ealloc_align(size, ECS_POOL_ALIGN);
+        EASSERT_MSG(data != 0, "couldn't grow component pool");
+        ememcpy(data, pool->data, old_size);
+        // zeroing also prefaults the new pages, systems don't take the page faults
+        memset((char *)data + old_size, 0, size - old_size);
+        efree(pool->data);
+        pool->data = data;
+
+        grow_array((void **)&pool->mask, sizeof(u64), old_capacity / 64, capacity / 64);
+        grow_array((void **)&pool->ticks.added, sizeof(u32), old_capacity, capacity);
+        grow_array((void **)&pool->ticks.changed, sizeof(u32), old_capacity, capacity);
+        grow_array((void **)&pool->ticks.chunk_added, sizeof(u32), old_capacity / 64, capacity / 64);
+        grow_array((void **)&pool->ticks.chunk_changed, sizeof(u32), old_capacity / 64, capacity / 64);
+    }
+
+    scene->entity_capacity = capacity;
+}
+
+void ecs_scene_release(escene *scene) {
+    for(u32 i = 0; i < ECS_MAX_COMPONENTS; ++i) {
+        ecs_component_destroy(scene, i);
+    }
+    efree(scene->entities);
+    efree(scene->query_buffer);
+    efree(scene->bvh_proxies);
+    scene->entities = 0;
+    scene->query_buffer = 0;
+    scene->bvh_proxies = 0;
+    scene->entity_capacity = 0;
+    scene->entity_count = 0;
+    scene->curr_entity_id = 0;
+}
+
+u32 ecs_entity_create(escene *scene, u64 components_mask) {
+    u32 id = scene->curr_entity_id++;
+    if(id >= scene->entity_capacity) {
+        ecs_scene_reserve(scene, id + 1);
+    }
+    // TODO: add right components
+    return id;
+}
+
+void ecs_entity_destroy(escene *scene, u32 entity) {
+    EASSERT_DBG(entity < scene->entity_capacity);
+    // TODO: recycle ids
+    for(u32 i = 0; i < ECS_MAX_COMPONENTS; ++i) {
+        if(scene->components[i].mask) {
+            scene->components[i].mask[entity >> 6] &= ~(1ull << (entity & 63));
+        }
+    }
+    if(scene->entities[entity]) {
+        scene->entities[entity] = 0;
+        --scene->entity_count;
+    }
+}
+
+void ecs_component_create(escene *scene, u32 component, u32 size, u32 align) {
+    EASSERT(component < ECS_MAX_COMPONENTS);
+    EASSERT_MSG(align && (align & (align - 1)) == 0 && align <= ECS_POOL_ALIGN, "invalid component alignment %u", align);
+    ecs_component_pool *pool = &scene->components[component];
+    EASSERT_MSG(pool->data == 0, "component %u already exists", component);
+
+    if(!scene->entity_capacity) {
+        ecs_scene_reserve(scene, ECS_INITIAL_ENTITIES);
+    }
+    pool->size = size;
+    pool->stride = (size + align - 1) & ~(align - 1);
+
+    u32 capacity = scene->entity_capacity;
+    u64 bytes = ((u64)capacity * pool->stride + ECS_PAGE_SIZE - 1) & ~(u64)(ECS_PAGE_SIZE - 1);
+    pool->data = ealloc_align(bytes, ECS_POOL_ALIGN);
+    EASSERT_MSG(pool->data != 0, "couldn't allocate component pool");
+    memset(pool->data, 0, bytes);
+
+    grow_array((void **)&pool->mask, sizeof(u64), 0, capacity / 64);
+    grow_array((void **)&pool->ticks.added, sizeof(u32), 0, capacity);
+    grow_array((void **)&pool->ticks.changed, sizeof(u32), 0, capacity);
+    grow_array((void **)&pool->ticks.chunk_added, sizeof(u32), 0, capacity / 64);
+    grow_array((void **)&pool->ticks.chunk_changed, sizeof(u32), 0, capacity / 64);
+}
+
+void ecs_component_destroy(escene *scene, u32 component) {
+    ecs_component_pool *pool = &scene->components[component];
+    if(!pool->data) {
+        return;
+    }
+    efree(pool->data);
+    efree(pool->mask);
+    efree(pool->ticks.added);
+    efree(pool->ticks.changed);
+    efree(pool->ticks.chunk_added);
+    efree(pool->ticks.chunk_changed);
+    *pool = (ecs_component_pool){0};
+}
+
+void *ecs_component_data(escene *scene, u32 component, u32 *stride) {
+    ecs_component_pool *pool = &scene->components[component];
+    if(stride) {
+        *stride = pool->stride;
+    }
+    return pool->data;
+}
+
+void ecs_entity_add_component(escene *scene, u32 entity, u32 component) {
+    ecs_component_pool *pool = &scene->components[component];
+    EASSERT_DBG(entity < scene->entity_capacity);
+    EASSERT_MSG(pool->data != 0, "component %u doesn't exist", component);
+    pool->mask[entity >> 6] |= 1ull << (entity & 63);
+    ecs_stamp(pool->ticks.added, pool->ticks.chunk_added, entity, __atomic_load_n(&scene->tick, __ATOMIC_RELAXED));
+    ecs_stamp(pool->ticks.changed, pool->ticks.chunk_changed, entity, __atomic_load_n(&scene->tick, __ATOMIC_RELAXED));
+}
+
+void ecs_entity_remove_component(escene *scene, u32 entity, u32 component) {
+    EASSERT_DBG(entity < scene->entity_capacity);
+    if(scene->components[component].mask) {
+        scene->components[component].mask[entity >> 6] &= ~(1ull << (entity & 63));
+    }
+}
+
+u8 ecs_entity_has_component(escene *scene, u32 entity, u32 component) {
+    u64 *mask = scene->components[component].mask;
+    return entity < scene->entity_capacity && mask && ((mask[entity >> 6] >> (entity & 63)) & 1);
+}
+
+void *ecs_get_component_of(escene *scene, u32 entity, u32 component, u32 component_size) {
+    ecs_component_pool *pool = &scene->components[component];
+    EASSERT_DBG(component_size == pool->size);
+    return (char *)pool->data + (u64)entity * pool->stride;
+}
+
+void *ecs_get_component_mut(escene *scene, u32 entity, u32 component, u32 component_size) {
+    ecs_component_pool *pool = &scene->components[component];
+    EASSERT_DBG(component_size == pool->size);
+    ecs_stamp(pool->ticks.changed, pool->ticks.chunk_changed, entity, __atomic_load_n(&scene->tick, __ATOMIC_RELAXED));
+    return (char *)pool->data + (u64)entity * pool->stride;
+}
+
+u32 ecs_advance_tick(escene *scene) {
+    // the scheduler advances it from the workers, every system run has its own tick
+    return __atomic_add_fetch(&scene->tick, 1, __ATOMIC_RELAXED);
+}
+
+u32 ecs_get_entities_with_components(escene *scene, u32 *components, u32 c_length, u32 *entities, u32 *e_length) {
+    return ecs_query(scene, components, c_length, 0, 0, 0, false, entities, e_length);
+}
+
+u32 ecs_get_entities_changed_since(escene *scene, u32 *components, u32 c_length, u32 filter, u32 since, u32 *entities, u32 *e_length) {
+    return ecs_query(scene, components, c_length, &filter, 1, since, false, entities, e_length);
+}
+
+u32 ecs_get_entities_added_since(escene *scene, u32 *components, u32 c_length, u32 filter, u32 since, u32 *entities, u32 *e_length) {
+    return ecs_query(scene, components, c_length, &filter, 1, since, true, entities, e_length);
+}
+
+u32 ecs_query(escene *scene, u32 *components, u32 c_length, u32 *filters, u32 f_length, u32 since, u8 added, u32 *entities, u32 *e_length) {
+    // only scan words that can hold created entities, ids reserved
+    // by command buffers can be past the capacity until applied
+    u32 created = scene->curr_entity_id < scene->entity_capacity ? scene->curr_entity_id : scene->entity_capacity;
+    u32 words = (created + 63) / 64;
+    u32 count = 0;
+    for(u32 w = 0; w < words; ++w) {
+        // early-out on chunks where no filter component changed
+        u8 chunk_changed = f_length == 0;
+        for(u32 f = 0; f < f_length && !chunk_changed; ++f) {
+            ecs_component_ticks *ticks = &scene->components[filters[f]].ticks;
+            chunk_changed = ticks->chunk_added && (added ? ticks->chunk_added[w] : ticks->chunk_changed[w]) > since;
+        }
+        if(!chunk_changed) {
+            continue;
+        }
+
+        u64 entities_mask = -1;
+        for(u32 i = 0; i < c_length; ++i) {
+            u64 *mask = scene->components[components[i]].mask;
+            entities_mask &= mask ? mask[w] : 0;
+        }
+        if(w == words - 1 && (created & 63)) {
+            entities_mask &= (1ull << (created & 63)) - 1;
+        }
+        while(entities_mask) {
+            u32 entity = w * 64 + __builtin_ctzll(entities_mask);
+            entities_mask &= entities_mask - 1;
+            u8 entity_changed = f_length == 0;
+            for(u32 f = 0; f < f_length && !entity_changed; ++f) {
+                ecs_component_ticks *ticks = &scene->components[filters[f]].ticks;
+                entity_changed = ticks->added && (added ? ticks->added[entity] : ticks->changed[entity]) > since;
+            }
+            if(entity_changed) {
+                entities[count++] = entity;
+            }
+        }
+    }
+    *e_length = count;
+    return count;
+}
+
+// new elements are zeroed
+static void grow_array(void **array, u32 element_size, u32 old_count, u32 new_count) {
+    void *grown = ealloc((u64)new_count * element_size);
+    EASSERT_MSG(grown != 0, "couldn't grow ecs array");
+    if(*array) {
+        ememcpy(grown, *array, (u64)old_count * element_size);
+        efree(*array);
+    }
+    memset((char *)grown + (u64)old_count * element_size, 0, (u64)(new_count - old_count) * element_size);
+    *array = grown;
+}
@@ -0,0 +1,153 @@
+#define ELOG_MODULE ECS
+
+#include "ecs_cmd.h"
+
+#include "assert.h"
+#include "memory.h"
+#include "thread.h"
+
+#include <stdlib.h>
+
+static ecs_cmd *push_cmd(ecs_cmdqueue *queue, u32 entity, ecs_cmd_type type, u32 component);
+static int compare_cmds(const void *a, const void *b);
+
+u8 ecs_cmdqueue_create(u64 arena_size, ecs_cmdqueue *queue) {
+    EASSERT(queue != 0);
+    *queue = (ecs_cmdqueue){0};
+    for(u32 i = 0; i < ECS_CMD_MAX_THREADS; ++i) {
+        queue->buffers[i].thread = i;
+    }
+    return earena_create(arena_size, &queue->arena);
+}
+
+void ecs_cmdqueue_destroy(ecs_cmdqueue *queue) {
+    earena_destroy(&queue->arena);
+    efree(queue->sorted);
+    queue->sorted = 0;
+    queue->sorted_capacity = 0;
+}
+
+ecs_cmdbuf *ecs_cmdqueue_local(ecs_cmdqueue *queue) {
+    u32 thread = ethread_index();
+    EASSERT_MSG(thread < ECS_CMD_MAX_THREADS, "too many threads recording commands");
+    return &queue->buffers[thread];
+}
+
+u32 ecs_cmdqueue_apply(ecs_cmdqueue *queue, escene *scene) {
+    u32 total = 0;
+    for(u32 i = 0; i < ECS_CMD_MAX_THREADS; ++i) {
+        total += queue->buffers[i].count;
+    }
+    if(total == 0) {
+        return 0;
+    }
+
+    // not from the arena: recording may have filled it
+    if(total > queue->sorted_capacity) {
+        efree(queue->sorted);
+        queue->sorted = ealloc(total * sizeof(ecs_cmd *));
+        EASSERT_MSG(queue->sorted != 0, "couldn't allocate the sort array for %u commands", total);
+        queue->sorted_capacity = total;
+    }
+    ecs_cmd **sorted = queue->sorted;
+
+    u32 count = 0;
+    for(u32 i = 0; i < ECS_CMD_MAX_THREADS; ++i) {
+        for(ecs_cmd_block *block = queue->buffers[i].head; block; block = block->next) {
+            for(u32 c = 0; c < block->count; ++c) {
+                sorted[count++] = &block->cmds[c];
+            }
+        }
+    }
+    qsort(sorted, count, sizeof(ecs_cmd *), compare_cmds);
+
+    for(u32 i = 0; i < count; ++i) {
+        ecs_cmd *cmd = sorted[i];
+        switch(cmd->type) {
+            case ECS_CMD_CREATE:
+                scene_add_entity(scene, cmd->entity);
+                break;
+            case ECS_CMD_ADD:
+                ecs_entity_add_component(scene, cmd->entity, cmd->component);
+                if(cmd->data) {
+                    ememcpy(ecs_get_component_of(scene, cmd->entity, cmd->component, cmd->size), cmd->data, cmd->size);
+                }
+                break;
+            case ECS_CMD_REMOVE:
+                ecs_entity_remove_component(scene, cmd->entity, cmd->component);
+                break;
+            case ECS_CMD_DESTROY:
+                ecs_entity_destroy(scene, cmd->entity);
+                break;
+        }
+    }
+
+    for(u32 i = 0; i < ECS_CMD_MAX_THREADS; ++i) {
+        ecs_cmdbuf *buffer = &queue->buffers[i];
+        buffer->head = 0;
+        buffer->tail = 0;
+        buffer->count = 0;
+    }
+    earena_reset(&queue->arena);
+
+    return count;
+}
+
+u32 ecs_cmd_create(ecs_cmdqueue *queue, escene *scene) {
+    // the scene grows when the command is applied
+    u32 entity = __atomic_fetch_add(&scene->curr_entity_id, 1, __ATOMIC_RELAXED);
+    push_cmd(queue, entity, ECS_CMD_CREATE, 0);
+    return entity;
+}
+
+void ecs_cmd_destroy(ecs_cmdqueue *queue, u32 entity) {
+    push_cmd(queue, entity, ECS_CMD_DESTROY, 0);
+}
+
+void ecs_cmd_add(ecs_cmdqueue *queue, u32 entity, u32 component, const void *data, u32 size) {
+    ecs_cmd *cmd = push_cmd(queue, entity, ECS_CMD_ADD, component);
+    if(data && size) {
+        cmd->data = earena_alloc(&queue->arena, size, 16);
+        EASSERT_MSG(cmd->data != 0, "command arena is full");
+        ememcpy(cmd->data, data, size);
+        cmd->size = size;
+    }
+}
+
+void ecs_cmd_remove(ecs_cmdqueue *queue, u32 entity, u32 component) {
+    push_cmd(queue, entity, ECS_CMD_REMOVE, component);
+}
+
+static ecs_cmd *push_cmd(ecs_cmdqueue *queue, u32 entity, ecs_cmd_type type, u32 component) {
+    ecs_cmdbuf *buffer = ecs_cmdqueue_local(queue);
+
+    if(!buffer->tail || buffer->tail->count == ECS_CMD_BLOCK_SIZE) {
+        ecs_cmd_block *block = earena_alloc(&queue->arena, sizeof(ecs_cmd_block), 64);
+        EASSERT_MSG(block != 0, "command arena is full");
+        block->next = 0;
+        block->count = 0;
+        if(buffer->tail) {
+            buffer->tail->next = block;
+        } else {
+            buffer->head = block;
+        }
+        buffer->tail = block;
+    }
+
+    EASSERT_DBG(buffer->count < (1 << 24));
+    ecs_cmd *cmd = &buffer->tail->cmds[buffer->tail->count++];
+    cmd->key = ((u64)entity << 32) | ((u64)buffer->thread << 24) | buffer->count;
+    cmd->entity = entity;
+    cmd->type = type;
+    cmd->component = component;
+    cmd->size = 0;
+    cmd->data = 0;
+    ++buffer->count;
+    return cmd;
+}
+
+static int compare_cmds(const void *a, const void *b) {
+    u64 ka = (*(ecs_cmd **)a)->key;
+    u64 kb = (*(ecs_cmd **)b)->key;
+    return (ka > kb) - (ka < kb);
+}
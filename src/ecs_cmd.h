@@ -0,0 +1,73 @@
+#ifndef ECS_CMD_H
+#define ECS_CMD_H
+
+#include "defines.h"
+#include "scene.h"
+#include "arena.h"
+#include "thread.h"
+
+// Deferred structural changes.
+// Systems record commands while iterating, from any thread, and the
+// queue is applied at a sync point (end of ecs_scheduler_run).
+// Recording never calls the allocator: commands live in a frame arena.
+
+// one buffer per live thread index
+#define ECS_CMD_MAX_THREADS ETHREAD_MAX_INDICES
+#define ECS_CMD_BLOCK_SIZE 128
+
+typedef enum ecs_cmd_type {
+    ECS_CMD_CREATE  = 0,
+    ECS_CMD_ADD     = 1,
+    ECS_CMD_REMOVE  = 2,
+    ECS_CMD_DESTROY = 3,
+} ecs_cmd_type;
+
+typedef struct ecs_cmd {
+    // entity, then recording thread, then recording order
+    u64 key;
+    u32 entity;
+    u16 type;
+    u16 component;
+    u32 size;
+    void *data;
+} ecs_cmd;
+
+typedef struct ecs_cmd_block {
+    struct ecs_cmd_block *next;
+    u32 count;
+    ecs_cmd cmds[ECS_CMD_BLOCK_SIZE];
+} ecs_cmd_block;
+
+// one per recording thread, only touched by that thread
+typedef struct ecs_cmdbuf {
+    ecs_cmd_block *head;
+    ecs_cmd_block *tail;
+    u32 count;
+    u32 thread;
+} ecs_cmdbuf;
+
+typedef struct ecs_cmdqueue {
+    earena arena;
+    ecs_cmdbuf buffers[ECS_CMD_MAX_THREADS];
+    // grown by apply, the arena is only for recording
+    ecs_cmd **sorted;
+    u32 sorted_capacity;
+} ecs_cmdqueue;
+
+// arena_size bounds the commands (and their data) recorded between two applies
+EAPI u8 ecs_cmdqueue_create(u64 arena_size, ecs_cmdqueue *queue);
+EAPI void ecs_cmdqueue_destroy(ecs_cmdqueue *queue);
+// buffer of the calling thread
+EAPI ecs_cmdbuf *ecs_cmdqueue_local(ecs_cmdqueue *queue);
+// applies every recorded command sorted by entity, then resets the queue
+// must not run concurrently with recording, may allocate
+EAPI u32 ecs_cmdqueue_apply(ecs_cmdqueue *queue, escene *scene);
+
+// the id is reserved immediately, the entity exists once applied
+EAPI u32 ecs_cmd_create(ecs_cmdqueue *queue, escene *scene);
+EAPI void ecs_cmd_destroy(ecs_cmdqueue *queue, u32 entity);
+// data (can be 0) is copied and written to the component pool when applied
+EAPI void ecs_cmd_add(ecs_cmdqueue *queue, u32 entity, u32 component, const void *data, u32 size);
+EAPI void ecs_cmd_remove(ecs_cmdqueue *queue, u32 entity, u32 component);
+
+#endif // ECS_CMD_H
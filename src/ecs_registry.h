@@ -0,0 +1,113 @@
+#ifndef ECS_REGISTRY_H
+#define ECS_REGISTRY_H
+
+#include "defines.h"
+#include "scene.h"
+
+// Compile-time component registry.
+// Components are listed as X(type, alignment), the type must be a typedef name.
+// Engine components come first so that their ids are the same in the engine
+// and in the app. The app lists its own components by defining
+// ECS_APP_COMPONENTS(X) before including this header.
+
+#define ECS_ENGINE_COMPONENTS(X)           \
+    X(sprite_c, _Alignof(sprite_c))        \
+    X(position_c, _Alignof(position_c))
+
+#ifndef ECS_APP_COMPONENTS
+    #define ECS_APP_COMPONENTS(X)
+#endif
+
+#define ECS_COMPONENTS(X) ECS_ENGINE_COMPONENTS(X) ECS_APP_COMPONENTS(X)
+
+#define ECS_ID(type) ECS_ID_##type
+// constant signature bit, or them together to build a query mask
+#define ECS_MASK(type) (1ull << ECS_ID(type))
+#define ECS_SIZE(type) ((u32)sizeof(type))
+#define ECS_ALIGN(type) ECS_ALIGN_##type
+#define ECS_STRIDE(type) ((ECS_SIZE(type) + ECS_ALIGN(type) - 1) & ~(ECS_ALIGN(type) - 1))
+
+// typed accessors: ECS_GET(scene, position_c, entity)->x
+#define ECS_GET(scene, type, entity) ecs_get_##type(scene, entity)
+#define ECS_MUT(scene, type, entity) ecs_mut_##type(scene, entity)
+#define ECS_HAS(scene, type, entity) ecs_has_mask(scene, entity, ECS_MASK(type))
+
+#define ECS_REGISTRY_ID(type, align) ECS_ID(type),
+enum ecs_component_id {
+    ECS_COMPONENTS(ECS_REGISTRY_ID)
+    ECS_COMPONENT_COUNT
+};
+#undef ECS_REGISTRY_ID
+
+_Static_assert(ECS_COMPONENT_COUNT <= 64, "component masks are 64 bits");
+
+#define ECS_REGISTRY_ALIGN(type, align) ECS_ALIGN_##type = (align),
+enum ecs_component_align {
+    ECS_COMPONENTS(ECS_REGISTRY_ALIGN)
+};
+#undef ECS_REGISTRY_ALIGN
+
+// offsets are computed with a constant stride, reads don't go through ecs.c
+#define ECS_REGISTRY_ACCESSORS(type, align)                                                        \
+    _Static_assert(((align) & ((align) - 1)) == 0 && (align) <= ECS_POOL_ALIGN,                    \
+                   "invalid alignment for " #type);                                                 \
+    static inline const type *ecs_get_##type(escene *scene, u32 entity) {                          \
+        return (const type *)((char *)scene->components[ECS_ID(type)].data + (u64)entity * ECS_STRIDE(type)); \
+    }                                                                                               \
+    static inline type *ecs_mut_##type(escene *scene, u32 entity) {                                \
+        ecs_component_pool *pool = &scene->components[ECS_ID(type)];                               \
+        ecs_stamp(pool->ticks.changed, pool->ticks.chunk_changed, entity,                          \
+                  __atomic_load_n(&scene->tick, __ATOMIC_RELAXED));                                 \
+        return (type *)((char *)pool->data + (u64)entity * ECS_STRIDE(type));                      \
+    }
+ECS_COMPONENTS(ECS_REGISTRY_ACCESSORS)
+#undef ECS_REGISTRY_ACCESSORS
+
+// creates the pools of every listed component
+static inline void ecs_register_components(escene *scene) {
+#define ECS_REGISTRY_CREATE(type, align) ecs_component_create(scene, ECS_ID(type), ECS_SIZE(type), ECS_ALIGN(type));
+    ECS_COMPONENTS(ECS_REGISTRY_CREATE)
+#undef ECS_REGISTRY_CREATE
+}
+
+// with a constant mask the loop is unrolled into one test per component
+// false for entities past the capacity and components that weren't created,
+// like ecs_entity_has_component
+static inline u8 ecs_has_mask(escene *scene, u32 entity, u64 mask) {
+    if(entity >= scene->entity_capacity) {
+        return false;
+    }
+    for(u64 m = mask; m; m &= m - 1) {
+        u64 *bits = scene->components[__builtin_ctzll(m)].mask;
+        if(!bits || !((bits[entity >> 6] >> (entity & 63)) & 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ecs_get_entities_with_components from a signature mask, with a constant
+// mask each 64 entities chunk is one AND per component, no call to ecs_query
+static inline u32 ecs_query_mask(escene *scene, u64 mask, u32 *entities, u32 *e_length) {
+    // ids reserved by command buffers can be past the capacity until applied
+    u32 created = scene->curr_entity_id < scene->entity_capacity ? scene->curr_entity_id : scene->entity_capacity;
+    u32 words = (created + 63) / 64;
+    u32 count = 0;
+    for(u32 w = 0; w < words; ++w) {
+        u64 entities_mask = -1;
+        for(u64 m = mask; m; m &= m - 1) {
+            u64 *bits = scene->components[__builtin_ctzll(m)].mask;
+            entities_mask &= bits ? bits[w] : 0;
+        }
+        if(w == words - 1 && (created & 63)) {
+            entities_mask &= (1ull << (created & 63)) - 1;
+        }
+        for(; entities_mask; entities_mask &= entities_mask - 1) {
+            entities[count++] = w * 64 + __builtin_ctzll(entities_mask);
+        }
+    }
+    *e_length = count;
+    return count;
+}
+
+#endif // ECS_REGISTRY_H
@@ -4,6 +4,15 @@
 #include "logger.h"
 #include "heap.h"
 #include "memory.h"
+#include "scheduler.h"
+#include "clock.h"
+#include "timestep.h"
+#include "thread.h"
+#include "jobs.h"
+#include "render_state.h"
+#include "renderer.h"
+#include "profiler.h"
+#include "frame_stats.h"
 
 #include <stdlib.h>
 #include <time.h>
@@ -12,7 +21,165 @@
 // tmp
 #define MEMORY_SIZE (1 * 1024 * 1024 * 1024)
 
+typedef struct simulation_context {
+    eapp *app;
+    etimestep timestep;
+    erender_state render_state;
+    u8 running;
+} simulation_context;
+
+static void run_steps(eapp *app, u32 steps) {
+    for(u32 i = 0; i < steps; ++i) {
+        app->update(app);
+        if(app->scheduler && app->scene) {
+            ecs_scheduler_run(app->scheduler, app->scene);
+        }
+    }
+}
+
+// draws are queued during app->render, rasterized when the target is unset
+// nothing is drawn until the compositor will show it
+static void render_frame(eapp *app, f32 alpha) {
+    if(!ewindow_ready(app->window)) {
+        return;
+    }
+    erender_target target;
+    u8 drawing = ewindow_framebuffer(app->window, &target.pixels, &target.width, &target.height, &target.stride, &target.age);
+    renderer_set_target(drawing ? &target : 0);
+    app->render(app, alpha);
+    renderer_set_target(0);
+    if(drawing) {
+        const ewindow_rect *damage;
+        u32 count = renderer_damage(&damage);
+        ewindow_present(app->window, damage, count);
+    }
+}
+
+// display connection syscalls, checked once per frame
+static struct {
+    u64 last;
+    u64 frame_max;
+} display_io;
+
+static void count_display_io() {
+    ewindow_io_stats stats;
+    ewindow_get_io_stats(&stats);
+    u64 syscalls = stats.sends + stats.reads;
+    if(syscalls - display_io.last > display_io.frame_max) {
+        display_io.frame_max = syscalls - display_io.last;
+    }
+    display_io.last = syscalls;
+}
+
+static void report_display_io(u64 frames) {
+    ewindow_io_stats stats;
+    ewindow_get_io_stats(&stats);
+    EDEBUG("display: %.2f syscalls per frame (at most %llu), %llu requests in %llu sends, %llu reads",
+            frames ? (f64)(stats.sends + stats.reads) / frames : 0.0, display_io.frame_max, stats.requests, stats.sends, stats.reads);
+}
+
+// input and other events are dispatched as they arrive until the frame is due
+static void wait_frame(etimestep *timestep) {
+    u64 wait_ns;
+    while((wait_ns = etimestep_wait_ns(timestep, eclock_now_ns()))) {
+        if(!ewindow_pump_all(wait_ns)) {
+            break;
+        }
+    }
+    etimestep_pace(timestep);
+}
+
+// frame N + 1 is simulated here while the main thread renders frame N
+static void *simulation_main(void *arg) {
+    simulation_context *context = arg;
+    eapp *app = context->app;
+    while(__atomic_load_n(&context->running, __ATOMIC_ACQUIRE)) {
+        u64 start = eclock_now_ns();
+        u32 steps = etimestep_advance(&context->timestep, start);
+        EPROFILE_BEGIN("update");
+        run_steps(app, steps);
+        EPROFILE_END();
+        if(steps) {
+            eframe_stats_record(app->frame_stats, EFRAME_PHASE_UPDATE, eclock_now_ns() - start);
+        }
+        if(steps && app->scene) {
+            EPROFILE_BEGIN("extract");
+            erender_extract(app->scene, erender_state_write(&context->render_state));
+            erender_state_publish(&context->render_state, eclock_now_ns());
+            EPROFILE_END();
+        }
+        etimestep_pace(&context->timestep);
+    }
+    return 0;
+}
+
+static void run_pipelined(eapp *app, etimestep *timestep) {
+    simulation_context context;
+    context.app = app;
+    context.timestep = *timestep;
+    // the simulation is paced on steps, rendering on frames
+    context.timestep.config.frame_ns = context.timestep.config.step_ns;
+    context.running = true;
+    erender_state_create(&context.render_state);
+    if(app->scene) {
+        // something to render before the first step
+        erender_extract(app->scene, erender_state_write(&context.render_state));
+        erender_state_publish(&context.render_state, eclock_now_ns());
+    }
+
+    // both threads allocate from now on
+    ememory_set_shared(true);
+    ethread simulation;
+    if(!ethread_create(simulation_main, &context, &simulation)) {
+        EERROR("couldn't start the simulation thread");
+        ememory_set_shared(false);
+        erender_state_destroy(&context.render_state);
+        return;
+    }
+
+    while(!ewindow_should_close(app->window)) {
+        u64 start = eclock_now_ns();
+        EPROFILE_BEGIN("pump");
+        ewindow_pump_all(0);
+        EPROFILE_END();
+        app->snapshot = erender_state_read(&context.render_state);
+        // how far into the next step the simulation should be by now
+        u64 now = eclock_now_ns();
+        eframe_stats_record(app->frame_stats, EFRAME_PHASE_PUMP, now - start);
+        u64 since = now > app->snapshot->time_ns ? now - app->snapshot->time_ns : 0;
+        f32 alpha = since >= app->timestep.step_ns ? 1.0f : (f32)since / app->timestep.step_ns;
+        EPROFILE_BEGIN("render");
+        render_frame(app, alpha);
+        EPROFILE_END();
+        app->snapshot = 0;
+        u64 rendered = eclock_now_ns();
+        eframe_stats_record(app->frame_stats, EFRAME_PHASE_RENDER, rendered - now);
+        eframe_stats_end_frame(app->frame_stats, rendered - start);
+        count_display_io();
+        ++timestep->frames;
+        EPROFILE_BEGIN("pace");
+        wait_frame(timestep);
+        EPROFILE_END();
+        EPROFILE_FRAME();
+    }
+
+    __atomic_store_n(&context.running, false, __ATOMIC_RELEASE);
+    ethread_join(&simulation);
+    ememory_set_shared(false);
+    timestep->steps = context.timestep.steps;
+    timestep->dropped_ns = context.timestep.dropped_ns;
+    erender_state_destroy(&context.render_state);
+}
+
 void engine_run(eapp *app) {
+    // per-module runtime levels, e.g. EGG_LOG=window=debug,memory=warn
+    const char *log_levels = getenv("EGG_LOG");
+    if(log_levels && !elog_set_levels(log_levels)) {
+        EWARN("invalid EGG_LOG: %s", log_levels);
+    }
+    if(!app->sync_logging && !elog_async_start()) {
+        EWARN("couldn't start the log writer, logging synchronously");
+    }
     EINFO("Hello from lib!");
 
     // init random system
@@ -22,26 +189,81 @@ void engine_run(eapp *app) {
     eheap heap = {0};
     ememory_init(MEMORY_SIZE, &heap);
     ememory_report();
+    EPROFILE_INIT();
 
     if(!display_backend_init(0)) {
         EFATAL("ERROR: failed to initialize display system. Crashing");
+        elog_async_stop();
         return;
     }
 
-    ewindow_config config = { .x = 100, .y = 100, .width = 600, .height = 400, .title = NULL };
+    ewindow_config config = { .x = 100, .y = 100, .width = 600, .height = 400, .title = NULL,
+                              .buffer_count = app->buffer_count, .swap_policy = app->swap_policy };
     ewindow_create(&config, &app->window);
 
+    // too big for the stack
+    static ejobs jobs;
+    ejobs_create(0, &jobs);
+    app->jobs = &jobs;
+    renderer_set_jobs(&jobs);
+
     app->init(app);
 
-    while(!ewindow_should_close(app->window)) {
-        ewindow_pump_all();
-        app->update(app);
-        app->render(app);
+    etimestep timestep;
+    etimestep_init(&app->timestep, eclock_now_ns(), &timestep);
+    app->timestep = timestep.config;
+
+    static eframe_stats frame_stats;
+    eframe_stats_init(timestep.config.frame_ns, 0, &frame_stats);
+    app->frame_stats = &frame_stats;
+
+    if(app->pipelined) {
+        run_pipelined(app, &timestep);
+    } else {
+        while(!ewindow_should_close(app->window)) {
+            u64 start = eclock_now_ns();
+            EPROFILE_BEGIN("pump");
+            ewindow_pump_all(0);
+            EPROFILE_END();
+            u64 pumped = eclock_now_ns();
+            EPROFILE_BEGIN("update");
+            run_steps(app, etimestep_advance(&timestep, pumped));
+            EPROFILE_END();
+            u64 updated = eclock_now_ns();
+            EPROFILE_BEGIN("render");
+            render_frame(app, timestep.alpha);
+            EPROFILE_END();
+            u64 rendered = eclock_now_ns();
+            eframe_stats_record(&frame_stats, EFRAME_PHASE_PUMP, pumped - start);
+            eframe_stats_record(&frame_stats, EFRAME_PHASE_UPDATE, updated - pumped);
+            eframe_stats_record(&frame_stats, EFRAME_PHASE_RENDER, rendered - updated);
+            eframe_stats_end_frame(&frame_stats, rendered - start);
+            count_display_io();
+            EPROFILE_BEGIN("pace");
+            wait_frame(&timestep);
+            EPROFILE_END();
+            EPROFILE_FRAME();
+        }
+    }
+
+    eframe_stats_report(&frame_stats);
+    EDEBUG("%llu frames, %llu steps, %llu ms of simulation dropped", timestep.frames, timestep.steps, timestep.dropped_ns / 1000000);
+    report_display_io(timestep.frames);
+    if(app->scheduler) {
+        ecs_scheduler_report(app->scheduler);
     }
+    renderer_shutdown();
+    ejobs_destroy(&jobs);
 
     // not pumped so memory is not cleaned
     ewindow_destroy(app->window);
 
+    EPROFILE_REPORT();
+    EPROFILE_EXPORT("egg_trace.json");
+    EPROFILE_SHUTDOWN();
+
     ememory_report();
     ememory_uninit();
+
+    elog_async_stop();
 }
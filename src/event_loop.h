@@ -0,0 +1,62 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "defines.h"
+
+// Waits on file descriptors (display connection, audio, network, inotify...)
+// and timers, and calls their handler when they are ready. Handlers run on
+// the thread calling eevent_loop_run and must not block. Sources are level
+// triggered: a handler may read only part of what is pending and is called
+// again on the next run, and EEVENT_WRITE is reported as long as the fd is
+// writable, so drop it with eevent_modify once there is nothing to send.
+
+#define EEVENT_MAX_SOURCES 64
+// eevent_loop_run timeout
+#define EEVENT_WAIT_FOREVER (~0ull)
+
+// what the fd is watched for, and reported to the handler
+#define EEVENT_READ  0x1
+#define EEVENT_WRITE 0x2
+// reported only: error or hang up
+#define EEVENT_CLOSED 0x4
+
+// events: EEVENT_* reported, expirations since the last call for timers
+typedef void (*eevent_fn)(void *user, i32 fd, u32 events);
+
+typedef struct eevent_source {
+    i32 fd;
+    eevent_fn fn;
+    void *user;
+    // a timerfd the loop created and closes
+    u8 timer;
+} eevent_source;
+
+typedef struct eevent_loop {
+    i32 epoll_fd;
+    // wakes epoll_wait at the timeout, ns precision
+    i32 timeout_fd;
+    // fd -1 when free
+    eevent_source sources[EEVENT_MAX_SOURCES];
+    u64 wakeups;
+    u64 dispatched;
+} eevent_loop;
+
+EAPI u8 eevent_loop_create(eevent_loop *loop);
+// closes the timers, other fds belong to whoever added them
+EAPI void eevent_loop_destroy(eevent_loop *loop);
+// the engine loop: display events and other sources, created on first use
+EAPI eevent_loop *eevent_loop_main();
+
+// the fd is left as is, make it non-blocking
+EAPI u8 eevent_add(eevent_loop *loop, i32 fd, u32 events, eevent_fn fn, void *user);
+EAPI u8 eevent_modify(eevent_loop *loop, i32 fd, u32 events);
+EAPI u8 eevent_remove(eevent_loop *loop, i32 fd);
+// fires first_ns from now then every period_ns, once if 0, fd to remove it
+EAPI u8 eevent_add_timer(eevent_loop *loop, u64 first_ns, u64 period_ns, eevent_fn fn, void *user, i32 *fd);
+
+// waits until a source is ready or timeout_ns passed (0 returns at once),
+// then dispatches what is ready: returns the number of handlers called, -1
+// on error
+EAPI i32 eevent_loop_run(eevent_loop *loop, u64 timeout_ns);
+
+#endif // EVENT_LOOP_H
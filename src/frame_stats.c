@@ -0,0 +1,139 @@
+#include "frame_stats.h"
+
+#include "logger.h"
+
+#include <string.h>
+
+#define MAX_VALUE ((1ull << EFRAME_STATS_MAX_BITS) - 1)
+
+static u32 bucket_index(u64 ns) {
+    if(ns > MAX_VALUE) {
+        ns = MAX_VALUE;
+    }
+    if(ns < EFRAME_STATS_SUB_BUCKETS) {
+        return (u32)ns;
+    }
+    // the top EFRAME_STATS_SUB_BITS + 1 bits pick the bucket in the row of the highest bit
+    u32 shift = 63 - __builtin_clzll(ns) - EFRAME_STATS_SUB_BITS;
+    return shift * EFRAME_STATS_SUB_BUCKETS + (u32)(ns >> shift);
+}
+
+// last value falling in the bucket
+static u64 bucket_upper(u32 index) {
+    if(index < 2 * EFRAME_STATS_SUB_BUCKETS) {
+        return index;
+    }
+    u32 shift = index / EFRAME_STATS_SUB_BUCKETS - 1;
+    u64 sub = index % EFRAME_STATS_SUB_BUCKETS + EFRAME_STATS_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+// percentile over the sum of histograms, without merging them
+static u64 percentile_of(const ehistogram **histograms, u32 histogram_count, f64 percentile) {
+    u64 count = 0;
+    u64 max = 0;
+    for(u32 i = 0; i < histogram_count; ++i) {
+        count += histograms[i]->count;
+        if(histograms[i]->max_ns > max) {
+            max = histograms[i]->max_ns;
+        }
+    }
+    if(count == 0) {
+        return 0;
+    }
+    if(percentile < 0.0) {
+        percentile = 0.0;
+    } else if(percentile > 100.0) {
+        percentile = 100.0;
+    }
+    u64 target = (u64)(percentile / 100.0 * count + 0.5);
+    if(target == 0) {
+        target = 1;
+    }
+
+    u64 seen = 0;
+    for(u32 b = 0; b < EFRAME_STATS_BUCKETS; ++b) {
+        for(u32 i = 0; i < histogram_count; ++i) {
+            seen += histograms[i]->counts[b];
+        }
+        if(seen >= target) {
+            u64 upper = bucket_upper(b);
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+void ehistogram_clear(ehistogram *histogram) {
+    memset(histogram, 0, sizeof(ehistogram));
+}
+
+void ehistogram_record(ehistogram *histogram, u64 ns) {
+    ++histogram->counts[bucket_index(ns)];
+    ++histogram->count;
+    histogram->total_ns += ns;
+    if(ns > histogram->max_ns) {
+        histogram->max_ns = ns;
+    }
+}
+
+u64 ehistogram_percentile(const ehistogram *histogram, f64 percentile) {
+    return percentile_of(&histogram, 1, percentile);
+}
+
+void eframe_stats_init(u64 budget_ns, u32 window_samples, eframe_stats *stats) {
+    memset(stats, 0, sizeof(eframe_stats));
+    stats->budget_ns = budget_ns;
+    stats->window_samples = window_samples ? window_samples : EFRAME_STATS_DEFAULT_WINDOW;
+}
+
+void eframe_stats_record(eframe_stats *stats, eframe_phase phase, u64 ns) {
+    eframe_phase_stats *p = &stats->phases[phase];
+    ehistogram_record(&p->total, ns);
+
+    ehistogram *window = &p->windows[p->current];
+    if(window->count == stats->window_samples) {
+        // the full window becomes the previous one
+        p->current ^= 1;
+        window = &p->windows[p->current];
+        ehistogram_clear(window);
+        if(phase == EFRAME_PHASE_FRAME) {
+            stats->window_over_budget[p->current] = 0;
+        }
+    }
+    ehistogram_record(window, ns);
+}
+
+void eframe_stats_end_frame(eframe_stats *stats, u64 ns) {
+    eframe_stats_record(stats, EFRAME_PHASE_FRAME, ns);
+    if(ns > stats->budget_ns) {
+        ++stats->over_budget;
+        ++stats->window_over_budget[stats->phases[EFRAME_PHASE_FRAME].current];
+    }
+}
+
+u64 eframe_stats_percentile(const eframe_stats *stats, eframe_phase phase, f64 percentile) {
+    const eframe_phase_stats *p = &stats->phases[phase];
+    const ehistogram *windows[2] = { &p->windows[0], &p->windows[1] };
+    return percentile_of(windows, 2, percentile);
+}
+
+u64 eframe_stats_rolling_over_budget(const eframe_stats *stats) {
+    return stats->window_over_budget[0] + stats->window_over_budget[1];
+}
+
+void eframe_stats_report(const eframe_stats *stats) {
+    static const char *names[EFRAME_PHASE_COUNT] = { "pump", "update", "render", "frame" };
+    EDEBUG("Showing frame times:");
+    for(u32 i = 0; i < EFRAME_PHASE_COUNT; ++i) {
+        const ehistogram *h = &stats->phases[i].total;
+        if(h->count == 0) {
+            continue;
+        }
+        EDEBUG("- %s: %llu samples, mean = %.3f ms, p50 = %.3f ms, p95 = %.3f ms, p99 = %.3f ms, max = %.3f ms",
+               names[i], h->count, h->total_ns / 1e6 / h->count,
+               ehistogram_percentile(h, 50.0) / 1e6, ehistogram_percentile(h, 95.0) / 1e6,
+               ehistogram_percentile(h, 99.0) / 1e6, h->max_ns / 1e6);
+    }
+    EDEBUG("%llu frames over the %.3f ms budget", stats->over_budget, stats->budget_ns / 1e6);
+}
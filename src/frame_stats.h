@@ -0,0 +1,75 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include "defines.h"
+
+// Frame timings. Durations go into fixed size log-linear histograms (HDR
+// style): every power of 2 is split in EFRAME_STATS_SUB_BUCKETS linear
+// buckets, so any value is known within 1 / EFRAME_STATS_SUB_BUCKETS of
+// itself and recording is a clz and an increment, cheap enough to stay on.
+// Percentiles are rolling: each phase keeps its current window and the one
+// before, so they cover the last window_samples to 2 * window_samples frames.
+
+#define EFRAME_STATS_SUB_BITS 5
+#define EFRAME_STATS_SUB_BUCKETS (1 << EFRAME_STATS_SUB_BITS)
+// values up to 2^40 ns (~18 min), longer ones are clamped
+#define EFRAME_STATS_MAX_BITS 40
+#define EFRAME_STATS_BUCKETS ((EFRAME_STATS_MAX_BITS - EFRAME_STATS_SUB_BITS + 1) * EFRAME_STATS_SUB_BUCKETS)
+// ~10 s at 60 fps
+#define EFRAME_STATS_DEFAULT_WINDOW 600
+
+typedef enum eframe_phase {
+    EFRAME_PHASE_PUMP,
+    EFRAME_PHASE_UPDATE,
+    EFRAME_PHASE_RENDER,
+    // pump + update + render, the time spent pacing is not part of it
+    EFRAME_PHASE_FRAME,
+    EFRAME_PHASE_COUNT
+} eframe_phase;
+
+typedef struct ehistogram {
+    u32 counts[EFRAME_STATS_BUCKETS];
+    u64 count;
+    u64 total_ns;
+    u64 max_ns;
+} ehistogram;
+
+typedef struct eframe_phase_stats {
+    // since init, for the report
+    ehistogram total;
+    ehistogram windows[2];
+    u8 current;
+} eframe_phase_stats;
+
+// Each phase must be recorded from a single thread, but different phases may
+// be recorded from different ones (pipelined update on the simulation thread).
+typedef struct eframe_stats {
+    u64 budget_ns;
+    u32 window_samples;
+
+    eframe_phase_stats phases[EFRAME_PHASE_COUNT];
+
+    // frames whose EFRAME_PHASE_FRAME took longer than budget_ns
+    u64 over_budget;
+    u64 window_over_budget[2];
+} eframe_stats;
+
+EAPI void ehistogram_clear(ehistogram *histogram);
+EAPI void ehistogram_record(ehistogram *histogram, u64 ns);
+// smallest value at or below which percentile % of the samples are, rounded
+// up to the end of its bucket, 0 when empty
+EAPI u64 ehistogram_percentile(const ehistogram *histogram, f64 percentile);
+
+// window_samples 0 for EFRAME_STATS_DEFAULT_WINDOW
+EAPI void eframe_stats_init(u64 budget_ns, u32 window_samples, eframe_stats *stats);
+EAPI void eframe_stats_record(eframe_stats *stats, eframe_phase phase, u64 ns);
+// records EFRAME_PHASE_FRAME and checks it against the budget
+EAPI void eframe_stats_end_frame(eframe_stats *stats, u64 ns);
+
+// rolling, over the last one to two windows
+EAPI u64 eframe_stats_percentile(const eframe_stats *stats, eframe_phase phase, f64 percentile);
+EAPI u64 eframe_stats_rolling_over_budget(const eframe_stats *stats);
+// logs p50, p95, p99 and max of every phase since init
+EAPI void eframe_stats_report(const eframe_stats *stats);
+
+#endif // FRAME_STATS_H
@@ -1,3 +1,5 @@
+#define ELOG_MODULE MEMORY
+
 #include "heap.h"
 
 #include "assert.h"
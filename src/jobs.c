@@ -0,0 +1,298 @@
+#define ELOG_MODULE JOBS
+
+#include "jobs.h"
+
+#include "assert.h"
+#include "memory.h"
+
+// failed attempts to find a job before a worker goes to sleep
+#define EJOBS_SPIN_COUNT 64
+
+// worker running on this thread, if any
+static _Thread_local ejobs *thread_jobs;
+static _Thread_local u32 thread_worker;
+
+static void *worker_main(void *arg);
+static void push_job(ejobs *jobs, ejob *job);
+static u8 take_job(ejobs *jobs, ejob *job);
+static void run_job(ejobs *jobs, ejob *job);
+
+static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+u8 ejobs_create(u32 worker_count, ejobs *jobs) {
+    EASSERT(jobs != 0);
+    if(worker_count == 0) {
+        worker_count = ethread_core_count() - 1;
+        // wider machines get the most the deques allow
+        if(worker_count > EJOBS_MAX_WORKERS - 1) {
+            worker_count = EJOBS_MAX_WORKERS - 1;
+        }
+    }
+    EASSERT(worker_count < EJOBS_MAX_WORKERS);
+
+    jobs->worker_count = worker_count + 1;
+    jobs->deques = ealloc_align(jobs->worker_count * sizeof(ejob_deque), 64);
+    if(!jobs->deques) {
+        EERROR("couldn't allocate job deques");
+        return false;
+    }
+    for(u32 i = 0; i < jobs->worker_count; ++i) {
+        jobs->deques[i].top = 0;
+        jobs->deques[i].bottom = 0;
+    }
+    jobs->queue_head = 0;
+    jobs->queue_count = 0;
+    jobs->pending = 0;
+    jobs->sleeping = 0;
+    jobs->stolen = 0;
+    jobs->started = 0;
+    jobs->running = true;
+    emutex_create(&jobs->lock);
+    econdvar_create(&jobs->wake);
+
+    thread_jobs = jobs;
+    thread_worker = 0;
+
+    for(u32 i = 1; i < jobs->worker_count; ++i) {
+        if(!ethread_create(worker_main, jobs, &jobs->threads[i])) {
+            EERROR("couldn't start job worker %u", i);
+            jobs->worker_count = i;
+            break;
+        }
+    }
+
+    EDEBUG("created job system with %u workers", jobs->worker_count);
+
+    return jobs->worker_count == worker_count + 1;
+}
+
+void ejobs_destroy(ejobs *jobs) {
+    emutex_lock(&jobs->lock);
+    __atomic_store_n(&jobs->running, false, __ATOMIC_RELEASE);
+    econdvar_broadcast(&jobs->wake);
+    emutex_unlock(&jobs->lock);
+
+    for(u32 i = 1; i < jobs->worker_count; ++i) {
+        ethread_join(&jobs->threads[i]);
+    }
+    emutex_destroy(&jobs->lock);
+    econdvar_destroy(&jobs->wake);
+    efree(jobs->deques);
+    jobs->deques = 0;
+    if(thread_jobs == jobs) {
+        thread_jobs = 0;
+    }
+}
+
+void ejobs_submit(ejobs *jobs, ejob_fn fn, void *arg, ejob_counter *counter) {
+    ejob job = { .fn = fn, .arg = arg, .counter = counter, .first = 0, .count = 1, .grain = 0 };
+    if(counter) {
+        __atomic_add_fetch(&counter->value, 1, __ATOMIC_RELAXED);
+    }
+    push_job(jobs, &job);
+}
+
+void ejobs_parallel_for(ejobs *jobs, ejob_fn fn, void *arg, u32 count, u32 grain, ejob_counter *counter) {
+    if(count == 0) {
+        return;
+    }
+    if(grain == 0) {
+        // enough ranges for stealing to balance uneven items
+        grain = count / (jobs->worker_count * 8);
+        grain = grain ? grain : 1;
+    }
+    ejob job = { .fn = fn, .arg = arg, .counter = counter, .first = 0, .count = count, .grain = grain };
+    if(counter) {
+        __atomic_add_fetch(&counter->value, 1, __ATOMIC_RELAXED);
+    }
+    push_job(jobs, &job);
+}
+
+void ejobs_wait(ejobs *jobs, ejob_counter *counter) {
+    u32 idle = 0;
+    while(__atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) != 0) {
+        ejob job;
+        if(take_job(jobs, &job)) {
+            run_job(jobs, &job);
+            idle = 0;
+        } else if(++idle < EJOBS_SPIN_COUNT) {
+            cpu_relax();
+        } else {
+            // the last jobs run elsewhere
+            ethread_yield();
+        }
+    }
+}
+
+// -- Chase-Lev deque --
+
+static u8 deque_push(ejob_deque *deque, ejob *job) {
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if(bottom - top >= EJOBS_DEQUE_SIZE) {
+        return false;
+    }
+    deque->jobs[bottom & (EJOBS_DEQUE_SIZE - 1)] = *job;
+    // the job is written before stealers can see it
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static u8 deque_pop(ejob_deque *deque, ejob *job) {
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+    if(top > bottom) {
+        // empty
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    *job = deque->jobs[bottom & (EJOBS_DEQUE_SIZE - 1)];
+    if(top == bottom) {
+        // last job: race the stealers for it
+        u8 won = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return won;
+    }
+    return true;
+}
+
+static u8 deque_steal(ejob_deque *deque, ejob *job) {
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if(top >= bottom) {
+        return false;
+    }
+    // copied before the CAS: once top moves, the owner can reuse the slot
+    *job = deque->jobs[top & (EJOBS_DEQUE_SIZE - 1)];
+    return __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+// -- internals --
+
+static void wake_workers(ejobs *jobs) {
+    // pairs with the sleeping increment in worker_main: either the sleeper
+    // sees the pending job, or this sees the sleeper
+    __atomic_add_fetch(&jobs->pending, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&jobs->sleeping, __ATOMIC_SEQ_CST)) {
+        emutex_lock(&jobs->lock);
+        econdvar_signal(&jobs->wake);
+        emutex_unlock(&jobs->lock);
+    }
+}
+
+static void push_job(ejobs *jobs, ejob *job) {
+    if(thread_jobs == jobs) {
+        if(deque_push(&jobs->deques[thread_worker], job)) {
+            wake_workers(jobs);
+            return;
+        }
+    } else {
+        emutex_lock(&jobs->lock);
+        if(jobs->queue_count < EJOBS_QUEUE_SIZE) {
+            jobs->queue[(jobs->queue_head + jobs->queue_count) % EJOBS_QUEUE_SIZE] = *job;
+            // also read without the lock by take_job
+            __atomic_store_n(&jobs->queue_count, jobs->queue_count + 1, __ATOMIC_RELAXED);
+            emutex_unlock(&jobs->lock);
+            wake_workers(jobs);
+            return;
+        }
+        emutex_unlock(&jobs->lock);
+    }
+    // full: running it now still makes progress
+    run_job(jobs, job);
+}
+
+static u8 take_job(ejobs *jobs, ejob *job) {
+    u8 worker = thread_jobs == jobs;
+    if(worker && deque_pop(&jobs->deques[thread_worker], job)) {
+        __atomic_sub_fetch(&jobs->pending, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    // start with a different victim on each worker to spread contention
+    u32 start = worker ? thread_worker + 1 : 0;
+    for(u32 i = 0; i < jobs->worker_count; ++i) {
+        u32 victim = (start + i) % jobs->worker_count;
+        if(worker && victim == thread_worker) {
+            continue;
+        }
+        if(deque_steal(&jobs->deques[victim], job)) {
+            __atomic_sub_fetch(&jobs->pending, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&jobs->stolen, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+
+    if(__atomic_load_n(&jobs->queue_count, __ATOMIC_RELAXED)) {
+        emutex_lock(&jobs->lock);
+        u8 found = jobs->queue_count > 0;
+        if(found) {
+            *job = jobs->queue[jobs->queue_head];
+            jobs->queue_head = (jobs->queue_head + 1) % EJOBS_QUEUE_SIZE;
+            __atomic_store_n(&jobs->queue_count, jobs->queue_count - 1, __ATOMIC_RELAXED);
+        }
+        emutex_unlock(&jobs->lock);
+        if(found) {
+            __atomic_sub_fetch(&jobs->pending, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run_job(ejobs *jobs, ejob *job) {
+    // hand the upper half of large ranges to whoever is idle
+    while(job->grain && job->count > job->grain) {
+        u32 half = job->count / 2;
+        ejob split = *job;
+        split.first = job->first + half;
+        split.count = job->count - half;
+        job->count = half;
+        if(job->counter) {
+            __atomic_add_fetch(&job->counter->value, 1, __ATOMIC_RELAXED);
+        }
+        push_job(jobs, &split);
+    }
+    job->fn(job->arg, job->first, job->count);
+    if(job->counter) {
+        __atomic_sub_fetch(&job->counter->value, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void *worker_main(void *arg) {
+    ejobs *jobs = arg;
+    thread_jobs = jobs;
+    thread_worker = __atomic_add_fetch(&jobs->started, 1, __ATOMIC_RELAXED);
+
+    u32 idle = 0;
+    while(__atomic_load_n(&jobs->running, __ATOMIC_ACQUIRE)) {
+        ejob job;
+        if(take_job(jobs, &job)) {
+            run_job(jobs, &job);
+            idle = 0;
+            continue;
+        }
+        if(++idle < EJOBS_SPIN_COUNT) {
+            cpu_relax();
+            continue;
+        }
+
+        emutex_lock(&jobs->lock);
+        __atomic_add_fetch(&jobs->sleeping, 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&jobs->pending, __ATOMIC_SEQ_CST) == 0 && jobs->running) {
+            econdvar_wait(&jobs->wake, &jobs->lock);
+        }
+        __atomic_sub_fetch(&jobs->sleeping, 1, __ATOMIC_SEQ_CST);
+        emutex_unlock(&jobs->lock);
+        idle = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "defines.h"
+#include "thread.h"
+
+// Work-stealing job system: every worker owns a Chase-Lev deque, pushes and
+// pops jobs at its bottom, and steals from the top of the others when empty.
+// The thread calling ejobs_create is worker 0. Other threads can submit and
+// wait too, their jobs go through a shared locked queue.
+
+#define EJOBS_MAX_WORKERS 64
+// power of 2, a full deque runs the job inline
+#define EJOBS_DEQUE_SIZE 4096
+#define EJOBS_QUEUE_SIZE 4096
+
+// plain jobs are a range of one: first = 0, count = 1
+typedef void (*ejob_fn)(void *arg, u32 first, u32 count);
+
+// jobs left to finish, jobs decrement it when done
+typedef struct ejob_counter {
+    u32 value;
+} ejob_counter;
+
+typedef struct ejob {
+    ejob_fn fn;
+    void *arg;
+    ejob_counter *counter;
+    u32 first;
+    u32 count;
+    // ranges larger than this are split in two before running
+    u32 grain;
+} ejob;
+
+typedef struct ejob_deque {
+    // stealers take from the top
+    i64 top;
+    u8 pad0[56];
+    // the owner pushes and pops at the bottom
+    i64 bottom;
+    u8 pad1[56];
+    ejob jobs[EJOBS_DEQUE_SIZE];
+} ejob_deque;
+
+typedef struct ejobs {
+    ethread threads[EJOBS_MAX_WORKERS];
+    // including the creating thread
+    u32 worker_count;
+    ejob_deque *deques;
+
+    // jobs from threads that aren't workers, protected by lock
+    ejob queue[EJOBS_QUEUE_SIZE];
+    u32 queue_head;
+    u32 queue_count;
+
+    // queued and not yet taken, to know when workers can sleep
+    u32 pending;
+    u32 sleeping;
+    emutex lock;
+    econdvar wake;
+
+    u8 running;
+    // workers get their index from it
+    u32 started;
+
+    // jobs taken from another worker
+    u64 stolen;
+} ejobs;
+
+// worker_count threads are started on top of the calling one, 0 for one per
+// core up to EJOBS_MAX_WORKERS in all
+EAPI u8 ejobs_create(u32 worker_count, ejobs *jobs);
+EAPI void ejobs_destroy(ejobs *jobs);
+
+// counter is optional, incremented here and decremented when the job is done
+EAPI void ejobs_submit(ejobs *jobs, ejob_fn fn, void *arg, ejob_counter *counter);
+// calls fn over [0, count) in ranges of at most grain items, split on demand
+// so that idle workers steal the other halves, 0 picks a grain
+EAPI void ejobs_parallel_for(ejobs *jobs, ejob_fn fn, void *arg, u32 count, u32 grain, ejob_counter *counter);
+// runs jobs on the calling thread until counter reaches 0
+EAPI void ejobs_wait(ejobs *jobs, ejob_counter *counter);
+
+#endif // JOBS_H
@@ -0,0 +1,220 @@
+#include "log_binary.h"
+
+#include "log_format.h"
+#include "clock.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+void *esysmap_file(const char *path, u64 size, i32 *fd);
+void esysunmap_file(void *addr, u64 mapped_size, i32 fd, u64 size);
+
+#define HEADER_SIZE ((sizeof(elog_binary_header) + 7) & ~7ull)
+
+static struct {
+    u8 *data;
+    u64 capacity;
+    i32 fd;
+    // offset of the next record from the start of the file, past capacity once full
+    u64 used;
+    // offset of the first record that didn't fit, the records end there
+    u64 end;
+    u64 start_ns;
+    // sites registered by a previous log are registered again
+    u32 generation;
+    u32 next_id;
+    u64 dropped;
+    // held while a site registers
+    u8 site_lock;
+} sink;
+
+u8 elog_binary_enabled;
+
+static u8 *reserve(u64 size) {
+    u64 offset = __atomic_fetch_add(&sink.used, size, __ATOMIC_RELAXED);
+    if(offset + size > sink.capacity) {
+        __atomic_add_fetch(&sink.dropped, 1, __ATOMIC_RELAXED);
+        u64 end = __atomic_load_n(&sink.end, __ATOMIC_RELAXED);
+        while(offset < end && !__atomic_compare_exchange_n(&sink.end, &end, offset, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        return 0;
+    }
+    return sink.data + offset;
+}
+
+static void write_site(elog_site *site, u32 id) {
+    u64 file_length = strlen(site->file);
+    u64 format_length = strlen(site->format);
+    u64 size = (sizeof(elog_binary_site_record) + file_length + 1 + format_length + 1 + 7) & ~7ull;
+    u8 *at = reserve(size);
+    if(!at) {
+        return;
+    }
+    elog_binary_site_record record = {
+        .size = size,
+        .id = id | ELOG_BINARY_SITE,
+        .line = site->line,
+        .level = site->level,
+        .file_length = file_length,
+        .format_length = format_length,
+    };
+    memcpy(at, &record, sizeof(record));
+    at += sizeof(record);
+    memcpy(at, site->file, file_length + 1);
+    memcpy(at + file_length + 1, site->format, format_length + 1);
+}
+
+static void parse_layout(elog_site *site) {
+    u32 count;
+    if(!elog_parse_layout(site->format, site->args, ELOG_SITE_MAX_ARGS, &count)) {
+        site->unpacked = true;
+        return;
+    }
+    site->arg_count = count;
+    for(u32 i = 0; i < count; ++i) {
+        site->strings |= site->args[i].type == ELOG_ARG_STRING;
+    }
+}
+
+// the first thread to use a site in this log parses it and writes its definition
+static u32 register_site(elog_site *site) {
+    while(__atomic_test_and_set(&sink.site_lock, __ATOMIC_ACQUIRE)) {
+    }
+    u64 key = __atomic_load_n(&site->key, __ATOMIC_RELAXED);
+    u32 id = (u32)key;
+    if((key >> 32) != sink.generation) {
+        if(!key) {
+            // the format doesn't change, parsed for the first log only
+            parse_layout(site);
+        }
+        id = ++sink.next_id;
+        write_site(site, id);
+        __atomic_store_n(&site->key, ((u64)sink.generation << 32) | id, __ATOMIC_RELEASE);
+    }
+    __atomic_clear(&sink.site_lock, __ATOMIC_RELEASE);
+    return id;
+}
+
+static inline u32 site_id(elog_site *site) {
+    // acquire: the layout is set before the key
+    u64 key = __atomic_load_n(&site->key, __ATOMIC_ACQUIRE);
+    if(__builtin_expect((key >> 32) == sink.generation, 1)) {
+        return (u32)key;
+    }
+    return register_site(site);
+}
+
+u8 elog_binary_open(const char *path, u64 capacity) {
+    if(elog_binary_enabled) {
+        EWARN("a binary log is already open");
+        return false;
+    }
+    if(!capacity) {
+        capacity = ELOG_BINARY_DEFAULT_CAPACITY;
+    }
+    capacity = (capacity + 4095) & ~4095ull;
+
+    sink.data = esysmap_file(path, capacity, &sink.fd);
+    if(!sink.data) {
+        EERROR("couldn't map the binary log %s", path);
+        return false;
+    }
+    // write faults would land in the traced code: a shared file mapping
+    // still faults on the first write of each page, even populated
+    for(u64 offset = 0; offset < capacity; offset += 4096) {
+        ((volatile u8 *)sink.data)[offset] = 0;
+    }
+    sink.capacity = capacity;
+    sink.used = HEADER_SIZE;
+    sink.end = capacity;
+    sink.start_ns = eclock_now_ns();
+    ++sink.generation;
+    sink.next_id = 0;
+    sink.dropped = 0;
+
+    elog_binary_header *header = (elog_binary_header *)sink.data;
+    memcpy(header->magic, "EGGBLOG", 8);
+    header->version = ELOG_BINARY_VERSION;
+    header->header_size = HEADER_SIZE;
+    header->start_ns = sink.start_ns;
+    header->used = 0;
+
+    __atomic_store_n(&elog_binary_enabled, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+void elog_binary_close() {
+    if(!elog_binary_enabled) {
+        return;
+    }
+    __atomic_store_n(&elog_binary_enabled, false, __ATOMIC_RELEASE);
+
+    u64 end = sink.used < sink.end ? sink.used : sink.end;
+    ((elog_binary_header *)sink.data)->used = end - HEADER_SIZE;
+    esysunmap_file(sink.data, sink.capacity, sink.fd, end);
+    sink.data = 0;
+    if(sink.dropped) {
+        EWARN("%llu binary log records dropped, log full", sink.dropped);
+    }
+}
+
+// packed from the format, through the stack
+static void write_unpacked(elog_site *site, u32 id, va_list *args) {
+    _Alignas(8) u8 staging[ELOG_BINARY_MAX_RECORD];
+    elog_binary_record *record = (elog_binary_record *)staging;
+    u32 args_size;
+    if(!elog_pack_args(site->format, args, staging + sizeof(elog_binary_record), ELOG_BINARY_MAX_RECORD - sizeof(elog_binary_record), &args_size)) {
+        args_size = 0;
+        id |= ELOG_BINARY_TRUNCATED;
+    }
+    record->size = sizeof(elog_binary_record) + args_size;
+    record->id = id;
+    record->time_ns = eclock_now_ns() - sink.start_ns;
+    u8 *at = reserve(record->size);
+    if(at) {
+        memcpy(at, staging, record->size);
+    }
+}
+
+void elog_binary_write(elog_site *site, ...) {
+    u32 id = site_id(site);
+    va_list args;
+    va_start(args, site);
+    if(__builtin_expect(site->unpacked, 0)) {
+        write_unpacked(site, id, &args);
+        va_end(args);
+        return;
+    }
+
+    // the size is known from the layout unless there are strings to measure
+    u32 lengths[ELOG_SITE_MAX_ARGS];
+    u32 args_size = 8 * site->arg_count;
+    if(site->strings) {
+        va_list measured;
+        va_copy(measured, args);
+        args_size = elog_measure_layout(site->args, site->arg_count, &measured, lengths);
+        va_end(measured);
+    }
+    if(args_size > ELOG_BINARY_MAX_RECORD - sizeof(elog_binary_record)) {
+        args_size = 0;
+        id |= ELOG_BINARY_TRUNCATED;
+    }
+
+    // packed in place, no staging copy
+    u32 size = sizeof(elog_binary_record) + args_size;
+    elog_binary_record *record = (elog_binary_record *)reserve(size);
+    if(record) {
+        record->id = id;
+        record->time_ns = eclock_now_ns() - sink.start_ns;
+        if(args_size) {
+            elog_pack_layout(site->args, site->arg_count, &args, lengths, (u8 *)(record + 1));
+        }
+        // last, a record of size 0 ends them after a crash
+        __atomic_store_n(&record->size, size, __ATOMIC_RELEASE);
+    }
+    va_end(args);
+}
+
+u64 elog_binary_dropped() {
+    return __atomic_load_n(&sink.dropped, __ATOMIC_RELAXED);
+}
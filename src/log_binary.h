@@ -0,0 +1,92 @@
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include "defines.h"
+#include "logger.h"
+#include "log_format.h"
+
+// Binary log: each call site registers itself once and gets an id, records
+// then only hold that id, a timestamp and the arguments packed as
+// elog_pack_args would, written in place in a memory-mapped file reserved
+// with one atomic add. The argument layout of a site is parsed from its format
+// when first registered. Site definitions (level, location, format) go in the
+// file too, when first used, build/elog_decode turns it back into text. Open
+// and close from the main thread while nothing traces.
+
+#define ELOG_BINARY_VERSION 1
+#define ELOG_BINARY_DEFAULT_CAPACITY (64 * 1024 * 1024)
+// record header and packed arguments
+#define ELOG_BINARY_MAX_RECORD 4096
+// in elog_binary_record.id
+#define ELOG_BINARY_SITE (1u << 31)
+#define ELOG_BINARY_TRUNCATED (1u << 30)
+#define ELOG_BINARY_ID_MASK (ELOG_BINARY_TRUNCATED - 1)
+// sites reading more arguments are packed from their format
+#define ELOG_SITE_MAX_ARGS 16
+
+typedef struct elog_site {
+    const char *format;
+    const char *file;
+    i32 line;
+    u8 level;
+    // log generation << 32 | id, 0 until first written
+    u64 key;
+    // set when first registered
+    elog_arg args[ELOG_SITE_MAX_ARGS];
+    u8 arg_count;
+    // more than ELOG_SITE_MAX_ARGS arguments
+    u8 unpacked;
+    u8 strings;
+} elog_site;
+
+// file layout, records follow the header
+typedef struct elog_binary_header {
+    // "EGGBLOG"
+    char magic[8];
+    u32 version;
+    u32 header_size;
+    // eclock_now_ns at open, record times are relative to it
+    u64 start_ns;
+    // bytes of records, set when closed, after a crash a record of size 0 ends them
+    u64 used;
+} elog_binary_header;
+
+// followed by the packed arguments
+typedef struct elog_binary_record {
+    // header included, multiple of 8
+    u32 size;
+    u32 id;
+    u64 time_ns;
+} elog_binary_record;
+
+// id has ELOG_BINARY_SITE set, followed by the file and format NUL terminated
+typedef struct elog_binary_site_record {
+    u32 size;
+    u32 id;
+    i32 line;
+    u32 level;
+    u32 file_length;
+    u32 format_length;
+} elog_binary_site_record;
+
+// set while a binary log is open
+EAPI extern u8 elog_binary_enabled;
+
+// capacity 0 for ELOG_BINARY_DEFAULT_CAPACITY, records past it are dropped
+EAPI u8 elog_binary_open(const char *path, u64 capacity);
+EAPI void elog_binary_close();
+EAPI void elog_binary_write(elog_site *site, ...);
+EAPI u64 elog_binary_dropped();
+
+// protocol tracing: to the binary log while one is open, else like EDEBUG
+#define ETRACE(msg, ...)                                                                       \
+    do {                                                                                       \
+        static elog_site etrace_site = { msg, __FILE__, __LINE__, LOG_LEVEL_DEBUG, 0 };        \
+        if(__builtin_expect(__atomic_load_n(&elog_binary_enabled, __ATOMIC_RELAXED), 0)) {     \
+            elog_binary_write(&etrace_site, ##__VA_ARGS__);                                    \
+        } else {                                                                               \
+            EDEBUG(msg, ##__VA_ARGS__);                                                        \
+        }                                                                                      \
+    } while(0)
+
+#endif // LOG_BINARY_H
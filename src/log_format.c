@@ -0,0 +1,457 @@
+#include "log_format.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *levels[5] = { "FATAL", "ERROR", "WARN", "INFO", "DEBUG" };
+
+typedef enum arg_type {
+    ARG_NONE,
+    ARG_SIGNED,
+    ARG_UNSIGNED,
+    ARG_DOUBLE,
+    ARG_STRING,
+    ARG_POINTER,
+} arg_type;
+
+typedef struct format_spec {
+    // at the '%'
+    const char *start;
+    const char *length_start;
+    // past the conversion
+    const char *end;
+    // 'H' for hh and 'q' for ll
+    char length;
+    char conversion;
+    u8 stars;
+    // -1 when there is none, -2 when it is an argument
+    i32 precision;
+    arg_type type;
+} format_spec;
+
+// p at a '%'
+static void parse_spec(const char *p, format_spec *spec) {
+    spec->start = p++;
+    spec->stars = 0;
+    spec->length = 0;
+    spec->precision = -1;
+
+    while(*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '\'') {
+        ++p;
+    }
+    if(*p == '*') {
+        ++spec->stars;
+        ++p;
+    } else {
+        while(*p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+    if(*p == '.') {
+        ++p;
+        if(*p == '*') {
+            ++spec->stars;
+            spec->precision = -2;
+            ++p;
+        } else {
+            spec->precision = 0;
+            while(*p >= '0' && *p <= '9') {
+                spec->precision = spec->precision * 10 + (*p - '0');
+                ++p;
+            }
+        }
+    }
+
+    spec->length_start = p;
+    switch(*p) {
+        case 'h':
+            spec->length = p[1] == 'h' ? 'H' : 'h';
+            p += p[1] == 'h' ? 2 : 1;
+            break;
+        case 'l':
+            spec->length = p[1] == 'l' ? 'q' : 'l';
+            p += p[1] == 'l' ? 2 : 1;
+            break;
+        case 'j': case 'z': case 't': case 'L':
+            spec->length = *p++;
+            break;
+    }
+
+    spec->conversion = *p;
+    spec->end = *p ? p + 1 : p;
+    switch(*p) {
+        case 'd': case 'i': case 'c':
+            spec->type = ARG_SIGNED;
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            spec->type = ARG_UNSIGNED;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec->type = ARG_DOUBLE;
+            break;
+        case 's':
+            spec->type = ARG_STRING;
+            break;
+        case 'p': case 'n':
+            spec->type = ARG_POINTER;
+            break;
+        default:
+            spec->type = ARG_NONE;
+            break;
+    }
+}
+
+static i64 read_signed(char length, va_list *args) {
+    switch(length) {
+        case 'H': return (signed char)va_arg(*args, int);
+        case 'h': return (short)va_arg(*args, int);
+        case 'l': return va_arg(*args, long);
+        case 'q': return va_arg(*args, long long);
+        case 'j': return va_arg(*args, intmax_t);
+        case 'z': return va_arg(*args, size_t);
+        case 't': return va_arg(*args, ptrdiff_t);
+        default: return va_arg(*args, int);
+    }
+}
+
+static u64 read_unsigned(char length, va_list *args) {
+    switch(length) {
+        case 'H': return (unsigned char)va_arg(*args, unsigned int);
+        case 'h': return (unsigned short)va_arg(*args, unsigned int);
+        case 'l': return va_arg(*args, unsigned long);
+        case 'q': return va_arg(*args, unsigned long long);
+        case 'j': return va_arg(*args, uintmax_t);
+        case 'z': return va_arg(*args, size_t);
+        case 't': return va_arg(*args, ptrdiff_t);
+        default: return va_arg(*args, unsigned int);
+    }
+}
+
+u8 elog_pack_args(const char *format, va_list *args, u8 *out, u32 capacity, u32 *size) {
+    u32 used = 0;
+    for(const char *p = format; *p; ++p) {
+        if(*p != '%') {
+            continue;
+        }
+        format_spec spec;
+        parse_spec(p, &spec);
+        p = spec.end - 1;
+        if(used + 8 * (spec.stars + 1) > capacity) {
+            return false;
+        }
+
+        i32 precision = spec.precision;
+        for(u8 i = 0; i < spec.stars; ++i) {
+            i64 value = va_arg(*args, int);
+            memcpy(out + used, &value, 8);
+            used += 8;
+            if(precision == -2 && i + 1 == spec.stars) {
+                // a negative precision is taken as if it were omitted
+                precision = value < 0 ? -1 : (i32)value;
+            }
+        }
+        switch(spec.type) {
+            case ARG_SIGNED: {
+                i64 value = spec.conversion == 'c' ? va_arg(*args, int) : read_signed(spec.length, args);
+                memcpy(out + used, &value, 8);
+                used += 8;
+            } break;
+            case ARG_UNSIGNED: {
+                u64 value = read_unsigned(spec.length, args);
+                memcpy(out + used, &value, 8);
+                used += 8;
+            } break;
+            case ARG_DOUBLE: {
+                f64 value = spec.length == 'L' ? (f64)va_arg(*args, long double) : va_arg(*args, f64);
+                memcpy(out + used, &value, 8);
+                used += 8;
+            } break;
+            case ARG_POINTER: {
+                void *value = va_arg(*args, void *);
+                memcpy(out + used, &value, 8);
+                used += 8;
+            } break;
+            case ARG_STRING: {
+                const char *string = va_arg(*args, const char *);
+                if(!string) {
+                    string = "(null)";
+                }
+                // with a precision the string doesn't have to be terminated
+                u64 max = precision >= 0 && precision < ELOG_MAX_STRING ? (u64)precision : ELOG_MAX_STRING;
+                u64 length = strnlen(string, max);
+                u64 stored = (length + 1 + 7) & ~7ull;
+                if(used + 8 + stored > capacity) {
+                    return false;
+                }
+                memcpy(out + used, &length, 8);
+                memcpy(out + used + 8, string, length);
+                memset(out + used + 8 + length, 0, stored - length);
+                used += 8 + stored;
+            } break;
+            case ARG_NONE:
+                break;
+        }
+    }
+    *size = used;
+    return true;
+}
+
+u8 elog_parse_layout(const char *format, elog_arg *layout, u32 capacity, u32 *count) {
+    u32 used = 0;
+    for(const char *p = format; *p; ++p) {
+        if(*p != '%') {
+            continue;
+        }
+        format_spec spec;
+        parse_spec(p, &spec);
+        p = spec.end - 1;
+        if(used + spec.stars + (spec.type != ARG_NONE) > capacity) {
+            return false;
+        }
+
+        for(u8 i = 0; i < spec.stars; ++i) {
+            u8 precision = spec.precision == -2 && i + 1 == spec.stars;
+            layout[used++] = (elog_arg){ .type = precision ? ELOG_ARG_PRECISION : ELOG_ARG_INT };
+        }
+        elog_arg arg = {0};
+        switch(spec.type) {
+            case ARG_SIGNED:
+                arg.type = spec.conversion == 'c' ? ELOG_ARG_INT
+                         : spec.length == 'H' ? ELOG_ARG_SCHAR
+                         : spec.length == 'h' ? ELOG_ARG_SHORT
+                         : spec.length ? ELOG_ARG_I64 : ELOG_ARG_INT;
+                break;
+            case ARG_UNSIGNED:
+                arg.type = spec.length == 'H' ? ELOG_ARG_UCHAR
+                         : spec.length == 'h' ? ELOG_ARG_USHORT
+                         : spec.length ? ELOG_ARG_U64 : ELOG_ARG_UINT;
+                break;
+            case ARG_DOUBLE:
+                arg.type = spec.length == 'L' ? ELOG_ARG_LONG_DOUBLE : ELOG_ARG_F64;
+                break;
+            case ARG_POINTER:
+                arg.type = ELOG_ARG_POINTER;
+                break;
+            case ARG_STRING:
+                arg.type = ELOG_ARG_STRING;
+                arg.precision = spec.precision >= 0 && spec.precision < ELOG_MAX_STRING ? spec.precision : ELOG_MAX_STRING;
+                break;
+            case ARG_NONE:
+                continue;
+        }
+        layout[used++] = arg;
+    }
+    *count = used;
+    return true;
+}
+
+u32 elog_measure_layout(const elog_arg *layout, u32 count, va_list *args, u32 *lengths) {
+    u32 size = 8 * count;
+    // star precision of the spec being read, -1 for none
+    i64 precision = -1;
+    for(u32 i = 0; i < count; ++i) {
+        switch(layout[i].type) {
+            case ELOG_ARG_PRECISION: {
+                i64 value = va_arg(*args, int);
+                // a negative precision is taken as if it were omitted
+                precision = value >= 0 && value < ELOG_MAX_STRING ? value : ELOG_MAX_STRING;
+                continue;
+            }
+            case ELOG_ARG_STRING: {
+                const char *string = va_arg(*args, const char *);
+                u64 max = precision >= 0 ? (u64)precision : layout[i].precision;
+                lengths[i] = strnlen(string ? string : "(null)", max);
+                size += (lengths[i] + 1 + 7) & ~7u;
+            } break;
+            case ELOG_ARG_I64: case ELOG_ARG_U64: va_arg(*args, u64); break;
+            case ELOG_ARG_F64: va_arg(*args, f64); break;
+            case ELOG_ARG_LONG_DOUBLE: va_arg(*args, long double); break;
+            case ELOG_ARG_POINTER: va_arg(*args, void *); break;
+            default: va_arg(*args, int); break;
+        }
+        precision = -1;
+    }
+    return size;
+}
+
+void elog_pack_layout(const elog_arg *layout, u32 count, va_list *args, const u32 *lengths, u8 *out) {
+    for(u32 i = 0; i < count; ++i) {
+        u64 value;
+        switch(layout[i].type) {
+            case ELOG_ARG_INT: case ELOG_ARG_PRECISION: {
+                i64 v = va_arg(*args, int);
+                memcpy(&value, &v, 8);
+            } break;
+            case ELOG_ARG_UINT: value = va_arg(*args, unsigned int); break;
+            case ELOG_ARG_SCHAR: {
+                i64 v = (signed char)va_arg(*args, int);
+                memcpy(&value, &v, 8);
+            } break;
+            case ELOG_ARG_UCHAR: value = (unsigned char)va_arg(*args, unsigned int); break;
+            case ELOG_ARG_SHORT: {
+                i64 v = (short)va_arg(*args, int);
+                memcpy(&value, &v, 8);
+            } break;
+            case ELOG_ARG_USHORT: value = (unsigned short)va_arg(*args, unsigned int); break;
+            case ELOG_ARG_I64: case ELOG_ARG_U64: value = va_arg(*args, u64); break;
+            case ELOG_ARG_F64: {
+                f64 v = va_arg(*args, f64);
+                memcpy(&value, &v, 8);
+            } break;
+            case ELOG_ARG_LONG_DOUBLE: {
+                f64 v = (f64)va_arg(*args, long double);
+                memcpy(&value, &v, 8);
+            } break;
+            case ELOG_ARG_POINTER: value = (u64)va_arg(*args, void *); break;
+            case ELOG_ARG_STRING: {
+                const char *string = va_arg(*args, const char *);
+                u64 length = lengths[i];
+                u64 stored = (length + 1 + 7) & ~7ull;
+                memcpy(out, &length, 8);
+                memcpy(out + 8, string ? string : "(null)", length);
+                memset(out + 8 + length, 0, stored - length);
+                out += 8 + stored;
+                continue;
+            }
+            default:
+                value = 0;
+                break;
+        }
+        memcpy(out, &value, 8);
+        out += 8;
+    }
+}
+
+// snprintf for a single spec, star arguments first
+#define FORMAT_ARG(out, capacity, spec, stars, star_count, value)                         \
+    ((star_count) == 0 ? snprintf(out, capacity, spec, value)                            \
+     : (star_count) == 1 ? snprintf(out, capacity, spec, (stars)[0], value)              \
+     : snprintf(out, capacity, spec, (stars)[0], (stars)[1], value))
+
+u64 elog_format_args(const char *format, const u8 *args, u32 args_size, char *out, u64 capacity) {
+    const u8 *arg = args;
+    const u8 *args_end = args + args_size;
+    u64 length = 0;
+    const char *p = format;
+    if(capacity == 0) {
+        return 0;
+    }
+
+    while(*p && length + 1 < capacity) {
+        const char *next = strchr(p, '%');
+        if(!next) {
+            next = p + strlen(p);
+        }
+        u64 literal = next - p;
+        if(literal > capacity - 1 - length) {
+            literal = capacity - 1 - length;
+        }
+        memcpy(out + length, p, literal);
+        length += literal;
+        if(!*next) {
+            break;
+        }
+
+        format_spec spec;
+        parse_spec(next, &spec);
+        p = spec.end;
+        u8 value_count = spec.type == ARG_NONE ? 0 : 1;
+        if(arg + 8 * (spec.stars + value_count) > args_end) {
+            // truncated or mismatched arguments, nothing sensible to print
+            break;
+        }
+
+        i32 stars[2] = { 0, 0 };
+        for(u8 i = 0; i < spec.stars; ++i) {
+            i64 value;
+            memcpy(&value, arg, 8);
+            stars[i] = (i32)value;
+            arg += 8;
+        }
+
+        // same spec, the length modifier replaced by the packed type
+        char spec_format[32];
+        u64 prefix = spec.length_start - spec.start;
+        if(prefix > sizeof(spec_format) - 4) {
+            prefix = sizeof(spec_format) - 4;
+        }
+        memcpy(spec_format, spec.start, prefix);
+        u64 spec_length = prefix;
+        if((spec.type == ARG_SIGNED && spec.conversion != 'c') || spec.type == ARG_UNSIGNED) {
+            spec_format[spec_length++] = 'l';
+            spec_format[spec_length++] = 'l';
+        }
+        spec_format[spec_length++] = spec.conversion;
+        spec_format[spec_length] = 0;
+
+        char *at = out + length;
+        u64 left = capacity - length;
+        i32 written = 0;
+        switch(spec.type) {
+            case ARG_SIGNED: {
+                i64 value;
+                memcpy(&value, arg, 8);
+                arg += 8;
+                if(spec.conversion == 'c') {
+                    written = FORMAT_ARG(at, left, spec_format, stars, spec.stars, (int)value);
+                } else {
+                    written = FORMAT_ARG(at, left, spec_format, stars, spec.stars, (long long)value);
+                }
+            } break;
+            case ARG_UNSIGNED: {
+                u64 value;
+                memcpy(&value, arg, 8);
+                arg += 8;
+                written = FORMAT_ARG(at, left, spec_format, stars, spec.stars, (unsigned long long)value);
+            } break;
+            case ARG_DOUBLE: {
+                f64 value;
+                memcpy(&value, arg, 8);
+                arg += 8;
+                written = FORMAT_ARG(at, left, spec_format, stars, spec.stars, value);
+            } break;
+            case ARG_POINTER: {
+                void *value;
+                memcpy(&value, arg, 8);
+                arg += 8;
+                if(spec.conversion == 'p') {
+                    written = FORMAT_ARG(at, left, spec_format, stars, spec.stars, value);
+                }
+            } break;
+            case ARG_STRING: {
+                u64 string_length;
+                memcpy(&string_length, arg, 8);
+                u64 stored = (string_length + 1 + 7) & ~7ull;
+                if(string_length > ELOG_MAX_STRING || arg + 8 + stored > args_end) {
+                    return length;
+                }
+                written = FORMAT_ARG(at, left, spec_format, stars, spec.stars, (const char *)(arg + 8));
+                arg += 8 + stored;
+            } break;
+            case ARG_NONE:
+                // "%%" or an unknown conversion, kept as is
+                written = spec.conversion == '%' ? snprintf(at, left, "%%") : snprintf(at, left, "%.*s", (int)(spec.end - spec.start), spec.start);
+                break;
+        }
+        if(written > 0) {
+            length += (u64)written < left ? (u64)written : left - 1;
+        }
+    }
+    out[length] = 0;
+    return length;
+}
+
+u64 elog_format_prefix(log_level level, const char *file, i32 line, char *out, u64 capacity) {
+    i32 written;
+    if(file && line >= 0) {
+        written = snprintf(out, capacity, "%s(%s:%u): ", levels[level], file, line);
+    } else {
+        written = snprintf(out, capacity, "%s: ", levels[level]);
+    }
+    if(written < 0) {
+        return 0;
+    }
+    return (u64)written < capacity ? (u64)written : capacity - 1;
+}
@@ -0,0 +1,54 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include "defines.h"
+#include "logger.h"
+
+#include <stdarg.h>
+
+// Packed printf arguments, to format a message later or somewhere else: every
+// argument takes 8 bytes (integers widened, floats as f64, pointers), strings
+// are their length then their bytes, NUL terminated and rounded up to 8.
+// The format is needed to read them back.
+
+// false if the arguments don't fit in capacity, size is then undefined
+EAPI u8 elog_pack_args(const char *format, va_list *args, u8 *out, u32 capacity, u32 *size);
+
+typedef enum elog_arg_type {
+    ELOG_ARG_INT,
+    ELOG_ARG_UINT,
+    ELOG_ARG_SCHAR,
+    ELOG_ARG_UCHAR,
+    ELOG_ARG_SHORT,
+    ELOG_ARG_USHORT,
+    ELOG_ARG_I64,
+    ELOG_ARG_U64,
+    ELOG_ARG_F64,
+    ELOG_ARG_LONG_DOUBLE,
+    ELOG_ARG_POINTER,
+    ELOG_ARG_STRING,
+    // int star precision, applies to the string that follows
+    ELOG_ARG_PRECISION,
+} elog_arg_type;
+
+// one argument read, so that packing doesn't parse the format again
+typedef struct elog_arg {
+    u8 type;
+    // strings: most bytes kept
+    u16 precision;
+} elog_arg;
+
+// false if the format reads more than capacity arguments
+EAPI u8 elog_parse_layout(const char *format, elog_arg *layout, u32 capacity, u32 *count);
+// size elog_pack_layout writes, the string lengths are kept for it
+EAPI u32 elog_measure_layout(const elog_arg *layout, u32 count, va_list *args, u32 *lengths);
+// the same bytes as elog_pack_args, out holds the measured size (8 per
+// argument when there are no strings, lengths are then unused)
+EAPI void elog_pack_layout(const elog_arg *layout, u32 count, va_list *args, const u32 *lengths, u8 *out);
+// formats like printf would have, one spec at a time, returns the length
+// written without the NUL, at most capacity - 1
+EAPI u64 elog_format_args(const char *format, const u8 *args, u32 args_size, char *out, u64 capacity);
+// "LEVEL(file:line): ", without the location when file is 0 or line negative
+EAPI u64 elog_format_prefix(log_level level, const char *file, i32 line, char *out, u64 capacity);
+
+#endif // LOG_FORMAT_H
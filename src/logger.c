@@ -1,35 +1,330 @@
 #include "logger.h"
 
+#include "log_format.h"
+#include "thread.h"
+#include "clock.h"
+
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
-void elog(log_level level, const char *file, i32 line, const char *msg, ...) {
-    const char *levels[5] = { "FATAL", "ERROR", "WARN", "INFO", "DEBUG" };
+#define RECORD_PADDING 1
+// the arguments didn't fit, only the format is kept
+#define RECORD_TRUNCATED 2
+// header, arguments and copied strings
+#define MAX_RECORD 4096
+#define BATCH_SIZE (64 * 1024)
+#define WRITER_SLEEP_NS 1000000ull
+
+// followed by the arguments packed by elog_pack_args
+typedef struct log_record {
+    u32 size;
+    u8 level;
+    u8 flags;
+    i32 line;
+    const char *file;
+    const char *format;
+} log_record;
+
+// padding records only have their first 8 bytes written
+#define RECORD_PADDING_SIZE offsetof(log_record, line)
+
+typedef struct log_ring {
+    // written by the logging thread
+    u64 head;
+    u8 pad0[56];
+    // written by the writer, once the records are output
+    u64 tail;
+    u8 pad1[56];
+    u8 data[ELOG_RING_SIZE];
+} log_ring;
+
+static struct {
+    log_ring rings[ELOG_MAX_THREADS];
+
+    elog_output_fn output;
+    void *user;
+
+    ethread writer;
+    // elog enqueues
+    u8 async;
+    // the writer loops
+    u8 running;
+    u64 dropped;
+    u64 reported_dropped;
+
+    // stdout, stderr
+    char batches[2][BATCH_SIZE];
+    u64 batch_lengths[2];
+} logger;
+
+static __thread u8 thread_is_writer;
+
+static void write_standard(void *user, u8 is_error, const char *text, u64 length) {
+    fwrite(text, 1, length, is_error ? stderr : stdout);
+}
+
+static void output(u8 is_error, const char *text, u64 length) {
+    if(logger.output) {
+        logger.output(logger.user, is_error, text, length);
+    } else {
+        write_standard(0, is_error, text, length);
+    }
+}
+
+static void batch_record(const log_record *record) {
+    u8 is_error = record->level <= LOG_LEVEL_WARN;
+    if(BATCH_SIZE - logger.batch_lengths[is_error] < ELOG_MAX_LINE) {
+        output(is_error, logger.batches[is_error], logger.batch_lengths[is_error]);
+        logger.batch_lengths[is_error] = 0;
+    }
+    char *line = logger.batches[is_error] + logger.batch_lengths[is_error];
+    u64 length = elog_format_prefix(record->level, record->file, record->line, line, ELOG_MAX_LINE);
+    if(record->flags & RECORD_TRUNCATED) {
+        i32 written = snprintf(line + length, ELOG_MAX_LINE - 1 - length, "%s [arguments too large]", record->format);
+        length += written > 0 && (u64)written < ELOG_MAX_LINE - 1 - length ? (u64)written : 0;
+    } else {
+        length += elog_format_args(record->format, (const u8 *)(record + 1), record->size - sizeof(log_record), line + length, ELOG_MAX_LINE - 1 - length);
+    }
+    line[length++] = '\n';
+    logger.batch_lengths[is_error] += length;
+}
+
+// formats and writes everything queued, returns whether there was anything
+static u8 drain() {
+    u64 tails[ELOG_MAX_THREADS];
+    u8 drained = false;
+    for(u32 i = 0; i < ELOG_MAX_THREADS; ++i) {
+        log_ring *ring = &logger.rings[i];
+        u64 tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        u64 head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        while(tail < head) {
+            const log_record *record = (const log_record *)(ring->data + (tail & (ELOG_RING_SIZE - 1)));
+            if(!(record->flags & RECORD_PADDING)) {
+                batch_record(record);
+            }
+            tail += record->size;
+            drained = true;
+        }
+        tails[i] = tail;
+    }
+
+    u64 dropped = __atomic_load_n(&logger.dropped, __ATOMIC_RELAXED);
+    if(dropped != logger.reported_dropped) {
+        log_record record = { .level = LOG_LEVEL_WARN, .line = -1, .format = "%llu log messages dropped, ring full" };
+        u8 packed[sizeof(log_record) + 8];
+        u64 count = dropped - logger.reported_dropped;
+        memcpy(packed, &record, sizeof(log_record));
+        memcpy(packed + sizeof(log_record), &count, 8);
+        batch_record((const log_record *)packed);
+        logger.reported_dropped = dropped;
+    }
+
+    for(u8 is_error = 0; is_error < 2; ++is_error) {
+        if(logger.batch_lengths[is_error]) {
+            output(is_error, logger.batches[is_error], logger.batch_lengths[is_error]);
+            logger.batch_lengths[is_error] = 0;
+        }
+    }
+    if(drained && !logger.output) {
+        fflush(stdout);
+    }
 
-    char out_msg[32000];
-    memset(out_msg, 0, sizeof(out_msg));
+    // only now, so that elog_flush returns once the records are written
+    for(u32 i = 0; i < ELOG_MAX_THREADS; ++i) {
+        __atomic_store_n(&logger.rings[i].tail, tails[i], __ATOMIC_RELEASE);
+    }
+    return drained;
+}
 
-    u8 out_msg_idx = 0;
-    strcpy(out_msg, levels[level]);
-    out_msg_idx += strlen(levels[level]);
+static void *writer_main(void *arg) {
+    thread_is_writer = true;
+    while(__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)) {
+        if(!drain()) {
+            eclock_sleep_ns(WRITER_SLEEP_NS);
+        }
+    }
+    drain();
+    return 0;
+}
 
-    if(file && line >= 0) {
-        out_msg_idx += sprintf(out_msg + out_msg_idx, "(%s:%u)", file, line);
+// returns false when the calling thread has no ring
+static u8 enqueue(log_level level, const char *file, i32 line, const char *msg, va_list *args) {
+    u32 index = ethread_index();
+    if(index >= ELOG_MAX_THREADS) {
+        return false;
     }
+    log_ring *ring = &logger.rings[index];
 
-    strcpy(out_msg + out_msg_idx, ": ");
-    out_msg_idx += 2;
+    _Alignas(8) u8 staging[MAX_RECORD];
+    log_record *record = (log_record *)staging;
+    u32 size;
+    record->flags = 0;
+    if(elog_pack_args(msg, args, staging + sizeof(log_record), MAX_RECORD - sizeof(log_record), &size)) {
+        size += sizeof(log_record);
+    } else {
+        size = sizeof(log_record);
+        record->flags = RECORD_TRUNCATED;
+    }
+    record->size = size;
+    record->level = level;
+    record->line = line;
+    record->file = file;
+    record->format = msg;
+
+    u64 head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    u64 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    u64 offset = head & (ELOG_RING_SIZE - 1);
+    // records never wrap, the end of the ring is skipped instead
+    u64 padding = offset + size > ELOG_RING_SIZE ? ELOG_RING_SIZE - offset : 0;
+    if(head + padding + size - tail > ELOG_RING_SIZE) {
+        __atomic_add_fetch(&logger.dropped, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    if(padding) {
+        log_record skip = { .size = padding, .flags = RECORD_PADDING };
+        memcpy(ring->data + offset, &skip, RECORD_PADDING_SIZE);
+        head += padding;
+        offset = 0;
+    }
+    memcpy(ring->data + offset, staging, size);
+    __atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+    return true;
+}
 
+void elog(log_level level, const char *file, i32 line, const char *msg, ...) {
     va_list arg_ptr;
     va_start(arg_ptr, msg);
-    out_msg_idx += vsnprintf(out_msg + out_msg_idx, 32000 - out_msg_idx, msg, arg_ptr);
+    if(level == LOG_LEVEL_FATAL) {
+        // whatever led to it first, then straight out in case it's the last thing we do
+        elog_flush();
+    } else if(__atomic_load_n(&logger.async, __ATOMIC_ACQUIRE) && !thread_is_writer) {
+        if(enqueue(level, file, line, msg, &arg_ptr)) {
+            va_end(arg_ptr);
+            return;
+        }
+    }
+
+    char out_msg[ELOG_MAX_LINE];
+    u64 out_msg_idx = elog_format_prefix(level, file, line, out_msg, ELOG_MAX_LINE);
+    i32 written = vsnprintf(out_msg + out_msg_idx, ELOG_MAX_LINE - 1 - out_msg_idx, msg, arg_ptr);
     va_end(arg_ptr);
+    if(written > 0) {
+        out_msg_idx += (u64)written < ELOG_MAX_LINE - 1 - out_msg_idx ? (u64)written : ELOG_MAX_LINE - 2 - out_msg_idx;
+    }
+    out_msg[out_msg_idx++] = '\n';
 
     const u8 is_error = level <= LOG_LEVEL_WARN;
-    if(is_error) {
-        fprintf(stderr, "%s\n", out_msg); 
-    } else {
-        printf("%s\n", out_msg);
+    output(is_error, out_msg, out_msg_idx);
+    if(level == LOG_LEVEL_FATAL) {
+        fflush(stdout);
+    }
+}
+
+u8 elog_async_start() {
+    if(logger.async) {
+        return true;
+    }
+    __atomic_store_n(&logger.running, true, __ATOMIC_RELEASE);
+    if(!ethread_create(writer_main, 0, &logger.writer)) {
+        logger.running = false;
+        return false;
+    }
+    __atomic_store_n(&logger.async, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+void elog_async_stop() {
+    if(!logger.async) {
+        return;
+    }
+    __atomic_store_n(&logger.async, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&logger.running, false, __ATOMIC_RELEASE);
+    ethread_join(&logger.writer);
+}
+
+void elog_flush() {
+    if(!__atomic_load_n(&logger.async, __ATOMIC_ACQUIRE) || thread_is_writer) {
+        return;
+    }
+    u64 heads[ELOG_MAX_THREADS];
+    for(u32 i = 0; i < ELOG_MAX_THREADS; ++i) {
+        heads[i] = __atomic_load_n(&logger.rings[i].head, __ATOMIC_ACQUIRE);
+    }
+    for(u32 i = 0; i < ELOG_MAX_THREADS; ++i) {
+        while(__atomic_load_n(&logger.rings[i].tail, __ATOMIC_ACQUIRE) < heads[i]) {
+            ethread_yield();
+        }
+    }
+}
+
+u64 elog_dropped() {
+    return __atomic_load_n(&logger.dropped, __ATOMIC_RELAXED);
+}
+
+void elog_set_output(elog_output_fn output, void *user) {
+    logger.output = output;
+    logger.user = user;
+}
+
+u8 elog_levels[ELOG_MODULE_COUNT] = {
+    LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG,
+};
+
+static const char *module_names[ELOG_MODULE_COUNT] = { "core", "memory", "ecs", "jobs", "window", "render" };
+static const char *level_names[5] = { "fatal", "error", "warn", "info", "debug" };
+
+void elog_set_level(elog_module module, log_level level) {
+    __atomic_store_n(&elog_levels[module], level, __ATOMIC_RELAXED);
+}
+
+// index of the name of length in names, or -1
+static i32 find_name(const char **names, u32 count, const char *name, u64 length) {
+    for(u32 i = 0; i < count; ++i) {
+        if(strlen(names[i]) == length && strncmp(names[i], name, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+u8 elog_set_levels(const char *spec) {
+    while(*spec) {
+        const char *end = strchr(spec, ',');
+        if(!end) {
+            end = spec + strlen(spec);
+        }
+        const char *equal = memchr(spec, '=', end - spec);
+        const char *level_name = equal ? equal + 1 : spec;
+        i32 level = find_name(level_names, 5, level_name, end - level_name);
+        if(level < 0) {
+            return false;
+        }
+        if(equal) {
+            i32 module = find_name(module_names, ELOG_MODULE_COUNT, spec, equal - spec);
+            if(module < 0) {
+                return false;
+            }
+            elog_set_level(module, level);
+        } else {
+            for(u32 i = 0; i < ELOG_MODULE_COUNT; ++i) {
+                elog_set_level(i, level);
+            }
+        }
+        spec = *end ? end + 1 : end;
+    }
+    return true;
+}
+
+u8 elog_limit_pass(elog_limit *limit, u64 interval_ns, u32 *suppressed) {
+    u64 now = eclock_now_ns();
+    u64 next = __atomic_load_n(&limit->next_ns, __ATOMIC_RELAXED);
+    // one thread wins the interval, the others count as suppressed
+    if(now < next || !__atomic_compare_exchange_n(&limit->next_ns, &next, now + interval_ns, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(&limit->suppressed, 1, __ATOMIC_RELAXED);
+        return false;
     }
+    *suppressed = __atomic_exchange_n(&limit->suppressed, 0, __ATOMIC_RELAXED);
+    return true;
 }
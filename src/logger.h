@@ -17,17 +17,124 @@ typedef enum log_level {
     LOG_LEVEL_DEBUG = 4,
 } log_level;
 
+// longest line written, longer ones are truncated
+#define ELOG_MAX_LINE 8192
+// power of 2, bytes of pending records per thread in async mode
+#define ELOG_RING_SIZE (1 << 15)
+// threads past this one log synchronously
+#define ELOG_MAX_THREADS 32
+// longest string argument copied into a record
+#define ELOG_MAX_STRING 1024
+
+// receives whole lines, newline included, a batch of them in async mode
+typedef void (*elog_output_fn)(void *user, u8 is_error, const char *text, u64 length);
+
 EAPI void elog(log_level level, const char *file, i32 line, const char *msg, ...);
 
-#define EFATAL(msg, ...) elog(LOG_LEVEL_FATAL, __FILE__, __LINE__, msg, ##__VA_ARGS__)
-#define EERROR(msg, ...) elog(LOG_LEVEL_ERROR, __FILE__, __LINE__, msg, ##__VA_ARGS__)
-#define EWARN(msg, ...) elog(LOG_LEVEL_WARN, __FILE__, __LINE__, msg, ##__VA_ARGS__)
-#define EINFO(msg, ...) elog(LOG_LEVEL_INFO, 0, -1, msg, ##__VA_ARGS__)
+// Async mode: elog only copies the format pointer and its arguments (strings
+// included) into a lock-free ring owned by the calling thread, a writer thread
+// formats them and writes them in batches. Messages stay ordered per thread.
+// A full ring drops the message and counts it. Fatal messages flush the rings
+// and are written synchronously. Start and stop from the main thread.
+EAPI u8 elog_async_start();
+// flushes and joins the writer, logging is synchronous again
+EAPI void elog_async_stop();
+// returns once every message logged before the call is written
+EAPI void elog_flush();
+EAPI u64 elog_dropped();
+// 0 to write to stdout and stderr again
+EAPI void elog_set_output(elog_output_fn output, void *user);
 
-#if LOG_LEVEL >= 4
-    #define EDEBUG(msg, ...) elog(LOG_LEVEL_DEBUG, __FILE__, __LINE__, msg, ##__VA_ARGS__)
-#else
-    #define EDEBUG(msg, ...)
+// Modules: a file picks its own by defining ELOG_MODULE (CORE, MEMORY, ECS,
+// JOBS, WINDOW or RENDER) before any include, CORE otherwise. Calls above the
+// module's compile-time level are compiled out, the others check the
+// runtime level of the module, a single load and compare, before evaluating
+// their arguments.
+typedef enum elog_module {
+    ELOG_MODULE_CORE,
+    ELOG_MODULE_MEMORY,
+    ELOG_MODULE_ECS,
+    ELOG_MODULE_JOBS,
+    ELOG_MODULE_WINDOW,
+    ELOG_MODULE_RENDER,
+    ELOG_MODULE_COUNT
+} elog_module;
+
+// compile-time levels, e.g. -DELOG_LEVEL_WINDOW=2 (LOG_LEVELS in the Makefile)
+#ifndef ELOG_LEVEL_CORE
+    #define ELOG_LEVEL_CORE LOG_LEVEL
+#endif
+#ifndef ELOG_LEVEL_MEMORY
+    #define ELOG_LEVEL_MEMORY LOG_LEVEL
+#endif
+#ifndef ELOG_LEVEL_ECS
+    #define ELOG_LEVEL_ECS LOG_LEVEL
+#endif
+#ifndef ELOG_LEVEL_JOBS
+    #define ELOG_LEVEL_JOBS LOG_LEVEL
+#endif
+#ifndef ELOG_LEVEL_WINDOW
+    #define ELOG_LEVEL_WINDOW LOG_LEVEL
+#endif
+#ifndef ELOG_LEVEL_RENDER
+    #define ELOG_LEVEL_RENDER LOG_LEVEL
+#endif
+
+#ifndef ELOG_MODULE
+    #define ELOG_MODULE CORE
 #endif
 
+// runtime levels, everything compiled in is logged by default
+EAPI extern u8 elog_levels[ELOG_MODULE_COUNT];
+
+EAPI void elog_set_level(elog_module module, log_level level);
+// "window=debug,memory=warn", a lone level applies to every module,
+// false on an unknown name, the entries before it are applied
+EAPI u8 elog_set_levels(const char *spec);
+
+typedef struct elog_limit {
+    u64 next_ns;
+    u32 suppressed;
+} elog_limit;
+
+// true at most once per interval, suppressed gets the number of calls skipped since
+EAPI u8 elog_limit_pass(elog_limit *limit, u64 interval_ns, u32 *suppressed);
+
+#define ELOG_CONCAT_(a, b) a##b
+#define ELOG_CONCAT(a, b) ELOG_CONCAT_(a, b)
+#define ELOG_ENABLED(level) \
+    ((level) <= ELOG_CONCAT(ELOG_LEVEL_, ELOG_MODULE) && (level) <= elog_levels[ELOG_CONCAT(ELOG_MODULE_, ELOG_MODULE)])
+
+#define ELOG(level, file, line, msg, ...)                       \
+    do {                                                        \
+        if(ELOG_ENABLED(level)) {                               \
+            elog(level, file, line, msg, ##__VA_ARGS__);        \
+        }                                                       \
+    } while(0)
+
+// for hot paths: at most one message per interval_ms from the call site, the
+// skipped ones are counted and reported with the next one
+#define ELOG_LIMITED(level, file, line, interval_ms, msg, ...)                                                 \
+    do {                                                                                                        \
+        static elog_limit elog_site_limit;                                                                      \
+        u32 elog_suppressed;                                                                                    \
+        if(ELOG_ENABLED(level) && elog_limit_pass(&elog_site_limit, (interval_ms) * 1000000ull, &elog_suppressed)) { \
+            if(elog_suppressed) {                                                                               \
+                elog(level, file, line, "%u similar messages suppressed", elog_suppressed);                     \
+            }                                                                                                   \
+            elog(level, file, line, msg, ##__VA_ARGS__);                                                        \
+        }                                                                                                       \
+    } while(0)
+
+#define EFATAL(msg, ...) elog(LOG_LEVEL_FATAL, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#define EERROR(msg, ...) ELOG(LOG_LEVEL_ERROR, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#define EWARN(msg, ...) ELOG(LOG_LEVEL_WARN, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#define EINFO(msg, ...) ELOG(LOG_LEVEL_INFO, 0, -1, msg, ##__VA_ARGS__)
+#define EDEBUG(msg, ...) ELOG(LOG_LEVEL_DEBUG, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+
+#define EERROR_LIMITED(interval_ms, msg, ...) ELOG_LIMITED(LOG_LEVEL_ERROR, __FILE__, __LINE__, interval_ms, msg, ##__VA_ARGS__)
+#define EWARN_LIMITED(interval_ms, msg, ...) ELOG_LIMITED(LOG_LEVEL_WARN, __FILE__, __LINE__, interval_ms, msg, ##__VA_ARGS__)
+#define EINFO_LIMITED(interval_ms, msg, ...) ELOG_LIMITED(LOG_LEVEL_INFO, 0, -1, interval_ms, msg, ##__VA_ARGS__)
+#define EDEBUG_LIMITED(interval_ms, msg, ...) ELOG_LIMITED(LOG_LEVEL_DEBUG, __FILE__, __LINE__, interval_ms, msg, ##__VA_ARGS__)
+
 #endif // LOGGER_H
@@ -1,3 +1,5 @@
+#define ELOG_MODULE MEMORY
+
 #include "memlist.h"
 
 #include "llist.h"
@@ -39,7 +41,7 @@ u8 ememlist_allocate(ememlist *list, u64 size, u64 *offset) {
         previous = it;
     }
 
-    EWARN("cannot allocate space, no block with enough space found. Requested: %llu, available: %llu", size, ememlist_free_space(list));
+    EWARN_LIMITED(1000, "cannot allocate space, no block with enough space found. Requested: %llu, available: %llu", size, ememlist_free_space(list));
     return false;
 }
 
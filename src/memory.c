@@ -1,12 +1,17 @@
+#define ELOG_MODULE MEMORY
+
 #include "memory.h"
 
 #include "heap.h"
+#include "profiler.h"
 #include "darray.h"
+#include "thread.h"
 
 #include "logger.h"
 #include <sys/mman.h>
 
 void *esysalloc(u64 size);
+void *esysalloc_align(u64 size, u64 align);
 void esysfree(void *memory);
 void esysmemcpy(void *dest, const void *src, u64 size);
 void *esysmap(void *addr, u64 length, u32 prot, u32 flags, u32 fd, u32 offset);
@@ -35,14 +40,32 @@ typedef struct memory_state {
     eheap *heap;
     memory_stats stats;
     ememory_allocator allocator;
+    u8 shared;
+    emutex lock;
 } memory_state;
 
 memory_state memstate;
 
+// emap appends to the stats with erealloc, the lock is taken again
+static __thread u32 lock_depth;
+
+static void lock() {
+    if(memstate.shared && lock_depth++ == 0) {
+        emutex_lock(&memstate.lock);
+    }
+}
+
+static void unlock() {
+    if(memstate.shared && --lock_depth == 0) {
+        emutex_unlock(&memstate.lock);
+    }
+}
+
 u8 ememory_init(u64 size, eheap *heap_ptr) {
     memstate = (memory_state){0};
     memstate.size = size;
     memstate.heap = heap_ptr;
+    emutex_create(&memstate.lock);
     memstate.memory = esysmap(0, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
     eheap_create(memstate.size, memstate.memory, memstate.heap);
     // append stats with the custom allocator just created
@@ -54,6 +77,7 @@ u8 ememory_init(u64 size, eheap *heap_ptr) {
 u8 ememory_uninit() {
     eheap_destroy(memstate.heap);
     eunmap(memstate.memory, memstate.size);
+    emutex_destroy(&memstate.lock);
     return true;
 }
 
@@ -61,6 +85,10 @@ void ememory_set_allocator(ememory_allocator allocator) {
     memstate.allocator = allocator;
 }
 
+void ememory_set_shared(u8 shared) {
+    memstate.shared = shared;
+}
+
 void ememory_report() {
     EDEBUG("Showing memory usage:");
     EDEBUG("%d mmapped regions:", memstate.stats.mapped_regions.count);
@@ -72,18 +100,50 @@ void ememory_report() {
 }
 
 void *ealloc(u64 size) {
+    EPROFILE_SCOPE("ealloc");
+    void *memory;
+    lock();
+    switch(memstate.allocator) {
+        case EMEMORY_ALLOCATOR_SYSTEM:
+            ++memstate.stats.system_allocations_count;
+            memory = esysalloc(size);
+            break;
+        default:
+        case EMEMORY_ALLOCATOR_CUSTOM:
+            ++memstate.stats.custom_allocations_count;
+            memory = eheap_alloc(memstate.heap, size);
+            break;
+    }
+    unlock();
+    return memory;
+}
+
+void *ealloc_align(u64 size, u64 align) {
+    EPROFILE_SCOPE("ealloc_align");
+    void *memory;
+    lock();
     switch(memstate.allocator) {
         case EMEMORY_ALLOCATOR_SYSTEM:
             ++memstate.stats.system_allocations_count;
-            return esysalloc(size);
+            memory = esysalloc_align(size, align);
+            break;
         default:
         case EMEMORY_ALLOCATOR_CUSTOM:
             ++memstate.stats.custom_allocations_count;
-            return eheap_alloc(memstate.heap, size);
+            memory = eheap_alloc_align(memstate.heap, size, align);
+            break;
     }
+    unlock();
+    return memory;
 }
 
 void efree(void *memory) {
+    EPROFILE_SCOPE("efree");
+    // like free, so that callers don't have to check
+    if(!memory) {
+        return;
+    }
+    lock();
     switch(memstate.allocator) {
         case EMEMORY_ALLOCATOR_SYSTEM:
             --memstate.stats.system_allocations_count;
@@ -95,9 +155,11 @@ void efree(void *memory) {
             eheap_free(memstate.heap, memory);
             break;
     }
+    unlock();
 }
 
 void *erealloc(void *memory, u64 size) {
+    EPROFILE_SCOPE("erealloc");
     void *new_memory = ealloc(size);
     if(memory && new_memory) {
         u64 old_size = eheap_get_usable_size(memstate.heap, memory);
@@ -115,11 +177,14 @@ void ememcpy(void *dest, const void *src, u64 size) {
 void *emap(void *addr, u64 length, u32 prot, u32 flags, u32 fd, u32 offset) {
     void *ptr = esysmap(addr, length, prot, flags, fd, offset);
     memory_stats_region item = { .size = length, .start = ptr };
+    lock();
     darray_append(&memstate.stats.mapped_regions, item);
+    unlock();
     return ptr;
 }
 
 void eunmap(void *addr, u64 length) {
+    lock();
     darray_foreach(memory_stats_region, it, &memstate.stats.mapped_regions) {
         if(it->start == addr) {
             // delete it
@@ -128,5 +193,6 @@ void eunmap(void *addr, u64 length) {
             break;
         }
     }
+    unlock();
     return esysunmap(addr, length);
 }
@@ -12,8 +12,13 @@ typedef enum ememory_allocator {
 EAPI u8 ememory_init(u64 size, eheap *heap_ptr);
 EAPI u8 ememory_uninit();
 EAPI void ememory_set_allocator(ememory_allocator allocator);
+// while set, any thread may allocate: calls are serialized by a lock
+// only change it when a single thread uses the allocator
+EAPI void ememory_set_shared(u8 shared);
 EAPI void ememory_report();
 EAPI void *ealloc(u64 size);
+// align must be a power of 2, freed with efree
+EAPI void *ealloc_align(u64 size, u64 align);
 EAPI void efree(void *memory);
 EAPI void *erealloc(void *memory, u64 size);
 EAPI void ememcpy(void *dest, const void *src, u64 size);
@@ -0,0 +1,262 @@
+#include "profiler.h"
+
+#include "assert.h"
+#include "clock.h"
+#include "memory.h"
+#include "thread.h"
+
+#include <stdio.h>
+
+typedef struct eprofile_thread {
+    eprofile_event *events;
+    // events ever written, the ring keeps the last EPROFILE_RING_SIZE
+    u64 head;
+    // open zones
+    const char *names[EPROFILE_MAX_DEPTH];
+    u64 starts[EPROFILE_MAX_DEPTH];
+    u32 depth;
+    u8 used;
+} eprofile_thread;
+
+static struct {
+    u8 initialized;
+    eprofile_thread threads[EPROFILE_MAX_THREADS];
+
+    // tick to ns conversion
+    u64 base_ticks;
+    f64 ns_per_tick;
+
+    u64 frame_start;
+    u64 frame_count;
+    eprofile_zone_summary summary[EPROFILE_MAX_SUMMARY];
+    u32 summary_count;
+    u64 summary_frame_ticks;
+} profiler;
+
+static inline u64 now_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return eclock_now_ns();
+#endif
+}
+
+static void calibrate() {
+    u64 start_ticks = now_ticks();
+    u64 start_ns = eclock_now_ns();
+    eclock_sleep_ns(5000000);
+    u64 end_ticks = now_ticks();
+    u64 end_ns = eclock_now_ns();
+    profiler.base_ticks = start_ticks;
+    profiler.ns_per_tick = end_ticks > start_ticks ? (f64)(end_ns - start_ns) / (end_ticks - start_ticks) : 1.0;
+}
+
+static f64 ticks_to_ns(u64 ticks) {
+    return ticks * profiler.ns_per_tick;
+}
+
+u8 eprofile_init() {
+    if(profiler.initialized) {
+        return true;
+    }
+    for(u32 i = 0; i < EPROFILE_MAX_THREADS; ++i) {
+        eprofile_thread *thread = &profiler.threads[i];
+        *thread = (eprofile_thread){0};
+        thread->events = ealloc(EPROFILE_RING_SIZE * sizeof(eprofile_event));
+        if(!thread->events) {
+            EERROR("couldn't allocate profiler buffers");
+            return false;
+        }
+    }
+    calibrate();
+    profiler.frame_start = now_ticks();
+    profiler.frame_count = 0;
+    profiler.summary_count = 0;
+    // release: threads see the buffers before the flag
+    __atomic_store_n(&profiler.initialized, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+void eprofile_shutdown() {
+    if(!profiler.initialized) {
+        return;
+    }
+    __atomic_store_n(&profiler.initialized, false, __ATOMIC_RELEASE);
+    for(u32 i = 0; i < EPROFILE_MAX_THREADS; ++i) {
+        efree(profiler.threads[i].events);
+        profiler.threads[i].events = 0;
+    }
+}
+
+u8 eprofile_begin(const char *name) {
+    if(!__atomic_load_n(&profiler.initialized, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    u32 index = ethread_index();
+    if(index >= EPROFILE_MAX_THREADS) {
+        return false;
+    }
+    eprofile_thread *thread = &profiler.threads[index];
+    thread->used = true;
+    if(thread->depth < EPROFILE_MAX_DEPTH) {
+        thread->names[thread->depth] = name;
+        thread->starts[thread->depth] = now_ticks();
+    }
+    ++thread->depth;
+    return true;
+}
+
+void eprofile_end() {
+    u64 end = now_ticks();
+    if(!__atomic_load_n(&profiler.initialized, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    u32 index = ethread_index();
+    if(index >= EPROFILE_MAX_THREADS) {
+        return;
+    }
+    eprofile_thread *thread = &profiler.threads[index];
+    if(thread->depth == 0) {
+        // begun before init
+        return;
+    }
+    u32 depth = --thread->depth;
+    if(depth >= EPROFILE_MAX_DEPTH) {
+        return;
+    }
+    u64 head = thread->head;
+    thread->events[head & (EPROFILE_RING_SIZE - 1)] = (eprofile_event){
+        .name = thread->names[depth],
+        .start = thread->starts[depth],
+        .end = end,
+        .depth = depth,
+    };
+    // readers only look at events below head
+    __atomic_store_n(&thread->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void eprofile_scope_end(u8 *begun) {
+    if(*begun) {
+        eprofile_end();
+    }
+}
+
+static void summarize(eprofile_event *event) {
+    for(u32 i = 0; i < profiler.summary_count; ++i) {
+        eprofile_zone_summary *zone = &profiler.summary[i];
+        if(zone->name == event->name && zone->depth == event->depth) {
+            ++zone->calls;
+            zone->total += event->end - event->start;
+            zone->first_start = event->start < zone->first_start ? event->start : zone->first_start;
+            return;
+        }
+    }
+    if(profiler.summary_count < EPROFILE_MAX_SUMMARY) {
+        profiler.summary[profiler.summary_count++] = (eprofile_zone_summary){
+            .name = event->name,
+            .depth = event->depth,
+            .calls = 1,
+            .first_start = event->start,
+            .total = event->end - event->start,
+        };
+    }
+}
+
+void eprofile_frame() {
+    if(!profiler.initialized) {
+        return;
+    }
+    u64 frame_end = now_ticks();
+    profiler.summary_count = 0;
+
+    // zones that ended during the frame, on every thread
+    for(u32 t = 0; t < EPROFILE_MAX_THREADS; ++t) {
+        eprofile_thread *thread = &profiler.threads[t];
+        if(!thread->used) {
+            continue;
+        }
+        u64 head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        u64 oldest = head > EPROFILE_RING_SIZE ? head - EPROFILE_RING_SIZE : 0;
+        for(u64 i = head; i > oldest; --i) {
+            eprofile_event *event = &thread->events[(i - 1) & (EPROFILE_RING_SIZE - 1)];
+            if(event->end < profiler.frame_start) {
+                break;
+            }
+            if(event->end <= frame_end) {
+                summarize(event);
+            }
+        }
+    }
+
+    // insertion sort by start: the summary reads as a flame graph, top-down
+    for(u32 i = 1; i < profiler.summary_count; ++i) {
+        eprofile_zone_summary zone = profiler.summary[i];
+        u32 j = i;
+        while(j > 0 && profiler.summary[j - 1].first_start > zone.first_start) {
+            profiler.summary[j] = profiler.summary[j - 1];
+            --j;
+        }
+        profiler.summary[j] = zone;
+    }
+
+    profiler.summary_frame_ticks = frame_end - profiler.frame_start;
+    profiler.frame_start = frame_end;
+    ++profiler.frame_count;
+}
+
+void eprofile_report() {
+    if(!profiler.initialized) {
+        return;
+    }
+    static const char indent[] = "                                ";
+    EINFO("Showing profile of frame %llu (%.3f ms):", profiler.frame_count, ticks_to_ns(profiler.summary_frame_ticks) / 1000000.0);
+    for(u32 i = 0; i < profiler.summary_count; ++i) {
+        eprofile_zone_summary *zone = &profiler.summary[i];
+        u32 depth = zone->depth < 16 ? zone->depth : 16;
+        EINFO("  %.*s%s: %.3f ms (%u calls)", depth * 2, indent, zone->name, ticks_to_ns(zone->total) / 1000000.0, zone->calls);
+    }
+}
+
+u32 eprofile_frame_summary(eprofile_zone_summary *zones, u32 capacity) {
+    u32 count = profiler.summary_count < capacity ? profiler.summary_count : capacity;
+    for(u32 i = 0; i < count; ++i) {
+        zones[i] = profiler.summary[i];
+    }
+    return count;
+}
+
+u8 eprofile_export_chrome(const char *path) {
+    if(!profiler.initialized) {
+        return false;
+    }
+    FILE *file = fopen(path, "w");
+    if(!file) {
+        EERROR("couldn't open %s to write the trace", path);
+        return false;
+    }
+
+    u64 written = 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for(u32 t = 0; t < EPROFILE_MAX_THREADS; ++t) {
+        eprofile_thread *thread = &profiler.threads[t];
+        if(!thread->used) {
+            continue;
+        }
+        u64 head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        u64 oldest = head > EPROFILE_RING_SIZE ? head - EPROFILE_RING_SIZE : 0;
+        for(u64 i = oldest; i < head; ++i) {
+            eprofile_event *event = &thread->events[i & (EPROFILE_RING_SIZE - 1)];
+            // complete events, microseconds since init
+            f64 start_us = ticks_to_ns(event->start - profiler.base_ticks) / 1000.0;
+            f64 duration_us = ticks_to_ns(event->end - event->start) / 1000.0;
+            fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+                    written ? "," : "", event->name, start_us, duration_us, t);
+            ++written;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    EINFO("wrote %llu profiler events to %s", written, path);
+    return true;
+}
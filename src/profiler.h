@@ -0,0 +1,76 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "defines.h"
+
+// Scoped CPU profiler. Zones are recorded into one ring buffer per thread,
+// written only by their thread. Each frame is summarized when it ends, and
+// the rings can be exported as Chrome trace JSON (chrome://tracing, Perfetto).
+// Everything compiles out unless EPROFILE_MODE is defined.
+
+#define EPROFILE_MAX_THREADS 32
+#define EPROFILE_MAX_DEPTH 32
+// power of 2, events per thread kept for the trace
+#define EPROFILE_RING_SIZE 8192
+// distinct zones (name + depth) in a frame summary
+#define EPROFILE_MAX_SUMMARY 64
+
+typedef struct eprofile_event {
+    const char *name;
+    u64 start;
+    u64 end;
+    u32 depth;
+} eprofile_event;
+
+typedef struct eprofile_zone_summary {
+    const char *name;
+    u32 depth;
+    u32 calls;
+    // for ordering, parents start before their children
+    u64 first_start;
+    u64 total;
+} eprofile_zone_summary;
+
+EAPI u8 eprofile_init();
+EAPI void eprofile_shutdown();
+
+// name must outlive the profiler, string literals are expected
+EAPI u8 eprofile_begin(const char *name);
+EAPI void eprofile_end();
+// marks the end of a frame and summarizes it
+EAPI void eprofile_frame();
+// logs the summary of the last frame, indented by depth
+EAPI void eprofile_report();
+// copies the summary of the last frame, returns the number of zones
+EAPI u32 eprofile_frame_summary(eprofile_zone_summary *zones, u32 capacity);
+EAPI u8 eprofile_export_chrome(const char *path);
+
+// for __attribute__((cleanup))
+EAPI void eprofile_scope_end(u8 *begun);
+
+#ifdef EPROFILE_MODE
+    #define EPROFILE_CONCAT_(a, b) a##b
+    #define EPROFILE_CONCAT(a, b) EPROFILE_CONCAT_(a, b)
+
+    #define EPROFILE_INIT() eprofile_init()
+    #define EPROFILE_SHUTDOWN() eprofile_shutdown()
+    #define EPROFILE_BEGIN(name) eprofile_begin(name)
+    #define EPROFILE_END() eprofile_end()
+    // zone until the end of the enclosing block
+    #define EPROFILE_SCOPE(name) \
+        u8 EPROFILE_CONCAT(eprofile_scope_, __LINE__) __attribute__((cleanup(eprofile_scope_end), unused)) = eprofile_begin(name)
+    #define EPROFILE_FRAME() eprofile_frame()
+    #define EPROFILE_REPORT() eprofile_report()
+    #define EPROFILE_EXPORT(path) eprofile_export_chrome(path)
+#else
+    #define EPROFILE_INIT()
+    #define EPROFILE_SHUTDOWN()
+    #define EPROFILE_BEGIN(name)
+    #define EPROFILE_END()
+    #define EPROFILE_SCOPE(name)
+    #define EPROFILE_FRAME()
+    #define EPROFILE_REPORT()
+    #define EPROFILE_EXPORT(path)
+#endif
+
+#endif // PROFILER_H
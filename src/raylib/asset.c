@@ -53,6 +53,23 @@ void asset_load(u32 id) {
     }
 }
 
+void asset_unload(u32 id) {
+    if(asset_manager.head < id) {
+        // ERROR
+        return;
+    }
+
+    easset *asset = &asset_manager.assets[id];
+    switch(asset->type) {
+        case ASSET_IMAGE:
+            UnloadImage(asset->image);
+            break;
+        case ASSET_TEXTURE:
+            UnloadTexture(asset->texture);
+            break;
+    }
+}
+
 void *asset_get_data(u32 id) {
     void *data = NULL;
 
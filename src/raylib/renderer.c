@@ -3,6 +3,35 @@
 
 #include "raylib.h"
 
+// raylib draws to the window itself
+void renderer_set_target(const erender_target *target) {
+}
+
+void renderer_set_jobs(struct ejobs *jobs) {
+}
+
+void renderer_flush() {
+}
+
+void renderer_shutdown() {
+}
+
+u32 renderer_damage(const struct ewindow_rect **rects) {
+    *rects = 0;
+    return 0;
+}
+
+void renderer_invalidate() {
+}
+
+erender_backend renderer_get_backend() {
+    return ERENDER_BACKEND_SCALAR;
+}
+
+u8 renderer_set_backend(erender_backend backend) {
+    return backend == ERENDER_BACKEND_SCALAR;
+}
+
 u8 renderer_clear() {
     BeginDrawing();
     ClearBackground(RAYWHITE);
@@ -16,3 +45,7 @@ u8 renderer_draw_asset(u32 id, int x, int y, int width, int height) {
     /*DrawTexture(*texture, x, y, WHITE);*/
     return true;
 }
+
+u8 renderer_draw_image(const struct eimage *image, int x, int y, int width, int height) {
+    return false;
+}
@@ -0,0 +1,77 @@
+#define ELOG_MODULE RENDER
+
+#include "render_state.h"
+
+#include "assert.h"
+#include "memory.h"
+#include "ecs_registry.h"
+
+u8 erender_state_create(erender_state *state) {
+    EASSERT(state != 0);
+    *state = (erender_state){0};
+    state->write = 0;
+    state->latest = 1;
+    state->read = 2;
+    return true;
+}
+
+void erender_state_destroy(erender_state *state) {
+    for(u32 i = 0; i < 3; ++i) {
+        efree(state->snapshots[i].sprites);
+    }
+    *state = (erender_state){0};
+}
+
+erender_snapshot *erender_state_write(erender_state *state) {
+    return &state->snapshots[state->write];
+}
+
+void erender_state_publish(erender_state *state, u64 time_ns) {
+    state->snapshots[state->write].time_ns = time_ns;
+    // release: the snapshot content is visible before its index
+    u32 previous = __atomic_exchange_n(&state->latest, state->write | ERENDER_STATE_FRESH, __ATOMIC_ACQ_REL);
+    // unread snapshots are overwritten, the reader only wants the latest
+    state->write = previous & ~ERENDER_STATE_FRESH;
+}
+
+const erender_snapshot *erender_state_read(erender_state *state) {
+    if(__atomic_load_n(&state->latest, __ATOMIC_RELAXED) & ERENDER_STATE_FRESH) {
+        u32 previous = __atomic_exchange_n(&state->latest, state->read, __ATOMIC_ACQ_REL);
+        state->read = previous & ~ERENDER_STATE_FRESH;
+    }
+    return &state->snapshots[state->read];
+}
+
+void erender_extract(escene *scene, erender_snapshot *snapshot) {
+    snapshot->bg_asset_id = scene->bg_asset_id;
+    snapshot->camera_x = scene->camera_x;
+    snapshot->camera_y = scene->camera_y;
+    snapshot->tick = scene->tick;
+    snapshot->sprite_count = 0;
+    if(!scene->components[ECS_ID(sprite_c)].data) {
+        return;
+    }
+
+    if(snapshot->sprite_capacity < scene->entity_capacity) {
+        efree(snapshot->sprites);
+        snapshot->sprites = ealloc(scene->entity_capacity * sizeof(erender_sprite));
+        EASSERT_MSG(snapshot->sprites != 0, "couldn't grow render snapshot");
+        snapshot->sprite_capacity = scene->entity_capacity;
+    }
+
+    u32 count;
+    ecs_query_mask(scene, ECS_MASK(sprite_c), scene->query_buffer, &count);
+    u8 positions = scene->components[ECS_ID(position_c)].data != 0;
+    for(u32 i = 0; i < count; ++i) {
+        u32 entity = scene->query_buffer[i];
+        erender_sprite *sprite = &snapshot->sprites[snapshot->sprite_count++];
+        sprite->asset_id = ECS_GET(scene, sprite_c, entity)->asset_id;
+        sprite->x = 0;
+        sprite->y = 0;
+        if(positions && ECS_HAS(scene, position_c, entity)) {
+            const position_c *position = ECS_GET(scene, position_c, entity);
+            sprite->x = position->x;
+            sprite->y = position->y;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include "defines.h"
+#include "scene.h"
+
+// Render state extracted from an escene after each simulation frame, so that
+// the renderer never reads the scene while the next frame is simulated.
+// Snapshots are triple buffered: the simulation writes one, the renderer
+// reads another, and the last published one waits in between. Neither side
+// ever blocks the other.
+
+// set in erender_state.latest when it holds a snapshot the reader hasn't seen
+#define ERENDER_STATE_FRESH 4
+
+typedef struct erender_sprite {
+    u32 asset_id;
+    i32 x;
+    i32 y;
+} erender_sprite;
+
+typedef struct erender_snapshot {
+    u32 bg_asset_id;
+    i32 camera_x;
+    i32 camera_y;
+    // scene tick the snapshot was extracted at
+    u32 tick;
+    // publication time
+    u64 time_ns;
+
+    erender_sprite *sprites;
+    u32 sprite_count;
+    u32 sprite_capacity;
+} erender_snapshot;
+
+typedef struct erender_state {
+    erender_snapshot snapshots[3];
+    // owned by the writer
+    u32 write;
+    // owned by the reader
+    u32 read;
+    // last published, exchanged atomically
+    u32 latest;
+} erender_state;
+
+EAPI u8 erender_state_create(erender_state *state);
+EAPI void erender_state_destroy(erender_state *state);
+
+// writer side: fill the returned snapshot then publish it
+EAPI erender_snapshot *erender_state_write(erender_state *state);
+EAPI void erender_state_publish(erender_state *state, u64 time_ns);
+// reader side: latest published snapshot, valid until the next call
+EAPI const erender_snapshot *erender_state_read(erender_state *state);
+
+// copies what scene_render needs, grows the snapshot with the allocator
+EAPI void erender_extract(escene *scene, erender_snapshot *snapshot);
+
+#endif // RENDER_STATE_H
@@ -3,8 +3,71 @@
 
 #include "defines.h"
 
+struct eimage;
+struct ewindow_rect;
+struct ejobs;
+
+// Native backend: a software renderer drawing premultiplied ARGB images into
+// the window framebuffer, clipped to it and scaled with nearest sampling
+// (replicated pixels for integer factors). Blending is source over, 4 (SSE2)
+// or 8 (AVX2) pixels per instruction.
+// Draws are deferred: commands are binned into ERENDER_TILE_SIZE square
+// tiles of the target, then tiles are rasterized in parallel by the jobs
+// workers on flush. Tiles no command touches are left alone, and commands
+// under an opaque image covering a whole tile are dropped from it. The
+// functions below are main thread only.
+// Each target is a frame: tiles whose commands are the same as in the previous
+// frame, and that the target's pixels already hold (see age), aren't
+// rasterized again. Images are compared by pointer, renderer_invalidate after
+// changing the pixels of one.
+
+#define ERENDER_TILE_SIZE 64
+// more damaged rectangles than this and the whole target is damaged
+#define ERENDER_MAX_DAMAGE_RECTS 16
+
+typedef enum erender_backend {
+    ERENDER_BACKEND_SCALAR = 0,
+    ERENDER_BACKEND_SSE2   = 1,
+    ERENDER_BACKEND_AVX2   = 2,
+} erender_backend;
+
+// what the renderer draws into, 0xAARRGGBB pixels
+typedef struct erender_target {
+    u32 *pixels;
+    u32 width;
+    u32 height;
+    // in pixels
+    u32 stride;
+    // frames since these pixels were drawn, 1 for the previous frame, 0 when
+    // unknown: everything is rasterized
+    u32 age;
+} erender_target;
+
+// copied, 0 to stop drawing: the calls below return false until a target is set
+// the engine sets the window framebuffer around app->render
+// commands queued for the previous target are flushed first
+EAPI void renderer_set_target(const erender_target *target);
+// tiles are rasterized by these workers, 0 to rasterize on the calling thread
+EAPI void renderer_set_jobs(struct ejobs *jobs);
+// rasterizes the queued commands, the target is complete when it returns
+EAPI void renderer_flush();
+// frees the command buffers
+EAPI void renderer_shutdown();
+// what changed between the last two frames, valid until the next frame ends
+// 0 when nothing did, a rectangle covering the target when too much did
+EAPI u32 renderer_damage(const struct ewindow_rect **rects);
+// the next frame is rasterized and damaged entirely
+EAPI void renderer_invalidate();
+
+// best backend supported by the CPU is picked by default
+EAPI erender_backend renderer_get_backend();
+// returns false if the CPU doesn't support it
+EAPI u8 renderer_set_backend(erender_backend backend);
+
 EAPI u8 renderer_clear();
+// the image data must stay valid until the next flush
 EAPI u8 renderer_draw_asset(u32 id, int x, int y, int width, int height);
+// same for images that aren't assets
+EAPI u8 renderer_draw_image(const struct eimage *image, int x, int y, int width, int height);
 
 #endif // RENDERER_H
-
@@ -1,5 +1,12 @@
+#define ELOG_MODULE RENDER
+
 #include "scene.h"
+#include "ecs_registry.h"
 #include "asset.h"
+#include "renderer.h"
+#include "spatial_hash.h"
+#include "bvh.h"
+#include "render_state.h"
 
 #include "defines.h"
 
@@ -10,90 +17,113 @@ void scene_create(escene_desc *description, escene *scene) {
 }
 
 void scene_destroy(escene *scene) {
-
+    ecs_scene_release(scene);
 }
 
 void scene_load(escene *scene) {
     asset_load(scene->bg_asset_id);
 }
 
+static void scene_sync_bvh(escene *scene);
+
 void scene_render(escene *scene, int width, int height) {
     renderer_draw_asset(scene->bg_asset_id, 0, 0, width, height);
-    if(!scene->COMP_SPRITE) {
+    if(!scene->components[ECS_ID(sprite_c)].data) {
         return;
     }
-    u32 sprite_c_id[1] = { scene->COMP_SPRITE };
-    u32 entities[64];
+    u32 *entities = scene->query_buffer;
     u32 count;
-    ecs_get_entities_with_components(scene, sprite_c_id, 1, entities, &count);
+    if(scene->bvh) {
+        scene_sync_bvh(scene);
+        collision_box view = { .x1 = scene->camera_x, .x2 = scene->camera_x + width, .y1 = scene->camera_y, .y2 = scene->camera_y + height };
+        count = ebvh_query(scene->bvh, view, entities, scene->entity_capacity);
+    } else {
+        ecs_query_mask(scene, ECS_MASK(sprite_c), entities, &count);
+    }
     for(int i = 0; i < count; ++i) {
-        u32 x = 0, y = 0;
-        sprite_c *sprite = (sprite_c*)ecs_get_component_of(scene, entities[i], scene->COMP_SPRITE, sizeof(sprite_c));
-        if(ecs_entity_has_component(scene, entities[i], scene->COMP_POSITION)) {
-            position_c *position = (position_c*)ecs_get_component_of(scene, entities[i], scene->COMP_POSITION, sizeof(position_c));
+        if(scene->bvh && !ECS_HAS(scene, sprite_c, entities[i])) {
+            // sprite removed since the proxy was inserted
+            ebvh_remove(scene->bvh, scene->bvh_proxies[entities[i]] - 1);
+            scene->bvh_proxies[entities[i]] = 0;
+            continue;
+        }
+        i32 x = 0, y = 0;
+        const sprite_c *sprite = ECS_GET(scene, sprite_c, entities[i]);
+        if(ECS_HAS(scene, position_c, entities[i])) {
+            const position_c *position = ECS_GET(scene, position_c, entities[i]);
             x = position->x;
             y = position->y;
         }
-        renderer_draw_asset(sprite->asset_id, x, y, 64, 64);
+        renderer_draw_asset(sprite->asset_id, x - scene->camera_x, y - scene->camera_y, SCENE_SPRITE_SIZE, SCENE_SPRITE_SIZE);
     }
 }
 
-void scene_add_entity(escene *scene, u32 entity) {
-    if(!scene->entities[entity]) {
-        ++scene->entity_count;
+void scene_render_snapshot(const erender_snapshot *snapshot, int width, int height) {
+    renderer_draw_asset(snapshot->bg_asset_id, 0, 0, width, height);
+    for(u32 i = 0; i < snapshot->sprite_count; ++i) {
+        const erender_sprite *sprite = &snapshot->sprites[i];
+        i32 x = sprite->x - snapshot->camera_x;
+        i32 y = sprite->y - snapshot->camera_y;
+        if(x >= width || y >= height || x + SCENE_SPRITE_SIZE <= 0 || y + SCENE_SPRITE_SIZE <= 0) {
+            continue;
+        }
+        renderer_draw_asset(sprite->asset_id, x, y, SCENE_SPRITE_SIZE, SCENE_SPRITE_SIZE);
     }
-    scene->entities[entity] = 1;
 }
 
-// -- ECS --
-
-u32 ecs_entity_create(escene *scene, u64 components_mask) {
-    u32 id = scene->curr_entity_id++;
-    // TODO: add right components
-    return id;
-}
-
-void ecs_entity_destroy(escene *scene, u32 entity) {
-    // TODO: scene remove
+static collision_box sprite_bounds(escene *scene, u32 entity) {
+    i32 x = 0, y = 0;
+    if(ECS_HAS(scene, position_c, entity)) {
+        const position_c *position = ECS_GET(scene, position_c, entity);
+        x = position->x;
+        y = position->y;
+    }
+    return (collision_box){ .x1 = x, .x2 = x + SCENE_SPRITE_SIZE, .y1 = y, .y2 = y + SCENE_SPRITE_SIZE };
 }
 
-// TODO: store max size for each pool?
-// for now let's assume that each pool has 2048 slots
-void ecs_component_create(escene *scene, u32 component, void *pool) {
-    // TODO: check if component with same id already exists
-    scene->components[component] = pool;
-}
+// only visits sprites added and entities moved since the last sync
+static void scene_sync_bvh(escene *scene) {
+    u32 *entities = scene->query_buffer;
+    u32 count;
+    u32 sprite_c_id[1] = { ECS_ID(sprite_c) };
+
+    // first sync, or the tick never advanced: every sprite, those added at tick 0 too
+    if(!scene->bvh_tick) {
+        ecs_query_mask(scene, ECS_MASK(sprite_c), entities, &count);
+        for(u32 i = 0; i < count; ++i) {
+            if(scene->bvh_proxies[entities[i]]) {
+                ebvh_move(scene->bvh, scene->bvh_proxies[entities[i]] - 1, sprite_bounds(scene, entities[i]));
+            } else {
+                scene->bvh_proxies[entities[i]] = ebvh_insert(scene->bvh, sprite_bounds(scene, entities[i]), entities[i]) + 1;
+            }
+        }
+        scene->bvh_tick = scene->tick;
+        return;
+    }
 
-void ecs_component_destroy(escene *scene, u32 component) {
-    scene->components[component] = (void*)0;
-}
+    // writes made after the last sync were stamped with its tick too
+    u32 since = scene->bvh_tick - 1;
 
-void ecs_entity_add_component(escene *scene, u32 entity, u32 component) {
-    scene->component_masks[component] |= 1 << entity;
-}
+    ecs_get_entities_added_since(scene, sprite_c_id, 1, ECS_ID(sprite_c), since, entities, &count);
+    for(u32 i = 0; i < count; ++i) {
+        if(!scene->bvh_proxies[entities[i]]) {
+            scene->bvh_proxies[entities[i]] = ebvh_insert(scene->bvh, sprite_bounds(scene, entities[i]), entities[i]) + 1;
+        }
+    }
 
-u8 ecs_entity_has_component(escene *scene, u32 entity, u32 component) {
-    return (scene->component_masks[component] >> entity) & 1;
-}
+    ecs_get_entities_changed_since(scene, sprite_c_id, 1, ECS_ID(position_c), since, entities, &count);
+    for(u32 i = 0; i < count; ++i) {
+        if(scene->bvh_proxies[entities[i]]) {
+            ebvh_move(scene->bvh, scene->bvh_proxies[entities[i]] - 1, sprite_bounds(scene, entities[i]));
+        }
+    }
 
-void *ecs_get_component_of(escene *scene, u32 entity, u32 component, u32 component_size) {
-    return (char *)scene->components[component] + entity * component_size;
+    scene->bvh_tick = scene->tick;
 }
 
-// TODO: max 64 entities here...
-u64 ecs_get_entities_with_components(escene *scene, u32 *components, u32 c_length, u32 *entities, u32 *e_length) {
-    u64 entities_mask = -1;
-    for(int i = 0; i < c_length; ++i) {
-        entities_mask &= scene->component_masks[components[i]];
-    }
-    u64 tmp = entities_mask;
-    u32 count = 0;
-    for(int i = 0; i < sizeof(u64) * 8; ++i) {
-        if(tmp & 1) {
-            entities[count++] = i;
-        }
-        tmp >>= 1;
+void scene_set_collision_box(escene *scene, u32 id, collision_box box) {
+    scene->collision_boxes[id] = box;
+    if(scene->broadphase) {
+        espatial_hash_update(scene->broadphase, id, box);
     }
-    *e_length = count;
-    return entities_mask;
 }
@@ -3,6 +3,17 @@
 
 #include "defines.h"
 
+// the scene grows past this when more entities are created
+#define ECS_INITIAL_ENTITIES 2048
+// component sets (entity creation, queries, system accesses) are 64 bit masks
+#define ECS_MAX_COMPONENTS 64
+// component pools are aligned on this so systems can use aligned SIMD loads
+#define ECS_POOL_ALIGN 64
+// pools grow by whole pages, touched when allocated
+#define ECS_PAGE_SIZE 4096
+
+#define SCENE_SPRITE_SIZE 64
+
 typedef struct sprite_c {
     u32 asset_id;
 } sprite_c;
@@ -19,6 +30,31 @@ typedef struct collision_box {
     int y2;
 } collision_box;
 
+// change detection, one per component pool
+typedef struct ecs_component_ticks {
+    u32 *added;
+    u32 *changed;
+    // latest tick of each 64 entities chunk, to skip unchanged chunks
+    u32 *chunk_added;
+    u32 *chunk_changed;
+} ecs_component_ticks;
+
+// engine owned storage of a component, sized for entity_capacity entities
+typedef struct ecs_component_pool {
+    // ECS_POOL_ALIGN aligned, 0 when the component isn't created
+    void *data;
+    u32 size;
+    // size rounded up to the component alignment
+    u32 stride;
+    // entity set, one bit per entity
+    u64 *mask;
+    ecs_component_ticks ticks;
+} ecs_component_pool;
+
+struct espatial_hash;
+struct ebvh;
+struct erender_snapshot;
+
 typedef struct escene_desc {
     const char *bg;
 } escene_desc;
@@ -30,19 +66,30 @@ typedef struct escene {
 
     // collision boxes for entities and terrain
     collision_box collision_boxes[2048];
+    // optional, kept in sync by scene_set_collision_box
+    struct espatial_hash *broadphase;
+
+    // optional, sprites outside of the view are culled when set
+    struct ebvh *bvh;
+    // proxy + 1 of each sprite entity, 0 when not in the tree
+    u32 *bvh_proxies;
+    u32 bvh_tick;
+
+    // top-left corner of the view
+    i32 camera_x;
+    i32 camera_y;
 
     u32 entity_count;
-    u32 entities[2048];
+    // multiple of 64, every per entity array is grown with it
+    u32 entity_capacity;
+    u32 *entities;
+    // scratch ids for queries made by the scene itself
+    u32 *query_buffer;
 
-    // TODO: ecs in its own file
-    // these are user constructed and managed
     u32 curr_entity_id;
-    void *components[100];
-    u64 component_masks[100];
-
-    // these should be fully engine managed
-    u32 COMP_SPRITE;
-    u32 COMP_POSITION;
+    ecs_component_pool components[ECS_MAX_COMPONENTS];
+    // current frame, 0 means never
+    u32 tick;
 } escene;
 
 EAPI void scene_create(escene_desc *description, escene *s);
@@ -50,22 +97,54 @@ EAPI void scene_destroy(escene *s);
 
 EAPI void scene_load(escene *s);
 EAPI void scene_render(escene *s, int width, int height);
+// same as scene_render, from state extracted by erender_extract
+EAPI void scene_render_snapshot(const struct erender_snapshot *snapshot, int width, int height);
 
 EAPI void scene_add_entity(escene *scene, u32 entity);
+EAPI void scene_set_collision_box(escene *scene, u32 id, collision_box box);
 
 // TODO: update, render
 
-// -- ECS --
+// -- ECS -- (ecs.c)
+
+// grows the scene so that it can hold entity_count entities,
+// pointers to components are invalidated when it does
+EAPI void ecs_scene_reserve(escene *scene, u32 entity_count);
+// frees the pools and per entity arrays
+EAPI void ecs_scene_release(escene *scene);
 
 EAPI u32 ecs_entity_create(escene *scene, u64 components_mask);
 EAPI void ecs_entity_destroy(escene *scene, u32 entity);
 
-EAPI void ecs_component_create(escene *scene, u32 component, void *pool);
+// align must be a power of 2 up to ECS_POOL_ALIGN
+EAPI void ecs_component_create(escene *scene, u32 component, u32 size, u32 align);
 EAPI void ecs_component_destroy(escene *scene, u32 component);
+// component i of the pool is at data + i * stride
+EAPI void *ecs_component_data(escene *scene, u32 component, u32 *stride);
 
 EAPI void ecs_entity_add_component(escene *scene, u32 entity, u32 component);
+EAPI void ecs_entity_remove_component(escene *scene, u32 entity, u32 component);
 EAPI u8 ecs_entity_has_component(escene *scene, u32 entity, u32 component);
+// read access
 EAPI void *ecs_get_component_of(escene *scene, u32 entity, u32 component, u32 component_size);
-EAPI u64 ecs_get_entities_with_components(escene *scene, u32 *components, u32 c_length, u32 *entities, u32 *e_length);
+// write access: marks the component as changed on the current tick
+EAPI void *ecs_get_component_mut(escene *scene, u32 entity, u32 component, u32 component_size);
+EAPI u32 ecs_advance_tick(escene *scene);
+// entities must hold up to entity_capacity ids, returns the number of entities found
+EAPI u32 ecs_get_entities_with_components(escene *scene, u32 *components, u32 c_length, u32 *entities, u32 *e_length);
+// same, keeping only entities whose filter component was changed (or added) after tick since
+EAPI u32 ecs_get_entities_changed_since(escene *scene, u32 *components, u32 c_length, u32 filter, u32 since, u32 *entities, u32 *e_length);
+EAPI u32 ecs_get_entities_added_since(escene *scene, u32 *components, u32 c_length, u32 filter, u32 since, u32 *entities, u32 *e_length);
+// any of the filter components changed after tick since, 0 filters returns all matches
+EAPI u32 ecs_query(escene *scene, u32 *components, u32 c_length, u32 *filters, u32 f_length, u32 since, u8 added, u32 *entities, u32 *e_length);
+
+// marks a component as changed, inlined by the typed accessors of ecs_registry.h
+// can race with other workers stamping the same chunk, they all store the same tick
+static inline void ecs_stamp(u32 *ticks, u32 *chunk_ticks, u32 entity, u32 tick) {
+    ticks[entity] = tick;
+    if(__atomic_load_n(&chunk_ticks[entity >> 6], __ATOMIC_RELAXED) != tick) {
+        __atomic_store_n(&chunk_ticks[entity >> 6], tick, __ATOMIC_RELAXED);
+    }
+}
 
 #endif // SCENE_H
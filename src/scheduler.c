@@ -0,0 +1,259 @@
+#define ELOG_MODULE ECS
+
+#include "scheduler.h"
+
+#include "assert.h"
+#include "clock.h"
+#include "memory.h"
+
+static void build_graph(ecs_scheduler *scheduler);
+static void reserve_entities(ecs_system *system, u32 capacity);
+static void query_entities(ecs_scheduler *scheduler, ecs_system *system);
+static void submit_system(ecs_scheduler *scheduler, u32 system);
+static void run_range(void *arg, u32 first, u32 count);
+static void compute_critical_path(ecs_scheduler *scheduler);
+
+static u8 systems_conflict(ecs_system_desc *a, ecs_system_desc *b) {
+    // a changed filter reads the ticks of its components
+    u64 a_reads = a->reads | a->changed;
+    u64 b_reads = b->reads | b->changed;
+    return (a->writes & (b_reads | b->writes)) || (b->writes & a_reads);
+}
+
+u8 ecs_scheduler_create(ejobs *jobs, ecs_scheduler *scheduler) {
+    EASSERT(scheduler != 0 && jobs != 0);
+    scheduler->jobs = jobs;
+    scheduler->counter.value = 0;
+    scheduler->system_count = 0;
+    scheduler->scene = 0;
+    scheduler->commands = 0;
+    scheduler->frame_ns = 0;
+    scheduler->critical_path_ns = 0;
+    scheduler->critical_tail = 0;
+    return true;
+}
+
+void ecs_scheduler_destroy(ecs_scheduler *scheduler) {
+    for(u32 i = 0; i < scheduler->system_count; ++i) {
+        efree(scheduler->systems[i].entities);
+    }
+    scheduler->system_count = 0;
+}
+
+u32 ecs_system_register(ecs_scheduler *scheduler, ecs_system_desc *desc) {
+    EASSERT_MSG(scheduler->system_count < ECS_MAX_SYSTEMS, "too many systems");
+    EASSERT(desc->run != 0);
+
+    u32 id = scheduler->system_count++;
+    ecs_system *system = &scheduler->systems[id];
+    *system = (ecs_system){0};
+    system->scheduler = scheduler;
+    system->desc = *desc;
+    if(system->desc.chunk_size == 0) {
+        system->desc.chunk_size = ECS_DEFAULT_CHUNK_SIZE;
+    }
+    system->enabled = true;
+
+    // allocated here as workers must not touch the allocator
+    reserve_entities(system, ECS_INITIAL_ENTITIES);
+
+    EDEBUG("registered system %u: %s", id, desc->name ? desc->name : "?");
+
+    return id;
+}
+
+void ecs_system_set_enabled(ecs_scheduler *scheduler, u32 system, u8 enabled) {
+    EASSERT(system < scheduler->system_count);
+    scheduler->systems[system].enabled = enabled;
+}
+
+void ecs_scheduler_run(ecs_scheduler *scheduler, escene *scene) {
+    u64 frame_start = eclock_now_ns();
+    scheduler->scene = scene;
+
+    // structural changes are not allowed while systems run, queries are
+    // resolved when a system is submitted, after the systems it depends on
+    for(u32 i = 0; i < scheduler->system_count; ++i) {
+        if(scheduler->systems[i].enabled) {
+            reserve_entities(&scheduler->systems[i], scene->entity_capacity);
+        }
+    }
+
+    build_graph(scheduler);
+
+    // roots are picked from the graph, not from pending_dependencies:
+    // workers release dependents while this loop is still submitting
+    for(u32 i = 0; i < scheduler->system_count; ++i) {
+        ecs_system *system = &scheduler->systems[i];
+        if(system->enabled && system->dependencies == 0) {
+            submit_system(scheduler, i);
+        }
+    }
+
+    ejobs_wait(scheduler->jobs, &scheduler->counter);
+
+    // commands and writes until the next run are stamped after every system ended
+    ecs_advance_tick(scene);
+
+    // sync point: structural changes recorded by the systems
+    if(scheduler->commands) {
+        ecs_cmdqueue_apply(scheduler->commands, scene);
+    }
+
+    scheduler->frame_ns = eclock_now_ns() - frame_start;
+    compute_critical_path(scheduler);
+}
+
+void ecs_scheduler_report(ecs_scheduler *scheduler) {
+    EDEBUG("Showing system timings (%u systems, %u workers):", scheduler->system_count, scheduler->jobs->worker_count);
+    for(u32 i = 0; i < scheduler->system_count; ++i) {
+        ecs_system *system = &scheduler->systems[i];
+        ecs_system_stats *stats = &system->stats;
+        EDEBUG("- %u) %s: last = %llu ns, avg = %llu ns, max = %llu ns, entities = %u",
+                i, system->desc.name ? system->desc.name : "?", stats->last_ns,
+                stats->frames ? stats->total_ns / stats->frames : 0, stats->max_ns,
+                system->entity_count);
+    }
+    EDEBUG("last frame: %llu ns, critical path: %llu ns", scheduler->frame_ns, scheduler->critical_path_ns);
+    if(scheduler->system_count == 0) {
+        return;
+    }
+    // walk the critical path backwards
+    u32 current = scheduler->critical_tail;
+    while(true) {
+        ecs_system *system = &scheduler->systems[current];
+        EDEBUG("  <- %s (%llu ns)", system->desc.name ? system->desc.name : "?", system->stats.last_ns);
+        u64 deps = system->dependencies;
+        if(!deps) {
+            break;
+        }
+        u32 next = __builtin_ctzll(deps);
+        for(u64 d = deps; d; d &= d - 1) {
+            u32 dep = __builtin_ctzll(d);
+            if(scheduler->systems[dep].stats.critical_ns > scheduler->systems[next].stats.critical_ns) {
+                next = dep;
+            }
+        }
+        current = next;
+    }
+}
+
+// follows the scene capacity, on the main thread before any chunk runs
+static void reserve_entities(ecs_system *system, u32 capacity) {
+    if(capacity <= system->entity_capacity) {
+        return;
+    }
+    efree(system->entities);
+    system->entities = ealloc(capacity * sizeof(u32));
+    EASSERT(system->entities != 0);
+    system->entity_capacity = capacity;
+}
+
+static void query_entities(ecs_scheduler *scheduler, ecs_system *system) {
+    system->entity_count = 0;
+    if(system->desc.query == 0) {
+        return;
+    }
+
+    u32 components[64];
+    u32 c_length = 0;
+    for(u64 q = system->desc.query; q; q &= q - 1) {
+        components[c_length++] = __builtin_ctzll(q);
+    }
+    u32 filters[64];
+    u32 f_length = 0;
+    // everything is new to a system that never ran
+    u64 changed = system->last_run_tick ? system->desc.changed : 0;
+    for(u64 c = changed; c; c &= c - 1) {
+        filters[f_length++] = __builtin_ctzll(c);
+    }
+    ecs_query(scheduler->scene, components, c_length, filters, f_length, system->last_run_tick, false, system->entities, &system->entity_count);
+}
+
+static void build_graph(ecs_scheduler *scheduler) {
+    for(u32 j = 0; j < scheduler->system_count; ++j) {
+        ecs_system *system = &scheduler->systems[j];
+        system->dependencies = 0;
+        system->dependent_count = 0;
+        system->pending_dependencies = 0;
+        if(!system->enabled) {
+            continue;
+        }
+        for(u32 i = 0; i < j; ++i) {
+            ecs_system *previous = &scheduler->systems[i];
+            if(previous->enabled && systems_conflict(&previous->desc, &system->desc)) {
+                system->dependencies |= 1ull << i;
+                previous->dependents[previous->dependent_count++] = j;
+                ++system->pending_dependencies;
+            }
+        }
+    }
+}
+
+// on the main thread for roots, else on the worker that ran the last dependency
+static void submit_system(ecs_scheduler *scheduler, u32 id) {
+    ecs_system *system = &scheduler->systems[id];
+    system->start_ns = eclock_now_ns();
+    // the writes of this run are stamped after the end of the systems it depends on
+    ecs_advance_tick(scheduler->scene);
+    query_entities(scheduler, system);
+    if(system->entity_count == 0) {
+        // systems without entities still run once
+        system->remaining = 1;
+        ejobs_submit(scheduler->jobs, run_range, system, &scheduler->counter);
+        return;
+    }
+    // split into chunk_size ranges as workers go idle
+    system->remaining = system->entity_count;
+    ejobs_parallel_for(scheduler->jobs, run_range, system, system->entity_count, system->desc.chunk_size, &scheduler->counter);
+}
+
+static void run_range(void *arg, u32 first, u32 count) {
+    ecs_system *system = arg;
+    ecs_scheduler *scheduler = system->scheduler;
+
+    u32 entities = system->entity_count ? count : 0;
+    system->desc.run(scheduler->scene, system->entities + first, entities, system->desc.user);
+
+    if(__atomic_sub_fetch(&system->remaining, count, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+
+    // last range of the system: release the systems waiting on it
+    system->end_ns = eclock_now_ns();
+    // every write of this run is stamped at most with this tick, later ones come after
+    system->last_run_tick = __atomic_load_n(&scheduler->scene->tick, __ATOMIC_RELAXED);
+    for(u32 i = 0; i < system->dependent_count; ++i) {
+        u32 dependent = system->dependents[i];
+        if(__atomic_sub_fetch(&scheduler->systems[dependent].pending_dependencies, 1, __ATOMIC_ACQ_REL) == 0) {
+            submit_system(scheduler, dependent);
+        }
+    }
+}
+
+static void compute_critical_path(ecs_scheduler *scheduler) {
+    scheduler->critical_path_ns = 0;
+    // systems only depend on earlier ones, so registration order is a topological order
+    for(u32 j = 0; j < scheduler->system_count; ++j) {
+        ecs_system *system = &scheduler->systems[j];
+        if(!system->enabled) {
+            continue;
+        }
+        ecs_system_stats *stats = &system->stats;
+        stats->last_ns = system->end_ns - system->start_ns;
+        stats->total_ns += stats->last_ns;
+        stats->max_ns = stats->last_ns > stats->max_ns ? stats->last_ns : stats->max_ns;
+        ++stats->frames;
+
+        u64 longest_dependency = 0;
+        for(u64 d = system->dependencies; d; d &= d - 1) {
+            u64 critical = scheduler->systems[__builtin_ctzll(d)].stats.critical_ns;
+            longest_dependency = critical > longest_dependency ? critical : longest_dependency;
+        }
+        stats->critical_ns = longest_dependency + stats->last_ns;
+        if(stats->critical_ns >= scheduler->critical_path_ns) {
+            scheduler->critical_path_ns = stats->critical_ns;
+            scheduler->critical_tail = j;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "defines.h"
+#include "scene.h"
+#include "jobs.h"
+#include "ecs_cmd.h"
+
+#define ECS_MAX_SYSTEMS 64
+#define ECS_DEFAULT_CHUNK_SIZE 256
+
+// component bit, used to build query/read/write sets
+#define ECS_BIT(component) (1ull << (component))
+
+_Static_assert(ECS_MAX_COMPONENTS <= 64, "component sets are 64 bits");
+
+// called once per range of entities, possibly from several threads at the same time
+typedef void (*ecs_system_fn)(escene *scene, u32 *entities, u32 count, void *user);
+
+typedef struct ecs_system_desc {
+    const char *name;
+    // entities having all these components are iterated,
+    // 0 runs the system once with no entities
+    u64 query;
+    // optional: only entities where one of these components changed since the system last ran,
+    // its own writes excepted, counted as reads. The first run sees every entity
+    u64 changed;
+    // declared accesses: systems that don't conflict run in parallel
+    u64 reads;
+    u64 writes;
+    ecs_system_fn run;
+    void *user;
+    // most entities per call, 0 for ECS_DEFAULT_CHUNK_SIZE
+    u32 chunk_size;
+} ecs_system_desc;
+
+typedef struct ecs_system_stats {
+    // wall time from first range start to last range end
+    u64 last_ns;
+    u64 max_ns;
+    u64 total_ns;
+    u64 frames;
+    // earliest finish of this system assuming infinite workers
+    u64 critical_ns;
+} ecs_system_stats;
+
+typedef struct ecs_system {
+    struct ecs_scheduler *scheduler;
+    ecs_system_desc desc;
+    u8 enabled;
+
+    // dependency graph, rebuilt each frame
+    u64 dependencies;
+    u32 dependents[ECS_MAX_SYSTEMS];
+    u32 dependent_count;
+    u32 pending_dependencies;
+
+    // sized for entity_capacity entities of the scene
+    u32 *entities;
+    u32 entity_count;
+    u32 entity_capacity;
+    // entities left to run this frame, 1 for systems without entities
+    u32 remaining;
+
+    // tick when the last run ended, changes stamped after it are new, 0 before the first run
+    u32 last_run_tick;
+    u64 start_ns;
+    u64 end_ns;
+    ecs_system_stats stats;
+} ecs_system;
+
+typedef struct ecs_scheduler {
+    ejobs *jobs;
+    // every system range submitted this frame
+    ejob_counter counter;
+    escene *scene;
+    // optional: applied once all systems are done
+    ecs_cmdqueue *commands;
+
+    ecs_system systems[ECS_MAX_SYSTEMS];
+    u32 system_count;
+
+    u64 frame_ns;
+    u64 critical_path_ns;
+    // last system on the critical path of the last frame
+    u32 critical_tail;
+} ecs_scheduler;
+
+// systems run as jobs of the given job system
+EAPI u8 ecs_scheduler_create(ejobs *jobs, ecs_scheduler *scheduler);
+EAPI void ecs_scheduler_destroy(ecs_scheduler *scheduler);
+// systems are ordered by registration when their accesses conflict
+EAPI u32 ecs_system_register(ecs_scheduler *scheduler, ecs_system_desc *desc);
+EAPI void ecs_system_set_enabled(ecs_scheduler *scheduler, u32 system, u8 enabled);
+// runs every enabled system once and returns when all are done, each system run
+// advances the scene tick so that changes are seen by every system exactly once
+EAPI void ecs_scheduler_run(ecs_scheduler *scheduler, escene *scene);
+EAPI void ecs_scheduler_report(ecs_scheduler *scheduler);
+
+#endif // SCHEDULER_H
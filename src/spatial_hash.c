@@ -0,0 +1,253 @@
+#include "spatial_hash.h"
+
+#include "assert.h"
+#include "memory.h"
+
+#include <string.h>
+
+static u32 round_pow2(u32 n);
+static u32 hash_cell(espatial_hash *hash, i32 cx, i32 cy);
+static u32 alloc_entry(espatial_hash *hash);
+static void link_cells(espatial_hash *hash, u32 box);
+static void unlink_cells(espatial_hash *hash, u32 box);
+static void compute_cells(espatial_hash *hash, espatial_box *b);
+
+u8 espatial_hash_create(u32 cell_size, u32 bucket_count, u32 box_capacity, espatial_hash *hash) {
+    EASSERT(hash != 0);
+    EASSERT(cell_size > 0 && bucket_count > 0 && box_capacity > 0);
+
+    *hash = (espatial_hash){0};
+    hash->cell_shift = __builtin_ctz(round_pow2(cell_size));
+    hash->bucket_mask = round_pow2(bucket_count) - 1;
+    hash->box_capacity = box_capacity;
+    // most boxes cover up to 4 cells when they are smaller than a cell
+    hash->entry_capacity = box_capacity * 4;
+
+    hash->buckets = ealloc((hash->bucket_mask + 1) * sizeof(u32));
+    hash->entries = ealloc(hash->entry_capacity * sizeof(espatial_entry));
+    hash->boxes = ealloc(box_capacity * sizeof(espatial_box));
+    hash->query_stamps = ealloc(box_capacity * sizeof(u32));
+    if(!hash->buckets || !hash->entries || !hash->boxes || !hash->query_stamps) {
+        EERROR("couldn't allocate spatial hash");
+        return false;
+    }
+    memset(hash->query_stamps, 0, box_capacity * sizeof(u32));
+    espatial_hash_clear(hash);
+
+    return true;
+}
+
+void espatial_hash_destroy(espatial_hash *hash) {
+    efree(hash->buckets);
+    efree(hash->entries);
+    efree(hash->boxes);
+    efree(hash->query_stamps);
+    *hash = (espatial_hash){0};
+}
+
+void espatial_hash_clear(espatial_hash *hash) {
+    memset(hash->buckets, 0xFF, (hash->bucket_mask + 1) * sizeof(u32));
+    memset(hash->boxes, 0, hash->box_capacity * sizeof(espatial_box));
+    hash->entry_count = 0;
+    hash->free_entry = ESPATIAL_NIL;
+}
+
+void espatial_hash_insert(espatial_hash *hash, u32 box, collision_box bounds) {
+    EASSERT(box < hash->box_capacity);
+    espatial_box *b = &hash->boxes[box];
+    EASSERT_MSG(!b->active, "box %u is already in the spatial hash", box);
+
+    b->bounds = bounds;
+    b->active = true;
+    compute_cells(hash, b);
+    link_cells(hash, box);
+}
+
+void espatial_hash_update(espatial_hash *hash, u32 box, collision_box bounds) {
+    EASSERT(box < hash->box_capacity);
+    espatial_box *b = &hash->boxes[box];
+    if(!b->active) {
+        espatial_hash_insert(hash, box, bounds);
+        return;
+    }
+
+    i32 cx0 = b->cx0, cy0 = b->cy0, cx1 = b->cx1, cy1 = b->cy1;
+    b->bounds = bounds;
+    compute_cells(hash, b);
+    if(cx0 == b->cx0 && cy0 == b->cy0 && cx1 == b->cx1 && cy1 == b->cy1) {
+        // still in the same cells
+        return;
+    }
+
+    i32 new_cx0 = b->cx0, new_cy0 = b->cy0, new_cx1 = b->cx1, new_cy1 = b->cy1;
+    b->cx0 = cx0; b->cy0 = cy0; b->cx1 = cx1; b->cy1 = cy1;
+    unlink_cells(hash, box);
+    b->cx0 = new_cx0; b->cy0 = new_cy0; b->cx1 = new_cx1; b->cy1 = new_cy1;
+    link_cells(hash, box);
+}
+
+void espatial_hash_remove(espatial_hash *hash, u32 box) {
+    EASSERT(box < hash->box_capacity);
+    if(!hash->boxes[box].active) {
+        return;
+    }
+    unlink_cells(hash, box);
+    hash->boxes[box].active = false;
+}
+
+u32 espatial_hash_pairs(espatial_hash *hash, espatial_pair *pairs, u32 capacity) {
+    u32 count = 0;
+    hash->tests = 0;
+
+    for(u32 a = 0; a < hash->box_capacity; ++a) {
+        espatial_box *box_a = &hash->boxes[a];
+        if(!box_a->active) {
+            continue;
+        }
+        for(u32 e = box_a->first_entry; e != ESPATIAL_NIL; e = hash->entries[e].box_next) {
+            espatial_entry *entry = &hash->entries[e];
+            u32 bucket = hash_cell(hash, entry->cx, entry->cy);
+            for(u32 o = hash->buckets[bucket]; o != ESPATIAL_NIL; o = hash->entries[o].next) {
+                espatial_entry *other = &hash->entries[o];
+                // other cells colliding in the bucket, or pair seen from the other side
+                if(other->box <= a || other->cx != entry->cx || other->cy != entry->cy) {
+                    continue;
+                }
+                espatial_box *box_b = &hash->boxes[other->box];
+                // two boxes share all the cells of their overlap: only
+                // report the pair in the top-left one
+                i32 cx = box_a->cx0 > box_b->cx0 ? box_a->cx0 : box_b->cx0;
+                i32 cy = box_a->cy0 > box_b->cy0 ? box_a->cy0 : box_b->cy0;
+                if(cx != entry->cx || cy != entry->cy) {
+                    continue;
+                }
+                ++hash->tests;
+                if(collision_box_overlap(&box_a->bounds, &box_b->bounds)) {
+                    if(count < capacity) {
+                        pairs[count] = (espatial_pair){ .a = a, .b = other->box };
+                    }
+                    ++count;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+u32 espatial_hash_query(espatial_hash *hash, collision_box region, u32 *boxes, u32 capacity) {
+    u32 count = 0;
+    hash->tests = 0;
+
+    if(++hash->query_stamp == 0) {
+        // wrapped around, old stamps could alias
+        memset(hash->query_stamps, 0, hash->box_capacity * sizeof(u32));
+        hash->query_stamp = 1;
+    }
+
+    espatial_box query = { .bounds = region };
+    compute_cells(hash, &query);
+    for(i32 cy = query.cy0; cy <= query.cy1; ++cy) {
+        for(i32 cx = query.cx0; cx <= query.cx1; ++cx) {
+            u32 bucket = hash_cell(hash, cx, cy);
+            for(u32 e = hash->buckets[bucket]; e != ESPATIAL_NIL; e = hash->entries[e].next) {
+                espatial_entry *entry = &hash->entries[e];
+                if(entry->cx != cx || entry->cy != cy || hash->query_stamps[entry->box] == hash->query_stamp) {
+                    continue;
+                }
+                hash->query_stamps[entry->box] = hash->query_stamp;
+                ++hash->tests;
+                if(collision_box_overlap(&region, &hash->boxes[entry->box].bounds)) {
+                    if(count < capacity) {
+                        boxes[count] = entry->box;
+                    }
+                    ++count;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+static void compute_cells(espatial_hash *hash, espatial_box *b) {
+    // boxes are half-open, a box ending on a cell boundary doesn't touch the next cell
+    i32 x2 = b->bounds.x2 > b->bounds.x1 ? b->bounds.x2 - 1 : b->bounds.x1;
+    i32 y2 = b->bounds.y2 > b->bounds.y1 ? b->bounds.y2 - 1 : b->bounds.y1;
+    b->cx0 = b->bounds.x1 >> hash->cell_shift;
+    b->cy0 = b->bounds.y1 >> hash->cell_shift;
+    b->cx1 = x2 >> hash->cell_shift;
+    b->cy1 = y2 >> hash->cell_shift;
+}
+
+static void link_cells(espatial_hash *hash, u32 box) {
+    espatial_box *b = &hash->boxes[box];
+    b->first_entry = ESPATIAL_NIL;
+    for(i32 cy = b->cy0; cy <= b->cy1; ++cy) {
+        for(i32 cx = b->cx0; cx <= b->cx1; ++cx) {
+            // entries may be reallocated, don't keep pointers across this call
+            u32 e = alloc_entry(hash);
+            espatial_entry *entry = &hash->entries[e];
+            u32 bucket = hash_cell(hash, cx, cy);
+            entry->box = box;
+            entry->cx = cx;
+            entry->cy = cy;
+            entry->prev = ESPATIAL_NIL;
+            entry->next = hash->buckets[bucket];
+            if(entry->next != ESPATIAL_NIL) {
+                hash->entries[entry->next].prev = e;
+            }
+            hash->buckets[bucket] = e;
+            entry->box_next = b->first_entry;
+            b->first_entry = e;
+        }
+    }
+}
+
+static void unlink_cells(espatial_hash *hash, u32 box) {
+    espatial_box *b = &hash->boxes[box];
+    u32 e = b->first_entry;
+    while(e != ESPATIAL_NIL) {
+        espatial_entry *entry = &hash->entries[e];
+        if(entry->prev != ESPATIAL_NIL) {
+            hash->entries[entry->prev].next = entry->next;
+        } else {
+            hash->buckets[hash_cell(hash, entry->cx, entry->cy)] = entry->next;
+        }
+        if(entry->next != ESPATIAL_NIL) {
+            hash->entries[entry->next].prev = entry->prev;
+        }
+        u32 next = entry->box_next;
+        // back to the free list
+        entry->box_next = hash->free_entry;
+        hash->free_entry = e;
+        e = next;
+    }
+    b->first_entry = ESPATIAL_NIL;
+}
+
+static u32 alloc_entry(espatial_hash *hash) {
+    if(hash->free_entry != ESPATIAL_NIL) {
+        u32 e = hash->free_entry;
+        hash->free_entry = hash->entries[e].box_next;
+        return e;
+    }
+    if(hash->entry_count == hash->entry_capacity) {
+        hash->entry_capacity *= 2;
+        hash->entries = erealloc(hash->entries, hash->entry_capacity * sizeof(espatial_entry));
+        EASSERT_MSG(hash->entries != 0, "couldn't grow spatial hash");
+    }
+    return hash->entry_count++;
+}
+
+static u32 hash_cell(espatial_hash *hash, i32 cx, i32 cy) {
+    return ((u32)cx * 73856093u ^ (u32)cy * 19349663u) & hash->bucket_mask;
+}
+
+static u32 round_pow2(u32 n) {
+    u32 p = 1;
+    while(p < n) {
+        p <<= 1;
+    }
+    return p;
+}
@@ -0,0 +1,80 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "defines.h"
+#include "scene.h"
+
+// Broadphase: boxes are hashed into a uniform grid of square cells.
+// Each box is registered in every cell it touches, so cells should be
+// about the size of a typical box.
+
+#define ESPATIAL_NIL 0xFFFFFFFF
+
+typedef struct espatial_entry {
+    u32 box;
+    i32 cx;
+    i32 cy;
+    // bucket chain
+    u32 prev;
+    u32 next;
+    // next cell of the same box
+    u32 box_next;
+} espatial_entry;
+
+typedef struct espatial_box {
+    collision_box bounds;
+    // cells covered, inclusive
+    i32 cx0;
+    i32 cy0;
+    i32 cx1;
+    i32 cy1;
+    u32 first_entry;
+    u8 active;
+} espatial_box;
+
+typedef struct espatial_pair {
+    u32 a;
+    u32 b;
+} espatial_pair;
+
+typedef struct espatial_hash {
+    u32 cell_shift;
+    u32 bucket_mask;
+    u32 *buckets;
+
+    espatial_entry *entries;
+    u32 entry_capacity;
+    u32 entry_count;
+    u32 free_entry;
+
+    espatial_box *boxes;
+    u32 box_capacity;
+
+    // dedup of region queries
+    u32 *query_stamps;
+    u32 query_stamp;
+
+    // overlap tests done by the last pairs/query call
+    u64 tests;
+} espatial_hash;
+
+// cell size is rounded to a power of 2, bucket_count too
+EAPI u8 espatial_hash_create(u32 cell_size, u32 bucket_count, u32 box_capacity, espatial_hash *hash);
+EAPI void espatial_hash_destroy(espatial_hash *hash);
+EAPI void espatial_hash_clear(espatial_hash *hash);
+
+EAPI void espatial_hash_insert(espatial_hash *hash, u32 box, collision_box bounds);
+// only touches the buckets if the box moved to other cells
+EAPI void espatial_hash_update(espatial_hash *hash, u32 box, collision_box bounds);
+EAPI void espatial_hash_remove(espatial_hash *hash, u32 box);
+
+// writes up to capacity overlapping pairs (a < b), returns the number found
+EAPI u32 espatial_hash_pairs(espatial_hash *hash, espatial_pair *pairs, u32 capacity);
+// writes up to capacity boxes overlapping region, returns the number found
+EAPI u32 espatial_hash_query(espatial_hash *hash, collision_box region, u32 *boxes, u32 capacity);
+
+static inline u8 collision_box_overlap(const collision_box *a, const collision_box *b) {
+    return a->x1 < b->x2 && b->x1 < a->x2 && a->y1 < b->y2 && b->y1 < a->y2;
+}
+
+#endif // SPATIAL_HASH_H
@@ -0,0 +1,81 @@
+#include "swapchain.h"
+
+#include "assert.h"
+
+#include <limits.h>
+
+void eswapchain_init(u64 buffer_size, eswap_policy policy, eswapchain *swapchain) {
+    EASSERT(swapchain != 0);
+    *swapchain = (eswapchain){0};
+    swapchain->buffer_size = buffer_size;
+    swapchain->policy = policy;
+}
+
+u8 eswapchain_add(eswapchain *swapchain, u32 handle, u32 *index) {
+    if(swapchain->count == ESWAPCHAIN_MAX_BUFFERS) {
+        return false;
+    }
+    *index = swapchain->count++;
+    swapchain->buffers[*index] = (eswapchain_buffer){ .handle = handle, .busy = false };
+    swapchain->free[swapchain->free_count++] = *index;
+    return true;
+}
+
+eswapchain_result eswapchain_acquire(eswapchain *swapchain, u32 *index) {
+    if(swapchain->free_count) {
+        *index = swapchain->free[--swapchain->free_count];
+        ++swapchain->frames;
+        return ESWAPCHAIN_ACQUIRED;
+    }
+    switch(swapchain->policy) {
+        case ESWAP_ALLOCATE:
+            if(swapchain->count < ESWAPCHAIN_MAX_BUFFERS) {
+                return ESWAPCHAIN_ALLOCATE;
+            }
+            break;
+        case ESWAP_BLOCK:
+            ++swapchain->waits;
+            return ESWAPCHAIN_WAIT;
+        case ESWAP_DROP:
+            break;
+    }
+    ++swapchain->dropped;
+    return ESWAPCHAIN_DROP;
+}
+
+void eswapchain_submit(eswapchain *swapchain, u32 index) {
+    EASSERT(index < swapchain->count && !swapchain->buffers[index].busy);
+    swapchain->buffers[index].busy = true;
+    swapchain->buffers[index].presented = ++swapchain->presents;
+}
+
+void eswapchain_submit_blank(eswapchain *swapchain, u32 index) {
+    EASSERT(index < swapchain->count && !swapchain->buffers[index].busy);
+    swapchain->buffers[index].busy = true;
+    swapchain->buffers[index].presented = 0;
+}
+
+u8 eswapchain_release(eswapchain *swapchain, u32 handle) {
+    for(u32 i = 0; i < swapchain->count; ++i) {
+        eswapchain_buffer *buffer = &swapchain->buffers[i];
+        if(buffer->handle != handle) {
+            continue;
+        }
+        // a buffer that isn't busy is already on the free list
+        if(buffer->busy) {
+            buffer->busy = false;
+            swapchain->free[swapchain->free_count++] = i;
+        }
+        return true;
+    }
+    return false;
+}
+
+u32 eswapchain_age(const eswapchain *swapchain, u32 index) {
+    EASSERT(index < swapchain->count);
+    u64 presented = swapchain->buffers[index].presented;
+    if(!presented || swapchain->presents - presented + 1 > UINT_MAX) {
+        return 0;
+    }
+    return swapchain->presents - presented + 1;
+}
@@ -0,0 +1,80 @@
+#ifndef SWAPCHAIN_H
+#define SWAPCHAIN_H
+
+#include "defines.h"
+
+// Window buffers shared with the compositor, all in one memory pool at
+// index * buffer_size. A buffer is acquired from the free list to draw into,
+// submitted when attached, and busy until the compositor releases it. The
+// backend creates the buffers and feeds the release events, this only keeps
+// track of them.
+
+#define ESWAPCHAIN_MAX_BUFFERS 4
+#define ESWAPCHAIN_DEFAULT_BUFFERS 2
+
+// when the compositor holds every buffer
+typedef enum eswap_policy {
+    // create another buffer, up to ESWAPCHAIN_MAX_BUFFERS, then drop
+    ESWAP_ALLOCATE = 0,
+    // skip the frame
+    ESWAP_DROP     = 1,
+    // wait for a release
+    ESWAP_BLOCK    = 2,
+} eswap_policy;
+
+typedef enum eswapchain_result {
+    ESWAPCHAIN_ACQUIRED,
+    // create a buffer and eswapchain_add it
+    ESWAPCHAIN_ALLOCATE,
+    // dispatch events until one is released
+    ESWAPCHAIN_WAIT,
+    ESWAPCHAIN_DROP,
+} eswapchain_result;
+
+typedef struct eswapchain_buffer {
+    // backend object, e.g. the wl_buffer id
+    u32 handle;
+    // held by the compositor
+    u8 busy;
+    // value of presents when last submitted, 0 if never
+    u64 presented;
+} eswapchain_buffer;
+
+typedef struct eswapchain {
+    eswapchain_buffer buffers[ESWAPCHAIN_MAX_BUFFERS];
+    u32 count;
+    // buffers that aren't busy, the last released on top as it is the most
+    // likely to still be in cache
+    u32 free[ESWAPCHAIN_MAX_BUFFERS];
+    u32 free_count;
+    u64 buffer_size;
+    eswap_policy policy;
+
+    u64 frames;
+    u64 presents;
+    // no buffer to draw into
+    u64 dropped;
+    u64 waits;
+} eswapchain;
+
+EAPI void eswapchain_init(u64 buffer_size, eswap_policy policy, eswapchain *swapchain);
+// a new buffer, free, false when there are already ESWAPCHAIN_MAX_BUFFERS
+EAPI u8 eswapchain_add(eswapchain *swapchain, u32 handle, u32 *index);
+// index of a buffer to draw into, or what to do when none is free
+EAPI eswapchain_result eswapchain_acquire(eswapchain *swapchain, u32 *index);
+// attached: busy until released
+EAPI void eswapchain_submit(eswapchain *swapchain, u32 index);
+// same for pixels that aren't a frame, e.g. cleared: its age stays 0 and
+// the other buffers' ages don't count it
+EAPI void eswapchain_submit_blank(eswapchain *swapchain, u32 index);
+// false when handle isn't one of the buffers
+EAPI u8 eswapchain_release(eswapchain *swapchain, u32 handle);
+// frames since the buffer was last submitted, 1 when it holds the previous
+// frame, 0 when it was never drawn
+EAPI u32 eswapchain_age(const eswapchain *swapchain, u32 index);
+
+static inline u64 eswapchain_offset(const eswapchain *swapchain, u32 index) {
+    return index * swapchain->buffer_size;
+}
+
+#endif // SWAPCHAIN_H
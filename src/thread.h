@@ -0,0 +1,43 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "defines.h"
+
+// live threads with recycled indices, the lowest free one is assigned first
+#define ETHREAD_MAX_INDICES 256
+
+// opaque storage, sized to fit the platform primitives
+typedef struct ethread {
+    u64 handle;
+} ethread;
+
+typedef struct emutex {
+    u64 internal[8];
+} emutex;
+
+typedef struct econdvar {
+    u64 internal[8];
+} econdvar;
+
+typedef void *(*ethread_fn)(void *arg);
+
+EAPI u8 ethread_create(ethread_fn fn, void *arg, ethread *thread);
+EAPI u8 ethread_join(ethread *thread);
+EAPI u32 ethread_core_count();
+// small id of the calling thread, assigned on first call (0, 1, 2...) and
+// handed to another thread once it exits: unique among the live threads
+EAPI u32 ethread_index();
+EAPI void ethread_yield();
+
+EAPI u8 emutex_create(emutex *mutex);
+EAPI u8 emutex_destroy(emutex *mutex);
+EAPI void emutex_lock(emutex *mutex);
+EAPI void emutex_unlock(emutex *mutex);
+
+EAPI u8 econdvar_create(econdvar *condvar);
+EAPI u8 econdvar_destroy(econdvar *condvar);
+EAPI void econdvar_wait(econdvar *condvar, emutex *mutex);
+EAPI void econdvar_signal(econdvar *condvar);
+EAPI void econdvar_broadcast(econdvar *condvar);
+
+#endif // THREAD_H
@@ -0,0 +1,67 @@
+#include "timestep.h"
+
+#include "assert.h"
+#include "clock.h"
+
+void etimestep_init(etimestep_config *config, u64 now_ns, etimestep *timestep) {
+    EASSERT(timestep != 0);
+    *timestep = (etimestep){0};
+    if(config) {
+        timestep->config = *config;
+    }
+    etimestep_config *c = &timestep->config;
+    c->step_ns = c->step_ns ? c->step_ns : ETIMESTEP_DEFAULT_STEP_NS;
+    c->max_steps = c->max_steps ? c->max_steps : ETIMESTEP_DEFAULT_MAX_STEPS;
+    c->frame_ns = c->frame_ns ? c->frame_ns : c->step_ns;
+    c->spin_ns = c->spin_set ? c->spin_ns : ETIMESTEP_DEFAULT_SPIN_NS;
+    // resolved, initializing again with this config keeps it
+    c->spin_set = true;
+
+    timestep->previous_ns = now_ns;
+    timestep->next_frame_ns = now_ns + c->frame_ns;
+}
+
+u32 etimestep_advance(etimestep *timestep, u64 now_ns) {
+    etimestep_config *c = &timestep->config;
+    timestep->accumulator_ns += now_ns - timestep->previous_ns;
+    timestep->previous_ns = now_ns;
+
+    u32 steps = timestep->accumulator_ns / c->step_ns;
+    if(steps > c->max_steps) {
+        u64 dropped = (u64)(steps - c->max_steps) * c->step_ns;
+        timestep->dropped_ns += dropped;
+        timestep->accumulator_ns -= dropped;
+        steps = c->max_steps;
+    }
+    timestep->accumulator_ns -= (u64)steps * c->step_ns;
+    timestep->alpha = (f32)timestep->accumulator_ns / c->step_ns;
+
+    ++timestep->frames;
+    timestep->steps += steps;
+    return steps;
+}
+
+void etimestep_pace(etimestep *timestep) {
+    etimestep_config *c = &timestep->config;
+    if(c->uncapped) {
+        return;
+    }
+    u64 now = eclock_now_ns();
+    if(now < timestep->next_frame_ns) {
+        eclock_wait_until_ns(timestep->next_frame_ns, c->spin_ns);
+        timestep->next_frame_ns += c->frame_ns;
+    } else if(now - timestep->next_frame_ns > c->frame_ns) {
+        // too far behind: start over instead of running frames back to back to catch up
+        timestep->next_frame_ns = now + c->frame_ns;
+    } else {
+        timestep->next_frame_ns += c->frame_ns;
+    }
+}
+
+u64 etimestep_wait_ns(const etimestep *timestep, u64 now_ns) {
+    const etimestep_config *c = &timestep->config;
+    if(c->uncapped || now_ns + c->spin_ns >= timestep->next_frame_ns) {
+        return 0;
+    }
+    return timestep->next_frame_ns - c->spin_ns - now_ns;
+}
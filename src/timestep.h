@@ -0,0 +1,55 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+#include "defines.h"
+
+// Fixed timestep: the simulation advances by step_ns at a time whatever the
+// frame rate, render interpolates between the last two steps with alpha.
+
+#define ETIMESTEP_DEFAULT_STEP_NS (1000000000ull / 60)
+#define ETIMESTEP_DEFAULT_MAX_STEPS 5
+#define ETIMESTEP_DEFAULT_SPIN_NS 500000ull
+
+typedef struct etimestep_config {
+    // 0 for ETIMESTEP_DEFAULT_STEP_NS
+    u64 step_ns;
+    // most steps run in one frame, time past it is dropped so that a slow
+    // frame doesn't ask for even more steps on the next one (spiral of death)
+    // 0 for ETIMESTEP_DEFAULT_MAX_STEPS
+    u32 max_steps;
+    // target frame duration, 0 paces frames at step_ns
+    u64 frame_ns;
+    // frames run back to back, as fast as possible
+    u8 uncapped;
+    // end of the frame wait spent yielding instead of sleeping
+    // ETIMESTEP_DEFAULT_SPIN_NS unless spin_set
+    u64 spin_ns;
+    // spin_ns is used as is, 0 sleeps the whole wait (on battery, hidden window)
+    u8 spin_set;
+} etimestep_config;
+
+typedef struct etimestep {
+    etimestep_config config;
+
+    u64 previous_ns;
+    u64 accumulator_ns;
+    u64 next_frame_ns;
+    // interpolation between the last two steps, in [0, 1)
+    f32 alpha;
+
+    u64 frames;
+    u64 steps;
+    // simulation time lost to the max_steps cap
+    u64 dropped_ns;
+} etimestep;
+
+EAPI void etimestep_init(etimestep_config *config, u64 now_ns, etimestep *timestep);
+// accumulates the time elapsed since the last call and returns the number of steps to run
+EAPI u32 etimestep_advance(etimestep *timestep, u64 now_ns);
+// waits for the start of the next frame, unless uncapped
+EAPI void etimestep_pace(etimestep *timestep);
+// how long to wait for events before etimestep_pace, which spins the end of
+// the wait: 0 when uncapped or the frame is due
+EAPI u64 etimestep_wait_ns(const etimestep *timestep, u64 now_ns);
+
+#endif // TIMESTEP_H
@@ -0,0 +1,215 @@
+#define ELOG_MODULE RENDER
+
+#include "../asset.h"
+#include "../logger.h"
+#include "../memory.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_ASSETS 2048
+
+typedef struct easset {
+    u32 id;
+    // lookup to the data -- path for now
+    const char *path;
+    easset_type type;
+    // both types are images drawn by the software renderer
+    eimage image;
+} easset;
+
+static struct {
+    easset assets[MAX_ASSETS];
+    u32 head;
+} asset_manager;
+
+typedef struct image_header {
+    u32 width;
+    u32 height;
+    // channels per pixel: 1 gray, 2 gray + alpha, 3 RGB, 4 RGB + alpha
+    u32 depth;
+    u32 maxval;
+} image_header;
+
+static void skip_space(FILE *file) {
+    int c = fgetc(file);
+    while(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '#') {
+        if(c == '#') {
+            while(c != '\n' && c != EOF) {
+                c = fgetc(file);
+            }
+        }
+        c = fgetc(file);
+    }
+    ungetc(c, file);
+}
+
+static u8 read_number(FILE *file, u32 *value) {
+    skip_space(file);
+    return fscanf(file, "%u", value) == 1;
+}
+
+// "P6 width height maxval" and a single whitespace before the pixels
+static u8 read_ppm_header(FILE *file, image_header *header) {
+    header->depth = 3;
+    if(!read_number(file, &header->width) || !read_number(file, &header->height) || !read_number(file, &header->maxval)) {
+        return false;
+    }
+    int c = fgetc(file);
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// "KEY value" lines until ENDHDR, TUPLTYPE is implied by DEPTH
+static u8 read_pam_header(FILE *file, image_header *header) {
+    char line[128];
+    while(fgets(line, sizeof(line), file)) {
+        char key[16];
+        u32 value;
+        if(line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if(strncmp(line, "ENDHDR", 6) == 0) {
+            return true;
+        }
+        if(strncmp(line, "TUPLTYPE", 8) == 0) {
+            continue;
+        }
+        if(sscanf(line, "%15s %u", key, &value) != 2) {
+            return false;
+        }
+        if(strcmp(key, "WIDTH") == 0) {
+            header->width = value;
+        } else if(strcmp(key, "HEIGHT") == 0) {
+            header->height = value;
+        } else if(strcmp(key, "DEPTH") == 0) {
+            header->depth = value;
+        } else if(strcmp(key, "MAXVAL") == 0) {
+            header->maxval = value;
+        }
+    }
+    return false;
+}
+
+static u8 load_image(const char *path, eimage *image) {
+    FILE *file = fopen(path, "rb");
+    if(!file) {
+        EERROR("couldn't open image %s", path);
+        return false;
+    }
+
+    image_header header = {0};
+    char magic[3] = "";
+    u8 valid = fread(magic, 1, 2, file) == 2;
+    if(valid && magic[0] == 'P' && magic[1] == '6') {
+        valid = read_ppm_header(file, &header);
+    } else if(valid && magic[0] == 'P' && magic[1] == '7') {
+        valid = read_pam_header(file, &header);
+    } else {
+        valid = false;
+    }
+    // 16 bits samples aren't supported
+    if(!valid || header.width == 0 || header.height == 0 || header.depth == 0 || header.depth > 4
+            || header.maxval == 0 || header.maxval > 255 || header.width > 16384 || header.height > 16384) {
+        EERROR("%s is not a supported PPM or PAM image", path);
+        fclose(file);
+        return false;
+    }
+
+    u64 pixel_count = (u64)header.width * header.height;
+    u64 data_size = pixel_count * header.depth;
+    u8 *data = ealloc(data_size);
+    u32 *pixels = ealloc(pixel_count * sizeof(u32));
+    if(!data || !pixels || fread(data, 1, data_size, file) != data_size) {
+        EERROR("couldn't read the pixels of %s", path);
+        efree(data);
+        efree(pixels);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    // to 8 bits premultiplied ARGB
+    u8 opaque = true;
+    u8 has_alpha = header.depth == 2 || header.depth == 4;
+    u8 color_channels = has_alpha ? header.depth - 1 : header.depth;
+    for(u64 i = 0; i < pixel_count; ++i) {
+        const u8 *sample = data + i * header.depth;
+        u32 r = sample[0] * 255 / header.maxval;
+        u32 g = color_channels == 3 ? sample[1] * 255 / header.maxval : r;
+        u32 b = color_channels == 3 ? sample[2] * 255 / header.maxval : r;
+        u32 a = has_alpha ? sample[color_channels] * 255 / header.maxval : 255;
+        if(a != 255) {
+            opaque = false;
+            r = (r * a + 127) / 255;
+            g = (g * a + 127) / 255;
+            b = (b * a + 127) / 255;
+        }
+        pixels[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+    efree(data);
+
+    image->width = header.width;
+    image->height = header.height;
+    image->pixels = pixels;
+    image->opaque = opaque;
+    return true;
+}
+
+u32 asset_register(const char *path, easset_type type) {
+    if(asset_manager.head > MAX_ASSETS - 1) {
+        EERROR("no more room for assets, %s not registered", path);
+        return false;
+    }
+
+    easset *asset = &asset_manager.assets[asset_manager.head];
+    asset->id = asset_manager.head;
+    asset->path = path;
+    asset->type = type;
+    asset->image = (eimage){0};
+    ++asset_manager.head;
+    return asset->id;
+}
+
+void asset_load(u32 id) {
+    if(id >= asset_manager.head) {
+        EERROR("asset %u is not registered", id);
+        return;
+    }
+
+    easset *asset = &asset_manager.assets[id];
+    switch(asset->type) {
+        case ASSET_IMAGE:
+        case ASSET_TEXTURE:
+            if(!asset->image.pixels) {
+                load_image(asset->path, &asset->image);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void asset_unload(u32 id) {
+    if(id >= asset_manager.head) {
+        return;
+    }
+
+    easset *asset = &asset_manager.assets[id];
+    efree(asset->image.pixels);
+    asset->image = (eimage){0};
+}
+
+void *asset_get_data(u32 id) {
+    if(id >= asset_manager.head) {
+        return NULL;
+    }
+
+    easset *asset = &asset_manager.assets[id];
+    switch(asset->type) {
+        case ASSET_IMAGE:
+        case ASSET_TEXTURE:
+            return &asset->image;
+        default:
+            return NULL;
+    }
+}
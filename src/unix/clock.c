@@ -0,0 +1,31 @@
+#include "../clock.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+static struct timespec to_timespec(u64 ns) {
+    return (struct timespec){ .tv_sec = ns / 1000000000ull, .tv_nsec = ns % 1000000000ull };
+}
+
+u64 eclock_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void eclock_sleep_ns(u64 ns) {
+    struct timespec ts = to_timespec(ns);
+    while(nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+void eclock_wait_until_ns(u64 deadline_ns, u64 spin_ns) {
+    if(deadline_ns > spin_ns) {
+        // absolute, so that interruptions don't drift
+        struct timespec ts = to_timespec(deadline_ns - spin_ns);
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR);
+    }
+    while(eclock_now_ns() < deadline_ns) {
+        sched_yield();
+    }
+}
@@ -0,0 +1,208 @@
+#include "../event_loop.h"
+#include "../assert.h"
+#include "../logger.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define NSEC 1000000000ull
+// epoll_event.data of the timeout timer, sources are their index
+#define TIMEOUT_TAG UINT32_MAX
+
+static u32 to_epoll(u32 events) {
+    return (events & EEVENT_READ ? EPOLLIN : 0) | (events & EEVENT_WRITE ? EPOLLOUT : 0);
+}
+
+static eevent_source *find_source(eevent_loop *loop, i32 fd) {
+    for(u32 i = 0; i < EEVENT_MAX_SOURCES; ++i) {
+        if(loop->sources[i].fd == fd) {
+            return &loop->sources[i];
+        }
+    }
+    return 0;
+}
+
+static struct itimerspec timer_spec(u64 first_ns, u64 period_ns) {
+    struct itimerspec spec = {0};
+    spec.it_value.tv_sec = first_ns / NSEC;
+    spec.it_value.tv_nsec = first_ns % NSEC;
+    spec.it_interval.tv_sec = period_ns / NSEC;
+    spec.it_interval.tv_nsec = period_ns % NSEC;
+    return spec;
+}
+
+u8 eevent_loop_create(eevent_loop *loop) {
+    EASSERT(loop != 0);
+    *loop = (eevent_loop){0};
+    for(u32 i = 0; i < EEVENT_MAX_SOURCES; ++i) {
+        loop->sources[i].fd = -1;
+    }
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(loop->epoll_fd == -1) {
+        EERROR("couldn't create the event loop: %s", strerror(errno));
+        return false;
+    }
+    loop->timeout_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = TIMEOUT_TAG };
+    if(loop->timeout_fd == -1 || epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->timeout_fd, &event) == -1) {
+        EERROR("couldn't create the event loop timer: %s", strerror(errno));
+        if(loop->timeout_fd != -1) {
+            close(loop->timeout_fd);
+        }
+        close(loop->epoll_fd);
+        return false;
+    }
+    return true;
+}
+
+void eevent_loop_destroy(eevent_loop *loop) {
+    for(u32 i = 0; i < EEVENT_MAX_SOURCES; ++i) {
+        if(loop->sources[i].fd != -1 && loop->sources[i].timer) {
+            close(loop->sources[i].fd);
+        }
+        loop->sources[i].fd = -1;
+    }
+    close(loop->timeout_fd);
+    close(loop->epoll_fd);
+    EDEBUG("event loop: %llu wakeups, %llu events dispatched", loop->wakeups, loop->dispatched);
+}
+
+eevent_loop *eevent_loop_main() {
+    static eevent_loop loop;
+    static u8 created;
+    if(!created) {
+        created = eevent_loop_create(&loop);
+        if(!created) {
+            return 0;
+        }
+    }
+    return &loop;
+}
+
+static u8 add_source(eevent_loop *loop, i32 fd, u32 events, eevent_fn fn, void *user, u8 timer) {
+    EASSERT(fn != 0);
+    if(find_source(loop, fd)) {
+        EERROR("fd %d is already in the event loop", fd);
+        return false;
+    }
+    eevent_source *source = find_source(loop, -1);
+    if(!source) {
+        EERROR("no more room in the event loop for fd %d", fd);
+        return false;
+    }
+    struct epoll_event event = { .events = to_epoll(events), .data.u32 = source - loop->sources };
+    if(epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        EERROR("couldn't watch fd %d: %s", fd, strerror(errno));
+        return false;
+    }
+    *source = (eevent_source){ .fd = fd, .fn = fn, .user = user, .timer = timer };
+    return true;
+}
+
+u8 eevent_add(eevent_loop *loop, i32 fd, u32 events, eevent_fn fn, void *user) {
+    return add_source(loop, fd, events, fn, user, false);
+}
+
+u8 eevent_modify(eevent_loop *loop, i32 fd, u32 events) {
+    eevent_source *source = find_source(loop, fd);
+    if(!source) {
+        return false;
+    }
+    struct epoll_event event = { .events = to_epoll(events), .data.u32 = source - loop->sources };
+    if(epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &event) == -1) {
+        EERROR("couldn't change the events of fd %d: %s", fd, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+u8 eevent_remove(eevent_loop *loop, i32 fd) {
+    eevent_source *source = find_source(loop, fd);
+    if(!source) {
+        return false;
+    }
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, 0);
+    if(source->timer) {
+        close(fd);
+    }
+    source->fd = -1;
+    return true;
+}
+
+u8 eevent_add_timer(eevent_loop *loop, u64 first_ns, u64 period_ns, eevent_fn fn, void *user, i32 *fd) {
+    i32 timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(timer == -1) {
+        EERROR("couldn't create a timer: %s", strerror(errno));
+        return false;
+    }
+    // 0 would disarm it
+    struct itimerspec spec = timer_spec(first_ns ? first_ns : 1, period_ns);
+    if(timerfd_settime(timer, 0, &spec, 0) == -1 || !add_source(loop, timer, EEVENT_READ, fn, user, true)) {
+        close(timer);
+        return false;
+    }
+    *fd = timer;
+    return true;
+}
+
+i32 eevent_loop_run(eevent_loop *loop, u64 timeout_ns) {
+    i32 timeout_ms = timeout_ns == EEVENT_WAIT_FOREVER ? -1 : 0;
+    if(timeout_ns && timeout_ns != EEVENT_WAIT_FOREVER) {
+        // epoll_wait only has ms
+        struct itimerspec spec = timer_spec(timeout_ns, 0);
+        timerfd_settime(loop->timeout_fd, 0, &spec, 0);
+        timeout_ms = -1;
+    }
+
+    struct epoll_event events[EEVENT_MAX_SOURCES + 1];
+    i32 count;
+    do {
+        count = epoll_wait(loop->epoll_fd, events, EEVENT_MAX_SOURCES + 1, timeout_ms);
+    } while(count == -1 && errno == EINTR);
+    if(count == -1) {
+        EERROR("event loop wait failed: %s", strerror(errno));
+        return -1;
+    }
+    ++loop->wakeups;
+
+    i32 dispatched = 0;
+    u8 timed_out = false;
+    for(i32 i = 0; i < count; ++i) {
+        u32 index = events[i].data.u32;
+        if(index == TIMEOUT_TAG) {
+            timed_out = true;
+            continue;
+        }
+        // removed by a handler called before
+        eevent_source *source = &loop->sources[index];
+        if(source->fd == -1) {
+            continue;
+        }
+        u32 reported = (events[i].events & EPOLLIN ? EEVENT_READ : 0) | (events[i].events & EPOLLOUT ? EEVENT_WRITE : 0)
+            | (events[i].events & (EPOLLERR | EPOLLHUP) ? EEVENT_CLOSED : 0);
+        if(source->timer) {
+            u64 expirations = 0;
+            if(read(source->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                continue;
+            }
+            reported = expirations;
+        }
+        source->fn(source->user, source->fd, reported);
+        ++dispatched;
+    }
+    if(timeout_ms == -1 && timeout_ns != EEVENT_WAIT_FOREVER) {
+        // disarmed, and drained if it fired
+        struct itimerspec spec = {0};
+        timerfd_settime(loop->timeout_fd, 0, &spec, 0);
+        u64 expirations;
+        if(timed_out && read(loop->timeout_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            // reset by the disarm
+        }
+    }
+    loop->dispatched += dispatched;
+    return dispatched;
+}
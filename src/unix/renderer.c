@@ -0,0 +1,642 @@
+#define ELOG_MODULE RENDER
+
+#include "../renderer.h"
+#include "../asset.h"
+#include "../window.h"
+#include "../assert.h"
+#include "../darray.h"
+#include "../jobs.h"
+#include "../logger.h"
+#include "../memory.h"
+#include "../profiler.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define ERENDER_X86
+    #include <immintrin.h>
+#endif
+
+// same as RAYWHITE on the raylib backend
+#define CLEAR_COLOR 0xFFF5F5F5
+// end of a tile bin
+#define NO_ENTRY UINT_MAX
+
+// src over dst, premultiplied
+typedef void (*blend_span_fn)(u32 *dst, const u32 *src, u32 count);
+
+static void blend_span_scalar(u32 *dst, const u32 *src, u32 count);
+#ifdef ERENDER_X86
+static void blend_span_sse2(u32 *dst, const u32 *src, u32 count);
+static void blend_span_avx2(u32 *dst, const u32 *src, u32 count);
+#endif
+
+// destination rectangle before clipping
+typedef struct draw_command {
+    eimage image;
+    i32 x;
+    i32 y;
+    i32 width;
+    i32 height;
+} draw_command;
+
+// commands of a tile are a list of entries, in submission order
+typedef struct bin_entry {
+    u32 command;
+    u32 next;
+} bin_entry;
+
+typedef struct tile_bin {
+    u32 head;
+    u32 tail;
+    // cleared before the commands are drawn
+    u8 clear;
+    // in the active list
+    u8 active;
+
+    // of the commands flushed this frame and in the previous one
+    u64 hash;
+    u64 last_hash;
+    // bit n set when the tile changed n + 1 frames ago
+    u8 history;
+} tile_bin;
+
+typedef struct da_commands {
+    draw_command *items;
+    u32 count;
+    u32 capacity;
+} da_commands;
+
+typedef struct da_entries {
+    bin_entry *items;
+    u32 count;
+    u32 capacity;
+} da_entries;
+
+typedef struct da_tiles {
+    u32 *items;
+    u32 count;
+    u32 capacity;
+} da_tiles;
+
+static struct {
+    erender_target target;
+    u8 has_target;
+    erender_backend backend;
+    blend_span_fn blend_span;
+    u8 init;
+
+    struct ejobs *jobs;
+    ejob_counter counter;
+
+    u32 tiles_x;
+    u32 tiles_y;
+    // tiles_x * tiles_y, tile_capacity allocated
+    tile_bin *tiles;
+    u32 tile_capacity;
+    // tiles with a clear or commands, rasterized on flush
+    da_tiles active;
+    da_commands commands;
+    da_entries entries;
+
+    // the next frame is rasterized entirely
+    u8 invalid;
+    // renderer_flush was called during this frame
+    u8 flushed;
+    ewindow_rect damage[ERENDER_MAX_DAMAGE_RECTS];
+    u32 damage_count;
+} renderer_state;
+
+static void end_frame();
+
+static void init_backend() {
+    if(renderer_state.init) {
+        return;
+    }
+    erender_backend best = ERENDER_BACKEND_SCALAR;
+#ifdef ERENDER_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        best = ERENDER_BACKEND_AVX2;
+    } else if(__builtin_cpu_supports("sse2")) {
+        best = ERENDER_BACKEND_SSE2;
+    }
+#endif
+    renderer_state.init = true;
+    renderer_set_backend(best);
+}
+
+void renderer_set_target(const erender_target *target) {
+    init_backend();
+    if(renderer_state.has_target) {
+        end_frame();
+    }
+    if(!target || !target->pixels || !target->width || !target->height) {
+        renderer_state.has_target = false;
+        return;
+    }
+    EASSERT(target->stride >= target->width);
+    u8 resized = target->width != renderer_state.target.width || target->height != renderer_state.target.height;
+    renderer_state.target = *target;
+    if(!resized && renderer_state.tiles) {
+        renderer_state.has_target = true;
+        return;
+    }
+    // nothing to compare with
+    renderer_state.invalid = true;
+    renderer_state.tiles_x = (target->width + ERENDER_TILE_SIZE - 1) / ERENDER_TILE_SIZE;
+    renderer_state.tiles_y = (target->height + ERENDER_TILE_SIZE - 1) / ERENDER_TILE_SIZE;
+    u32 tile_count = renderer_state.tiles_x * renderer_state.tiles_y;
+    if(tile_count > renderer_state.tile_capacity) {
+        efree(renderer_state.tiles);
+        renderer_state.tiles = ealloc(tile_count * sizeof(tile_bin));
+        if(!renderer_state.tiles) {
+            EERROR("couldn't allocate %u render tiles", tile_count);
+            renderer_state.tile_capacity = 0;
+            renderer_state.has_target = false;
+            return;
+        }
+        renderer_state.tile_capacity = tile_count;
+    }
+    for(u32 i = 0; i < tile_count; ++i) {
+        renderer_state.tiles[i] = (tile_bin){ .head = NO_ENTRY, .tail = NO_ENTRY };
+    }
+    renderer_state.has_target = true;
+}
+
+u32 renderer_damage(const ewindow_rect **rects) {
+    *rects = renderer_state.damage;
+    return renderer_state.damage_count;
+}
+
+void renderer_invalidate() {
+    renderer_state.invalid = true;
+}
+
+void renderer_set_jobs(struct ejobs *jobs) {
+    renderer_flush();
+    renderer_state.jobs = jobs;
+}
+
+void renderer_shutdown() {
+    renderer_set_target(0);
+    efree(renderer_state.tiles);
+    efree(renderer_state.active.items);
+    efree(renderer_state.commands.items);
+    efree(renderer_state.entries.items);
+    renderer_state.tiles = 0;
+    renderer_state.tile_capacity = 0;
+    renderer_state.target = (erender_target){0};
+    renderer_state.active = (da_tiles){0};
+    renderer_state.commands = (da_commands){0};
+    renderer_state.entries = (da_entries){0};
+    renderer_state.jobs = 0;
+}
+
+erender_backend renderer_get_backend() {
+    init_backend();
+    return renderer_state.backend;
+}
+
+u8 renderer_set_backend(erender_backend backend) {
+    init_backend();
+    switch(backend) {
+        case ERENDER_BACKEND_SCALAR:
+            renderer_state.blend_span = blend_span_scalar;
+            break;
+#ifdef ERENDER_X86
+        case ERENDER_BACKEND_SSE2:
+            if(!__builtin_cpu_supports("sse2")) {
+                return false;
+            }
+            renderer_state.blend_span = blend_span_sse2;
+            break;
+        case ERENDER_BACKEND_AVX2:
+            if(!__builtin_cpu_supports("avx2")) {
+                return false;
+            }
+            renderer_state.blend_span = blend_span_avx2;
+            break;
+#endif
+        default:
+            return false;
+    }
+    renderer_state.backend = backend;
+    return true;
+}
+
+static void activate_tile(u32 tile) {
+    if(!renderer_state.tiles[tile].active) {
+        renderer_state.tiles[tile].active = true;
+        darray_append(&renderer_state.active, tile);
+    }
+}
+
+u8 renderer_clear() {
+    if(!renderer_state.has_target) {
+        return false;
+    }
+    // everything queued so far is cleared over
+    renderer_state.commands.count = 0;
+    renderer_state.entries.count = 0;
+    u32 tile_count = renderer_state.tiles_x * renderer_state.tiles_y;
+    for(u32 i = 0; i < tile_count; ++i) {
+        tile_bin *bin = &renderer_state.tiles[i];
+        bin->head = bin->tail = NO_ENTRY;
+        bin->clear = true;
+        activate_tile(i);
+    }
+    return true;
+}
+
+u8 renderer_draw_asset(u32 id, int x, int y, int width, int height) {
+    return renderer_draw_image(asset_get_data(id), x, y, width, height);
+}
+
+u8 renderer_draw_image(const eimage *image, int x, int y, int width, int height) {
+    if(!renderer_state.has_target || !image || !image->pixels || width <= 0 || height <= 0) {
+        return false;
+    }
+    erender_target *target = &renderer_state.target;
+
+    // clipped destination rectangle, 64 bits as x + width can overflow
+    i64 x0 = x > 0 ? x : 0;
+    i64 y0 = y > 0 ? y : 0;
+    i64 x1 = (i64)x + width < target->width ? (i64)x + width : target->width;
+    i64 y1 = (i64)y + height < target->height ? (i64)y + height : target->height;
+    if(x0 >= x1 || y0 >= y1) {
+        // nothing visible
+        return true;
+    }
+
+    u32 command = renderer_state.commands.count;
+    darray_append(&renderer_state.commands, ((draw_command){ .image = *image, .x = x, .y = y, .width = width, .height = height }));
+
+    for(u32 ty = y0 / ERENDER_TILE_SIZE; ty <= (y1 - 1) / ERENDER_TILE_SIZE; ++ty) {
+        for(u32 tx = x0 / ERENDER_TILE_SIZE; tx <= (x1 - 1) / ERENDER_TILE_SIZE; ++tx) {
+            u32 tile = ty * renderer_state.tiles_x + tx;
+            tile_bin *bin = &renderer_state.tiles[tile];
+            i64 tile_x0 = tx * ERENDER_TILE_SIZE, tile_y0 = ty * ERENDER_TILE_SIZE;
+            i64 tile_x1 = tile_x0 + ERENDER_TILE_SIZE < target->width ? tile_x0 + ERENDER_TILE_SIZE : target->width;
+            i64 tile_y1 = tile_y0 + ERENDER_TILE_SIZE < target->height ? tile_y0 + ERENDER_TILE_SIZE : target->height;
+
+            u32 entry = renderer_state.entries.count;
+            darray_append(&renderer_state.entries, ((bin_entry){ .command = command, .next = NO_ENTRY }));
+            if(image->opaque && x0 <= tile_x0 && y0 <= tile_y0 && x1 >= tile_x1 && y1 >= tile_y1) {
+                // hides the clear and everything drawn before
+                bin->head = entry;
+                bin->clear = false;
+            } else if(bin->tail == NO_ENTRY) {
+                bin->head = entry;
+            } else {
+                renderer_state.entries.items[bin->tail].next = entry;
+            }
+            bin->tail = entry;
+            activate_tile(tile);
+        }
+    }
+    return true;
+}
+
+static void draw_span(u32 *dst, const u32 *src, u32 count, u8 opaque) {
+    if(opaque) {
+        memcpy(dst, src, count * sizeof(u32));
+    } else {
+        renderer_state.blend_span(dst, src, count);
+    }
+}
+
+// command clipped to [x0, x1) x [y0, y1), at most a tile wide
+static void draw_clipped(const draw_command *command, i64 x0, i64 y0, i64 x1, i64 y1) {
+    erender_target *target = &renderer_state.target;
+    const eimage *image = &command->image;
+
+    // nearest sampling at pixel centers, the same as repeating each source
+    // pixel factor times for integer factors
+    u32 dx0 = x0 - command->x;
+    u32 dy0 = y0 - command->y;
+    u32 span = x1 - x0;
+    u32 *dst = target->pixels + y0 * target->stride + x0;
+
+    if((u32)command->width == image->width) {
+        // unscaled columns, rows straight from the image
+        for(u32 dy = dy0; dy < dy0 + (y1 - y0); ++dy, dst += target->stride) {
+            u32 sy = (u32)(((2 * (u64)dy + 1) * image->height) / (2 * (u64)command->height));
+            draw_span(dst, image->pixels + (u64)sy * image->width + dx0, span, image->opaque);
+        }
+        return;
+    }
+
+    // source column of each destination pixel, and the gathered row
+    u32 columns[ERENDER_TILE_SIZE];
+    u32 row[ERENDER_TILE_SIZE];
+    u8 integer = (u32)command->width % image->width == 0;
+    u32 factor = command->width / image->width;
+    if(!integer) {
+        for(u32 i = 0; i < span; ++i) {
+            u64 dx = dx0 + i;
+            columns[i] = (u32)(((2 * dx + 1) * image->width) / (2 * (u64)command->width));
+        }
+    }
+
+    u32 last_sy = UINT_MAX;
+    for(u32 dy = dy0; dy < dy0 + (y1 - y0); ++dy, dst += target->stride) {
+        u32 sy = (u32)(((2 * (u64)dy + 1) * image->height) / (2 * (u64)command->height));
+        if(sy != last_sy) {
+            // rows repeated by vertical scaling are gathered once
+            const u32 *src = image->pixels + (u64)sy * image->width;
+            if(integer) {
+                u32 dx = dx0;
+                u32 i = 0;
+                while(i < span) {
+                    u32 pixel = src[dx / factor];
+                    u32 repeat = factor - dx % factor;
+                    for(; repeat && i < span; --repeat, ++i, ++dx) {
+                        row[i] = pixel;
+                    }
+                }
+            } else {
+                for(u32 i = 0; i < span; ++i) {
+                    row[i] = src[columns[i]];
+                }
+            }
+            last_sy = sy;
+        }
+        draw_span(dst, row, span, image->opaque);
+    }
+}
+
+static void rasterize_tile(u32 tile) {
+    erender_target *target = &renderer_state.target;
+    tile_bin *bin = &renderer_state.tiles[tile];
+    i64 x0 = (tile % renderer_state.tiles_x) * ERENDER_TILE_SIZE;
+    i64 y0 = (tile / renderer_state.tiles_x) * ERENDER_TILE_SIZE;
+    i64 x1 = x0 + ERENDER_TILE_SIZE < target->width ? x0 + ERENDER_TILE_SIZE : target->width;
+    i64 y1 = y0 + ERENDER_TILE_SIZE < target->height ? y0 + ERENDER_TILE_SIZE : target->height;
+
+    if(bin->clear) {
+        u32 *row = target->pixels + y0 * target->stride + x0;
+        for(i64 x = 0; x < x1 - x0; ++x) {
+            row[x] = CLEAR_COLOR;
+        }
+        for(i64 y = y0 + 1; y < y1; ++y) {
+            memcpy(target->pixels + y * target->stride + x0, row, (x1 - x0) * sizeof(u32));
+        }
+    }
+
+    for(u32 entry = bin->head; entry != NO_ENTRY; entry = renderer_state.entries.items[entry].next) {
+        const draw_command *command = &renderer_state.commands.items[renderer_state.entries.items[entry].command];
+        i64 cx0 = command->x > x0 ? command->x : x0;
+        i64 cy0 = command->y > y0 ? command->y : y0;
+        i64 cx1 = (i64)command->x + command->width < x1 ? (i64)command->x + command->width : x1;
+        i64 cy1 = (i64)command->y + command->height < y1 ? (i64)command->y + command->height : y1;
+        draw_clipped(command, cx0, cy0, cx1, cy1);
+    }
+}
+
+static void rasterize_tiles(void *arg, u32 first, u32 count) {
+    for(u32 i = first; i < first + count; ++i) {
+        rasterize_tile(renderer_state.active.items[i]);
+    }
+}
+
+#define HASH_PRIME 0x100000001b3ull
+
+static u64 hash_u64(u64 hash, u64 value) {
+    return (hash ^ value) * HASH_PRIME;
+}
+
+// what the bin draws, the same hash means the same pixels
+// folded in order, so the same whether the frame was flushed once or more
+static u64 hash_bin(u64 hash, const tile_bin *bin) {
+    if(bin->clear) {
+        hash = hash_u64(hash, 0xc1ea4);
+    }
+    for(u32 entry = bin->head; entry != NO_ENTRY; entry = renderer_state.entries.items[entry].next) {
+        const draw_command *command = &renderer_state.commands.items[renderer_state.entries.items[entry].command];
+        hash = hash_u64(hash, (u64)(uintptr_t)command->image.pixels);
+        hash = hash_u64(hash, ((u64)command->image.width << 32) | command->image.height);
+        hash = hash_u64(hash, ((u64)(u32)command->x << 32) | (u32)command->y);
+        hash = hash_u64(hash, ((u64)(u32)command->width << 32) | (u32)command->height);
+    }
+    return hash;
+}
+
+// the hashes stay for the damage
+static void reset_bin(tile_bin *bin) {
+    bin->head = bin->tail = NO_ENTRY;
+    bin->clear = false;
+    bin->active = false;
+}
+
+// end_frame: the last flush of the frame, active tiles the target already
+// holds are skipped
+static void flush(u8 end_frame) {
+    EPROFILE_SCOPE("renderer_flush");
+    u32 count = renderer_state.active.count;
+    if(!count) {
+        return;
+    }
+
+    // the history goes back 8 frames
+    u32 age = renderer_state.target.age;
+    u8 skip = end_frame && age >= 1 && age <= 8 && !renderer_state.invalid && !renderer_state.flushed;
+    // changed in the frames the target missed
+    u8 missed = skip ? (u8)((1u << (age - 1)) - 1) : 0;
+    u32 drawn = 0;
+    for(u32 i = 0; i < count; ++i) {
+        u32 tile = renderer_state.active.items[i];
+        tile_bin *bin = &renderer_state.tiles[tile];
+        bin->hash = hash_bin(bin->hash, bin);
+        if(skip && bin->hash == bin->last_hash && !(bin->history & missed)) {
+            reset_bin(bin);
+            continue;
+        }
+        renderer_state.active.items[drawn++] = tile;
+    }
+    if(!end_frame) {
+        // tiles hidden now could show later in the frame
+        renderer_state.flushed = true;
+    }
+
+    if(!drawn) {
+        // nothing changed
+    } else if(renderer_state.jobs) {
+        // a tile per job, tiles cost very different amounts
+        ejobs_parallel_for(renderer_state.jobs, rasterize_tiles, 0, drawn, 1, &renderer_state.counter);
+        ejobs_wait(renderer_state.jobs, &renderer_state.counter);
+    } else {
+        rasterize_tiles(0, 0, drawn);
+    }
+
+    for(u32 i = 0; i < drawn; ++i) {
+        reset_bin(&renderer_state.tiles[renderer_state.active.items[i]]);
+    }
+    renderer_state.active.count = 0;
+    renderer_state.commands.count = 0;
+    renderer_state.entries.count = 0;
+}
+
+void renderer_flush() {
+    flush(false);
+}
+
+// rectangles of the tiles changed this frame: runs of a tile row, merged with
+// the run of the same columns in the row above
+static void build_damage() {
+    erender_target *target = &renderer_state.target;
+    ewindow_rect *rects = renderer_state.damage;
+    u32 count = 0;
+    for(u32 ty = 0; ty < renderer_state.tiles_y; ++ty) {
+        const tile_bin *row = renderer_state.tiles + ty * renderer_state.tiles_x;
+        i32 y = ty * ERENDER_TILE_SIZE;
+        i32 height = (ty + 1) * ERENDER_TILE_SIZE < target->height ? ERENDER_TILE_SIZE : (i32)target->height - y;
+        u32 tx = 0;
+        while(tx < renderer_state.tiles_x) {
+            if(!(row[tx].history & 1)) {
+                ++tx;
+                continue;
+            }
+            u32 first = tx;
+            while(tx < renderer_state.tiles_x && (row[tx].history & 1)) {
+                ++tx;
+            }
+            i32 x = first * ERENDER_TILE_SIZE;
+            i32 width = (tx * ERENDER_TILE_SIZE < target->width ? (i32)(tx * ERENDER_TILE_SIZE) : (i32)target->width) - x;
+
+            u32 i = 0;
+            while(i < count && (rects[i].x != x || rects[i].width != width || rects[i].y + rects[i].height != y)) {
+                ++i;
+            }
+            if(i < count) {
+                rects[i].height += height;
+            } else if(count < ERENDER_MAX_DAMAGE_RECTS) {
+                rects[count++] = (ewindow_rect){ .x = x, .y = y, .width = width, .height = height };
+            } else {
+                rects[0] = (ewindow_rect){ .x = 0, .y = 0, .width = target->width, .height = target->height };
+                renderer_state.damage_count = 1;
+                return;
+            }
+        }
+    }
+    renderer_state.damage_count = count;
+}
+
+// compares the tiles with the previous frame
+static void end_frame() {
+    flush(true);
+
+    u32 tile_count = renderer_state.tiles_x * renderer_state.tiles_y;
+    for(u32 i = 0; i < tile_count; ++i) {
+        tile_bin *bin = &renderer_state.tiles[i];
+        u8 changed = renderer_state.invalid || bin->hash != bin->last_hash;
+        bin->history = (bin->history << 1) | changed;
+        bin->last_hash = bin->hash;
+        bin->hash = 0;
+    }
+    build_damage();
+    renderer_state.invalid = false;
+    renderer_state.flushed = false;
+}
+
+// round(x * a / 255) on each 8 bits channel, for x and a in [0, 255]:
+// t = x * a + 128, (t + (t >> 8)) >> 8
+static inline u32 blend_pixel(u32 s, u32 d) {
+    u32 a = 255 - (s >> 24);
+    u32 rb = (d & 0x00FF00FF) * a + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    u32 ag = ((d >> 8) & 0x00FF00FF) * a + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return s + (rb | ag);
+}
+
+static void blend_span_scalar(u32 *dst, const u32 *src, u32 count) {
+    for(u32 i = 0; i < count; ++i) {
+        u32 s = src[i];
+        if((s >> 24) == 255) {
+            dst[i] = s;
+        } else if(s != 0) {
+            dst[i] = blend_pixel(s, dst[i]);
+        }
+    }
+}
+
+#ifdef ERENDER_X86
+
+// 16 bits lanes hold one channel, the inverted source alpha is spread over
+// the 4 lanes of its pixel before the multiply
+// inlined in the AVX2 kernel as well, calling non-VEX code from it would
+// pay for the SSE/AVX transitions
+__attribute__((target("sse2")))
+static inline void blend4(u32 *dst, const u32 *src) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_max = _mm_set1_epi32(0xFF);
+    const __m128i round = _mm_set1_epi16(0x80);
+    __m128i s = _mm_loadu_si128((const __m128i *)src);
+    __m128i alpha = _mm_srli_epi32(s, 24);
+    if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_max)) == 0xFFFF) {
+        _mm_storeu_si128((__m128i *)dst, s);
+        return;
+    }
+    if(_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF) {
+        return;
+    }
+    __m128i d = _mm_loadu_si128((const __m128i *)dst);
+    __m128i inv = _mm_xor_si128(alpha, alpha_max);
+    inv = _mm_or_si128(inv, _mm_slli_epi32(inv, 16));
+    __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi32(inv, inv));
+    __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi32(inv, inv));
+    lo = _mm_add_epi16(lo, round);
+    hi = _mm_add_epi16(hi, round);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    _mm_storeu_si128((__m128i *)dst, _mm_add_epi8(s, _mm_packus_epi16(lo, hi)));
+}
+
+__attribute__((target("sse2")))
+static void blend_span_sse2(u32 *dst, const u32 *src, u32 count) {
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4) {
+        blend4(dst + i, src + i);
+    }
+    blend_span_scalar(dst + i, src + i, count - i);
+}
+
+// same as SSE2, unpacks and packs stay within each 128 bits lane
+__attribute__((target("avx2")))
+static void blend_span_avx2(u32 *dst, const u32 *src, u32 count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_max = _mm256_set1_epi32(0xFF);
+    const __m256i round = _mm256_set1_epi16(0x80);
+    u32 i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i alpha = _mm256_srli_epi32(s, 24);
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alpha_max)) == -1) {
+            _mm256_storeu_si256((__m256i *)(dst + i), s);
+            continue;
+        }
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) == -1) {
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i inv = _mm256_xor_si256(alpha, alpha_max);
+        inv = _mm256_or_si256(inv, _mm256_slli_epi32(inv, 16));
+        __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi32(inv, inv));
+        __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi32(inv, inv));
+        lo = _mm256_add_epi16(lo, round);
+        hi = _mm256_add_epi16(hi, round);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_add_epi8(s, _mm256_packus_epi16(lo, hi)));
+    }
+    if(i + 4 <= count) {
+        blend4(dst + i, src + i);
+        i += 4;
+    }
+    blend_span_scalar(dst + i, src + i, count - i);
+}
+
+#endif
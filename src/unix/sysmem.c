@@ -1,9 +1,13 @@
+#define ELOG_MODULE MEMORY
+
 #include "../defines.h"
 #include "../assert.h"
 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 void *esysalloc(u64 size) {
     void *ptr = malloc(size);
@@ -11,6 +15,13 @@ void *esysalloc(u64 size) {
     return ptr;
 }
 
+void *esysalloc_align(u64 size, u64 align) {
+    // aligned_alloc wants a multiple of the alignment
+    void *ptr = aligned_alloc(align, (size + align - 1) & ~(align - 1));
+    EASSERT_MSG(ptr != 0, "couldn't allocate memory");
+    return ptr;
+}
+
 void esysfree(void *memory) {
     free(memory);
 }
@@ -28,3 +39,31 @@ void *esysmap(void *addr, u64 length, u32 prot, u32 flags, u32 fd, u32 offset) {
 void esysunmap(void *addr, u64 length) {
     munmap(addr, length);
 }
+
+// creates or truncates the file at path to size and maps it, shared
+void *esysmap_file(const char *path, u64 size, i32 *fd) {
+    *fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(*fd < 0) {
+        return 0;
+    }
+    // blocks allocated up front, writes through the mapping don't have to
+    if(posix_fallocate(*fd, 0, size) != 0) {
+        close(*fd);
+        return 0;
+    }
+    void *ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, *fd, 0);
+    if(ptr == MAP_FAILED) {
+        close(*fd);
+        return 0;
+    }
+    return ptr;
+}
+
+// unmaps the file and cuts it to size
+void esysunmap_file(void *addr, u64 mapped_size, i32 fd, u64 size) {
+    munmap(addr, mapped_size);
+    if(ftruncate(fd, size) != 0) {
+        EERROR("couldn't truncate a mapped file");
+    }
+    close(fd);
+}
@@ -0,0 +1,114 @@
+#define ELOG_MODULE JOBS
+
+#include "../thread.h"
+#include "../assert.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(pthread_t) <= sizeof(((ethread *)0)->handle), "ethread too small for pthread_t");
+_Static_assert(sizeof(pthread_mutex_t) <= sizeof(((emutex *)0)->internal), "emutex too small for pthread_mutex_t");
+_Static_assert(sizeof(pthread_cond_t) <= sizeof(((econdvar *)0)->internal), "econdvar too small for pthread_cond_t");
+
+u8 ethread_create(ethread_fn fn, void *arg, ethread *thread) {
+    EASSERT(thread != 0);
+    if(pthread_create((pthread_t *)&thread->handle, 0, fn, arg) != 0) {
+        EERROR("failed to create thread");
+        return false;
+    }
+    return true;
+}
+
+u8 ethread_join(ethread *thread) {
+    EASSERT(thread != 0);
+    return pthread_join((pthread_t)thread->handle, 0) == 0;
+}
+
+u32 ethread_core_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+}
+
+// bit set while a live thread holds the index
+static u64 indices_used[ETHREAD_MAX_INDICES / 64];
+// past ETHREAD_MAX_INDICES live threads, indices aren't recycled
+static u32 overflow_count;
+static pthread_key_t index_key;
+static pthread_once_t index_key_once = PTHREAD_ONCE_INIT;
+static __thread u32 thread_index_plus_one;
+
+// runs when a thread that took an index exits
+static void release_index(void *value) {
+    u32 index = (u32)(u64)value - 1;
+    if(index < ETHREAD_MAX_INDICES) {
+        __atomic_and_fetch(&indices_used[index / 64], ~(1ull << (index % 64)), __ATOMIC_RELEASE);
+    }
+}
+
+static void create_index_key() {
+    EASSERT(pthread_key_create(&index_key, release_index) == 0);
+}
+
+// lowest free index, so the indices stay small however many threads come and go
+static u32 claim_index() {
+    for(u32 word = 0; word < ETHREAD_MAX_INDICES / 64; ++word) {
+        u64 used = __atomic_load_n(&indices_used[word], __ATOMIC_RELAXED);
+        while(~used) {
+            u32 bit = __builtin_ctzll(~used);
+            if(__atomic_compare_exchange_n(&indices_used[word], &used, used | (1ull << bit), false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return word * 64 + bit;
+            }
+        }
+    }
+    return ETHREAD_MAX_INDICES + __atomic_fetch_add(&overflow_count, 1, __ATOMIC_RELAXED);
+}
+
+u32 ethread_index() {
+    if(!thread_index_plus_one) {
+        pthread_once(&index_key_once, create_index_key);
+        thread_index_plus_one = claim_index() + 1;
+        pthread_setspecific(index_key, (void *)(u64)thread_index_plus_one);
+    }
+    return thread_index_plus_one - 1;
+}
+
+void ethread_yield() {
+    sched_yield();
+}
+
+u8 emutex_create(emutex *mutex) {
+    return pthread_mutex_init((pthread_mutex_t *)mutex->internal, 0) == 0;
+}
+
+u8 emutex_destroy(emutex *mutex) {
+    return pthread_mutex_destroy((pthread_mutex_t *)mutex->internal) == 0;
+}
+
+void emutex_lock(emutex *mutex) {
+    pthread_mutex_lock((pthread_mutex_t *)mutex->internal);
+}
+
+void emutex_unlock(emutex *mutex) {
+    pthread_mutex_unlock((pthread_mutex_t *)mutex->internal);
+}
+
+u8 econdvar_create(econdvar *condvar) {
+    return pthread_cond_init((pthread_cond_t *)condvar->internal, 0) == 0;
+}
+
+u8 econdvar_destroy(econdvar *condvar) {
+    return pthread_cond_destroy((pthread_cond_t *)condvar->internal) == 0;
+}
+
+void econdvar_wait(econdvar *condvar, emutex *mutex) {
+    pthread_cond_wait((pthread_cond_t *)condvar->internal, (pthread_mutex_t *)mutex->internal);
+}
+
+void econdvar_signal(econdvar *condvar) {
+    pthread_cond_signal((pthread_cond_t *)condvar->internal);
+}
+
+void econdvar_broadcast(econdvar *condvar) {
+    pthread_cond_broadcast((pthread_cond_t *)condvar->internal);
+}
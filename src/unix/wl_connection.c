@@ -0,0 +1,207 @@
+// memfd_create
+#define _GNU_SOURCE
+
+#define ELOG_MODULE WINDOW
+
+#include "../wl_connection.h"
+#include "../assert.h"
+#include "../logger.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// the same pages twice in a row: in[i] and in[i + EWL_IN_SIZE] are one byte
+static u8 *map_ring() {
+    i32 fd = memfd_create("egg-wayland-in", MFD_CLOEXEC);
+    if(fd == -1) {
+        return 0;
+    }
+    u8 *ring = 0;
+    if(ftruncate(fd, EWL_IN_SIZE) == 0) {
+        // reserves the range, then maps the halves over it
+        ring = mmap(0, 2 * EWL_IN_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(ring == MAP_FAILED) {
+            ring = 0;
+        } else if(mmap(ring, EWL_IN_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+                || mmap(ring + EWL_IN_SIZE, EWL_IN_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(ring, 2 * EWL_IN_SIZE);
+            ring = 0;
+        }
+    }
+    close(fd);
+    return ring;
+}
+
+u8 ewl_connection_init(i32 fd, ewl_connection *connection) {
+    EASSERT(connection != 0);
+    *connection = (ewl_connection){0};
+    connection->fd = fd;
+    connection->in = map_ring();
+    if(!connection->in) {
+        EERROR("couldn't map the Wayland receive buffer");
+        connection->failed = true;
+        return false;
+    }
+    return true;
+}
+
+void ewl_connection_destroy(ewl_connection *connection) {
+    i32 fd;
+    while(ewl_connection_take_fd(connection, &fd)) {
+        close(fd);
+    }
+    if(connection->in) {
+        munmap(connection->in, 2 * EWL_IN_SIZE);
+        connection->in = 0;
+    }
+}
+
+static void queue_fds(ewl_connection *connection, struct msghdr *msghdr) {
+    for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(msghdr); cmsg; cmsg = CMSG_NXTHDR(msghdr, cmsg)) {
+        if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        u32 count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(i32);
+        for(u32 i = 0; i < count; ++i) {
+            i32 fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(i32), sizeof(i32));
+            if(connection->in_fd_tail - connection->in_fd_head == EWL_IN_MAX_FDS) {
+                EERROR("too many fds received from Wayland, closing %d", fd);
+                close(fd);
+                continue;
+            }
+            connection->in_fds[connection->in_fd_tail++ % EWL_IN_MAX_FDS] = fd;
+        }
+    }
+}
+
+i64 ewl_connection_read(ewl_connection *connection) {
+    u32 used = connection->in_tail - connection->in_head;
+    if(connection->failed || used == EWL_IN_SIZE) {
+        return connection->failed ? -1 : 0;
+    }
+    // contiguous thanks to the mirror
+    struct iovec iov = { .iov_base = connection->in + connection->in_tail % EWL_IN_SIZE, .iov_len = EWL_IN_SIZE - used };
+    char cmsg_buf[CMSG_SPACE(EWL_MAX_FDS * sizeof(i32))];
+    struct msghdr msghdr = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = cmsg_buf, .msg_controllen = sizeof(cmsg_buf) };
+
+    i64 read_bytes;
+    do {
+        read_bytes = recvmsg(connection->fd, &msghdr, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+        ++connection->reads;
+    } while(read_bytes == -1 && errno == EINTR);
+    if(read_bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    if(read_bytes <= 0) {
+        EERROR("failed to read window messages. Is the display system still alive?");
+        connection->failed = true;
+        return -1;
+    }
+    queue_fds(connection, &msghdr);
+    connection->in_tail += read_bytes;
+    connection->bytes_in += read_bytes;
+    return read_bytes;
+}
+
+u8 ewl_connection_next(ewl_connection *connection, ewl_message *message) {
+    u32 used = connection->in_tail - connection->in_head;
+    if(used < EWL_HEADER_SIZE) {
+        return false;
+    }
+    u8 *data = connection->in + connection->in_head % EWL_IN_SIZE;
+    u32 words[2];
+    memcpy(words, data, sizeof(words));
+    u16 size = words[1] >> 16;
+    if(size < EWL_HEADER_SIZE || size % 4) {
+        EERROR("malformed Wayland event: object_id=%u opcode=%u size=%u", words[0], words[1] & 0xFFFF, size);
+        connection->failed = true;
+        return false;
+    }
+    if(used < size) {
+        // the rest comes with a later read
+        return false;
+    }
+    message->object_id = words[0];
+    message->opcode = words[1] & 0xFFFF;
+    message->size = size;
+    message->args = data + EWL_HEADER_SIZE;
+    connection->in_head += size;
+    return true;
+}
+
+u8 ewl_connection_take_fd(ewl_connection *connection, i32 *fd) {
+    if(connection->in_fd_head == connection->in_fd_tail) {
+        return false;
+    }
+    *fd = connection->in_fds[connection->in_fd_head++ % EWL_IN_MAX_FDS];
+    return true;
+}
+
+u8 ewl_connection_flush(ewl_connection *connection, u8 block) {
+    while(connection->out_used && !connection->failed) {
+        struct iovec iov = { .iov_base = connection->out, .iov_len = connection->out_used };
+        char cmsg_buf[CMSG_SPACE(sizeof(connection->out_fds))];
+        struct msghdr msghdr = { .msg_iov = &iov, .msg_iovlen = 1 };
+        if(connection->out_fd_count) {
+            u64 fds_size = connection->out_fd_count * sizeof(i32);
+            msghdr.msg_control = cmsg_buf;
+            msghdr.msg_controllen = CMSG_SPACE(fds_size);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(fds_size);
+            memcpy(CMSG_DATA(cmsg), connection->out_fds, fds_size);
+        }
+
+        i64 sent = sendmsg(connection->fd, &msghdr, MSG_DONTWAIT | MSG_NOSIGNAL);
+        ++connection->sends;
+        if(sent == -1 && errno == EINTR) {
+            continue;
+        }
+        if(sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if(!block) {
+                return true;
+            }
+            struct pollfd pfd = { .fd = connection->fd, .events = POLLOUT };
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        if(sent == -1) {
+            EERROR("failed to send Wayland requests. Is the display system still alive?");
+            connection->failed = true;
+            return false;
+        }
+
+        // the fds went with the first byte
+        connection->out_fd_count = 0;
+        connection->bytes_out += sent;
+        memmove(connection->out, connection->out + sent, connection->out_used - sent);
+        connection->out_used -= sent;
+    }
+    return !connection->failed;
+}
+
+u8 ewl_connection_queue(ewl_connection *connection, const u8 *msg, u16 size, i32 fd) {
+    EASSERT(size <= EWL_OUT_SIZE);
+    if(connection->out_used + size > EWL_OUT_SIZE || (fd != -1 && connection->out_fd_count == EWL_MAX_FDS)) {
+        if(!ewl_connection_flush(connection, true)) {
+            return false;
+        }
+    }
+    if(connection->failed) {
+        return false;
+    }
+    memcpy(connection->out + connection->out_used, msg, size);
+    connection->out_used += size;
+    if(fd != -1) {
+        connection->out_fds[connection->out_fd_count++] = fd;
+    }
+    ++connection->requests;
+    return true;
+}
@@ -1,11 +1,21 @@
 // @ref: https://gaultier.github.io/blog/wayland_from_scratch.html#wayland-basics
 
+#define ELOG_MODULE WINDOW
+
 #include "../window.h"
+#include "../swapchain.h"
 #include "../logger.h"
+#include "../log_binary.h"
 #include "../assert.h"
+#include "../clock.h"
+#include "../event_loop.h"
+#include "../wl_connection.h"
+#include "../wl_objects.h"
 #include "../darray.h"
 #include "../memory.h"
+#include "../profiler.h"
 
+#include <errno.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,53 +31,32 @@
 
 static const u32 wayland_display_object_id = 1;
 static const u16 wayland_wl_display_get_registry_opcode = 1;
-static const u16 wayland_wl_registry_event_global = 0;
 static const u16 wayland_wl_registry_bind_opcode = 0;
 static const u16 wayland_wl_shm_create_pool_opcode = 0;
-static const u16 wayland_shm_pool_event_format = 0;
-static const u16 wayland_wl_display_error_event = 0;
 static const u16 wayland_wl_compositor_create_surface_opcode = 0; 
 static const u16 wayland_xdg_wm_base_get_xdg_surface_opcode = 2;
 static const u16 wayland_xdg_surface_get_toplevel_opcode = 1;
 static const u16 wayland_wl_surface_commit_opcode = 6;
 static const u16 wayland_wl_surface_attach_opcode = 1;
-static const u16 wayland_xdg_wm_base_event_ping = 0;
+static const u16 wayland_wl_surface_damage_opcode = 2;
+static const u16 wayland_wl_surface_frame_opcode = 3;
+static const u16 wayland_wl_surface_damage_buffer_opcode = 9;
+// wl_surface.damage_buffer
+static const u32 wayland_wl_compositor_damage_buffer_version = 4;
 static const u16 wayland_xdg_wm_base_pong_opcode = 3;
-static const u16 wayland_xdg_toplevel_event_configure = 0;
-static const u16 wayland_xdg_toplevel_event_wm_capabilities = 3;
-static const u16 wayland_xdg_surface_event_configure = 0;
 static const u16 wayland_xdg_surface_ack_configure_opcode = 4;
 static const u16 wayland_wl_shm_pool_create_buffer_opcode = 0;
-static const u16 wayland_wl_surface_event_preferred_buffer_scale = 2;
-static const u16 wayland_wl_surface_event_preferred_buffer_transform = 3;
-static const u16 wayland_wl_buffer_event_release = 0;
-static const u16 wayland_xdg_toplevel_event_close = 1;
-static const u16 wayland_wl_output_event_geometry = 0;
-static const u16 wayland_wl_output_event_mode = 1;
-static const u16 wayland_wl_output_event_done = 2;
-static const u16 wayland_wl_output_event_scale = 3;
-static const u16 wayland_wl_output_event_name = 4;
-static const u16 wayland_wl_output_event_description = 5;
-static const u16 wayland_wl_surface_event_enter = 0;
 static const u16 wayland_wl_buffer_destroy_opcode = 0;
 static const u16 wayland_wl_shm_pool_destroy_opcode = 1;
-static const u16 wayland_wl_display_event_delete_id = 1;
 static const u16 wayland_xdg_toplevel_destroy_opcode = 0;
 static const u16 wayland_xdg_surface_destroy_opcode = 0;
 static const u16 wayland_wl_surface_destroy_opcode = 0;
 static const u16 wayland_wl_seat_get_keyboard_opcode = 1;
-static const u16 wayland_wl_seat_event_name = 1;
-static const u16 wayland_wl_seat_event_capabilities = 0;
-static const u16 wayland_wl_keyboard_event_keymap = 0;
-static const u16 wayland_wl_keyboard_event_enter = 1;
-static const u16 wayland_wl_keyboard_event_leave = 2;
-static const u16 wayland_wl_keyboard_event_key = 3;
-static const u16 wayland_wl_keyboard_event_modifiers = 4;
-static const u16 wayland_wl_keyboard_event_repeat_info = 5;
 static const u32 wayland_format_xrgb8888 = 1;
 static const u16 wayland_header_size = 8;
 static const u32 color_channels = 4;
 
+
 typedef enum display_state_t {
     DISPLAY_STATE_NONE,
     DISPLAY_STATE_INIT,
@@ -80,10 +69,8 @@ typedef enum window_state_t {
     WINDOW_STATE_SHOULD_CLOSE,
 } window_state_t;
 
+// memory of a destroyed pool, freed on its delete_id
 typedef struct memchunk {
-    // when delete_id event is received with this object id, the memory will be freed
-    u32 wl_object; 
-    u32 wl_buffers[2];
     i32 fd;
     void *data;
     u32 size;
@@ -100,7 +87,20 @@ typedef struct window_backend_state {
     u32 xdg_surface;
     u32 xdg_toplevel;
     u32 wl_shm_pool;
+    // acquired from the swapchain and drawn into, 0 when none
     u32 wl_buffer;
+    i32 acquired;
+    // buffers in the pool, created on demand with ESWAP_ALLOCATE
+    eswapchain swapchain;
+    u32 buffer_count;
+    eswap_policy swap_policy;
+
+    // frame callback requested with the last commit, 0 once done
+    u32 wl_callback;
+    u64 presented_ns;
+    // no done for EWINDOW_HIDDEN_FRAME_NS, drawing on the timer
+    u8 hidden;
+    u64 hidden_frames;
 
     u32 shm_pool_size;
     u8 *shm_pool_data;
@@ -118,21 +118,27 @@ typedef struct window_backend_state {
 
 typedef struct display_backend_state {
     i32 fd;
-    u32 current_id;
+    // every object the client created, by id
+    ewl_objects objects;
+    // connection lost or protocol error, nothing is read anymore
+    u8 failed;
+
+    // requests and events go through it
+    ewl_connection connection;
+    // the socket was full, flushed again when it is writable
+    u8 write_watched;
 
     u32 wl_registry;
     u32 wl_shm;
     u32 xdg_wm_base;
     u32 wl_compositor;
+    u32 wl_compositor_version;
     u32 wl_output;
     u32 wl_seat;
     u32 wl_keyboard;
 
     da_windows windows;
 
-    // old memory chunks to be freed on delete_id events
-    memchunk old_memchunks[255];
-
     display_state_t state;
 } display_backend_state;
 
@@ -141,26 +147,49 @@ static display_backend_state display_state;
 
 // RPCs
 
-static u8 wayland_wl_registry_bind(u32 name, char *interface, u32 interface_len, u32 version, u32 *state_interface);
+static u8 wayland_wl_registry_bind(u32 name, char *interface, u32 interface_len, u32 version, const ewl_interface *object_interface, u32 *state_interface);
 static u8 wayland_wl_seat_get_keyboard();
 static u8 wayland_wl_shm_create_pool(window_backend_state *backend_state);
-static u8 wayland_wl_shm_pool_create_buffer(window_backend_state *backend_state);
+static u8 wayland_wl_shm_pool_create_buffer(window_backend_state *backend_state, u32 offset, u32 *wl_buffer);
 static u8 wayland_wl_compositor_create_surface(window_backend_state *backend_state);
 static u8 wayland_xdg_wm_base_get_xdg_surface(window_backend_state *backend_state);
 static u8 wayland_xdg_surface_get_toplevel(window_backend_state *backend_state);
 static u8 wayland_wl_surface_commit(window_backend_state *backend_state);
 static u8 wayland_wl_surface_attach(window_backend_state *backend_state);
+static u8 wayland_wl_surface_damage(window_backend_state *backend_state, const ewindow_rect *rect);
+static u8 wayland_wl_surface_frame(window_backend_state *backend_state);
 static u8 wayland_xdg_wm_base_pong(u32 ping);
 static u8 wayland_xdg_surface_ack_configure(window_backend_state *backend_state, u32 serial);
-static u8 wayland_wl_buffer_destroy(window_backend_state *backend_state);
+static u8 wayland_wl_buffer_destroy(u32 wl_buffer);
 static u8 wayland_wl_shm_pool_destroy(window_backend_state *backend_state);
 static u8 wayland_xdg_toplevel_destroy(window_backend_state *backend_state);
 static u8 wayland_xdg_surface_destroy(window_backend_state *backend_state);
 static u8 wayland_wl_surface_destroy(window_backend_state *backend_state);
 
+// events of each interface, defined with their handlers
+
+static const ewl_interface wl_display_interface;
+static const ewl_interface wl_registry_interface;
+static const ewl_interface wl_shm_interface;
+static const ewl_interface wl_shm_pool_interface;
+static const ewl_interface wl_compositor_interface;
+static const ewl_interface xdg_wm_base_interface;
+static const ewl_interface wl_output_interface;
+static const ewl_interface wl_seat_interface;
+static const ewl_interface wl_keyboard_interface;
+static const ewl_interface wl_buffer_interface;
+static const ewl_interface wl_callback_interface;
+static const ewl_interface wl_surface_interface;
+static const ewl_interface xdg_surface_interface;
+static const ewl_interface xdg_toplevel_interface;
+
 //
 
-static u8 ewindow_pump(ewindow *window, u32 object_id, u16 opcode, u8 **msg, u64 *msg_len);
+static void display_events(void *user, i32 fd, u32 events);
+static u8 wayland_send(const u8 *msg, u16 size);
+static u8 wayland_send_fd(const u8 *msg, u16 size, i32 fd);
+static u8 wayland_flush(u8 block);
+static u32 wayland_new_id(const ewl_interface *interface, void *owner);
 static ewindow *get_window(u64 window_id);
 static u8 window_create_surface(window_backend_state *backend_state);
 static u8 window_destroy_surface(window_backend_state *backend_state);
@@ -168,6 +197,8 @@ static u8 window_alloc_memory(u32 size, void **shm_pool_data, i32 *shm_fd);
 static u8 window_unalloc_memory(u32 size, void *shm_pool_data, i32 shm_fd);
 static u8 window_unbind_memory(window_backend_state *backend_state);
 static u8 window_render(window_backend_state *backend_state);
+static void window_alloc_buffers(window_backend_state *backend_state);
+static u8 window_acquire_buffer(window_backend_state *backend_state);
 
 static void write_u32(u8 *buf, u64 *buf_idx, u32 val);
 static void write_u16(u8 *buf, u64 *buf_idx, u16 val);
@@ -225,7 +256,21 @@ u8 display_backend_init(struct display_backend_state *state) {
     }
 
     state->fd = fd;
-    state->current_id = wayland_display_object_id;
+    if(!ewl_connection_init(fd, &state->connection)) {
+        // TODO: close socket on error
+        return false;
+    }
+
+    // read from the engine event loop, drained without blocking
+    eevent_loop *loop = eevent_loop_main();
+    if(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1 || !loop || !eevent_add(loop, fd, EEVENT_READ, display_events, 0)) {
+        // TODO: close socket on error
+        EERROR("unable to watch the Wayland socket");
+        return false;
+    }
+    ewl_objects_init(&state->objects);
+    u32 display_id = wayland_new_id(&wl_display_interface, 0);
+    EASSERT(display_id == wayland_display_object_id);
 
     // create the registry
 
@@ -239,21 +284,24 @@ u8 display_backend_init(struct display_backend_state *state) {
     u16 final_msg_size = wayland_header_size + sizeof(u32);
     write_u16(msg, &msg_idx, final_msg_size);
 
-    write_u32(msg, &msg_idx, ++state->current_id);
+    u32 registry_id = wayland_new_id(&wl_registry_interface, 0);
+    write_u32(msg, &msg_idx, registry_id);
 
-    if(msg_idx != send(state->fd, msg, final_msg_size, MSG_DONTWAIT)) {
+    if(!wayland_send(msg, final_msg_size)) {
         // TODO: close socket on error
         EERROR("failed to create Wayland registry");
         return false;
     }
 
-    state->wl_registry = state->current_id;
+    state->wl_registry = registry_id;
 
-    EDEBUG("created display backend: -> wl_display@%u.get_registry: wl_registry=%u", wayland_display_object_id, state->current_id);
+    ETRACE("created display backend: -> wl_display@%u.get_registry: wl_registry=%u", wayland_display_object_id, registry_id);
 
     // pump until all interfaces are bound
     while(state->wl_shm == 0 || state->xdg_wm_base == 0 || state->wl_compositor == 0) {
-        ewindow_pump_all();
+        if(!ewindow_pump_all(EEVENT_WAIT_FOREVER)) {
+            return false;
+        }
     }
 
     darray_reserve(&display_state.windows, 2);
@@ -282,10 +330,15 @@ u8 ewindow_create(ewindow_config *config, u64 *window_id) {
     backend_state->width = window->width;
     backend_state->height = window->height;
 
-    backend_state->shm_pool_size = window->height * window->height * color_channels;
+    backend_state->buffer_count = config->buffer_count ? config->buffer_count : ESWAPCHAIN_DEFAULT_BUFFERS;
+    if(backend_state->buffer_count > ESWAPCHAIN_MAX_BUFFERS) {
+        backend_state->buffer_count = ESWAPCHAIN_MAX_BUFFERS;
+    }
+    backend_state->swap_policy = config->swap_policy;
+    backend_state->acquired = -1;
 
     // first initial allocation
-    window_alloc_memory(backend_state->shm_pool_size, (void *)&backend_state->shm_pool_data, &backend_state->shm_fd);
+    window_alloc_buffers(backend_state);
 
     window_create_surface(backend_state); 
 
@@ -302,6 +355,9 @@ u8 ewindow_destroy(u64 window_id) {
 
     window_backend_state *backend_state = window->backend_state;
 
+    if(backend_state->hidden_frames) {
+        EDEBUG("%llu frames drawn on the timer while hidden", backend_state->hidden_frames);
+    }
     window_unbind_memory(backend_state);
     window_destroy_surface(backend_state);
 
@@ -314,469 +370,539 @@ u8 ewindow_destroy(u64 window_id) {
         }
     }
 
+    // nothing is pumped anymore when the engine stops
+    wayland_flush(true);
+
     EDEBUG("destroyed window");
 
     return true;
 }
 
-u8 ewindow_pump_all() {
-    u8 read_buf[4096] = "";
-    u8 cmsg_buf[4096] = "";
-    struct iovec iov = { .iov_base = read_buf, .iov_len = sizeof(read_buf) };
-    struct msghdr msghdr = {
-        .msg_iov = &iov,
-        .msg_iovlen = 1,
-        .msg_control = cmsg_buf,
-        .msg_controllen = sizeof(cmsg_buf),
-    };
-
-    // use recvmsg as some events contain ancillary data
-    i64 read_bytes = recvmsg(display_state.fd, &msghdr, 0);
-    // i64 read_bytes = recv(display_state.fd, read_buf, sizeof(read_buf), 0);
-
-    if(read_bytes == -1) {
-        EERROR("failed to read window messages. Is the display system still alive?");
-        return false;
+// reads until the socket would block, the loop only reports new data
+static void display_events(void *user, i32 fd, u32 events) {
+    if(events & EEVENT_WRITE) {
+        wayland_flush(false);
+    }
+    if(!(events & (EEVENT_READ | EEVENT_CLOSED))) {
+        return;
     }
 
-    u8 *msg = read_buf;
-    u64 msg_len = read_bytes;
-
-    EDEBUG("received data: %u bytes", msg_len);
-
-    while(msg_len > 0) {
-        EASSERT(msg_len >= 8); 
-        u32 object_id = *(u32 *)msg;
-        msg += sizeof(u32); msg_len -= sizeof(u32);
-        EASSERT_MSG(object_id <= display_state.current_id, "Received object_id = %u when current_id = %u", object_id, display_state.current_id);
-        u16 opcode = *(u16 *)msg;
-        msg += sizeof(u16); msg_len -= sizeof(u16);
-        u16 size = *(u16 *)msg;
-        msg += sizeof(u16); msg_len -= sizeof(u16);
-
-        // global events -- treated by display_state
-
-        if(object_id == display_state.wl_registry && opcode == wayland_wl_registry_event_global) {
-            u32 name = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 interface_len = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 padded_interface_len = roundup4(interface_len);
-            char interface[512] = "";
-            EASSERT(padded_interface_len <= sizeof(interface) - 1);
-            memcpy(interface, msg, padded_interface_len);
-            msg += padded_interface_len; msg_len -= padded_interface_len;
-            EASSERT(interface[interface_len - 1] == 0);
-            u32 version = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-
-            EDEBUG("<- wl_registry@%u.global: name=%u interface=%.*s version=%u", display_state.wl_registry, name, interface_len, interface, version);
-
-            EASSERT(size == sizeof(object_id) + sizeof(opcode) + sizeof(size) + sizeof(name) + sizeof(interface_len) + padded_interface_len + sizeof(version));
-
-            char wl_shm_interface[] = "wl_shm";
-            if(strcmp(wl_shm_interface, interface) == 0) {
-                wayland_wl_registry_bind(name, interface, interface_len, version, &display_state.wl_shm);
-            }
-
-            char xdg_wm_base_interface[] = "xdg_wm_base";
-            if(strcmp(xdg_wm_base_interface, interface) == 0) {
-                wayland_wl_registry_bind(name, interface, interface_len, version, &display_state.xdg_wm_base);
-            }
-
-            char wl_compositor_interface[] = "wl_compositor";
-            if(strcmp(wl_compositor_interface, interface) == 0) {
-                wayland_wl_registry_bind(name, interface, interface_len, version, &display_state.wl_compositor);
-            }
-
-            char wl_output_interface[] = "wl_output";
-            if(strcmp(wl_output_interface, interface) == 0) {
-                wayland_wl_registry_bind(name, interface, interface_len, version, &display_state.wl_output);
-            }
+    ewl_connection *connection = &display_state.connection;
+    while(!display_state.failed) {
+        i64 read_bytes = ewl_connection_read(connection);
+        if(read_bytes == -1) {
+            display_state.failed = true;
+            return;
+        }
+        ETRACE("received data: %lld bytes", read_bytes);
 
-            char wl_seat_interface[] = "wl_seat";
-            if(strcmp(wl_seat_interface, interface) == 0) {
-                wayland_wl_registry_bind(name, interface, interface_len, version, &display_state.wl_seat);
-                wayland_wl_seat_get_keyboard();
+        // complete events only, a partial one stays in the ring for the next read
+        ewl_message message;
+        while(!display_state.failed && ewl_connection_next(connection, &message)) {
+            if(!ewl_objects_dispatch(&display_state.objects, &message)) {
+                display_state.failed = true;
             }
-
-            continue;
         }
-
-        if(object_id == display_state.wl_seat && opcode == wayland_wl_seat_event_name) {
-            u32 size = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 padded_size = roundup4(size);
-            char name[255] = "";
-            memcpy(name, msg, padded_size);
-            msg += padded_size; msg_len -= padded_size;
-            EDEBUG("<- wl_seat@%u.name: name=%.*s", display_state.wl_seat, size, name);
-            continue;
+        if(connection->failed) {
+            display_state.failed = true;
         }
-
-        if(object_id == display_state.wl_seat && opcode == wayland_wl_seat_event_capabilities) {
-            u32 capabilities = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_seat@%u.capabilities: capabilities=%u", display_state.wl_seat, capabilities);
-            continue;
+        if(read_bytes == 0) {
+            return;
         }
+    }
+}
 
-        if(object_id == display_state.wl_keyboard && opcode == wayland_wl_keyboard_event_keymap) {
-            u32 format = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 size = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            
-            // retrieve fd as ancillary data
-            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
-            EASSERT(cmsg->cmsg_level == SOL_SOCKET);
-            EASSERT(cmsg->cmsg_type == SCM_RIGHTS);
-            i32 fd = *(i32 *)CMSG_DATA(cmsg);
-
-            EDEBUG("<- wl_keyboard@%u.keymap: format=%u fd=%u size=%u", display_state.wl_keyboard, format, fd, size);
-            continue;
-        }
+// events, msg points into the connection ring, fds are taken from its queue
+
+static u8 wl_display_error(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 target_object_id = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 code = *(u32 *)msg;
+    msg += sizeof(u32);
+    char error[512] = "";
+    u32 error_len = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 padded_error_len = roundup4(error_len);
+    EASSERT(padded_error_len <= sizeof(error));
+    memcpy(error, msg, padded_error_len);
+
+    EFATAL("error from Wayland: target_object_id=%u code=%u error=%s", target_object_id, code, error);
+    EASSERT(false);
+    return false;
+}
 
-        if(object_id == display_state.wl_keyboard && opcode == wayland_wl_keyboard_event_repeat_info) {
-            u32 rate = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 delay = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_keyboard@%u.repeat_info: rate=%u delay=%u", display_state.wl_keyboard, rate, delay);
-            continue;
-        }
+static u8 wl_display_delete_id(void *owner, const ewl_message *message) {
+    u32 id = *(u32 *)message->args;
+    ETRACE("<- wl_display@%u.delete_id: id=%u", wayland_display_object_id, id);
+
+    // the compositor is done with a destroyed pool, its memory can be freed
+    ewl_object *object = ewl_objects_get(&display_state.objects, id);
+    if(object && object->interface == &wl_shm_pool_interface && object->owner) {
+        memchunk *chunk = object->owner;
+        window_unalloc_memory(chunk->size, chunk->data, chunk->fd);
+        efree(chunk);
+        EDEBUG("freed memory linked to wl_shm_pool@%u", id);
+    }
+    ewl_objects_remove(&display_state.objects, id);
+    return true;
+}
 
-        if(object_id == display_state.wl_keyboard && opcode == wayland_wl_keyboard_event_enter) {
-            u32 serial = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 surface = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 len = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            char buf[256] = "";
-            EASSERT(len <= sizeof(buf));
-            memcpy(buf, msg, len);
-            msg += len; msg_len -= len;
-            EDEBUG("<- wl_keyboard@%u.enter: serial=%u surface=%u keys[%u]", display_state.wl_keyboard, serial, surface, len);
-            continue;
-        }
+static u8 wl_registry_global(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 name = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 interface_len = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 padded_interface_len = roundup4(interface_len);
+    char interface[512] = "";
+    EASSERT(padded_interface_len <= sizeof(interface) - 1);
+    memcpy(interface, msg, padded_interface_len);
+    msg += padded_interface_len;
+    EASSERT(interface[interface_len - 1] == 0);
+    u32 version = *(u32 *)msg;
+    msg += sizeof(u32);
+
+    ETRACE("<- wl_registry@%u.global: name=%u interface=%.*s version=%u", display_state.wl_registry, name, interface_len, interface, version);
+
+    EASSERT(message->size == wayland_header_size + sizeof(name) + sizeof(interface_len) + padded_interface_len + sizeof(version));
+
+    if(strcmp(interface, wl_shm_interface.name) == 0) {
+        wayland_wl_registry_bind(name, interface, interface_len, version, &wl_shm_interface, &display_state.wl_shm);
+    }
 
-        if(object_id == display_state.wl_keyboard && opcode == wayland_wl_keyboard_event_modifiers) {
-            u32 serial = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 mods_depressed = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 mods_latched = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 mods_locked = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 group = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_keyboard@%u.modifiers: serial=%u depressed=%u latched=%u locked=%u group=%u", display_state.wl_keyboard, serial, mods_depressed, mods_latched, mods_locked, group);
-            continue;
-        }
+    if(strcmp(interface, xdg_wm_base_interface.name) == 0) {
+        wayland_wl_registry_bind(name, interface, interface_len, version, &xdg_wm_base_interface, &display_state.xdg_wm_base);
+    }
 
-        if(object_id == display_state.wl_keyboard && opcode == wayland_wl_keyboard_event_leave) {
-            u32 serial = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 surface = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_keyboard@%u.leave: serial=%u surface=%u", display_state.wl_keyboard, serial, surface);
-            continue;
-        }
+    if(strcmp(interface, wl_compositor_interface.name) == 0) {
+        wayland_wl_registry_bind(name, interface, interface_len, version, &wl_compositor_interface, &display_state.wl_compositor);
+        display_state.wl_compositor_version = version;
+    }
 
-        if(object_id == display_state.wl_keyboard && opcode == wayland_wl_keyboard_event_key) {
-            u32 serial = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 time = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 key = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 state = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-
-            // TODO: tmp
-            if(state == 1 && key == 23) {
-                ewindow_config config = { .x = 0, .y = 0, .width = 600, .height = 400 };
-                u64 id;
-                ewindow_create(&config, &id);
-            }
+    if(strcmp(interface, wl_output_interface.name) == 0) {
+        wayland_wl_registry_bind(name, interface, interface_len, version, &wl_output_interface, &display_state.wl_output);
+    }
 
-            EDEBUG("<- wl_keyboard@%u.key: serial=%u time=%u key=%u state=%u", display_state.wl_keyboard, serial, time, key, state);
-            continue;
-        }
+    if(strcmp(interface, wl_seat_interface.name) == 0) {
+        wayland_wl_registry_bind(name, interface, interface_len, version, &wl_seat_interface, &display_state.wl_seat);
+        wayland_wl_seat_get_keyboard();
+    }
 
-        if(object_id == display_state.wl_shm && opcode == wayland_shm_pool_event_format) {
-            u32 format = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_shm: format=%#x", format);
-            continue;
-        }
+    return true;
+}
 
-        if(object_id == display_state.xdg_wm_base && opcode == wayland_xdg_wm_base_event_ping) {
-            u32 ping = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- xdg_wm_base@%u.ping: ping=%u", ping);
-            wayland_xdg_wm_base_pong(ping);
-            continue;
-        }
+static u8 wl_seat_name(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 size = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 padded_size = roundup4(size);
+    char name[255] = "";
+    EASSERT(padded_size <= sizeof(name));
+    memcpy(name, msg, padded_size);
+    ETRACE("<- wl_seat@%u.name: name=%.*s", display_state.wl_seat, size, name);
+    return true;
+}
 
-        if(object_id == display_state.wl_output && opcode == wayland_wl_output_event_name) {
-            u32 size = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 padded_size = roundup4(size);
-            char name[255] = "";
-            memcpy(name, msg, padded_size);
-            msg += padded_size; msg_len -= padded_size;
-            EDEBUG("<- wl_output@%u.name: name=%.*s", display_state.wl_output, size, name);
-            continue;
-        }
+static u8 wl_seat_capabilities(void *owner, const ewl_message *message) {
+    u32 capabilities = *(u32 *)message->args;
+    ETRACE("<- wl_seat@%u.capabilities: capabilities=%u", display_state.wl_seat, capabilities);
+    return true;
+}
 
-        if(object_id == display_state.wl_output && opcode == wayland_wl_output_event_description) {
-            u32 size = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 padded_size = roundup4(size);
-            char description[255] = "";
-            memcpy(description, msg, padded_size);
-            msg += padded_size; msg_len -= padded_size;
-            EDEBUG("<- wl_output@%u.description: description=%.*s", display_state.wl_output, size, description);
-            continue;
-        }
+static u8 wl_keyboard_keymap(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 format = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 size = *(u32 *)msg;
+    msg += sizeof(u32);
+
+    // received with the event, the keymap isn't used yet
+    i32 fd = -1;
+    if(!ewl_connection_take_fd(&display_state.connection, &fd)) {
+        EERROR("wl_keyboard.keymap came without its fd");
+        return false;
+    }
+    close(fd);
 
-        if(object_id == display_state.wl_output && opcode == wayland_wl_output_event_scale) {
-            u32 scale = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_output@%u.scale: scale=%u", display_state.wl_output, scale);
-            continue;
-        }
+    ETRACE("<- wl_keyboard@%u.keymap: format=%u fd=%d size=%u", display_state.wl_keyboard, format, fd, size);
+    return true;
+}
 
-        if(object_id == display_state.wl_output && opcode == wayland_wl_output_event_geometry) {
-            u32 x = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 y = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 physical_width = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 physical_height = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 subpixel = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 make_size = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 make_padded_size = roundup4(make_size);
-            char make[255] = "";
-            memcpy(make, msg, make_padded_size);
-            msg += make_padded_size; msg_len -= make_padded_size;
-            u32 model_size = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 model_padded_size = roundup4(model_size);
-            char model[255] = "";
-            memcpy(model, msg, model_padded_size);
-            msg += model_padded_size; msg_len -= model_padded_size;
-            u32 transform = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_output@%u.geometry: x=%u y=%u physical_width=%u physical_height=%u subpixel=%u make=%.*s model=%.*s transform=%u", display_state.wl_output, x, y, physical_width, physical_height, subpixel, make_size, make, model_size, model, transform);
-            continue;
-        }
+static u8 wl_keyboard_repeat_info(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 rate = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 delay = *(u32 *)msg;
+    msg += sizeof(u32);
+    ETRACE("<- wl_keyboard@%u.repeat_info: rate=%u delay=%u", display_state.wl_keyboard, rate, delay);
+    return true;
+}
 
-        if(object_id == display_state.wl_output && opcode == wayland_wl_output_event_done) {
-            EDEBUG("<- wl_output@%u.done", display_state.wl_output);
-            continue;
-        }
+static u8 wl_keyboard_enter(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 serial = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 surface = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 len = *(u32 *)msg;
+    msg += sizeof(u32);
+    ETRACE("<- wl_keyboard@%u.enter: serial=%u surface=%u keys[%u]", display_state.wl_keyboard, serial, surface, len);
+    return true;
+}
 
-        if(object_id == display_state.wl_output && opcode == wayland_wl_output_event_mode) {
-            u32 flags = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 width = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 height = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 refresh = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            EDEBUG("<- wl_output@%u.mode: flags=0x%x w=%u h=%u refresh=%u", display_state.wl_output, flags, width, height, refresh);
-            continue;
-        }
+static u8 wl_keyboard_modifiers(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 serial = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 mods_depressed = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 mods_latched = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 mods_locked = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 group = *(u32 *)msg;
+    msg += sizeof(u32);
+    ETRACE("<- wl_keyboard@%u.modifiers: serial=%u depressed=%u latched=%u locked=%u group=%u", display_state.wl_keyboard, serial, mods_depressed, mods_latched, mods_locked, group);
+    return true;
+}
 
-        if(object_id == wayland_display_object_id && opcode == wayland_wl_display_event_delete_id) {
-            u32 id = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-
-            // check if the object is a pool
-            u32 i = 0;
-            u32 len = sizeof(display_state.old_memchunks) / sizeof(memchunk);
-            while(i < len && display_state.old_memchunks[i].wl_object != id) ++i;
-            if(i < len) {
-                // free the memory associated with the deleted pool
-                memchunk *chunk = &display_state.old_memchunks[i];
-                window_unalloc_memory(chunk->size, chunk->data, chunk->fd);
-                chunk->wl_object = 0;
-                chunk->wl_buffers[0] = 0; // TODO: account for double buffering
-                chunk->fd = 0;
-                chunk->data = 0;
-                chunk->size = 0;
-                EDEBUG("freed memory linked to wl_shm_pool@%u", id);
-            }
+static u8 wl_keyboard_leave(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 serial = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 surface = *(u32 *)msg;
+    msg += sizeof(u32);
+    ETRACE("<- wl_keyboard@%u.leave: serial=%u surface=%u", display_state.wl_keyboard, serial, surface);
+    return true;
+}
 
-            EDEBUG("<- wl_display@%u.delete_id: id=%u", wayland_display_object_id, id);
-            continue;
-        }
+static u8 wl_keyboard_key(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 serial = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 time = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 key = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 state = *(u32 *)msg;
+    msg += sizeof(u32);
 
-        if(object_id == wayland_display_object_id && opcode == wayland_wl_display_error_event) {
-            u32 target_object_id = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 code = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            char error[512] = "";
-            u32 error_len = *(u32 *)msg;
-            msg += sizeof(u32); msg_len -= sizeof(u32);
-            u32 padded_error_len = roundup4(error_len);
-            memcpy(error, msg, padded_error_len);
-            msg += padded_error_len; msg_len -= padded_error_len;
-
-            EFATAL("error from Wayland: target_object_id=%u code=%u error=%s", target_object_id, code, error);
-            EASSERT(false);
-            return false;
-        }
+    // TODO: tmp
+    if(state == 1 && key == 23) {
+        ewindow_config config = { .x = 0, .y = 0, .width = 600, .height = 400 };
+        u64 id;
+        ewindow_create(&config, &id);
+    }
 
-        // check if event comes from an old buffer
-        if(opcode == wayland_wl_buffer_event_release) {
-            u32 i = 0;
-            u32 len = sizeof(display_state.old_memchunks) / sizeof(memchunk);
-            while(i < len && display_state.old_memchunks[i].wl_buffers[0] != object_id) ++i;
-            if(i < len) {
-                EDEBUG("<- wl_buffer@%u.release", display_state.old_memchunks[i].wl_buffers[0]);
-                continue;
-            }
-        }
+    ETRACE("<- wl_keyboard@%u.key: serial=%u time=%u key=%u state=%u", display_state.wl_keyboard, serial, time, key, state);
+    return true;
+}
 
-        // dispatch event to each window backend
+static u8 wl_shm_format(void *owner, const ewl_message *message) {
+    u32 format = *(u32 *)message->args;
+    ETRACE("<- wl_shm: format=%#x", format);
+    return true;
+}
 
-        u8 consumed = false;
-        darray_foreach(ewindow, window, &display_state.windows) {
-            // we will feed the event to one window, then pass
-            // it to the next ones if it has not been consumed 
-            if(ewindow_pump(window, object_id, opcode, &msg, &msg_len)) {
-                consumed = true;
-                break;
-            }
-        }
-        if(consumed) {
-            continue;
-        }
+static u8 xdg_wm_base_ping(void *owner, const ewl_message *message) {
+    u32 ping = *(u32 *)message->args;
+    ETRACE("<- xdg_wm_base@%u.ping: ping=%u", display_state.xdg_wm_base, ping);
+    wayland_xdg_wm_base_pong(ping);
+    return true;
+}
 
-        // event not consumed by any window
+static u8 wl_output_name(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 size = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 padded_size = roundup4(size);
+    char name[255] = "";
+    EASSERT(padded_size <= sizeof(name));
+    memcpy(name, msg, padded_size);
+    ETRACE("<- wl_output@%u.name: name=%.*s", display_state.wl_output, size, name);
+    return true;
+}
 
-        EFATAL("unimplemented Wayland event: object_id=%u opcode=%u", object_id, opcode);
-        EASSERT(false);
-        return false;
-    }
+static u8 wl_output_description(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 size = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 padded_size = roundup4(size);
+    char description[255] = "";
+    EASSERT(padded_size <= sizeof(description));
+    memcpy(description, msg, padded_size);
+    ETRACE("<- wl_output@%u.description: description=%.*s", display_state.wl_output, size, description);
+    return true;
+}
 
-    // TODO: tmp
-    darray_foreach(ewindow, window, &display_state.windows) {
-        window_render(window->backend_state);
-    }
+static u8 wl_output_scale(void *owner, const ewl_message *message) {
+    u32 scale = *(u32 *)message->args;
+    ETRACE("<- wl_output@%u.scale: scale=%u", display_state.wl_output, scale);
+    return true;
+}
 
+static u8 wl_output_geometry(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 x = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 y = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 physical_width = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 physical_height = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 subpixel = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 make_size = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 make_padded_size = roundup4(make_size);
+    char make[255] = "";
+    EASSERT(make_padded_size <= sizeof(make));
+    memcpy(make, msg, make_padded_size);
+    msg += make_padded_size;
+    u32 model_size = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 model_padded_size = roundup4(model_size);
+    char model[255] = "";
+    EASSERT(model_padded_size <= sizeof(model));
+    memcpy(model, msg, model_padded_size);
+    msg += model_padded_size;
+    u32 transform = *(u32 *)msg;
+    msg += sizeof(u32);
+    ETRACE("<- wl_output@%u.geometry: x=%u y=%u physical_width=%u physical_height=%u subpixel=%u make=%.*s model=%.*s transform=%u", display_state.wl_output, x, y, physical_width, physical_height, subpixel, make_size, make, model_size, model, transform);
     return true;
 }
 
-static u8 ewindow_pump(ewindow *window, u32 object_id, u16 opcode, u8 **msg, u64 *msg_len) {
-    EASSERT(window != 0);
+static u8 wl_output_done(void *owner, const ewl_message *message) {
+    ETRACE("<- wl_output@%u.done", display_state.wl_output);
+    return true;
+}
 
-    window_backend_state *backend_state;
-    backend_state = window->backend_state;
+static u8 wl_output_mode(void *owner, const ewl_message *message) {
+    u8 *msg = message->args;
+    u32 flags = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 width = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 height = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 refresh = *(u32 *)msg;
+    msg += sizeof(u32);
+    ETRACE("<- wl_output@%u.mode: flags=0x%x w=%u h=%u refresh=%u", display_state.wl_output, flags, width, height, refresh);
+    return true;
+}
 
-    if(object_id == backend_state->wl_buffer && opcode == wayland_wl_buffer_event_release) {
-        EDEBUG("<- wl_buffer@%u.release", backend_state->wl_buffer);
-        return true;
+// window objects, owner is the window backend state
+
+static u8 wl_buffer_release(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    ETRACE("<- wl_buffer@%u.release", message->object_id);
+    if(!eswapchain_release(&backend_state->swapchain, message->object_id)) {
+        EWARN("wl_buffer@%u released but not in the swapchain", message->object_id);
     }
+    return true;
+}
 
-    if(window && object_id == backend_state->xdg_toplevel && opcode == wayland_xdg_toplevel_event_wm_capabilities) {
-        u32 len = *(u32 *)(*msg);
-        *msg += sizeof(u32); *msg_len -= sizeof(u32);
-        char buf[256] = "";
-        EASSERT(len <= sizeof(buf));
-        memcpy(buf, *msg, len);
-        *msg += len; *msg_len -= len;
-        EDEBUG("<- xdg_toplevel@%u.wm_capabilities: capabilities[%u]", backend_state->xdg_toplevel, len);
-        return true;
+static u8 wl_callback_done(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    u32 time = *(u32 *)message->args;
+    ETRACE("<- wl_callback@%u.done: time=%u", backend_state->wl_callback, time);
+    // the server destroys the callback, its delete_id follows
+    backend_state->wl_callback = 0;
+    if(backend_state->hidden) {
+        EDEBUG("window visible again, drawing on frame callbacks");
+        backend_state->hidden = false;
     }
+    return true;
+}
 
-    if(window && object_id == backend_state->xdg_surface && opcode == wayland_xdg_surface_event_configure) {
-        u32 serial = *(u32 *)(*msg);
-        *msg += sizeof(u32); *msg_len -= sizeof(u32);
+static u8 xdg_toplevel_wm_capabilities(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    u32 len = *(u32 *)message->args;
+    ETRACE("<- xdg_toplevel@%u.wm_capabilities: capabilities[%u]", backend_state->xdg_toplevel, len);
+    return true;
+}
 
-        EDEBUG("<- xdg_surface@%u.configure: serial=%u", backend_state->xdg_surface, serial);
+static u8 xdg_surface_configure(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    u32 serial = *(u32 *)message->args;
 
-        if((backend_state->width_req != 0 && backend_state->height_req != 0) 
-                && (backend_state->width_req != backend_state->width || backend_state->height_req != backend_state->height)) {
-            window_unbind_memory(backend_state);
+    ETRACE("<- xdg_surface@%u.configure: serial=%u", backend_state->xdg_surface, serial);
 
-            // update infos and allocate new memory
-            backend_state->width = backend_state->width_req;
-            backend_state->height = backend_state->height_req;
-            backend_state->shm_pool_size = backend_state->width * backend_state->height * color_channels;
-            window_alloc_memory(backend_state->shm_pool_size, (void *)&backend_state->shm_pool_data, &backend_state->shm_fd);
-        }
+    u8 resized = (backend_state->width_req != 0 && backend_state->height_req != 0)
+            && (backend_state->width_req != backend_state->width || backend_state->height_req != backend_state->height);
+    if(resized) {
+        window_unbind_memory(backend_state);
 
-        wayland_xdg_surface_ack_configure(backend_state, serial);
+        // update infos and allocate new memory
+        backend_state->width = backend_state->width_req;
+        backend_state->height = backend_state->height_req;
+        window_alloc_buffers(backend_state);
+    }
 
-        // pool and buffers will be recreated next iteration
-        backend_state->state = WINDOW_STATE_SURFACE_ACKED_CONFIGURE;
+    wayland_xdg_surface_ack_configure(backend_state, serial);
 
-        return true;
+    // pool and buffers will be recreated next iteration, other configures
+    // (focus, states) only need the ack
+    if(resized || backend_state->state == WINDOW_STATE_NONE) {
+        backend_state->state = WINDOW_STATE_SURFACE_ACKED_CONFIGURE;
     }
 
-    if(object_id == backend_state->xdg_toplevel && opcode == wayland_xdg_toplevel_event_configure) {
-        u32 w = *(u32 *)(*msg);
-        *msg += sizeof(u32); *msg_len -= sizeof(u32);
-        u32 h = *(u32 *)(*msg);
-        *msg += sizeof(u32); *msg_len -= sizeof(u32);
-        u32 len = *(u32 *)(*msg);
-        *msg += sizeof(u32); *msg_len -= sizeof(u32);
-        char buf[256] = "";
-        EASSERT(len <= sizeof(buf));
-        memcpy(buf, *msg, len);
-        *msg += len; *msg_len -= len;
-
-        if((w != 0 && h != 0) && (w != backend_state->width || h != backend_state->height)) {
-            // change dimensions, will reallocate memory when acking the configure event
-            backend_state->width_req = w;
-            backend_state->height_req = h;
-        }
+    return true;
+}
 
-        EDEBUG("<- xdg_toplevel@%u.configure: w=%u h=%u states[%u]", backend_state->xdg_toplevel, w, h, len);
-        return true;
+static u8 xdg_toplevel_configure(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    u8 *msg = message->args;
+    u32 w = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 h = *(u32 *)msg;
+    msg += sizeof(u32);
+    u32 len = *(u32 *)msg;
+    msg += sizeof(u32);
+
+    if((w != 0 && h != 0) && (w != backend_state->width || h != backend_state->height)) {
+        // change dimensions, will reallocate memory when acking the configure event
+        backend_state->width_req = w;
+        backend_state->height_req = h;
     }
 
-    if(object_id == backend_state->wl_surface && opcode == wayland_wl_surface_event_preferred_buffer_scale) {
-        i32 factor = *(i32 *)(*msg);
-        *msg += sizeof(i32); *msg_len -= sizeof(i32);
-        EDEBUG("<- wl_surface@%u.preferred_buffer_scale: factor=%u", backend_state->wl_surface, factor);
-        return true;
-    }
+    ETRACE("<- xdg_toplevel@%u.configure: w=%u h=%u states[%u]", backend_state->xdg_toplevel, w, h, len);
+    return true;
+}
 
-    if(object_id == backend_state->wl_surface && opcode == wayland_wl_surface_event_preferred_buffer_transform) {
-        u32 transform = *(u32 *)(*msg);
-        *msg += sizeof(u32); *msg_len -= sizeof(u32);
-        EDEBUG("<- wl_surface@%u.preferred_buffer_transform: transform=%u", backend_state->wl_surface, transform);
-        return true;
-    }
+static u8 wl_surface_preferred_buffer_scale(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    i32 factor = *(i32 *)message->args;
+    ETRACE("<- wl_surface@%u.preferred_buffer_scale: factor=%u", backend_state->wl_surface, factor);
+    return true;
+}
 
-    if(object_id == backend_state->xdg_toplevel && opcode == wayland_xdg_toplevel_event_close) {
-        EDEBUG("<- xdg_toplevel@%u.close", backend_state->xdg_toplevel);
-        backend_state->state = WINDOW_STATE_SHOULD_CLOSE;
-        return true;
+static u8 wl_surface_preferred_buffer_transform(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    u32 transform = *(u32 *)message->args;
+    ETRACE("<- wl_surface@%u.preferred_buffer_transform: transform=%u", backend_state->wl_surface, transform);
+    return true;
+}
+
+static u8 xdg_toplevel_close(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    ETRACE("<- xdg_toplevel@%u.close", backend_state->xdg_toplevel);
+    backend_state->state = WINDOW_STATE_SHOULD_CLOSE;
+    return true;
+}
+
+static u8 wl_surface_enter(void *owner, const ewl_message *message) {
+    window_backend_state *backend_state = owner;
+    u32 output = *(u32 *)message->args;
+    ETRACE("<- wl_surface@%u.enter: output=%u", backend_state->wl_surface, output);
+    return true;
+}
+
+// interfaces, events indexed by opcode
+
+#define interface_events(handlers) handlers, sizeof(handlers) / sizeof(ewl_event_handler)
+
+static const ewl_event_handler wl_display_events[] = {
+    wl_display_error,
+    wl_display_delete_id,
+};
+static const ewl_interface wl_display_interface = { "wl_display", interface_events(wl_display_events) };
+
+static const ewl_event_handler wl_registry_events[] = {
+    wl_registry_global,
+    // global_remove
+    0,
+};
+static const ewl_interface wl_registry_interface = { "wl_registry", interface_events(wl_registry_events) };
+
+static const ewl_event_handler wl_shm_events[] = {
+    wl_shm_format,
+};
+static const ewl_interface wl_shm_interface = { "wl_shm", interface_events(wl_shm_events) };
+
+static const ewl_interface wl_shm_pool_interface = { "wl_shm_pool", 0, 0 };
+static const ewl_interface wl_compositor_interface = { "wl_compositor", 0, 0 };
+
+static const ewl_event_handler xdg_wm_base_events[] = {
+    xdg_wm_base_ping,
+};
+static const ewl_interface xdg_wm_base_interface = { "xdg_wm_base", interface_events(xdg_wm_base_events) };
+
+static const ewl_event_handler wl_output_events[] = {
+    wl_output_geometry,
+    wl_output_mode,
+    wl_output_done,
+    wl_output_scale,
+    wl_output_name,
+    wl_output_description,
+};
+static const ewl_interface wl_output_interface = { "wl_output", interface_events(wl_output_events) };
+
+static const ewl_event_handler wl_seat_events[] = {
+    wl_seat_capabilities,
+    wl_seat_name,
+};
+static const ewl_interface wl_seat_interface = { "wl_seat", interface_events(wl_seat_events) };
+
+static const ewl_event_handler wl_keyboard_events[] = {
+    wl_keyboard_keymap,
+    wl_keyboard_enter,
+    wl_keyboard_leave,
+    wl_keyboard_key,
+    wl_keyboard_modifiers,
+    wl_keyboard_repeat_info,
+};
+static const ewl_interface wl_keyboard_interface = { "wl_keyboard", interface_events(wl_keyboard_events) };
+
+static const ewl_event_handler wl_buffer_events[] = {
+    wl_buffer_release,
+};
+static const ewl_interface wl_buffer_interface = { "wl_buffer", interface_events(wl_buffer_events) };
+
+static const ewl_event_handler wl_callback_events[] = {
+    wl_callback_done,
+};
+static const ewl_interface wl_callback_interface = { "wl_callback", interface_events(wl_callback_events) };
+
+static const ewl_event_handler wl_surface_events[] = {
+    wl_surface_enter,
+    // leave
+    0,
+    wl_surface_preferred_buffer_scale,
+    wl_surface_preferred_buffer_transform,
+};
+static const ewl_interface wl_surface_interface = { "wl_surface", interface_events(wl_surface_events) };
+
+static const ewl_event_handler xdg_surface_events[] = {
+    xdg_surface_configure,
+};
+static const ewl_interface xdg_surface_interface = { "xdg_surface", interface_events(xdg_surface_events) };
+
+static const ewl_event_handler xdg_toplevel_events[] = {
+    xdg_toplevel_configure,
+    xdg_toplevel_close,
+    // configure_bounds
+    0,
+    xdg_toplevel_wm_capabilities,
+};
+static const ewl_interface xdg_toplevel_interface = { "xdg_toplevel", interface_events(xdg_toplevel_events) };
+
+u8 ewindow_pump_all(u64 timeout_ns) {
+    EPROFILE_SCOPE("ewindow_pump_all");
+    eevent_loop *loop = eevent_loop_main();
+    // the compositor can't answer requests it didn't get
+    if(display_state.failed || !loop || !wayland_flush(false) || eevent_loop_run(loop, timeout_ns) == -1 || display_state.failed) {
+        return false;
     }
 
-    if(object_id == backend_state->wl_surface && opcode == wayland_wl_surface_event_enter) {
-        u32 output = *(u32 *)(*msg);
-        *msg += sizeof(u32); *msg_len -= sizeof(u32);
-        EDEBUG("<- wl_surface@%u.enter: output=%u", backend_state->wl_surface, output);
-        return true;
+    // TODO: tmp
+    darray_foreach(ewindow, window, &display_state.windows) {
+        window_render(window->backend_state);
     }
 
-    // message not consumed 
-    return false;
+    return true;
 }
 
 static ewindow *get_window(u64 window_id) {
@@ -799,24 +925,36 @@ static u8 window_render(window_backend_state *backend_state) {
             wayland_wl_shm_create_pool(backend_state);
             // TODO: return to pump errrors, but recv blocks for now
         }
-        if(backend_state->wl_buffer == 0) {
-            wayland_wl_shm_pool_create_buffer(backend_state);
+        eswapchain *swapchain = &backend_state->swapchain;
+        while(swapchain->count < backend_state->buffer_count) {
+            u32 wl_buffer, index;
+            wayland_wl_shm_pool_create_buffer(backend_state, eswapchain_offset(swapchain, swapchain->count), &wl_buffer);
             // TODO: return to pump errrors, but recv blocks for now
+            eswapchain_add(swapchain, wl_buffer, &index);
         }
 
         EASSERT(backend_state->shm_pool_data != 0);
         EASSERT(backend_state->shm_pool_size != 0);
 
-        u32 *pixels = (u32 *)backend_state->shm_pool_data;
-        for(u32 i = 0; i < backend_state->width * backend_state->height; ++i) {
-            u8 r = 0xFF;
-            u8 g = 0xFF;
-            u8 b = 0x00;
-            pixels[i] = (r << 16) | (g << 8) | b;
+        // black until the renderer draws the first frame, without waiting:
+        // with every buffer busy the renderer's first frame maps the window
+        u32 index;
+        if(backend_state->acquired < 0 && swapchain->free_count && eswapchain_acquire(swapchain, &index) == ESWAPCHAIN_ACQUIRED) {
+            backend_state->acquired = index;
+            backend_state->wl_buffer = swapchain->buffers[index].handle;
+        }
+        if(backend_state->acquired >= 0) {
+            memset(backend_state->shm_pool_data + eswapchain_offset(swapchain, backend_state->acquired), 0, swapchain->buffer_size);
+
+            ewindow_rect whole = { .x = 0, .y = 0, .width = backend_state->width, .height = backend_state->height };
+            wayland_wl_surface_attach(backend_state);
+            wayland_wl_surface_damage(backend_state, &whole);
+            wayland_wl_surface_commit(backend_state);
+            // the renderer doesn't know these pixels, it redraws the buffer whole
+            eswapchain_submit_blank(swapchain, backend_state->acquired);
+            backend_state->acquired = -1;
+            backend_state->wl_buffer = 0;
         }
-
-        wayland_wl_surface_attach(backend_state);
-        wayland_wl_surface_commit(backend_state);
 
         backend_state->state = WINDOW_STATE_SURFACE_ATTACHED;
     }
@@ -824,6 +962,135 @@ static u8 window_render(window_backend_state *backend_state) {
     return true;
 }
 
+u8 ewindow_framebuffer(u64 window_id, u32 **pixels, u32 *width, u32 *height, u32 *stride, u32 *age) {
+    ewindow *window = get_window(window_id);
+    EASSERT(window != NULL);
+
+    window_backend_state *backend_state = window->backend_state;
+    // the buffers are created, and one attached, in window_render
+    if(backend_state->state != WINDOW_STATE_SURFACE_ATTACHED) {
+        return false;
+    }
+    if(backend_state->acquired < 0 && !window_acquire_buffer(backend_state)) {
+        return false;
+    }
+
+    *pixels = (u32 *)(backend_state->shm_pool_data + eswapchain_offset(&backend_state->swapchain, backend_state->acquired));
+    *width = backend_state->width;
+    *height = backend_state->height;
+    *stride = backend_state->width;
+    *age = eswapchain_age(&backend_state->swapchain, backend_state->acquired);
+    return true;
+}
+
+u8 ewindow_present(u64 window_id, const ewindow_rect *damage, u32 count) {
+    ewindow *window = get_window(window_id);
+    EASSERT(window != NULL);
+
+    window_backend_state *backend_state = window->backend_state;
+    if(backend_state->state != WINDOW_STATE_SURFACE_ATTACHED || backend_state->acquired < 0) {
+        return false;
+    }
+
+    ewindow_rect whole = { .x = 0, .y = 0, .width = backend_state->width, .height = backend_state->height };
+    if(!damage) {
+        damage = &whole;
+        count = 1;
+    }
+    // committed even when nothing changed, the buffer ages count commits
+    u8 sent = wayland_wl_surface_attach(backend_state);
+    for(u32 i = 0; i < count && sent; ++i) {
+        sent = wayland_wl_surface_damage(backend_state, &damage[i]);
+    }
+    // drawn on the timer, the callback requested before is still pending
+    if(sent && !backend_state->wl_callback) {
+        sent = wayland_wl_surface_frame(backend_state);
+    }
+    sent = sent && wayland_wl_surface_commit(backend_state);
+    // the frame's requests in one write
+    sent = wayland_flush(false) && sent;
+    backend_state->presented_ns = eclock_now_ns();
+    // released when the compositor is done reading it
+    eswapchain_submit(&backend_state->swapchain, backend_state->acquired);
+    backend_state->acquired = -1;
+    backend_state->wl_buffer = 0;
+    return sent;
+}
+
+void ewindow_get_io_stats(ewindow_io_stats *stats) {
+    *stats = (ewindow_io_stats){0};
+    stats->requests = display_state.connection.requests;
+    stats->sends = display_state.connection.sends;
+    stats->bytes_out = display_state.connection.bytes_out;
+    stats->reads = display_state.connection.reads;
+    stats->bytes_in = display_state.connection.bytes_in;
+}
+
+u8 ewindow_ready(u64 window_id) {
+    ewindow *window = get_window(window_id);
+    EASSERT(window != NULL);
+
+    window_backend_state *backend_state = window->backend_state;
+    if(backend_state->state != WINDOW_STATE_SURFACE_ATTACHED) {
+        return false;
+    }
+    if(!backend_state->wl_callback) {
+        return true;
+    }
+    // compositors stop sending done to hidden windows
+    if(eclock_now_ns() - backend_state->presented_ns < EWINDOW_HIDDEN_FRAME_NS) {
+        return false;
+    }
+    if(!backend_state->hidden) {
+        EDEBUG("no frame callback for %llu ms, window hidden, drawing on a timer", EWINDOW_HIDDEN_FRAME_NS / 1000000);
+        backend_state->hidden = true;
+    }
+    ++backend_state->hidden_frames;
+    return true;
+}
+
+// a free buffer in wl_buffer and acquired, false when the frame is dropped
+static u8 window_acquire_buffer(window_backend_state *backend_state) {
+    eswapchain *swapchain = &backend_state->swapchain;
+    for(;;) {
+        u32 index;
+        switch(eswapchain_acquire(swapchain, &index)) {
+            case ESWAPCHAIN_ACQUIRED:
+                backend_state->acquired = index;
+                backend_state->wl_buffer = swapchain->buffers[index].handle;
+                return true;
+            case ESWAPCHAIN_ALLOCATE: {
+                u32 wl_buffer;
+                if(!wayland_wl_shm_pool_create_buffer(backend_state, eswapchain_offset(swapchain, swapchain->count), &wl_buffer)) {
+                    return false;
+                }
+                eswapchain_add(swapchain, wl_buffer, &index);
+                EDEBUG("all %u window buffers busy, allocated another one", swapchain->count - 1);
+            } break;
+            case ESWAPCHAIN_WAIT:
+                // a resize in there replaces the swapchain
+                if(!ewindow_pump_all(EEVENT_WAIT_FOREVER) || backend_state->state != WINDOW_STATE_SURFACE_ATTACHED) {
+                    return false;
+                }
+                break;
+            case ESWAPCHAIN_DROP:
+                return false;
+        }
+    }
+}
+
+// pool and swapchain for the current size, no buffer created yet
+static void window_alloc_buffers(window_backend_state *backend_state) {
+    u64 buffer_size = (u64)backend_state->width * backend_state->height * color_channels;
+    // room for every buffer the swapchain may allocate
+    u32 pool_buffers = backend_state->swap_policy == ESWAP_ALLOCATE ? ESWAPCHAIN_MAX_BUFFERS : backend_state->buffer_count;
+    backend_state->shm_pool_size = buffer_size * pool_buffers;
+    window_alloc_memory(backend_state->shm_pool_size, (void *)&backend_state->shm_pool_data, &backend_state->shm_fd);
+    eswapchain_init(buffer_size, backend_state->swap_policy, &backend_state->swapchain);
+    backend_state->acquired = -1;
+    backend_state->wl_buffer = 0;
+}
+
 u8 ewindow_should_close(u64 window_id) {
     ewindow *window = get_window(window_id);
     EASSERT(window != NULL);
@@ -876,22 +1143,26 @@ static u8 window_unbind_memory(window_backend_state *backend_state) {
         return true;
     }
 
-    // store old memory to free later
-    u32 i = 0;
-    while(display_state.old_memchunks[i].wl_object != 0) ++i;
-    EASSERT(i < sizeof(display_state.old_memchunks) / sizeof(memchunk));
-    memchunk *chunk = &display_state.old_memchunks[i];
-    chunk->wl_object = backend_state->wl_shm_pool;
-    chunk->wl_buffers[0] = backend_state->wl_buffer; // TODO: account for double buffering
+    // store old memory to free later, with the pool object
+    memchunk *chunk = ealloc(sizeof(memchunk));
+    EASSERT(chunk != 0);
     chunk->fd = backend_state->shm_fd;
     chunk->data = backend_state->shm_pool_data;
     chunk->size = backend_state->shm_pool_size;
+    ewl_objects_get(&display_state.objects, backend_state->wl_shm_pool)->owner = chunk;
+    eswapchain *swapchain = &backend_state->swapchain;
 
     // send delete pool and buffer(s) requests if exist
     // we will wait for delete_id event before freeing the actual memory
-    if(backend_state->wl_buffer > 0) {
-        wayland_wl_buffer_destroy(backend_state);
+    for(u32 i = 0; i < swapchain->count; ++i) {
+        wayland_wl_buffer_destroy(swapchain->buffers[i].handle);
+    }
+    if(swapchain->frames) {
+        EDEBUG("%u window buffers: %llu frames, %llu dropped, %llu waits for a release", swapchain->count, swapchain->frames, swapchain->dropped, swapchain->waits);
     }
+    swapchain->count = 0;
+    backend_state->acquired = -1;
+    backend_state->wl_buffer = 0;
     if(backend_state->wl_shm_pool > 0) {
         wayland_wl_shm_pool_destroy(backend_state);
     }
@@ -914,6 +1185,11 @@ static u8 window_create_surface(window_backend_state *backend_state) {
 }
 
 static u8 window_destroy_surface(window_backend_state *backend_state) {
+    // its done may still come, the window won't be there
+    if(backend_state->wl_callback != 0) {
+        ewl_objects_destroyed(&display_state.objects, backend_state->wl_callback);
+        backend_state->wl_callback = 0;
+    }
     if(backend_state->wl_surface != 0) {
         wayland_xdg_toplevel_destroy(backend_state);
         wayland_xdg_surface_destroy(backend_state);
@@ -925,7 +1201,40 @@ static u8 window_destroy_surface(window_backend_state *backend_state) {
     return false;
 }
 
-static u8 wayland_wl_registry_bind(u32 name, char *interface, u32 interface_len, u32 version, u32 *state_interface) {
+// block: waits for the socket to take everything, else the rest is sent when
+// the event loop reports it writable
+static u8 wayland_flush(u8 block) {
+    ewl_connection *connection = &display_state.connection;
+    if(!ewl_connection_flush(connection, block)) {
+        display_state.failed = true;
+        return false;
+    }
+    u8 pending = ewl_connection_pending(connection);
+    if(pending != display_state.write_watched) {
+        eevent_modify(eevent_loop_main(), display_state.fd, pending ? EEVENT_READ | EEVENT_WRITE : EEVENT_READ);
+        display_state.write_watched = pending;
+    }
+    return true;
+}
+
+static u8 wayland_send_fd(const u8 *msg, u16 size, i32 fd) {
+    if(!ewl_connection_queue(&display_state.connection, msg, size, fd)) {
+        display_state.failed = true;
+        return false;
+    }
+    return true;
+}
+
+static u8 wayland_send(const u8 *msg, u16 size) {
+    return wayland_send_fd(msg, size, -1);
+}
+
+// for a new_id argument, its events are dispatched to owner
+static u32 wayland_new_id(const ewl_interface *interface, void *owner) {
+    return ewl_objects_add(&display_state.objects, interface, owner);
+}
+
+static u8 wayland_wl_registry_bind(u32 name, char *interface, u32 interface_len, u32 version, const ewl_interface *object_interface, u32 *state_interface) {
     u8 msg[512] = "";
     u64 msg_idx = 0;
     u16 padded_interface_len = roundup4(interface_len);
@@ -934,7 +1243,7 @@ static u8 wayland_wl_registry_bind(u32 name, char *interface, u32 interface_len,
 
     write_u16(msg, &msg_idx, wayland_wl_registry_bind_opcode);
 
-    u16 final_msg_size = wayland_header_size + sizeof(name) + sizeof(interface_len) + padded_interface_len + sizeof(version) + sizeof(display_state.current_id);
+    u16 final_msg_size = wayland_header_size + sizeof(name) + sizeof(interface_len) + padded_interface_len + sizeof(version) + sizeof(u32);
     EASSERT(roundup4(final_msg_size) == final_msg_size);
 
     write_u16(msg, &msg_idx, final_msg_size);
@@ -948,17 +1257,18 @@ static u8 wayland_wl_registry_bind(u32 name, char *interface, u32 interface_len,
 
     write_u32(msg, &msg_idx, version);
 
-    write_u32(msg, &msg_idx, ++display_state.current_id);
+    u32 id = wayland_new_id(object_interface, 0);
+    write_u32(msg, &msg_idx, id);
     EASSERT(roundup4(msg_idx) == final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to bind Wayland interface: %s", interface);
         return false;
     }
 
-    *state_interface = display_state.current_id;
+    *state_interface = id;
 
-    EDEBUG("bound Wayland interface: -> wl_registry@%u.bind: name=%u interface=%.*s version=%u", display_state.wl_registry, name, interface_len, interface, version);
+    ETRACE("bound Wayland interface: -> wl_registry@%u.bind: name=%u interface=%.*s version=%u", display_state.wl_registry, name, interface_len, interface, version);
 
     return true;
 }
@@ -973,21 +1283,22 @@ static u8 wayland_wl_seat_get_keyboard() {
 
     write_u16(msg, &msg_idx, wayland_wl_seat_get_keyboard_opcode);
 
-    u16 final_msg_size = wayland_header_size + sizeof(display_state.current_id);
+    u16 final_msg_size = wayland_header_size + sizeof(u32);
     EASSERT(roundup4(final_msg_size) == final_msg_size);
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    write_u32(msg, &msg_idx, ++display_state.current_id);
+    u32 id = wayland_new_id(&wl_keyboard_interface, 0);
+    write_u32(msg, &msg_idx, id);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to get keyboard from Wayland");
         return false;
     }
 
-    display_state.wl_keyboard = display_state.current_id;
+    display_state.wl_keyboard = id;
 
-    EDEBUG("got keyboard: -> wl_seat@%u.get_keyboard: keyboard=%u", display_state.wl_seat, display_state.wl_keyboard);
+    ETRACE("got keyboard: -> wl_seat@%u.get_keyboard: keyboard=%u", display_state.wl_seat, display_state.wl_keyboard);
 
     return true;
 }
@@ -1002,48 +1313,32 @@ static u8 wayland_wl_shm_create_pool(window_backend_state *backend_state) {
 
     write_u16(msg, &msg_idx, wayland_wl_shm_create_pool_opcode);
 
-    u16 final_msg_size = wayland_header_size + sizeof(display_state.current_id) + sizeof(backend_state->shm_pool_size);
+    u16 final_msg_size = wayland_header_size + sizeof(u32) + sizeof(backend_state->shm_pool_size);
     EASSERT(roundup4(final_msg_size) == final_msg_size);
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    write_u32(msg, &msg_idx, ++display_state.current_id);
+    u32 id = wayland_new_id(&wl_shm_pool_interface, 0);
+    write_u32(msg, &msg_idx, id);
 
     write_u32(msg, &msg_idx, backend_state->shm_pool_size);
 
     EASSERT(msg_idx == final_msg_size);
 
-    char buf[CMSG_SPACE(sizeof(backend_state->shm_fd))];
-
-    struct iovec io = { .iov_base = msg, .iov_len = msg_idx };
-    struct msghdr socket_msg = {
-        .msg_iov = &io,
-        .msg_iovlen = 1,
-        .msg_control = buf,
-        .msg_controllen = sizeof(buf),
-    };
-
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&socket_msg);
-    cmsg->cmsg_level = SOL_SOCKET;
-    cmsg->cmsg_type = SCM_RIGHTS;
-    cmsg->cmsg_len = CMSG_LEN(sizeof(backend_state->shm_fd));
-
-    memcpy(CMSG_DATA(cmsg), &backend_state->shm_fd, sizeof(backend_state->shm_fd));
-    socket_msg.msg_controllen = cmsg->cmsg_len;
-
-    if(sendmsg(display_state.fd, &socket_msg, 0) == -1) {
+    // the fd goes with the message, the pool is backed by it
+    if(!wayland_send_fd(msg, final_msg_size, backend_state->shm_fd)) {
         EERROR("failed to share shm pool during window creation");
         return false;
     }
 
-    backend_state->wl_shm_pool = display_state.current_id;
+    backend_state->wl_shm_pool = id;
 
-    EDEBUG("created shm pool: -> wl_shm@%u.create_pool: wl_shm_pool=%u", display_state.wl_shm, display_state.current_id);
+    ETRACE("created shm pool: -> wl_shm@%u.create_pool: wl_shm_pool=%u", display_state.wl_shm, id);
 
     return true;
 }
 
-static u8 wayland_wl_shm_pool_create_buffer(window_backend_state *backend_state) {
+static u8 wayland_wl_shm_pool_create_buffer(window_backend_state *backend_state, u32 offset, u32 *wl_buffer) {
     EASSERT(backend_state->wl_shm_pool > 0);
 
     u8 msg[128] = "";
@@ -1053,14 +1348,14 @@ static u8 wayland_wl_shm_pool_create_buffer(window_backend_state *backend_state)
 
     write_u16(msg, &msg_idx, wayland_wl_shm_pool_create_buffer_opcode);
 
-    u16 final_msg_size = wayland_header_size + sizeof(display_state.current_id) + sizeof(u32) * 5;
+    u16 final_msg_size = wayland_header_size + sizeof(u32) + sizeof(u32) * 5;
     EASSERT(roundup4(final_msg_size) == final_msg_size);
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    write_u32(msg, &msg_idx, ++display_state.current_id);
+    u32 id = wayland_new_id(&wl_buffer_interface, backend_state);
+    write_u32(msg, &msg_idx, id);
 
-    u32 offset = 0;
     write_u32(msg, &msg_idx, offset);
 
     write_u32(msg, &msg_idx, backend_state->width);
@@ -1074,14 +1369,14 @@ static u8 wayland_wl_shm_pool_create_buffer(window_backend_state *backend_state)
 
     EASSERT(msg_idx == final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to create Wayland buffer");
         return false;
     }
 
-    backend_state->wl_buffer = display_state.current_id;
+    *wl_buffer = id;
 
-    EDEBUG("created Wayland buffer: -> wl_shm_pool@%u.create_buffer: wl_buffer=%u", backend_state->wl_shm_pool, backend_state->wl_buffer);
+    ETRACE("created Wayland buffer: -> wl_shm_pool@%u.create_buffer: wl_buffer=%u offset=%u", backend_state->wl_shm_pool, *wl_buffer, offset);
 
     return true;
 }
@@ -1096,21 +1391,22 @@ static u8 wayland_wl_compositor_create_surface(window_backend_state *backend_sta
 
     write_u16(msg, &msg_idx, wayland_wl_compositor_create_surface_opcode);
 
-    u16 final_msg_size = wayland_header_size + sizeof(display_state.current_id);
+    u16 final_msg_size = wayland_header_size + sizeof(u32);
     EASSERT(roundup4(final_msg_size) == final_msg_size);
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    write_u32(msg, &msg_idx, ++display_state.current_id);
+    u32 id = wayland_new_id(&wl_surface_interface, backend_state);
+    write_u32(msg, &msg_idx, id);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to create Wayland surface");
         return false;
     }
 
-    backend_state->wl_surface = display_state.current_id;
+    backend_state->wl_surface = id;
 
-    EDEBUG("created Wayland surface: -> wl_compositor@%u.create_surface: wl_surface=%u", display_state.wl_compositor, backend_state->wl_surface);
+    ETRACE("created Wayland surface: -> wl_compositor@%u.create_surface: wl_surface=%u", display_state.wl_compositor, backend_state->wl_surface);
 
     return true;
 }
@@ -1126,23 +1422,24 @@ static u8 wayland_xdg_wm_base_get_xdg_surface(window_backend_state *backend_stat
 
     write_u16(msg, &msg_idx, wayland_xdg_wm_base_get_xdg_surface_opcode);
 
-    u16 final_msg_size = wayland_header_size + sizeof(display_state.current_id) + sizeof(backend_state->wl_surface);
+    u16 final_msg_size = wayland_header_size + sizeof(u32) + sizeof(backend_state->wl_surface);
     EASSERT(roundup4(final_msg_size) == final_msg_size);
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    write_u32(msg, &msg_idx, ++display_state.current_id);
+    u32 id = wayland_new_id(&xdg_surface_interface, backend_state);
+    write_u32(msg, &msg_idx, id);
 
     write_u32(msg, &msg_idx, backend_state->wl_surface);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to get xdg surface from Wayland");
         return false;
     }
 
-    backend_state->xdg_surface = display_state.current_id;
+    backend_state->xdg_surface = id;
 
-    EDEBUG("got xdg surface: -> xdg_wm_base@%u.get_xdg_surface: xdg_surface=%u wl_surface=%u", display_state.xdg_wm_base, backend_state->xdg_surface, backend_state->wl_surface);
+    ETRACE("got xdg surface: -> xdg_wm_base@%u.get_xdg_surface: xdg_surface=%u wl_surface=%u", display_state.xdg_wm_base, backend_state->xdg_surface, backend_state->wl_surface);
 
     return true;
 }
@@ -1157,21 +1454,22 @@ static u8 wayland_xdg_surface_get_toplevel(window_backend_state *backend_state)
 
     write_u16(msg, &msg_idx, wayland_xdg_surface_get_toplevel_opcode);
 
-    u16 final_msg_size = wayland_header_size + sizeof(display_state.current_id);
+    u16 final_msg_size = wayland_header_size + sizeof(u32);
     EASSERT(roundup4(final_msg_size) == final_msg_size);
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    write_u32(msg, &msg_idx, ++display_state.current_id);
+    u32 id = wayland_new_id(&xdg_toplevel_interface, backend_state);
+    write_u32(msg, &msg_idx, id);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to get xdg toplevel from Wayland");
         return false;
     }
 
-    backend_state->xdg_toplevel = display_state.current_id;
+    backend_state->xdg_toplevel = id;
 
-    EDEBUG("got xdg toplevel: -> xdg_surface@%u.get_toplevel: xdg_toplevel=%u", backend_state->xdg_surface, backend_state->xdg_toplevel);
+    ETRACE("got xdg toplevel: -> xdg_surface@%u.get_toplevel: xdg_toplevel=%u", backend_state->xdg_surface, backend_state->xdg_toplevel);
 
     return true;
 }
@@ -1191,12 +1489,80 @@ static u8 wayland_wl_surface_commit(window_backend_state *backend_state) {
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to commit Wayland surface");
         return false;
     }
 
-    EDEBUG("committed Wayland surface: -> wl_surface@%u.commit", backend_state->wl_surface);
+    ETRACE("committed Wayland surface: -> wl_surface@%u.commit", backend_state->wl_surface);
+
+    return true;
+}
+
+// done is sent when it is a good time to draw the next frame, applied on commit
+static u8 wayland_wl_surface_frame(window_backend_state *backend_state) {
+    EASSERT(backend_state->wl_surface > 0);
+
+    u8 msg[128] = "";
+    u64 msg_idx = 0;
+
+    write_u32(msg, &msg_idx, backend_state->wl_surface);
+
+    write_u16(msg, &msg_idx, wayland_wl_surface_frame_opcode);
+
+    u16 final_msg_size = wayland_header_size + sizeof(u32);
+    EASSERT(roundup4(final_msg_size) == final_msg_size);
+
+    write_u16(msg, &msg_idx, final_msg_size);
+
+    u32 id = wayland_new_id(&wl_callback_interface, backend_state);
+    write_u32(msg, &msg_idx, id);
+
+    EASSERT(msg_idx == final_msg_size);
+
+    if(!wayland_send(msg, final_msg_size)) {
+        EERROR("failed to request a Wayland frame callback");
+        return false;
+    }
+
+    backend_state->wl_callback = id;
+
+    ETRACE("requested frame callback: -> wl_surface@%u.frame: wl_callback=%u", backend_state->wl_surface, backend_state->wl_callback);
+
+    return true;
+}
+
+// in buffer pixels, surface ones before wl_compositor version 4, the same
+// as the buffer scale is 1
+static u8 wayland_wl_surface_damage(window_backend_state *backend_state, const ewindow_rect *rect) {
+    EASSERT(backend_state->wl_surface > 0);
+
+    u8 msg[128] = "";
+    u64 msg_idx = 0;
+
+    write_u32(msg, &msg_idx, backend_state->wl_surface);
+
+    u8 damage_buffer = display_state.wl_compositor_version >= wayland_wl_compositor_damage_buffer_version;
+    write_u16(msg, &msg_idx, damage_buffer ? wayland_wl_surface_damage_buffer_opcode : wayland_wl_surface_damage_opcode);
+
+    u16 final_msg_size = wayland_header_size + sizeof(i32) * 4;
+    EASSERT(roundup4(final_msg_size) == final_msg_size);
+
+    write_u16(msg, &msg_idx, final_msg_size);
+
+    write_u32(msg, &msg_idx, rect->x);
+    write_u32(msg, &msg_idx, rect->y);
+    write_u32(msg, &msg_idx, rect->width);
+    write_u32(msg, &msg_idx, rect->height);
+
+    EASSERT(msg_idx == final_msg_size);
+
+    if(!wayland_send(msg, final_msg_size)) {
+        EERROR("failed to damage Wayland surface");
+        return false;
+    }
+
+    ETRACE("damaged Wayland surface: -> wl_surface@%u.%s: x=%d y=%d width=%d height=%d", backend_state->wl_surface, damage_buffer ? "damage_buffer" : "damage", rect->x, rect->y, rect->width, rect->height);
 
     return true;
 }
@@ -1225,13 +1591,12 @@ static u8 wayland_wl_surface_attach(window_backend_state *backend_state) {
 
     EASSERT(msg_idx == final_msg_size);
 
-    int res = send(display_state.fd, msg, final_msg_size, 0);
-    if(msg_idx != res) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to attach Wayland surface");
         return false;
     }
 
-    EDEBUG("attached Wayland surface: -> wl_surface@%u.attach: wl_buffer=%u", backend_state->wl_surface, backend_state->wl_buffer);
+    ETRACE("attached Wayland surface: -> wl_surface@%u.attach: wl_buffer=%u", backend_state->wl_surface, backend_state->wl_buffer);
 
     return true;
 }
@@ -1254,12 +1619,12 @@ static u8 wayland_xdg_wm_base_pong(u32 ping) {
 
     write_u32(msg, &msg_idx, ping);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to answer xdg_wm_base ping");
         return false;
     }
 
-    EDEBUG("pong xdg wm base: -> xdg_wm_base@%u.pong: ping=%u", display_state.xdg_wm_base, ping);
+    ETRACE("pong xdg wm base: -> xdg_wm_base@%u.pong: ping=%u", display_state.xdg_wm_base, ping);
 
     return true;
 }
@@ -1281,23 +1646,23 @@ static u8 wayland_xdg_surface_ack_configure(window_backend_state *backend_state,
 
     write_u32(msg, &msg_idx, serial);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to acknowledge xdg_surface configure");
         return false;
     }
 
-    EDEBUG("acked xdg_surface configure: -> xdg_surface@%u.ack_configure: serial=%u", backend_state->xdg_surface, serial);
+    ETRACE("acked xdg_surface configure: -> xdg_surface@%u.ack_configure: serial=%u", backend_state->xdg_surface, serial);
 
     return true;
 }
 
-static u8 wayland_wl_buffer_destroy(window_backend_state *backend_state) {
-    EASSERT(backend_state->wl_buffer > 0);
+static u8 wayland_wl_buffer_destroy(u32 wl_buffer) {
+    EASSERT(wl_buffer > 0);
 
     u8 msg[128] = "";
     u64 msg_idx = 0;
 
-    write_u32(msg, &msg_idx, backend_state->wl_buffer);
+    write_u32(msg, &msg_idx, wl_buffer);
 
     write_u16(msg, &msg_idx, wayland_wl_buffer_destroy_opcode);
 
@@ -1306,14 +1671,15 @@ static u8 wayland_wl_buffer_destroy(window_backend_state *backend_state) {
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to destroy wl_buffer");
         return false;
     }
 
-    EDEBUG("destroyed wl_buffer: -> wl_buffer@%u.destroy", backend_state->wl_buffer);
+    ETRACE("destroyed wl_buffer: -> wl_buffer@%u.destroy", wl_buffer);
 
-    backend_state->wl_buffer = 0;
+    // release events still on the way are dropped
+    ewl_objects_destroyed(&display_state.objects, wl_buffer);
 
     return true;
 }
@@ -1333,12 +1699,14 @@ static u8 wayland_wl_shm_pool_destroy(window_backend_state *backend_state) {
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to destroy wl_shm_pool");
         return false;
     }
 
-    EDEBUG("destroyed wl_shm_pool: -> wl_shm_pool@%u.destroy", backend_state->wl_shm_pool);
+    ETRACE("destroyed wl_shm_pool: -> wl_shm_pool@%u.destroy", backend_state->wl_shm_pool);
+
+    ewl_objects_destroyed(&display_state.objects, backend_state->wl_shm_pool);
 
     backend_state->wl_shm_pool = 0;
 
@@ -1360,12 +1728,14 @@ static u8 wayland_xdg_toplevel_destroy(window_backend_state *backend_state) {
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to destroy xdg_toplevel");
         return false;
     }
 
-    EDEBUG("destroyed xdg_toplevel: -> xdg_toplevel@%u.destroy", backend_state->xdg_toplevel);
+    ETRACE("destroyed xdg_toplevel: -> xdg_toplevel@%u.destroy", backend_state->xdg_toplevel);
+
+    ewl_objects_destroyed(&display_state.objects, backend_state->xdg_toplevel);
 
     backend_state->xdg_toplevel = 0;
 
@@ -1387,12 +1757,14 @@ static u8 wayland_xdg_surface_destroy(window_backend_state *backend_state) {
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to destroy xdg_surface");
         return false;
     }
 
-    EDEBUG("destroyed xdg_surface: -> xdg_surface@%u.destroy", backend_state->xdg_surface);
+    ETRACE("destroyed xdg_surface: -> xdg_surface@%u.destroy", backend_state->xdg_surface);
+
+    ewl_objects_destroyed(&display_state.objects, backend_state->xdg_surface);
 
     backend_state->xdg_surface = 0;
 
@@ -1414,12 +1786,14 @@ static u8 wayland_wl_surface_destroy(window_backend_state *backend_state) {
 
     write_u16(msg, &msg_idx, final_msg_size);
 
-    if(msg_idx != send(display_state.fd, msg, final_msg_size, 0)) {
+    if(!wayland_send(msg, final_msg_size)) {
         EERROR("failed to destroy wl_surface");
         return false;
     }
 
-    EDEBUG("destroyed wl_surface: -> wl_surface@%u.destroy", backend_state->wl_surface);
+    ETRACE("destroyed wl_surface: -> wl_surface@%u.destroy", backend_state->wl_surface);
+
+    ewl_objects_destroyed(&display_state.objects, backend_state->wl_surface);
 
     backend_state->wl_surface = 0;
 
@@ -1,3 +1,5 @@
+#define ELOG_MODULE WINDOW
+
 #include "../window.h"
 
 #include <string.h>
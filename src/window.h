@@ -2,9 +2,15 @@
 #define WINDOW_H
 
 #include "defines.h"
+#include "swapchain.h"
+#include "event_loop.h"
 
 struct display_backend_state;
 
+// frames are drawn at this interval while the compositor sends no frame
+// callbacks, e.g. when the window is hidden
+#define EWINDOW_HIDDEN_FRAME_NS (250ull * 1000000)
+
 typedef struct ewindow_config {
     i32 x;
     i32 y;
@@ -12,8 +18,31 @@ typedef struct ewindow_config {
     u32 height;
     const char *title;
     const char *icon;
+    // native backend: 0 for ESWAPCHAIN_DEFAULT_BUFFERS, at most ESWAPCHAIN_MAX_BUFFERS
+    u32 buffer_count;
+    // what to do when the compositor holds every buffer
+    eswap_policy swap_policy;
 } ewindow_config;
 
+// in buffer pixels
+typedef struct ewindow_rect {
+    i32 x;
+    i32 y;
+    i32 width;
+    i32 height;
+} ewindow_rect;
+
+// display connection traffic since it was opened
+typedef struct ewindow_io_stats {
+    u64 requests;
+    // sendmsg calls: one per frame while the socket keeps up
+    u64 sends;
+    // recvmsg calls, the last of a read returns nothing
+    u64 reads;
+    u64 bytes_out;
+    u64 bytes_in;
+} ewindow_io_stats;
+
 typedef struct ewindow {
     u64 id;
     const char* title;
@@ -27,7 +56,23 @@ EAPI u8 display_backend_init(struct display_backend_state *state);
 
 EAPI u8 ewindow_create(ewindow_config *config, u64 *window_id);
 EAPI u8 ewindow_should_close(u64 window_id);
-EAPI u8 ewindow_pump_all();
+// dispatches the display events, waiting up to timeout_ns for the first ones
+// (0 returns at once, EEVENT_WAIT_FOREVER), with the other sources of the
+// engine event loop
+EAPI u8 ewindow_pump_all(u64 timeout_ns);
 EAPI u8 ewindow_destroy(u64 window_id);
 
+EAPI void ewindow_get_io_stats(ewindow_io_stats *stats);
+
+// true when a frame drawn now would be shown: the compositor signaled the
+// previous one with a frame callback, or on the timer fallback
+EAPI u8 ewindow_ready(u64 window_id);
+// software rendering: the window's 0xXXRRGGBB pixels, stride in pixels
+// false until the compositor has configured the window
+// age: frames since these pixels were presented, 0 when their content is unknown
+EAPI u8 ewindow_framebuffer(u64 window_id, u32 **pixels, u32 *width, u32 *height, u32 *stride, u32 *age);
+// shows what was drawn into the framebuffer, damage is what changed since the
+// previous frame, NULL for the whole window
+EAPI u8 ewindow_present(u64 window_id, const ewindow_rect *damage, u32 count);
+
 #endif // WINDOW_H
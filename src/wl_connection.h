@@ -0,0 +1,85 @@
+#ifndef WL_CONNECTION_H
+#define WL_CONNECTION_H
+
+#include "defines.h"
+
+// Wayland socket buffering. Requests are appended to an output buffer and
+// written with one sendmsg when flushed (end of frame, buffer full, before
+// waiting for events), fds passed with SCM_RIGHTS go with that write.
+// Events are read into a ring buffer mapped twice in a row, so a message
+// is always contiguous and parsed where it was read, even across the end of
+// the ring. Bytes of a message split across reads wait there for the rest,
+// received fds wait in a queue for the event that carries them.
+
+// as libwayland: the socket buffer is usually larger, fds per sendmsg are limited
+#define EWL_OUT_SIZE 4096
+#define EWL_MAX_FDS 28
+// a page multiple, the largest message is 4096 bytes
+#define EWL_IN_SIZE (64 * 1024)
+#define EWL_IN_MAX_FDS 64
+#define EWL_HEADER_SIZE 8
+
+// an event, args point into the ring: valid until the next read
+typedef struct ewl_message {
+    u32 object_id;
+    u16 opcode;
+    // header included
+    u16 size;
+    u8 *args;
+} ewl_message;
+
+typedef struct ewl_connection {
+    // non-blocking socket
+    i32 fd;
+    // connection lost, nothing is sent anymore
+    u8 failed;
+
+    u8 out[EWL_OUT_SIZE];
+    u32 out_used;
+    // sent with the first bytes, the compositor queues them until the
+    // requests using them are read
+    i32 out_fds[EWL_MAX_FDS];
+    u32 out_fd_count;
+
+    u64 requests;
+    // sendmsg calls, with those that would have blocked
+    u64 sends;
+    u64 bytes_out;
+
+    // EWL_IN_SIZE bytes mapped twice, positions grow and wrap at 2^32
+    u8 *in;
+    u32 in_head;
+    u32 in_tail;
+    i32 in_fds[EWL_IN_MAX_FDS];
+    u32 in_fd_head;
+    u32 in_fd_tail;
+
+    // recvmsg calls, with those that would have blocked
+    u64 reads;
+    u64 bytes_in;
+} ewl_connection;
+
+EAPI u8 ewl_connection_init(i32 fd, ewl_connection *connection);
+// unmaps the ring and closes the fds no event took, not the socket
+EAPI void ewl_connection_destroy(ewl_connection *connection);
+// fd -1 for none, it must stay open until flushed. Flushes first, waiting
+// for the socket, when the buffer is full
+EAPI u8 ewl_connection_queue(ewl_connection *connection, const u8 *msg, u16 size, i32 fd);
+// block: waits until the socket took everything. Else what it can't take
+// now stays queued, ewl_connection_pending tells to watch it for writing
+EAPI u8 ewl_connection_flush(ewl_connection *connection, u8 block);
+
+static inline u8 ewl_connection_pending(const ewl_connection *connection) {
+    return connection->out_used != 0;
+}
+
+// one recvmsg into the free part of the ring: bytes read, 0 when it would
+// block or the ring is full, -1 when the connection is closed or broken
+EAPI i64 ewl_connection_read(ewl_connection *connection);
+// the next complete event, false when it isn't all read yet or on a
+// malformed header (failed is set)
+EAPI u8 ewl_connection_next(ewl_connection *connection, ewl_message *message);
+// the oldest received fd, for the event being handled
+EAPI u8 ewl_connection_take_fd(ewl_connection *connection, i32 *fd);
+
+#endif // WL_CONNECTION_H
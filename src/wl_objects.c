@@ -0,0 +1,70 @@
+#define ELOG_MODULE WINDOW
+
+#include "wl_objects.h"
+#include "assert.h"
+#include "darray.h"
+#include "logger.h"
+#include "memory.h"
+
+void ewl_objects_init(ewl_objects *objects) {
+    EASSERT(objects != 0);
+    *objects = (ewl_objects){0};
+    // the null object, never used
+    darray_append(objects, (ewl_object){0});
+}
+
+void ewl_objects_destroy(ewl_objects *objects) {
+    efree(objects->items);
+    *objects = (ewl_objects){0};
+}
+
+u32 ewl_objects_add(ewl_objects *objects, const ewl_interface *interface, void *owner) {
+    EASSERT(interface != 0);
+    ewl_object object = { .interface = interface, .owner = owner };
+    u32 id = objects->free_head;
+    if(id) {
+        objects->free_head = objects->items[id].next_free;
+        objects->items[id] = object;
+    } else {
+        id = objects->count;
+        darray_append(objects, object);
+    }
+    ++objects->live;
+    return id;
+}
+
+void ewl_objects_destroyed(ewl_objects *objects, u32 id) {
+    ewl_object *object = ewl_objects_get(objects, id);
+    EASSERT_MSG(object != 0, "destroying unknown Wayland object %u", id);
+    object->destroyed = true;
+}
+
+void ewl_objects_remove(ewl_objects *objects, u32 id) {
+    ewl_object *object = ewl_objects_get(objects, id);
+    if(!object) {
+        EWARN("delete_id for unknown Wayland object %u", id);
+        return;
+    }
+    *object = (ewl_object){ .next_free = objects->free_head };
+    objects->free_head = id;
+    --objects->live;
+}
+
+u8 ewl_objects_dispatch(ewl_objects *objects, const ewl_message *message) {
+    ewl_object *object = ewl_objects_get(objects, message->object_id);
+    if(!object) {
+        EERROR("Wayland event for unknown object %u, opcode=%u", message->object_id, message->opcode);
+        return false;
+    }
+    if(object->destroyed) {
+        ++objects->dropped;
+        return true;
+    }
+    const ewl_interface *interface = object->interface;
+    if(message->opcode >= interface->event_count || !interface->events[message->opcode]) {
+        EERROR("unimplemented Wayland event: %s@%u opcode=%u", interface->name, message->object_id, message->opcode);
+        return false;
+    }
+    ++objects->dispatched;
+    return interface->events[message->opcode](object->owner, message);
+}
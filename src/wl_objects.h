@@ -0,0 +1,66 @@
+#ifndef WL_OBJECTS_H
+#define WL_OBJECTS_H
+
+#include "defines.h"
+#include "wl_connection.h"
+
+// Wayland client objects indexed by id. Each entry has the interface of the
+// object, whose events are handlers indexed by opcode, and its owner, passed
+// to them: an event is dispatched with two array lookups. Ids are handed out
+// for new_id arguments and used again once the compositor sends delete_id,
+// so the table stays as small as the number of live objects.
+// Between the destroy request and delete_id the object is destroyed: the
+// events the compositor sent meanwhile are dropped.
+
+// false to stop dispatching, the connection is then unusable
+typedef u8 (*ewl_event_handler)(void *owner, const ewl_message *message);
+
+typedef struct ewl_interface {
+    const char *name;
+    // indexed by opcode, 0 for events that aren't handled
+    const ewl_event_handler *events;
+    u16 event_count;
+} ewl_interface;
+
+typedef struct ewl_object {
+    // 0 when the id is free
+    const ewl_interface *interface;
+    void *owner;
+    u8 destroyed;
+    // next free id when free, 0 ends the list
+    u32 next_free;
+} ewl_object;
+
+typedef struct ewl_objects {
+    // indexed by id, 0 is the null object
+    ewl_object *items;
+    u32 count;
+    u32 capacity;
+    // last freed id, the first used again
+    u32 free_head;
+    u32 live;
+    u64 dispatched;
+    u64 dropped;
+} ewl_objects;
+
+EAPI void ewl_objects_init(ewl_objects *objects);
+EAPI void ewl_objects_destroy(ewl_objects *objects);
+// id for a new_id argument, the first one is 1 for wl_display
+EAPI u32 ewl_objects_add(ewl_objects *objects, const ewl_interface *interface, void *owner);
+// the destroy request was sent, or the owner is gone: no more events, the
+// entry, owner included, stays until ewl_objects_remove
+EAPI void ewl_objects_destroyed(ewl_objects *objects, u32 id);
+// delete_id: the id can be used again
+EAPI void ewl_objects_remove(ewl_objects *objects, u32 id);
+// false for unknown objects or events, and when the handler fails
+EAPI u8 ewl_objects_dispatch(ewl_objects *objects, const ewl_message *message);
+
+// 0 when the id isn't in use
+static inline ewl_object *ewl_objects_get(ewl_objects *objects, u32 id) {
+    if(id >= objects->count || !objects->items[id].interface) {
+        return 0;
+    }
+    return &objects->items[id];
+}
+
+#endif // WL_OBJECTS_H
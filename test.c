@@ -13,28 +13,21 @@
 // TODO: put that in app or smth
 escene current_scene;
 
-struct velocity_c {
+typedef struct velocity_c {
     int vx;
     int vy;
-};
+} velocity_c;
 
-struct velocity_c *velocities;
-
-sprite_c *sprites;
-position_c *positions;
-
-// TODO: replace that by and id returned by the engine (like entity)?
-enum COMPONENTS {
-    COMP_POSITION = 0,
-    COMP_VELOCITY = 1,
-    COMP_SPRITE = 2
-};
+// ids, masks and accessors are generated after the engine components
+#define ECS_APP_COMPONENTS(X) \
+    X(velocity_c, _Alignof(velocity_c))
+#include "src/ecs_registry.h"
 
 u8 update(eapp *app) {
     return false;
 }
 
-u8 render(eapp *app) {
+u8 render(eapp *app, f32 alpha) {
     renderer_clear();
     if(current_scene.id) {
         scene_render(&current_scene, app->window.width, app->window.height); // TODO: size infos in scene?
@@ -43,13 +36,7 @@ u8 render(eapp *app) {
 }
 
 // we can define variables that have a static lifetime here
-#define INIT()                    \
-    struct position_c pos[2048];  \
-    positions = pos;              \
-    struct velocity_c vel[2048];  \
-    velocities = vel;             \
-    sprite_c spr[2048];           \
-    sprites = spr
+#define INIT()
 
 
 u8 init(eapp *app) {
@@ -59,31 +46,26 @@ u8 init(eapp *app) {
     printf("scene %d created, ready to be loaded\n", scene.id);
     scene_load(&current_scene);
 
-    ecs_component_create(&scene, COMP_SPRITE, sprites);
-    ecs_component_create(&scene, COMP_POSITION, positions);
-    scene.COMP_SPRITE = COMP_SPRITE;
-    scene.COMP_POSITION = COMP_POSITION;
+    ecs_register_components(&scene);
 
     u32 id = ecs_entity_create(&scene, 0x1);
     printf("created entity with id: %u\n", id);
     id = ecs_entity_create(&scene, 0x1);
     printf("created entity with id: %u\n", id);
 
-    ecs_component_create(&scene, COMP_VELOCITY, velocities);
-
-    ecs_entity_add_component(&scene, 0, COMP_POSITION);
-    ecs_entity_add_component(&scene, 0, COMP_SPRITE);
+    ecs_entity_add_component(&scene, 0, ECS_ID(position_c));
+    ecs_entity_add_component(&scene, 0, ECS_ID(sprite_c));
 
-    position_c *position = (position_c*)ecs_get_component_of(&scene, 0, COMP_POSITION, sizeof(position_c));
+    position_c *position = ECS_MUT(&scene, position_c, 0);
     position->x = 100;
     position->y = 275;
 
-    sprite_c *sprite = (sprite_c*)ecs_get_component_of(&scene, 0, COMP_SPRITE, sizeof(sprite_c));
+    sprite_c *sprite = ECS_MUT(&scene, sprite_c, 0);
     sprite->asset_id = asset_register("assets/icon.png", ASSET_TEXTURE);
     asset_load(sprite->asset_id);
 
-    ecs_entity_add_component(&scene, 1, COMP_POSITION);
-    ecs_entity_add_component(&scene, 1, COMP_VELOCITY);
+    ecs_entity_add_component(&scene, 1, ECS_ID(position_c));
+    ecs_entity_add_component(&scene, 1, ECS_ID(velocity_c));
 
     current_scene = scene;
 }
@@ -10,7 +10,7 @@ u8 update(eapp *app) {
     return false;
 }
 
-u8 render(eapp *app) {
+u8 render(eapp *app, f32 alpha) {
     return true;
 }
 
@@ -0,0 +1,145 @@
+#include "bvh.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/bvh.h"
+#include "../src/memory.h"
+
+#include <stdlib.h>
+
+#define BOX_COUNT 1024
+
+static collision_box boxes[BOX_COUNT];
+static u32 proxies[BOX_COUNT];
+static u8 alive[BOX_COUNT];
+
+static collision_box random_box(i32 world, i32 max_size) {
+    i32 x = rand() % world, y = rand() % world;
+    return (collision_box){ .x1 = x, .x2 = x + 1 + rand() % max_size, .y1 = y, .y2 = y + 1 + rand() % max_size };
+}
+
+static u8 overlap(collision_box a, collision_box b) {
+    return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+static void check_query(ebvh *tree, collision_box region) {
+    static u32 found[BOX_COUNT];
+    u32 expected = 0;
+    for(u32 i = 0; i < BOX_COUNT; ++i) {
+        expected += alive[i] && overlap(region, boxes[i]);
+    }
+    u32 count = ebvh_query(tree, region, found, BOX_COUNT);
+    EASSERT_MSG(count == expected, "found %u boxes, expected %u", count, expected);
+    for(u32 i = 0; i < count; ++i) {
+        EASSERT(alive[found[i]] && overlap(region, boxes[found[i]]));
+    }
+}
+
+static void bvh_test_build() {
+    ebvh tree;
+    EASSERT(ebvh_create(16, 4, &tree));
+
+    srand(46);
+    // starts small, must grow
+    for(u32 i = 0; i < BOX_COUNT; ++i) {
+        boxes[i] = random_box(8192, 64);
+        proxies[i] = ebvh_insert(&tree, boxes[i], i);
+        alive[i] = true;
+    }
+    EASSERT(ebvh_validate(&tree));
+    EASSERT(tree.count == 2 * BOX_COUNT - 1);
+    // balanced: a degenerate tree would be BOX_COUNT high
+    EASSERT_MSG(ebvh_height(&tree) <= 24, "tree height %d", ebvh_height(&tree));
+
+    for(u32 q = 0; q < 64; ++q) {
+        check_query(&tree, random_box(8192, 1024));
+    }
+
+    // a small view only visits a fraction of the tree
+    collision_box view = { .x1 = 0, .x2 = 600, .y1 = 0, .y2 = 400 };
+    static u32 found[BOX_COUNT];
+    ebvh_query(&tree, view, found, BOX_COUNT);
+    EASSERT_MSG(tree.visited < BOX_COUNT / 4, "visited %llu nodes", tree.visited);
+
+    ebvh_destroy(&tree);
+}
+
+static void bvh_test_move_remove() {
+    ebvh tree;
+    ebvh_create(BOX_COUNT, 8, &tree);
+
+    srand(47);
+    for(u32 i = 0; i < BOX_COUNT; ++i) {
+        boxes[i] = random_box(4096, 64);
+        proxies[i] = ebvh_insert(&tree, boxes[i], i);
+        alive[i] = true;
+    }
+
+    u32 reinserted = 0;
+    for(u32 frame = 0; frame < 16; ++frame) {
+        for(u32 i = 0; i < BOX_COUNT; ++i) {
+            i32 dx = rand() % 5 - 2, dy = rand() % 5 - 2;
+            if(i % 11 == 0) {
+                dx *= 100;
+            }
+            boxes[i].x1 += dx; boxes[i].x2 += dx;
+            boxes[i].y1 += dy; boxes[i].y2 += dy;
+            reinserted += ebvh_move(&tree, proxies[i], boxes[i]);
+        }
+        EASSERT(ebvh_validate(&tree));
+        check_query(&tree, random_box(4096, 1024));
+    }
+    // small moves stay inside the fat bounds
+    EASSERT(reinserted < BOX_COUNT * 16 / 2);
+
+    for(u32 i = 0; i < BOX_COUNT; i += 2) {
+        ebvh_remove(&tree, proxies[i]);
+        alive[i] = false;
+    }
+    EASSERT(ebvh_validate(&tree));
+    check_query(&tree, (collision_box){ .x1 = -1 << 20, .x2 = 1 << 20, .y1 = -1 << 20, .y2 = 1 << 20 });
+
+    ebvh_destroy(&tree);
+}
+
+static void bvh_test_point_raycast() {
+    ebvh tree;
+    ebvh_create(8, 4, &tree);
+
+    collision_box a = { .x1 = 10, .x2 = 20, .y1 = 0, .y2 = 10 };
+    collision_box b = { .x1 = 40, .x2 = 50, .y1 = 0, .y2 = 10 };
+    collision_box c = { .x1 = 15, .x2 = 45, .y1 = 100, .y2 = 110 };
+    ebvh_insert(&tree, a, 1);
+    ebvh_insert(&tree, b, 2);
+    ebvh_insert(&tree, c, 3);
+
+    u32 found[4];
+    EASSERT(ebvh_query_point(&tree, 12, 5, found, 4) == 1 && found[0] == 1);
+    // inside the fat bounds only
+    EASSERT(ebvh_query_point(&tree, 8, 5, found, 4) == 0);
+
+    u32 user = 0;
+    f32 t = 0.0f;
+    EASSERT(ebvh_raycast(&tree, 0.0f, 5.0f, 1.0f, 0.0f, 1000.0f, &user, &t));
+    EASSERT(user == 1 && t == 10.0f);
+    EASSERT(ebvh_raycast(&tree, 60.0f, 5.0f, -1.0f, 0.0f, 1000.0f, &user, &t));
+    EASSERT(user == 2 && t == 10.0f);
+    // too short
+    EASSERT(!ebvh_raycast(&tree, 0.0f, 5.0f, 1.0f, 0.0f, 5.0f, &user, &t));
+    // vertical, starting inside a box
+    EASSERT(ebvh_raycast(&tree, 30.0f, 105.0f, 0.0f, 1.0f, 1000.0f, &user, &t));
+    EASSERT(user == 3 && t == 0.0f);
+    EASSERT(!ebvh_raycast(&tree, 30.0f, 0.0f, 0.0f, -1.0f, 1000.0f, &user, &t));
+
+    ebvh_destroy(&tree);
+}
+
+void bvh_tests() {
+    EINFO("-- bvh_tests");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+    bvh_test_build();
+    bvh_test_move_remove();
+    bvh_test_point_raycast();
+    ememory_uninit();
+}
@@ -0,0 +1,6 @@
+#ifndef BVH_TESTS_H
+#define BVH_TESTS_H
+
+void bvh_tests();
+
+#endif // BVH_TESTS_H
@@ -0,0 +1,108 @@
+#include "collision.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/collision.h"
+#include "../src/memory.h"
+#include "../src/spatial_hash.h"
+
+#include <stdlib.h>
+
+#define BOX_COUNT 1000
+
+static collision_box boxes[BOX_COUNT];
+static u32 indices[BOX_COUNT];
+
+static collision_box random_box(i32 world, i32 max_size) {
+    i32 x = rand() % world;
+    i32 y = rand() % world;
+    return (collision_box){ .x1 = x, .x2 = x + 1 + rand() % max_size, .y1 = y, .y2 = y + 1 + rand() % max_size };
+}
+
+static void expect_mask(collision_box box, u32 first, u32 count, const u64 *mask, u32 hits) {
+    u32 expected = 0;
+    for(u32 i = 0; i < count; ++i) {
+        u8 overlap = collision_box_overlap(&box, &boxes[first + i]);
+        expected += overlap;
+        EASSERT(((mask[i >> 6] >> (i & 63)) & 1) == overlap);
+    }
+    EASSERT(hits == expected);
+}
+
+static void collision_test_backends() {
+    ecollision_store store;
+    EASSERT(ecollision_store_create(BOX_COUNT, &store));
+    EASSERT(store.capacity % ECOLLISION_LANES == 0);
+    EASSERT(((u64)store.x1 & 63) == 0);
+
+    srand(31);
+    for(u32 i = 0; i < BOX_COUNT; ++i) {
+        boxes[i] = random_box(512, 64);
+    }
+    ecollision_store_load(&store, boxes, BOX_COUNT);
+
+    ecollision_backend best = ecollision_get_backend();
+    u64 mask[(BOX_COUNT + 63) / 64];
+    for(u32 backend = ECOLLISION_BACKEND_SCALAR; backend <= ECOLLISION_BACKEND_AVX2; ++backend) {
+        if(!ecollision_set_backend(backend)) {
+            continue;
+        }
+        srand(32);
+        for(u32 q = 0; q < 64; ++q) {
+            collision_box box = random_box(512, 128);
+            // whole store, then a partial range that doesn't end on a lane boundary
+            u32 hits = ecollision_test_range(&store, box, 0, BOX_COUNT, mask);
+            expect_mask(box, 0, BOX_COUNT, mask, hits);
+            hits = ecollision_test_range(&store, box, 128, 77, mask);
+            expect_mask(box, 128, 77, mask, hits);
+
+            u32 count = rand() % BOX_COUNT;
+            for(u32 i = 0; i < count; ++i) {
+                indices[i] = rand() % BOX_COUNT;
+            }
+            hits = ecollision_test_indices(&store, box, indices, count, mask);
+            u32 expected = 0;
+            for(u32 i = 0; i < count; ++i) {
+                u8 overlap = collision_box_overlap(&box, &boxes[indices[i]]);
+                expected += overlap;
+                EASSERT(((mask[i >> 6] >> (i & 63)) & 1) == overlap);
+            }
+            EASSERT(hits == expected);
+        }
+    }
+    EASSERT(ecollision_set_backend(best));
+
+    ecollision_store_destroy(&store);
+}
+
+static void collision_test_edges() {
+    ecollision_store store;
+    EASSERT(ecollision_store_create(4, &store));
+    ecollision_store_set(&store, 0, (collision_box){ .x1 = 10, .x2 = 20, .y1 = 0, .y2 = 10 });
+    ecollision_store_set(&store, 1, (collision_box){ .x1 = 9, .x2 = 20, .y1 = 9, .y2 = 10 });
+    ecollision_store_set(&store, 2, (collision_box){ .x1 = -20, .x2 = -10, .y1 = 0, .y2 = 10 });
+    EASSERT(store.count == 3);
+
+    collision_box box = { .x1 = 0, .x2 = 10, .y1 = 0, .y2 = 10 };
+    u64 mask;
+    for(u32 backend = ECOLLISION_BACKEND_SCALAR; backend <= ECOLLISION_BACKEND_AVX2; ++backend) {
+        if(!ecollision_set_backend(backend)) {
+            continue;
+        }
+        // touching edges don't overlap, padding never does
+        EASSERT(ecollision_test_range(&store, box, 0, store.capacity, &mask) == 1);
+        EASSERT(mask == 0x2);
+    }
+
+    ecollision_store_destroy(&store);
+}
+
+void collision_tests() {
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+
+    collision_test_backends();
+    collision_test_edges();
+
+    ememory_uninit();
+}
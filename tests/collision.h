@@ -0,0 +1,6 @@
+#ifndef COLLISION_TESTS_H
+#define COLLISION_TESTS_H
+
+void collision_tests();
+
+#endif // COLLISION_TESTS_H
@@ -0,0 +1,197 @@
+#include "ecs.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/scene.h"
+#include "../src/memory.h"
+
+typedef struct health_c {
+    i32 current;
+    i32 max;
+} health_c;
+
+#define ECS_APP_COMPONENTS(X) \
+    X(health_c, 16)
+#include "../src/ecs_registry.h"
+
+// escene is too big for the stack
+static escene scene;
+static u32 entities[4 * ECS_INITIAL_ENTITIES];
+
+static void ecs_test_query() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+    ecs_component_create(&scene, 1, sizeof(u32), _Alignof(u32));
+
+    // spans several 64 entities words
+    for(u32 i = 0; i < 200; ++i) {
+        u32 entity = ecs_entity_create(&scene, 0);
+        ecs_entity_add_component(&scene, entity, 0);
+        if(i % 2 == 0) {
+            ecs_entity_add_component(&scene, entity, 1);
+        }
+    }
+
+    u32 count;
+    u32 components[2] = { 0, 1 };
+    EASSERT(ecs_get_entities_with_components(&scene, components, 1, entities, &count) == 200);
+    EASSERT(ecs_get_entities_with_components(&scene, components, 2, entities, &count) == 100);
+    EASSERT(entities[99] == 198);
+
+    ecs_entity_remove_component(&scene, 198, 1);
+    ecs_entity_destroy(&scene, 0);
+    EASSERT(ecs_get_entities_with_components(&scene, components, 2, entities, &count) == 98);
+    EASSERT(entities[0] == 2);
+
+    ecs_scene_release(&scene);
+}
+
+static void ecs_test_change_ticks() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+
+    u32 since = ecs_advance_tick(&scene);
+    for(u32 i = 0; i < 256; ++i) {
+        ecs_entity_add_component(&scene, ecs_entity_create(&scene, 0), 0);
+    }
+
+    u32 count;
+    u32 component = 0;
+    // added on the current tick, so not after it
+    EASSERT(ecs_get_entities_added_since(&scene, &component, 1, 0, since, entities, &count) == 0);
+    EASSERT(ecs_get_entities_added_since(&scene, &component, 1, 0, since - 1, entities, &count) == 256);
+
+    since = ecs_advance_tick(&scene);
+    EASSERT(ecs_get_entities_changed_since(&scene, &component, 1, 0, since, entities, &count) == 0);
+
+    // reads don't count as changes
+    ecs_get_component_of(&scene, 3, 0, sizeof(u32));
+    *(u32 *)ecs_get_component_mut(&scene, 130, 0, sizeof(u32)) = 46;
+    u32 first_write = since;
+    since = ecs_advance_tick(&scene);
+    *(u32 *)ecs_get_component_mut(&scene, 200, 0, sizeof(u32)) = 47;
+
+    EASSERT(ecs_get_entities_changed_since(&scene, &component, 1, 0, first_write - 1, entities, &count) == 2);
+    EASSERT(entities[0] == 130 && entities[1] == 200);
+    EASSERT(ecs_get_entities_changed_since(&scene, &component, 1, 0, first_write, entities, &count) == 1);
+    EASSERT(entities[0] == 200);
+    EASSERT(ecs_get_entities_added_since(&scene, &component, 1, 0, first_write - 1, entities, &count) == 0);
+    // only the chunks holding 130 and 200 were touched
+    EASSERT(scene.components[0].ticks.chunk_changed[0] < first_write);
+    EASSERT(scene.components[0].ticks.chunk_changed[1] < first_write);
+    EASSERT(scene.components[0].ticks.chunk_changed[2] == first_write);
+    EASSERT(scene.components[0].ticks.chunk_changed[3] == since);
+
+    ecs_scene_release(&scene);
+}
+
+typedef struct wide_c {
+    f32 values[5];
+} wide_c;
+
+static void ecs_test_pools() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+    // padded to 32 bytes
+    ecs_component_create(&scene, 1, sizeof(wide_c), 32);
+
+    u32 stride;
+    EASSERT(((u64)ecs_component_data(&scene, 1, &stride) & (ECS_POOL_ALIGN - 1)) == 0);
+    EASSERT(stride == 32);
+    EASSERT(scene.entity_capacity == ECS_INITIAL_ENTITIES);
+
+    // past the initial capacity, values must survive each growth
+    u32 total = 3 * ECS_INITIAL_ENTITIES + 5;
+    for(u32 i = 0; i < total; ++i) {
+        u32 entity = ecs_entity_create(&scene, 0);
+        ecs_entity_add_component(&scene, entity, 0);
+        *(u32 *)ecs_get_component_mut(&scene, entity, 0, sizeof(u32)) = i * 3;
+        if(i % 3 == 0) {
+            ecs_entity_add_component(&scene, entity, 1);
+            wide_c *wide = ecs_get_component_mut(&scene, entity, 1, sizeof(wide_c));
+            EASSERT(((u64)wide & 31) == 0);
+            wide->values[4] = i;
+        }
+    }
+    EASSERT(scene.entity_capacity == 4 * ECS_INITIAL_ENTITIES);
+    EASSERT(((u64)ecs_component_data(&scene, 0, 0) & (ECS_POOL_ALIGN - 1)) == 0);
+
+    u32 count;
+    u32 components[2] = { 0, 1 };
+    EASSERT(ecs_get_entities_with_components(&scene, components, 1, entities, &count) == total);
+    EASSERT(ecs_get_entities_with_components(&scene, components, 2, entities, &count) == (total + 2) / 3);
+    for(u32 i = 0; i < total; ++i) {
+        EASSERT(*(u32 *)ecs_get_component_of(&scene, i, 0, sizeof(u32)) == i * 3);
+    }
+    for(u32 i = 0; i < count; ++i) {
+        wide_c *wide = ecs_get_component_of(&scene, entities[i], 1, sizeof(wide_c));
+        EASSERT(wide->values[4] == entities[i]);
+    }
+    // new slots start zeroed
+    u32 entity = ecs_entity_create(&scene, 0);
+    EASSERT(*(u32 *)ecs_get_component_of(&scene, entity, 0, sizeof(u32)) == 0);
+
+    ecs_scene_release(&scene);
+    EASSERT(scene.components[0].data == 0);
+}
+
+static void ecs_test_registry() {
+    // engine components first, then app ones
+    _Static_assert(ECS_ID(sprite_c) == 0 && ECS_ID(position_c) == 1 && ECS_ID(health_c) == 2, "registry order");
+    _Static_assert(ECS_COMPONENT_COUNT == 3, "registry count");
+    _Static_assert(ECS_STRIDE(health_c) == 16 && ECS_STRIDE(position_c) == sizeof(position_c), "registry strides");
+    _Static_assert((ECS_MASK(position_c) | ECS_MASK(health_c)) == 0x6, "registry masks");
+
+    scene = (escene){0};
+    ecs_register_components(&scene);
+    u32 stride;
+    ecs_component_data(&scene, ECS_ID(health_c), &stride);
+    EASSERT(stride == ECS_STRIDE(health_c));
+
+    for(u32 i = 0; i < 100; ++i) {
+        u32 entity = ecs_entity_create(&scene, 0);
+        ecs_entity_add_component(&scene, entity, ECS_ID(position_c));
+        if(i % 4 == 0) {
+            ecs_entity_add_component(&scene, entity, ECS_ID(health_c));
+            ECS_MUT(&scene, health_c, entity)->current = i;
+        }
+    }
+    u32 since = ecs_advance_tick(&scene);
+    ECS_MUT(&scene, position_c, 7)->x = 46;
+
+    EASSERT(ECS_HAS(&scene, health_c, 8) && !ECS_HAS(&scene, health_c, 7));
+    EASSERT(ecs_has_mask(&scene, 8, ECS_MASK(position_c) | ECS_MASK(health_c)));
+    // a component without pool, an entity past the capacity
+    ecs_component_destroy(&scene, ECS_ID(sprite_c));
+    EASSERT(!ECS_HAS(&scene, sprite_c, 8));
+    EASSERT(!ECS_HAS(&scene, health_c, scene.entity_capacity));
+    // same storage as the runtime accessors
+    EASSERT(ECS_GET(&scene, health_c, 8) == ecs_get_component_of(&scene, 8, ECS_ID(health_c), sizeof(health_c)));
+    EASSERT(ECS_GET(&scene, health_c, 8)->current == 8);
+    EASSERT(ECS_GET(&scene, position_c, 7)->x == 46);
+
+    u32 count;
+    EASSERT(ecs_query_mask(&scene, ECS_MASK(position_c) | ECS_MASK(health_c), entities, &count) == 25);
+    for(u32 i = 0; i < count; ++i) {
+        EASSERT(entities[i] == i * 4);
+    }
+    // sprite_c has no entity
+    EASSERT(ecs_query_mask(&scene, ECS_MASK(sprite_c) | ECS_MASK(position_c), entities, &count) == 0);
+    u32 component = ECS_ID(position_c);
+    // typed writes stamp the changed tick too
+    EASSERT(ecs_get_entities_changed_since(&scene, &component, 1, component, since - 1, entities, &count) == 1);
+    EASSERT(entities[0] == 7);
+
+    ecs_scene_release(&scene);
+}
+
+void ecs_tests() {
+    EINFO("-- ecs_tests");
+    eheap heap = {0};
+    ememory_init(4 * 1024 * 1024, &heap);
+    ecs_test_query();
+    ecs_test_change_ticks();
+    ecs_test_pools();
+    ecs_test_registry();
+    ememory_uninit();
+}
@@ -0,0 +1,6 @@
+#ifndef ECS_TESTS_H
+#define ECS_TESTS_H
+
+void ecs_tests();
+
+#endif // ECS_TESTS_H
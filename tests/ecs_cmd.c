@@ -0,0 +1,152 @@
+#include "ecs_cmd.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/ecs_cmd.h"
+#include "../src/memory.h"
+#include "../src/thread.h"
+
+// escene is too big for the stack
+static escene scene;
+
+static void ecs_cmd_test_deferred() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+    u32 *pool = ecs_component_data(&scene, 0, 0);
+
+    ecs_cmdqueue queue;
+    EASSERT(ecs_cmdqueue_create(64 * 1024, &queue));
+
+    u32 entity = ecs_cmd_create(&queue, &scene);
+    u32 value = 46;
+    ecs_cmd_add(&queue, entity, 0, &value, sizeof(value));
+    // nothing happens before the sync point
+    EASSERT(!ecs_entity_has_component(&scene, entity, 0));
+    EASSERT(scene.entity_count == 0);
+
+    EASSERT(ecs_cmdqueue_apply(&queue, &scene) == 2);
+    EASSERT(ecs_entity_has_component(&scene, entity, 0));
+    EASSERT(pool[entity] == 46);
+    EASSERT(scene.entity_count == 1);
+    EASSERT(queue.arena.used == 0);
+
+    ecs_cmd_remove(&queue, entity, 0);
+    EASSERT(ecs_entity_has_component(&scene, entity, 0));
+    ecs_cmdqueue_apply(&queue, &scene);
+    EASSERT(!ecs_entity_has_component(&scene, entity, 0));
+
+    ecs_cmdqueue_destroy(&queue);
+    ecs_scene_release(&scene);
+}
+
+static void ecs_cmd_test_order() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+    u32 *pool = ecs_component_data(&scene, 0, 0);
+
+    ecs_cmdqueue queue;
+    ecs_cmdqueue_create(64 * 1024, &queue);
+
+    u32 a = ecs_entity_create(&scene, 0);
+    u32 b = ecs_entity_create(&scene, 0);
+    // recorded out of entity order, and destroy then re-add on the same entity
+    ecs_cmd_add(&queue, b, 0, 0, 0);
+    ecs_cmd_add(&queue, a, 0, 0, 0);
+    ecs_cmd_destroy(&queue, a);
+    ecs_cmd_add(&queue, a, 0, 0, 0);
+    EASSERT(ecs_cmdqueue_local(&queue)->count == 4);
+
+    ecs_cmdqueue_apply(&queue, &scene);
+    // same entity commands keep their recording order
+    EASSERT(ecs_entity_has_component(&scene, a, 0));
+    EASSERT(ecs_entity_has_component(&scene, b, 0));
+    EASSERT(ecs_cmdqueue_local(&queue)->count == 0);
+
+    ecs_cmdqueue_destroy(&queue);
+    ecs_scene_release(&scene);
+}
+
+static void ecs_cmd_test_many() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+    u32 *pool = ecs_component_data(&scene, 0, 0);
+
+    ecs_cmdqueue queue;
+    ecs_cmdqueue_create(256 * 1024, &queue);
+
+    // spans several blocks
+    for(u32 i = 0; i < 3 * ECS_CMD_BLOCK_SIZE; ++i) {
+        u32 entity = ecs_cmd_create(&queue, &scene);
+        ecs_cmd_add(&queue, entity, 0, &i, sizeof(i));
+    }
+    EASSERT(ecs_cmdqueue_apply(&queue, &scene) == 6 * ECS_CMD_BLOCK_SIZE);
+    for(u32 i = 0; i < 3 * ECS_CMD_BLOCK_SIZE; ++i) {
+        EASSERT(ecs_entity_has_component(&scene, i, 0));
+        EASSERT(pool[i] == i);
+    }
+
+    ecs_cmdqueue_destroy(&queue);
+    ecs_scene_release(&scene);
+}
+
+static void ecs_cmd_test_full_arena() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+
+    // room for two aligned blocks and no more: recording fills the arena
+    ecs_cmdqueue queue;
+    ecs_cmdqueue_create(2 * sizeof(ecs_cmd_block) + 128, &queue);
+    for(u32 i = 0; i < 2 * ECS_CMD_BLOCK_SIZE; ++i) {
+        ecs_cmd_add(&queue, i, 0, 0, 0);
+    }
+    EASSERT(ecs_cmdqueue_apply(&queue, &scene) == 2 * ECS_CMD_BLOCK_SIZE);
+    EASSERT(ecs_entity_has_component(&scene, 2 * ECS_CMD_BLOCK_SIZE - 1, 0));
+
+    ecs_cmdqueue_destroy(&queue);
+    ecs_scene_release(&scene);
+}
+
+static ecs_cmdqueue thread_queue;
+
+static void *record_thread(void *arg) {
+    u32 entity = *(u32 *)arg;
+    ecs_cmd_add(&thread_queue, entity, 0, &entity, sizeof(entity));
+    return 0;
+}
+
+static void ecs_cmd_test_threads() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+    u32 *pool = ecs_component_data(&scene, 0, 0);
+    ecs_cmdqueue_create(256 * 1024, &thread_queue);
+
+    // more threads than buffers over time, their indices are recycled
+    u32 count = 2 * ECS_CMD_MAX_THREADS;
+    u32 entities[2 * ECS_CMD_MAX_THREADS];
+    for(u32 i = 0; i < count; ++i) {
+        entities[i] = ecs_cmd_create(&thread_queue, &scene);
+        ethread thread;
+        EASSERT(ethread_create(record_thread, &entities[i], &thread));
+        ethread_join(&thread);
+    }
+    EASSERT(ecs_cmdqueue_apply(&thread_queue, &scene) == 2 * count);
+    for(u32 i = 0; i < count; ++i) {
+        EASSERT(ecs_entity_has_component(&scene, entities[i], 0));
+        EASSERT(pool[entities[i]] == entities[i]);
+    }
+
+    ecs_cmdqueue_destroy(&thread_queue);
+    ecs_scene_release(&scene);
+}
+
+void ecs_cmd_tests() {
+    EINFO("-- ecs_cmd_tests");
+    eheap heap = {0};
+    ememory_init(4 * 1024 * 1024, &heap);
+    ecs_cmd_test_deferred();
+    ecs_cmd_test_order();
+    ecs_cmd_test_many();
+    ecs_cmd_test_full_arena();
+    ecs_cmd_test_threads();
+    ememory_uninit();
+}
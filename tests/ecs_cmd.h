@@ -0,0 +1,6 @@
+#ifndef ECS_CMD_TESTS_H
+#define ECS_CMD_TESTS_H
+
+void ecs_cmd_tests();
+
+#endif // ECS_CMD_TESTS_H
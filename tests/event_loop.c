@@ -0,0 +1,118 @@
+#include "event_loop.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/event_loop.h"
+#include "../src/logger.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MS 1000000ull
+
+typedef struct test_source {
+    u32 calls;
+    u32 events;
+    u32 bytes;
+} test_source;
+
+// drains, like the display connection
+static void on_readable(void *user, i32 fd, u32 events) {
+    test_source *source = user;
+    ++source->calls;
+    source->events = events;
+    char buf[16];
+    i64 n;
+    while((n = read(fd, buf, sizeof(buf))) > 0) {
+        source->bytes += n;
+    }
+}
+
+static void on_timer(void *user, i32 fd, u32 expirations) {
+    test_source *source = user;
+    ++source->calls;
+    source->events += expirations;
+}
+
+static void event_loop_test_fds() {
+    eevent_loop loop;
+    EASSERT(eevent_loop_create(&loop));
+    i32 fds[2];
+    EASSERT(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    test_source source = {0};
+    EASSERT(eevent_add(&loop, fds[0], EEVENT_READ, on_readable, &source));
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!eevent_add(&loop, fds[0], EEVENT_READ, on_readable, &source));
+
+    // nothing to read, returns at once
+    EASSERT(eevent_loop_run(&loop, 0) == 0);
+
+    // everything is read by one call
+    EASSERT(write(fds[1], "egg egg egg egg egg egg", 23) == 23);
+    EASSERT(eevent_loop_run(&loop, EEVENT_WAIT_FOREVER) == 1);
+    EASSERT(source.calls == 1 && source.bytes == 23 && source.events == EEVENT_READ);
+
+    // the timeout bounds the wait, below a ms
+    u64 start = eclock_now_ns();
+    EASSERT(eevent_loop_run(&loop, MS / 2) == 0);
+    u64 waited = eclock_now_ns() - start;
+    EASSERT(waited >= MS / 2 && waited < 100 * MS);
+
+    // the writer gone, reported with the end of file
+    close(fds[1]);
+    EASSERT(eevent_loop_run(&loop, 0) == 1);
+    EASSERT(source.calls == 2 && (source.events & EEVENT_CLOSED));
+
+    EASSERT(eevent_remove(&loop, fds[0]));
+    EASSERT(!eevent_remove(&loop, fds[0]));
+    EASSERT(eevent_loop_run(&loop, 0) == 0);
+    close(fds[0]);
+
+    // a pipe is always writable
+    EASSERT(pipe(fds) == 0);
+    test_source writer = {0};
+    EASSERT(eevent_add(&loop, fds[1], 0, on_readable, &writer));
+    EASSERT(eevent_loop_run(&loop, 0) == 0);
+    EASSERT(eevent_modify(&loop, fds[1], EEVENT_WRITE));
+    EASSERT(eevent_loop_run(&loop, 0) == 1 && writer.events == EEVENT_WRITE);
+    EASSERT(eevent_remove(&loop, fds[1]));
+    close(fds[0]);
+    close(fds[1]);
+
+    eevent_loop_destroy(&loop);
+}
+
+static void event_loop_test_timers() {
+    eevent_loop loop;
+    EASSERT(eevent_loop_create(&loop));
+
+    test_source once = {0};
+    test_source periodic = {0};
+    i32 once_fd, periodic_fd;
+    EASSERT(eevent_add_timer(&loop, 2 * MS, 0, on_timer, &once, &once_fd));
+    EASSERT(eevent_add_timer(&loop, MS, MS, on_timer, &periodic, &periodic_fd));
+
+    u64 start = eclock_now_ns();
+    while(eclock_now_ns() - start < 10 * MS) {
+        EASSERT(eevent_loop_run(&loop, MS) >= 0);
+    }
+    EASSERT(once.calls == 1 && once.events == 1);
+    // missed expirations are counted, not lost
+    EASSERT(periodic.calls >= 1 && periodic.events >= 8 && periodic.events <= 12);
+
+    EASSERT(eevent_remove(&loop, periodic_fd));
+    u32 events = periodic.events;
+    EASSERT(eevent_loop_run(&loop, 3 * MS) == 0);
+    EASSERT(periodic.events == events);
+
+    eevent_loop_destroy(&loop);
+}
+
+void event_loop_tests() {
+    EINFO("-- event_loop_tests");
+    event_loop_test_fds();
+    event_loop_test_timers();
+}
@@ -0,0 +1,6 @@
+#ifndef EVENT_LOOP_TESTS_H
+#define EVENT_LOOP_TESTS_H
+
+void event_loop_tests();
+
+#endif // EVENT_LOOP_TESTS_H
@@ -0,0 +1,79 @@
+#include "frame_stats.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/frame_stats.h"
+
+#define MS 1000000ull
+
+// within a bucket of the exact value
+static u8 close_to(u64 value, u64 expected) {
+    u64 error = expected / EFRAME_STATS_SUB_BUCKETS + 1;
+    return value >= expected && value <= expected + error;
+}
+
+static void frame_stats_test_histogram() {
+    static ehistogram histogram;
+    ehistogram_clear(&histogram);
+    EASSERT(ehistogram_percentile(&histogram, 50.0) == 0);
+
+    // 1..1000 ms
+    for(u64 i = 1; i <= 1000; ++i) {
+        ehistogram_record(&histogram, i * MS);
+    }
+    EASSERT(histogram.count == 1000 && histogram.max_ns == 1000 * MS);
+    EASSERT(close_to(ehistogram_percentile(&histogram, 50.0), 500 * MS));
+    EASSERT(close_to(ehistogram_percentile(&histogram, 95.0), 950 * MS));
+    EASSERT(close_to(ehistogram_percentile(&histogram, 99.0), 990 * MS));
+    // never above the largest sample
+    EASSERT(ehistogram_percentile(&histogram, 100.0) == 1000 * MS);
+
+    // small values are exact, huge ones clamped
+    ehistogram_clear(&histogram);
+    ehistogram_record(&histogram, 0);
+    ehistogram_record(&histogram, 17);
+    ehistogram_record(&histogram, 1ull << 50);
+    EASSERT(ehistogram_percentile(&histogram, 10.0) == 0);
+    EASSERT(ehistogram_percentile(&histogram, 50.0) == 17);
+    EASSERT(histogram.counts[EFRAME_STATS_BUCKETS - 1] == 1);
+}
+
+static void frame_stats_test_rolling() {
+    static eframe_stats stats;
+    eframe_stats_init(16 * MS, 100, &stats);
+
+    // a slow window then two fast ones
+    for(u32 i = 0; i < 100; ++i) {
+        eframe_stats_record(&stats, EFRAME_PHASE_RENDER, 10 * MS);
+        eframe_stats_end_frame(&stats, 20 * MS);
+    }
+    EASSERT(eframe_stats_rolling_over_budget(&stats) == 100);
+    for(u32 i = 0; i < 100; ++i) {
+        eframe_stats_end_frame(&stats, 5 * MS);
+    }
+    // half of the samples are still slow
+    EASSERT(close_to(eframe_stats_percentile(&stats, EFRAME_PHASE_FRAME, 99.0), 20 * MS));
+    EASSERT(close_to(eframe_stats_percentile(&stats, EFRAME_PHASE_FRAME, 40.0), 5 * MS));
+    EASSERT(eframe_stats_rolling_over_budget(&stats) == 100);
+
+    for(u32 i = 0; i < 100; ++i) {
+        eframe_stats_end_frame(&stats, 5 * MS);
+    }
+    // the slow window rolled out, the totals still have it
+    EASSERT(close_to(eframe_stats_percentile(&stats, EFRAME_PHASE_FRAME, 99.0), 5 * MS));
+    EASSERT(eframe_stats_rolling_over_budget(&stats) == 0);
+    EASSERT(stats.over_budget == 100);
+    EASSERT(stats.phases[EFRAME_PHASE_FRAME].total.count == 300);
+
+    // phases roll on their own samples
+    EASSERT(close_to(eframe_stats_percentile(&stats, EFRAME_PHASE_RENDER, 50.0), 10 * MS));
+    EASSERT(eframe_stats_percentile(&stats, EFRAME_PHASE_PUMP, 50.0) == 0);
+
+    eframe_stats_report(&stats);
+}
+
+void frame_stats_tests() {
+    EINFO("-- frame_stats_tests");
+    frame_stats_test_histogram();
+    frame_stats_test_rolling();
+}
@@ -0,0 +1,6 @@
+#ifndef FRAME_STATS_TESTS_H
+#define FRAME_STATS_TESTS_H
+
+void frame_stats_tests();
+
+#endif // FRAME_STATS_TESTS_H
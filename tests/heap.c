@@ -3,6 +3,8 @@
 #include "../src/defines.h"
 #include "../src/assert.h"
 #include "../src/heap.h"
+#include "../src/memory.h"
+#include "../src/thread.h"
 
 #include <sys/mman.h>
 
@@ -82,10 +84,50 @@ static void heap_test_alloc_too_much() {
     munmap(memory, 133);
 }
 
+static void *alloc_thread(void *arg) {
+    u64 seed = (u64)arg;
+    void *blocks[16] = {0};
+    for(u32 i = 0; i < 20000; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        u32 slot = (seed >> 33) % 16;
+        efree(blocks[slot]);
+        blocks[slot] = ealloc(16 + (seed >> 50));
+        EASSERT(blocks[slot] != 0);
+        // overlapping blocks would overwrite each other's tag
+        *(u64 *)blocks[slot] = (u64)blocks[slot];
+        for(u32 j = 0; j < 16; ++j) {
+            EASSERT(!blocks[j] || *(u64 *)blocks[j] == (u64)blocks[j]);
+        }
+    }
+    for(u32 j = 0; j < 16; ++j) {
+        efree(blocks[j]);
+    }
+    return 0;
+}
+
+static void heap_test_shared() {
+    eheap heap = {0};
+    ememory_init(4 * 1024 * 1024, &heap);
+    u64 space = eheap_remaining_space(&heap);
+    ememory_set_shared(true);
+    ethread threads[4];
+    for(u64 i = 0; i < 4; ++i) {
+        EASSERT(ethread_create(alloc_thread, (void *)(i + 1), &threads[i]));
+    }
+    for(u32 i = 0; i < 4; ++i) {
+        ethread_join(&threads[i]);
+    }
+    ememory_set_shared(false);
+    // everything was given back
+    EASSERT(eheap_remaining_space(&heap) == space);
+    ememory_uninit();
+}
+
 void heap_tests() {
     EINFO("-- heap_tests");
     heap_test_create();
     heap_test_alloc();
     heap_test_alloc_many();
     heap_test_alloc_too_much();
+    heap_test_shared();
 }
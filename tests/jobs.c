@@ -0,0 +1,108 @@
+#include "jobs.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/memory.h"
+#include "../src/jobs.h"
+
+#define ITEM_COUNT 100000
+
+// too big for the stack
+static ejobs jobs;
+static u32 visits[ITEM_COUNT];
+
+static void visit_range(void *arg, u32 first, u32 count) {
+    u32 grain = *(u32 *)arg;
+    EASSERT(count <= grain);
+    for(u32 i = first; i < first + count; ++i) {
+        __atomic_add_fetch(&visits[i], 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void jobs_test_parallel_for() {
+    u32 grains[] = { 1, 64, 1000, ITEM_COUNT };
+    for(u32 g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g) {
+        for(u32 i = 0; i < ITEM_COUNT; ++i) {
+            visits[i] = 0;
+        }
+        ejob_counter counter = {0};
+        ejobs_parallel_for(&jobs, visit_range, &grains[g], ITEM_COUNT, grains[g], &counter);
+        ejobs_wait(&jobs, &counter);
+        EASSERT(counter.value == 0);
+        // every item exactly once
+        for(u32 i = 0; i < ITEM_COUNT; ++i) {
+            EASSERT(visits[i] == 1);
+        }
+    }
+}
+
+static u32 leaves;
+
+// each job submits two children until depth runs out
+static void spawn_tree(void *arg, u32 first, u32 count) {
+    u64 depth = (u64)arg;
+    if(depth == 0) {
+        __atomic_add_fetch(&leaves, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    ejob_counter children = {0};
+    ejobs_submit(&jobs, spawn_tree, (void *)(depth - 1), &children);
+    ejobs_submit(&jobs, spawn_tree, (void *)(depth - 1), &children);
+    // waiting inside a job helps instead of blocking the worker
+    ejobs_wait(&jobs, &children);
+}
+
+static void jobs_test_nested() {
+    leaves = 0;
+    ejob_counter counter = {0};
+    ejobs_submit(&jobs, spawn_tree, (void *)12, &counter);
+    ejobs_wait(&jobs, &counter);
+    EASSERT(leaves == 1 << 12);
+}
+
+static u32 outside_sum;
+
+static void add_one(void *arg, u32 first, u32 count) {
+    __atomic_add_fetch(&outside_sum, 1, __ATOMIC_RELAXED);
+}
+
+// submits from a thread that isn't a worker, through the shared queue
+static void *outside_thread(void *arg) {
+    ejob_counter counter = {0};
+    for(u32 i = 0; i < 10000; ++i) {
+        ejobs_submit(&jobs, add_one, 0, &counter);
+    }
+    ejobs_wait(&jobs, &counter);
+    return 0;
+}
+
+static void jobs_test_outside() {
+    outside_sum = 0;
+    ethread thread;
+    EASSERT(ethread_create(outside_thread, 0, &thread));
+    ethread_join(&thread);
+    EASSERT(outside_sum == 10000);
+}
+
+void jobs_tests() {
+    EINFO("-- jobs_tests");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+
+    // more workers than cores on purpose, stealing must hold up
+    EASSERT(ejobs_create(3, &jobs));
+    EASSERT(jobs.worker_count == 4);
+    jobs_test_parallel_for();
+    jobs_test_nested();
+    jobs_test_outside();
+    ejobs_destroy(&jobs);
+
+    // one per core
+    EASSERT(ejobs_create(0, &jobs));
+    EASSERT(jobs.worker_count == ethread_core_count());
+    jobs_test_parallel_for();
+    jobs_test_nested();
+    ejobs_destroy(&jobs);
+
+    ememory_uninit();
+}
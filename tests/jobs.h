@@ -0,0 +1,6 @@
+#ifndef JOBS_TESTS_H
+#define JOBS_TESTS_H
+
+void jobs_tests();
+
+#endif // JOBS_TESTS_H
@@ -0,0 +1,194 @@
+#include "log_binary.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/log_binary.h"
+#include "../src/log_format.h"
+#include "../src/thread.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LOG_PATH "build/test_log.blog"
+#define THREAD_RECORDS 1000
+
+static u8 file_data[1024 * 1024];
+static u64 file_size;
+
+static void read_log() {
+    FILE *file = fopen(LOG_PATH, "rb");
+    EASSERT(file != 0);
+    file_size = fread(file_data, 1, sizeof(file_data), file);
+    fclose(file);
+}
+
+// formats every record in order, into lines separated by '\n'
+static u32 decode_log(char *out, u64 capacity) {
+    const elog_binary_header *header = (const elog_binary_header *)file_data;
+    EASSERT(memcmp(header->magic, "EGGBLOG", 8) == 0);
+    EASSERT(header->header_size + header->used == file_size);
+
+    const char *formats[64] = { 0 };
+    u64 end = header->header_size + header->used;
+    for(u64 offset = header->header_size; offset < end; ) {
+        const elog_binary_site_record *site = (const elog_binary_site_record *)(file_data + offset);
+        if(site->id & ELOG_BINARY_SITE) {
+            formats[site->id & ELOG_BINARY_ID_MASK] = (const char *)(site + 1) + site->file_length + 1;
+        }
+        offset += site->size;
+    }
+
+    u32 count = 0;
+    u64 length = 0;
+    for(u64 offset = header->header_size; offset < end; ) {
+        const elog_binary_record *record = (const elog_binary_record *)(file_data + offset);
+        if(!(record->id & ELOG_BINARY_SITE)) {
+            const char *format = formats[record->id & ELOG_BINARY_ID_MASK];
+            EASSERT(format != 0);
+            length += elog_format_args(format, (const u8 *)(record + 1), record->size - sizeof(elog_binary_record), out + length, capacity - length - 1);
+            out[length++] = '\n';
+            ++count;
+        }
+        offset += record->size;
+    }
+    out[length] = 0;
+    return count;
+}
+
+static void log_binary_test_records() {
+    static char text[64 * 1024];
+    EASSERT(elog_binary_open(LOG_PATH, 0));
+    char interface[] = { 'w', 'l', '_', 's', 'h', 'm', '!', '!' };
+    for(u32 i = 0; i < 3; ++i) {
+        ETRACE("<- wl_registry@%u.global: name=%u interface=%.*s version=%u", 2, i, 6, interface, 1);
+    }
+    ETRACE("<- wl_output@%u.mode: refresh=%d scale=%.2f", 7, -60000, 1.5);
+    // more arguments than a layout holds, packed from the format
+    ETRACE("%u%u%u%u%u%u%u%u%u%u%u%u%u%u%u%u%u", 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7);
+    elog_binary_close();
+    EASSERT(!elog_binary_enabled);
+
+    read_log();
+    // a site record per call site, the strings are copied up to their precision
+    EASSERT(decode_log(text, sizeof(text)) == 5);
+    EASSERT(strcmp(text,
+        "<- wl_registry@2.global: name=0 interface=wl_shm version=1\n"
+        "<- wl_registry@2.global: name=1 interface=wl_shm version=1\n"
+        "<- wl_registry@2.global: name=2 interface=wl_shm version=1\n"
+        "<- wl_output@7.mode: refresh=-60000 scale=1.50\n"
+        "12345678901234567\n") == 0);
+
+    // a new log defines its sites again
+    EASSERT(elog_binary_open(LOG_PATH, 0));
+    ETRACE("<- wl_output@%u.done", 7);
+    elog_binary_close();
+    read_log();
+    EASSERT(decode_log(text, sizeof(text)) == 1);
+    EASSERT(strcmp(text, "<- wl_output@7.done\n") == 0);
+
+    // past its capacity the log drops records
+    EASSERT(elog_binary_open(LOG_PATH, 4096));
+    for(u32 i = 0; i < 1000; ++i) {
+        ETRACE("<- wl_buffer@%u.release", i);
+    }
+    EASSERT(elog_binary_dropped() > 0);
+    elog_binary_close();
+    read_log();
+    EASSERT(file_size <= 4096);
+    EASSERT(decode_log(text, sizeof(text)) + elog_binary_dropped() == 1000);
+}
+
+static void *trace_thread(void *arg) {
+    u32 id = *(u32 *)arg;
+    for(u32 i = 0; i < THREAD_RECORDS; ++i) {
+        ETRACE("t%u %u", id, i);
+    }
+    return 0;
+}
+
+static void log_binary_test_threads() {
+    static char text[256 * 1024];
+    EASSERT(elog_binary_open(LOG_PATH, 0));
+    u32 ids[2] = { 0, 1 };
+    ethread threads[2];
+    for(u32 i = 0; i < 2; ++i) {
+        EASSERT(ethread_create(trace_thread, &ids[i], &threads[i]));
+    }
+    for(u32 i = 0; i < 2; ++i) {
+        ethread_join(&threads[i]);
+    }
+    elog_binary_close();
+
+    read_log();
+    EASSERT(decode_log(text, sizeof(text)) == 2 * THREAD_RECORDS);
+    // both threads share the site, each one's records stay in order
+    for(u32 t = 0; t < 2; ++t) {
+        char prefix[8];
+        snprintf(prefix, sizeof(prefix), "t%u ", t);
+        i64 last = -1;
+        u32 seen = 0;
+        for(const char *line = text; *line; line = strchr(line, '\n') + 1) {
+            if(strncmp(line, prefix, strlen(prefix)) == 0) {
+                i64 value;
+                sscanf(line + strlen(prefix), "%ld", &value);
+                EASSERT(value > last);
+                last = value;
+                ++seen;
+            }
+        }
+        EASSERT(seen == THREAD_RECORDS);
+    }
+    remove(LOG_PATH);
+}
+
+static void pack_both(const char *format, ...) {
+    static u8 expected[ELOG_BINARY_MAX_RECORD];
+    static u8 packed[ELOG_BINARY_MAX_RECORD];
+    elog_arg layout[ELOG_SITE_MAX_ARGS];
+    u32 count;
+    EASSERT(elog_parse_layout(format, layout, ELOG_SITE_MAX_ARGS, &count));
+
+    va_list args;
+    va_start(args, format);
+    va_list measured;
+    va_copy(measured, args);
+    va_list from_format;
+    va_copy(from_format, args);
+    u32 expected_size;
+    EASSERT(elog_pack_args(format, &from_format, expected, sizeof(expected), &expected_size));
+    u32 lengths[ELOG_SITE_MAX_ARGS];
+    u32 size = elog_measure_layout(layout, count, &measured, lengths);
+    memset(packed, 0xAA, sizeof(packed));
+    elog_pack_layout(layout, count, &args, lengths, packed);
+    va_end(from_format);
+    va_end(measured);
+    va_end(args);
+
+    EASSERT_MSG(size == expected_size && memcmp(packed, expected, size) == 0, "layout packing differs for %s", format);
+    EASSERT(packed[size] == 0xAA);
+}
+
+// the layout parsed once packs the same bytes as parsing the format each time
+static void log_binary_test_layout() {
+    pack_both("no arguments, 100%% literal");
+    pack_both("%d %u %x %c %i", -5, 4000000000u, 0xBEEF, 'z', 42);
+    pack_both("%hhd %hhu %hd %hu", -3, 250, -30000, 60000);
+    pack_both("%ld %llu %zu %jd %td", -7l, 1ull << 40, (size_t)9, (intmax_t)-11, (ptrdiff_t)13);
+    pack_both("%f %.2e %Lf", 1.5, -2.25, (long double)3.75);
+    pack_both("%p %s %s", (void *)0x1234, "hello", (char *)0);
+    pack_both("%.3s|%.*s|%.*s|%-*d", "truncated", 2, "ab cd", -1, "negative precision", 6, 77);
+    pack_both("%*.*f %s", 8, 3, 2.5, "after a star precision");
+
+    elog_arg layout[2];
+    u32 count;
+    EASSERT(!elog_parse_layout("%d %d %d", layout, 2, &count));
+}
+
+void log_binary_tests() {
+    EINFO("-- log_binary_tests");
+    log_binary_test_layout();
+    log_binary_test_records();
+    log_binary_test_threads();
+}
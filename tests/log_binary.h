@@ -0,0 +1,6 @@
+#ifndef LOG_BINARY_TESTS_H
+#define LOG_BINARY_TESTS_H
+
+void log_binary_tests();
+
+#endif // LOG_BINARY_TESTS_H
@@ -0,0 +1,221 @@
+#include "logger.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/logger.h"
+#include "../src/thread.h"
+#include "../src/clock.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define THREAD_MESSAGES 1000
+
+static struct {
+    char text[256 * 1024];
+    u64 length;
+    // output calls block while set
+    u8 blocked;
+    u8 entered;
+} capture;
+
+static void capture_output(void *user, u8 is_error, const char *text, u64 length) {
+    __atomic_store_n(&capture.entered, true, __ATOMIC_RELEASE);
+    while(__atomic_load_n(&capture.blocked, __ATOMIC_ACQUIRE)) {
+        ethread_yield();
+    }
+    if(capture.length + length < sizeof(capture.text)) {
+        memcpy(capture.text + capture.length, text, length);
+        capture.length += length;
+        capture.text[capture.length] = 0;
+    }
+}
+
+static void capture_reset() {
+    capture.length = 0;
+    capture.text[0] = 0;
+}
+
+static u32 count_lines(const char *prefix) {
+    u32 count = 0;
+    u64 prefix_length = strlen(prefix);
+    for(const char *line = capture.text; *line; ) {
+        if(strncmp(line, prefix, prefix_length) == 0) {
+            ++count;
+        }
+        const char *end = strchr(line, '\n');
+        line = end ? end + 1 : line + strlen(line);
+    }
+    return count;
+}
+
+#define EXPECT_FORMAT "%d %u %lld %llu %hhd %5.2f %s|%-4s| %*d %.*s %% %c %zu %x %lx %e"
+#define EXPECT_ARGS -42, 42u, -(1ll << 40), ~0ull, 300, 3.14159, "str", "ab", 6, 7, 3, "truncated", 'z', (size_t)123, 0xbeefu, 0xdeadbeefcafeul, 1e-9
+
+static void logger_test_formats() {
+    char expected[512];
+    u64 length = snprintf(expected, sizeof(expected), "INFO: " EXPECT_FORMAT "\n", EXPECT_ARGS);
+
+    // the writer formats exactly like printf
+    capture_reset();
+    EINFO(EXPECT_FORMAT, EXPECT_ARGS);
+    EASSERT(capture.length == length && strcmp(capture.text, expected) == 0);
+
+    EASSERT(elog_async_start());
+    capture_reset();
+    EINFO(EXPECT_FORMAT, EXPECT_ARGS);
+    elog_flush();
+    EASSERT(capture.length == length && strcmp(capture.text, expected) == 0);
+
+    // strings are copied, not referenced
+    char name[16];
+    strcpy(name, "before");
+    capture_reset();
+    EWARN("name=%s", name);
+    strcpy(name, "after");
+    elog_flush();
+    EASSERT(strstr(capture.text, "name=before\n") != 0);
+    EASSERT(strncmp(capture.text, "WARN(", 5) == 0);
+
+    // long strings are cut, huge records keep only their format
+    static char long_string[3 * ELOG_MAX_STRING];
+    memset(long_string, 'x', sizeof(long_string) - 1);
+    capture_reset();
+    EINFO("%s", long_string);
+    EINFO("%s %s %s %s %s", long_string, long_string, long_string, long_string, long_string);
+    elog_flush();
+    EASSERT(capture.length == 6 + ELOG_MAX_STRING + 1 + strlen("INFO: %s %s %s %s %s [arguments too large]\n"));
+
+    elog_async_stop();
+}
+
+typedef struct thread_context {
+    u32 id;
+} thread_context;
+
+static void *log_thread(void *arg) {
+    thread_context *context = arg;
+    for(u32 i = 0; i < THREAD_MESSAGES; ++i) {
+        EINFO("t%u %u", context->id, i);
+    }
+    return 0;
+}
+
+// messages of a thread are in order, none are lost without being counted
+static void check_thread(u32 id, u32 *seen) {
+    char prefix[32];
+    u64 prefix_length = snprintf(prefix, sizeof(prefix), "INFO: t%u ", id);
+    i64 last = -1;
+    *seen = 0;
+    for(const char *line = strstr(capture.text, prefix); line; line = strstr(line + 1, prefix)) {
+        i64 value;
+        sscanf(line + prefix_length, "%ld", &value);
+        EASSERT(value > last);
+        last = value;
+        ++*seen;
+    }
+}
+
+static void logger_test_threads() {
+    EASSERT(elog_async_start());
+    capture_reset();
+    u64 dropped = elog_dropped();
+
+    thread_context contexts[2] = { { 0 }, { 1 } };
+    ethread threads[2];
+    for(u32 i = 0; i < 2; ++i) {
+        EASSERT(ethread_create(log_thread, &contexts[i], &threads[i]));
+    }
+    for(u32 i = 0; i < 2; ++i) {
+        ethread_join(&threads[i]);
+    }
+    elog_flush();
+
+    u32 seen[2];
+    check_thread(0, &seen[0]);
+    check_thread(1, &seen[1]);
+    EASSERT(seen[0] + seen[1] + (elog_dropped() - dropped) == 2 * THREAD_MESSAGES);
+    elog_async_stop();
+}
+
+static void logger_test_drops() {
+    EASSERT(elog_async_start());
+    capture_reset();
+    u64 dropped = elog_dropped();
+
+    // stall the writer, the ring fills up and messages are dropped instead of blocking
+    __atomic_store_n(&capture.blocked, true, __ATOMIC_RELEASE);
+    __atomic_store_n(&capture.entered, false, __ATOMIC_RELEASE);
+    EINFO("first");
+    while(!__atomic_load_n(&capture.entered, __ATOMIC_ACQUIRE)) {
+        ethread_yield();
+    }
+    u32 sent = ELOG_RING_SIZE / 32;
+    for(u32 i = 0; i < sent; ++i) {
+        EINFO("message %u", i);
+    }
+    u64 lost = elog_dropped() - dropped;
+    EASSERT(lost > 0);
+    __atomic_store_n(&capture.blocked, false, __ATOMIC_RELEASE);
+    elog_flush();
+    EASSERT(count_lines("INFO: message ") + lost == sent);
+    // reported by the writer
+    EASSERT(count_lines("WARN: ") == 1);
+
+    // fatal messages flush what came before and are written at once
+    capture_reset();
+    EINFO("before fatal");
+    elog(LOG_LEVEL_FATAL, __FILE__, __LINE__, "not really");
+    EASSERT(strstr(capture.text, "INFO: before fatal\n") != 0);
+    EASSERT(strstr(capture.text, "not really\n") != 0);
+    elog_async_stop();
+}
+
+static u32 evaluated;
+
+static u32 expensive() {
+    return ++evaluated;
+}
+
+static void logger_test_levels() {
+    capture_reset();
+    evaluated = 0;
+    // runtime levels are checked before the arguments are evaluated
+    elog_set_level(ELOG_MODULE_CORE, LOG_LEVEL_WARN);
+    EINFO("hidden %u", expensive());
+    EWARN("shown %u", expensive());
+    EASSERT(evaluated == 1);
+    EASSERT(count_lines("INFO: hidden") == 0 && count_lines("WARN(") == 1);
+
+    EASSERT(elog_set_levels("debug"));
+    EASSERT(elog_set_levels("window=warn,memory=error"));
+    EASSERT(elog_levels[ELOG_MODULE_WINDOW] == LOG_LEVEL_WARN);
+    EASSERT(elog_levels[ELOG_MODULE_MEMORY] == LOG_LEVEL_ERROR);
+    EASSERT(elog_levels[ELOG_MODULE_CORE] == LOG_LEVEL_DEBUG);
+    EASSERT(!elog_set_levels("window=loud"));
+    EASSERT(!elog_set_levels("sound=info"));
+    EASSERT(elog_set_levels("debug"));
+
+    // one message per interval, the rest counted and reported with the next one
+    capture_reset();
+    evaluated = 0;
+    for(u32 round = 0; round < 2; ++round) {
+        for(u32 i = 0; i < 100; ++i) {
+            EWARN_LIMITED(20, "limited %u", expensive());
+        }
+        eclock_sleep_ns(30 * 1000000ull);
+    }
+    EASSERT(evaluated == 2);
+    EASSERT(count_lines("WARN(") == 3);
+    EASSERT(strstr(capture.text, "99 similar messages suppressed") != 0);
+}
+
+void logger_tests() {
+    EINFO("-- logger_tests");
+    elog_set_output(capture_output, 0);
+    logger_test_formats();
+    logger_test_threads();
+    logger_test_drops();
+    logger_test_levels();
+    elog_set_output(0, 0);
+}
@@ -0,0 +1,6 @@
+#ifndef LOGGER_TESTS_H
+#define LOGGER_TESTS_H
+
+void logger_tests();
+
+#endif // LOGGER_TESTS_H
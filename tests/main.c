@@ -3,6 +3,24 @@
 #include "llist.h"
 #include "memlist.h"
 #include "heap.h"
+#include "ecs.h"
+#include "ecs_cmd.h"
+#include "scheduler.h"
+#include "spatial_hash.h"
+#include "bvh.h"
+#include "collision.h"
+#include "timestep.h"
+#include "render_state.h"
+#include "jobs.h"
+#include "profiler.h"
+#include "frame_stats.h"
+#include "logger.h"
+#include "log_binary.h"
+#include "renderer.h"
+#include "swapchain.h"
+#include "event_loop.h"
+#include "wl_connection.h"
+#include "wl_objects.h"
 
 int main(void) {
     EINFO("Starting tests");
@@ -10,6 +28,24 @@ int main(void) {
     llist_tests();
     memlist_tests();
     heap_tests();
+    ecs_tests();
+    ecs_cmd_tests();
+    scheduler_tests();
+    spatial_hash_tests();
+    bvh_tests();
+    collision_tests();
+    timestep_tests();
+    render_state_tests();
+    jobs_tests();
+    profiler_tests();
+    frame_stats_tests();
+    logger_tests();
+    log_binary_tests();
+    renderer_tests();
+    swapchain_tests();
+    event_loop_tests();
+    wl_connection_tests();
+    wl_objects_tests();
 
     EINFO("Successfully finished tests");
 
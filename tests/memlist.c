@@ -5,14 +5,14 @@
 #include "../src/memlist.h"
 
 static void memlist_test_create() {
-    ememlist list;
+    ememlist list = {0};
     ememlist_create(64, &list);
     EASSERT(list.count == 1);
     ememlist_destroy(&list);
 }
 
 static void memlist_test_allocate() {
-    ememlist list;
+    ememlist list = {0};
     ememlist_create(64, &list);
     u64 offset;
     u8 res;
@@ -28,7 +28,7 @@ static void memlist_test_allocate() {
 }
 
 static void memlist_test_allocate_many() {
-    ememlist list;
+    ememlist list = {0};
     ememlist_create(64, &list);
     u8 res;
 
@@ -0,0 +1,104 @@
+// zones are compiled out otherwise
+#define EPROFILE_MODE
+
+#include "profiler.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/memory.h"
+#include "../src/thread.h"
+#include "../src/profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void busy_wait(u64 ns) {
+    u64 end = eclock_now_ns() + ns;
+    while(eclock_now_ns() < end);
+}
+
+static void child_zone() {
+    EPROFILE_SCOPE("child");
+    busy_wait(200000);
+}
+
+static void *worker_zone(void *arg) {
+    EPROFILE_SCOPE("worker");
+    busy_wait(100000);
+    return 0;
+}
+
+static eprofile_zone_summary *find_zone(eprofile_zone_summary *zones, u32 count, const char *name) {
+    for(u32 i = 0; i < count; ++i) {
+        if(strcmp(zones[i].name, name) == 0) {
+            return &zones[i];
+        }
+    }
+    return 0;
+}
+
+static void profiler_test_frame() {
+    // before the first frame: not summarized
+    EPROFILE_BEGIN("stale");
+    EPROFILE_END();
+    EPROFILE_FRAME();
+
+    EPROFILE_BEGIN("parent");
+    child_zone();
+    child_zone();
+    EPROFILE_END();
+
+    ethread worker;
+    EASSERT(ethread_create(worker_zone, 0, &worker));
+    ethread_join(&worker);
+    EPROFILE_FRAME();
+
+    eprofile_zone_summary zones[EPROFILE_MAX_SUMMARY];
+    u32 count = eprofile_frame_summary(zones, EPROFILE_MAX_SUMMARY);
+    EASSERT(count == 3);
+    EASSERT(find_zone(zones, count, "stale") == 0);
+
+    eprofile_zone_summary *parent = find_zone(zones, count, "parent");
+    eprofile_zone_summary *child = find_zone(zones, count, "child");
+    EASSERT(parent && child && find_zone(zones, count, "worker"));
+    EASSERT(parent->depth == 0 && parent->calls == 1);
+    EASSERT(child->depth == 1 && child->calls == 2);
+    // ordered top-down and nested in time
+    EASSERT(parent < child);
+    EASSERT(parent->total >= child->total);
+}
+
+static void profiler_test_export() {
+    const char *path = "build/test_trace.json";
+    EASSERT(eprofile_export_chrome(path));
+
+    FILE *file = fopen(path, "r");
+    EASSERT(file != 0);
+    char content[4096] = "";
+    fread(content, 1, sizeof(content) - 1, file);
+    fclose(file);
+    remove(path);
+
+    EASSERT(strncmp(content, "{\"displayTimeUnit\"", 18) == 0);
+    EASSERT(strstr(content, "{\"name\":\"child\",\"ph\":\"X\"") != 0);
+    EASSERT(strstr(content, "\"name\":\"worker\"") != 0);
+}
+
+void profiler_tests() {
+    EINFO("-- profiler_tests");
+    eheap heap = {0};
+    // room for every thread ring
+    ememory_init(32 * 1024 * 1024, &heap);
+
+    // nothing is recorded before init
+    EPROFILE_BEGIN("ignored");
+    EPROFILE_END();
+
+    EASSERT(eprofile_init());
+    profiler_test_frame();
+    profiler_test_export();
+    eprofile_shutdown();
+
+    ememory_uninit();
+}
@@ -0,0 +1,6 @@
+#ifndef PROFILER_TESTS_H
+#define PROFILER_TESTS_H
+
+void profiler_tests();
+
+#endif // PROFILER_TESTS_H
@@ -0,0 +1,115 @@
+#include "render_state.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/memory.h"
+#include "../src/thread.h"
+#include "../src/render_state.h"
+#include "../src/ecs_registry.h"
+
+#define STRESS_FRAMES 200000
+
+static escene scene;
+static erender_state state;
+
+static void render_state_test_buffers() {
+    erender_state_create(&state);
+
+    // nothing published yet: still a valid snapshot
+    const erender_snapshot *read = erender_state_read(&state);
+    EASSERT(read->tick == 0);
+
+    erender_state_write(&state)->tick = 1;
+    erender_state_publish(&state, 10);
+    erender_state_write(&state)->tick = 2;
+    erender_state_publish(&state, 20);
+    // the writer never gets the buffer being read
+    EASSERT(erender_state_write(&state) != read);
+
+    // only the latest one is seen, and it stays until something new is published
+    read = erender_state_read(&state);
+    EASSERT(read->tick == 2 && read->time_ns == 20);
+    EASSERT(erender_state_read(&state) == read);
+    EASSERT(erender_state_write(&state) != read);
+
+    erender_state_write(&state)->tick = 3;
+    erender_state_publish(&state, 30);
+    EASSERT(erender_state_read(&state)->tick == 3);
+
+    erender_state_destroy(&state);
+}
+
+static void *stress_writer(void *arg) {
+    for(u32 frame = 1; frame <= STRESS_FRAMES; ++frame) {
+        erender_snapshot *snapshot = erender_state_write(&state);
+        snapshot->tick = frame;
+        snapshot->camera_x = frame;
+        snapshot->camera_y = -(i32)frame;
+        erender_state_publish(&state, frame);
+    }
+    return 0;
+}
+
+static void render_state_test_threads() {
+    erender_state_create(&state);
+    ethread writer;
+    EASSERT(ethread_create(stress_writer, 0, &writer));
+
+    u32 last = 0;
+    while(last < STRESS_FRAMES) {
+        const erender_snapshot *snapshot = erender_state_read(&state);
+        // never torn, never older than what was already seen
+        EASSERT(snapshot->tick >= last);
+        EASSERT(snapshot->camera_x == (i32)snapshot->tick && snapshot->camera_y == -(i32)snapshot->tick);
+        last = snapshot->tick;
+    }
+
+    ethread_join(&writer);
+    erender_state_destroy(&state);
+}
+
+static void render_state_test_extract() {
+    scene = (escene){0};
+    ecs_register_components(&scene);
+    scene.bg_asset_id = 7;
+    scene.camera_x = 5;
+    for(u32 i = 0; i < 300; ++i) {
+        u32 entity = ecs_entity_create(&scene, 0);
+        if(i % 2) {
+            ecs_entity_add_component(&scene, entity, ECS_ID(sprite_c));
+            ECS_MUT(&scene, sprite_c, entity)->asset_id = i;
+        }
+        if(i % 3 == 0) {
+            ecs_entity_add_component(&scene, entity, ECS_ID(position_c));
+            ECS_MUT(&scene, position_c, entity)->x = i;
+        }
+    }
+
+    erender_state_create(&state);
+    erender_extract(&scene, erender_state_write(&state));
+    erender_state_publish(&state, 0);
+    const erender_snapshot *snapshot = erender_state_read(&state);
+    EASSERT(snapshot->bg_asset_id == 7 && snapshot->camera_x == 5);
+    EASSERT(snapshot->sprite_count == 150);
+    EASSERT(snapshot->sprites[1].asset_id == 3 && snapshot->sprites[1].x == 3);
+    EASSERT(snapshot->sprites[2].asset_id == 5 && snapshot->sprites[2].x == 0);
+
+    // later scene changes don't show up in the published snapshot
+    ECS_MUT(&scene, position_c, 3)->x = 46;
+    EASSERT(snapshot->sprites[1].x == 3);
+
+    erender_state_destroy(&state);
+    ecs_scene_release(&scene);
+}
+
+void render_state_tests() {
+    EINFO("-- render_state_tests");
+    eheap heap = {0};
+    ememory_init(4 * 1024 * 1024, &heap);
+
+    render_state_test_buffers();
+    render_state_test_threads();
+    render_state_test_extract();
+
+    ememory_uninit();
+}
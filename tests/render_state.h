@@ -0,0 +1,6 @@
+#ifndef RENDER_STATE_TESTS_H
+#define RENDER_STATE_TESTS_H
+
+void render_state_tests();
+
+#endif // RENDER_STATE_TESTS_H
@@ -0,0 +1,500 @@
+#include "renderer.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/asset.h"
+#include "../src/bvh.h"
+#include "../src/ecs_registry.h"
+#include "../src/jobs.h"
+#include "../src/logger.h"
+#include "../src/memory.h"
+#include "../src/renderer.h"
+#include "../src/scene.h"
+#include "../src/window.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLEND_PIXELS 67
+#define SENTINEL 0xDEADBEEF
+// not a multiple of the tile size, rows padded
+#define TILES_WIDTH 200
+#define TILES_HEIGHT 150
+#define TILES_STRIDE 208
+#define TILE_DRAWS 300
+
+static u32 target_pixels[TILES_STRIDE * TILES_HEIGHT];
+static u32 expected_pixels[TILES_STRIDE * TILES_HEIGHT];
+static ejobs jobs;
+
+static u32 random_premultiplied() {
+    u32 a = rand() % 4 == 0 ? 255 : rand() % 4 == 0 ? 0 : rand() % 256;
+    u32 r = a ? rand() % (a + 1) : 0;
+    u32 g = a ? rand() % (a + 1) : 0;
+    u32 b = a ? rand() % (a + 1) : 0;
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// src over dst, rounded to nearest
+static u32 reference_blend(u32 s, u32 d) {
+    u32 a = 255 - (s >> 24);
+    u32 out = 0;
+    for(u32 shift = 0; shift < 32; shift += 8) {
+        u32 channel = ((s >> shift) & 0xFF) + (((d >> shift) & 0xFF) * a + 127) / 255;
+        out |= channel << shift;
+    }
+    return out;
+}
+
+static void set_target(u32 width, u32 height, u32 stride) {
+    for(u32 i = 0; i < sizeof(target_pixels) / sizeof(u32); ++i) {
+        target_pixels[i] = SENTINEL;
+    }
+    erender_target target = { .pixels = target_pixels, .width = width, .height = height, .stride = stride };
+    renderer_set_target(&target);
+}
+
+static void renderer_test_blend() {
+    u32 src[BLEND_PIXELS];
+    u32 dst[BLEND_PIXELS];
+    eimage image = { .width = BLEND_PIXELS, .height = 1, .pixels = src, .opaque = false };
+
+    erender_backend best = renderer_get_backend();
+    for(u32 backend = ERENDER_BACKEND_SCALAR; backend <= ERENDER_BACKEND_AVX2; ++backend) {
+        if(!renderer_set_backend(backend)) {
+            continue;
+        }
+        srand(42);
+        for(u32 round = 0; round < 64; ++round) {
+            // every length to go through the vector loops and their tails
+            u32 count = 1 + round % BLEND_PIXELS;
+            for(u32 i = 0; i < BLEND_PIXELS; ++i) {
+                src[i] = random_premultiplied();
+                dst[i] = random_premultiplied();
+            }
+            // runs of opaque and empty pixels take shortcuts
+            if(round % 3 == 0) {
+                for(u32 i = 0; i < 16; ++i) {
+                    src[i] = round % 2 ? 0 : src[i] | 0xFF000000;
+                }
+            }
+            set_target(BLEND_PIXELS, 1, BLEND_PIXELS);
+            memcpy(target_pixels, dst, sizeof(dst));
+            image.width = count;
+            EASSERT(renderer_draw_image(&image, 0, 0, count, 1));
+            renderer_flush();
+            for(u32 i = 0; i < count; ++i) {
+                EASSERT(target_pixels[i] == reference_blend(src[i], dst[i]));
+            }
+            for(u32 i = count; i < BLEND_PIXELS; ++i) {
+                EASSERT(target_pixels[i] == dst[i]);
+            }
+        }
+    }
+    renderer_set_backend(best);
+    renderer_set_target(0);
+}
+
+static void renderer_test_clip() {
+    u32 pixels[4 * 4];
+    for(u32 i = 0; i < 16; ++i) {
+        pixels[i] = 0xFF000000 | i;
+    }
+    eimage image = { .width = 4, .height = 4, .pixels = pixels, .opaque = true };
+
+    // no target, nothing to draw into
+    renderer_set_target(0);
+    EASSERT(!renderer_draw_image(&image, 0, 0, 4, 4));
+    EASSERT(!renderer_clear());
+
+    // 6x5 in rows of 8, the padding is never written
+    set_target(6, 5, 8);
+    EASSERT(renderer_clear());
+    EASSERT(renderer_draw_image(&image, -2, -1, 4, 4));
+    EASSERT(renderer_draw_image(&image, 4, 3, 4, 4));
+    renderer_flush();
+    for(u32 y = 0; y < 8; ++y) {
+        for(u32 x = 0; x < 8; ++x) {
+            u32 pixel = target_pixels[y * 8 + x];
+            if(x >= 6 || y >= 5) {
+                EASSERT(pixel == SENTINEL);
+            } else if(x < 2 && y < 3) {
+                EASSERT(pixel == (0xFF000000 | ((y + 1) * 4 + x + 2)));
+            } else if(x >= 4 && y >= 3) {
+                EASSERT(pixel == (0xFF000000 | ((y - 3) * 4 + x - 4)));
+            } else {
+                EASSERT(pixel == 0xFFF5F5F5);
+            }
+        }
+    }
+
+    // outside or empty: nothing drawn, not an error
+    EASSERT(renderer_draw_image(&image, 6, 0, 4, 4));
+    EASSERT(renderer_draw_image(&image, -4, 0, 4, 4));
+    EASSERT(renderer_draw_image(&image, 0x7FFFFFF0, 0, 0x7FFFFFFF, 4));
+    EASSERT(!renderer_draw_image(&image, 0, 0, 0, 4));
+    EASSERT(!renderer_draw_image(&image, 0, 0, 4, -1));
+    renderer_flush();
+    EASSERT(target_pixels[2 * 8 + 3] == 0xFFF5F5F5);
+    renderer_set_target(0);
+}
+
+static void expect_scaled(const eimage *image, i32 x, i32 y, u32 width, u32 height, u32 target_width, u32 target_height) {
+    for(u32 ty = 0; ty < target_height; ++ty) {
+        for(u32 tx = 0; tx < target_width; ++tx) {
+            i64 dx = (i64)tx - x, dy = (i64)ty - y;
+            if(dx < 0 || dy < 0 || dx >= width || dy >= height) {
+                continue;
+            }
+            u32 sx = ((2 * dx + 1) * image->width) / (2 * width);
+            u32 sy = ((2 * dy + 1) * image->height) / (2 * height);
+            EASSERT(target_pixels[ty * target_width + tx] == image->pixels[sy * image->width + sx]);
+        }
+    }
+}
+
+static void renderer_test_scaling() {
+    u32 pixels[3 * 2];
+    for(u32 i = 0; i < 6; ++i) {
+        pixels[i] = 0xFF000000 | (i * 0x111111);
+    }
+    eimage image = { .width = 3, .height = 2, .pixels = pixels, .opaque = true };
+
+    // integer factors repeat each pixel, clipped in the middle of a repeat
+    set_target(16, 8, 16);
+    EASSERT(renderer_draw_image(&image, -1, 1, 9, 4));
+    renderer_flush();
+    for(u32 y = 1; y < 5; ++y) {
+        for(u32 x = 0; x < 8; ++x) {
+            EASSERT(target_pixels[y * 16 + x] == pixels[(y - 1) / 2 * 3 + (x + 1) / 3]);
+        }
+    }
+    expect_scaled(&image, -1, 1, 9, 4, 16, 8);
+
+    // other factors sample the nearest pixel, down or up
+    set_target(16, 8, 16);
+    EASSERT(renderer_draw_image(&image, 2, 0, 5, 3));
+    renderer_flush();
+    expect_scaled(&image, 2, 0, 5, 3, 16, 8);
+    set_target(16, 8, 16);
+    EASSERT(renderer_draw_image(&image, -3, -2, 2, 7));
+    renderer_flush();
+    expect_scaled(&image, -3, -2, 2, 7, 16, 8);
+
+    // wider than a gather chunk
+    set_target(3000, 2, 3000);
+    EASSERT(renderer_draw_image(&image, 0, 0, 2999, 2));
+    renderer_flush();
+    expect_scaled(&image, 0, 0, 2999, 2, 3000, 2);
+    set_target(3000, 2, 3000);
+    EASSERT(renderer_draw_image(&image, -5, 0, 3003, 2));
+    renderer_flush();
+    expect_scaled(&image, -5, 0, 3003, 2, 3000, 2);
+
+    // translucent images are blended after scaling
+    pixels[0] = 0x80400000;
+    image.opaque = false;
+    set_target(16, 8, 16);
+    EASSERT(renderer_clear());
+    EASSERT(renderer_draw_image(&image, 0, 0, 6, 4));
+    renderer_flush();
+    EASSERT(target_pixels[0] == reference_blend(0x80400000, 0xFFF5F5F5));
+    EASSERT(target_pixels[16 + 1] == target_pixels[0]);
+    EASSERT(target_pixels[2] == pixels[1]);
+    renderer_set_target(0);
+}
+
+typedef struct test_draw {
+    const eimage *image;
+    i32 x;
+    i32 y;
+    i32 width;
+    i32 height;
+} test_draw;
+
+// one pixel at a time, in order
+static void reference_draw(const test_draw *draw) {
+    const eimage *image = draw->image;
+    for(i64 y = draw->y; y < (i64)draw->y + draw->height; ++y) {
+        for(i64 x = draw->x; x < (i64)draw->x + draw->width; ++x) {
+            if(x < 0 || y < 0 || x >= TILES_WIDTH || y >= TILES_HEIGHT) {
+                continue;
+            }
+            u32 sx = ((2 * (x - draw->x) + 1) * image->width) / (2 * draw->width);
+            u32 sy = ((2 * (y - draw->y) + 1) * image->height) / (2 * draw->height);
+            u32 *dst = &expected_pixels[y * TILES_STRIDE + x];
+            *dst = reference_blend(image->pixels[sy * image->width + sx], *dst);
+        }
+    }
+}
+
+static void renderer_test_tiles() {
+    static u32 opaque_pixels[24 * 24];
+    static u32 translucent_pixels[17 * 9];
+    for(u32 i = 0; i < 24 * 24; ++i) {
+        opaque_pixels[i] = random_premultiplied() | 0xFF000000;
+    }
+    for(u32 i = 0; i < 17 * 9; ++i) {
+        translucent_pixels[i] = random_premultiplied();
+    }
+    eimage opaque = { .width = 24, .height = 24, .pixels = opaque_pixels, .opaque = true };
+    eimage translucent = { .width = 17, .height = 9, .pixels = translucent_pixels, .opaque = false };
+
+    static test_draw draws[TILE_DRAWS];
+    EASSERT(ejobs_create(3, &jobs));
+    srand(43);
+    for(u32 round = 0; round < 4; ++round) {
+        // single threaded then on the workers, with and without a clear
+        renderer_set_jobs(round % 2 ? &jobs : 0);
+        u8 clear = round < 2;
+        for(u32 i = 0; i < TILE_DRAWS; ++i) {
+            test_draw *draw = &draws[i];
+            draw->image = rand() % 3 ? &translucent : &opaque;
+            draw->x = rand() % (TILES_WIDTH + 100) - 50;
+            draw->y = rand() % (TILES_HEIGHT + 100) - 50;
+            // mostly small, some covering whole tiles
+            u32 size = rand() % 8 == 0 ? 150 : 40;
+            draw->width = 1 + rand() % size;
+            draw->height = 1 + rand() % size;
+        }
+        // the untouched corner stays as it was without a clear
+        for(u32 i = 0; i < TILE_DRAWS && !clear; ++i) {
+            if(draws[i].x < 64 && draws[i].y + draws[i].height > 128) {
+                draws[i].y = 0;
+                draws[i].height = 64;
+            }
+        }
+
+        set_target(TILES_WIDTH, TILES_HEIGHT, TILES_STRIDE);
+        for(u32 i = 0; i < TILES_STRIDE * TILES_HEIGHT; ++i) {
+            expected_pixels[i] = SENTINEL;
+        }
+        if(clear) {
+            EASSERT(renderer_clear());
+            for(u32 y = 0; y < TILES_HEIGHT; ++y) {
+                for(u32 x = 0; x < TILES_WIDTH; ++x) {
+                    expected_pixels[y * TILES_STRIDE + x] = 0xFFF5F5F5;
+                }
+            }
+        }
+        for(u32 i = 0; i < TILE_DRAWS; ++i) {
+            EASSERT(renderer_draw_image(draws[i].image, draws[i].x, draws[i].y, draws[i].width, draws[i].height));
+            reference_draw(&draws[i]);
+        }
+        renderer_flush();
+        EASSERT(memcmp(target_pixels, expected_pixels, sizeof(expected_pixels)) == 0);
+        if(!clear) {
+            EASSERT(target_pixels[140 * TILES_STRIDE + 10] == SENTINEL);
+        }
+    }
+
+    // an opaque image over a whole tile hides what was drawn before
+    set_target(TILES_WIDTH, TILES_HEIGHT, TILES_STRIDE);
+    EASSERT(renderer_clear());
+    EASSERT(renderer_draw_image(&translucent, 0, 0, 100, 100));
+    EASSERT(renderer_draw_image(&opaque, 0, 0, 64, 64));
+    renderer_flush();
+    EASSERT(target_pixels[0] == opaque_pixels[0]);
+    EASSERT(target_pixels[63 * TILES_STRIDE + 63] == opaque_pixels[24 * 24 - 1]);
+
+    renderer_set_jobs(0);
+    renderer_set_target(0);
+    ejobs_destroy(&jobs);
+}
+
+static u32 damage_sprite_pixel = 0xFFFF0000;
+static eimage damage_sprite = { .width = 1, .height = 1, .pixels = &damage_sprite_pixel, .opaque = true };
+
+// a cleared frame with a sprite, into pixels poisoned to see what is rasterized
+static u32 damage_frame(u32 age, i32 sprite_x, const ewindow_rect **rects) {
+    for(u32 i = 0; i < sizeof(target_pixels) / sizeof(u32); ++i) {
+        target_pixels[i] = SENTINEL;
+    }
+    erender_target target = { .pixels = target_pixels, .width = TILES_WIDTH, .height = TILES_HEIGHT, .stride = TILES_STRIDE, .age = age };
+    renderer_set_target(&target);
+    EASSERT(renderer_clear());
+    EASSERT(renderer_draw_image(&damage_sprite, sprite_x, 70, 20, 20));
+    renderer_set_target(0);
+    return renderer_damage(rects);
+}
+
+static u32 pixel_at(u32 x, u32 y) {
+    return target_pixels[y * TILES_STRIDE + x];
+}
+
+static void renderer_test_damage() {
+    const ewindow_rect *rects;
+
+    // after the other tests, everything drawn and damaged
+    renderer_invalidate();
+    EASSERT(damage_frame(0, 10, &rects) == 1);
+    EASSERT(rects[0].x == 0 && rects[0].y == 0 && rects[0].width == TILES_WIDTH && rects[0].height == TILES_HEIGHT);
+    EASSERT(pixel_at(0, 0) == 0xFFF5F5F5 && pixel_at(10, 70) == damage_sprite_pixel);
+
+    // the same frame over the previous one, nothing to do
+    EASSERT(damage_frame(1, 10, &rects) == 0);
+    EASSERT(pixel_at(0, 0) == SENTINEL && pixel_at(10, 70) == SENTINEL);
+
+    // moved to the next tile: the two tiles merged in one rectangle
+    EASSERT(damage_frame(1, 100, &rects) == 1);
+    EASSERT(rects[0].x == 0 && rects[0].y == 64 && rects[0].width == 128 && rects[0].height == 64);
+    EASSERT(pixel_at(10, 70) == 0xFFF5F5F5 && pixel_at(100, 70) == damage_sprite_pixel);
+    EASSERT(pixel_at(0, 0) == SENTINEL && pixel_at(150, 70) == SENTINEL);
+
+    // a buffer from before the move still gets the moved tiles
+    EASSERT(damage_frame(2, 100, &rects) == 0);
+    EASSERT(pixel_at(10, 70) == 0xFFF5F5F5 && pixel_at(100, 70) == damage_sprite_pixel);
+    EASSERT(pixel_at(0, 0) == SENTINEL);
+    EASSERT(damage_frame(1, 100, &rects) == 0);
+    EASSERT(pixel_at(100, 70) == SENTINEL);
+
+    // unknown contents or older than the history, not damaged as it didn't change
+    EASSERT(damage_frame(0, 100, &rects) == 0);
+    EASSERT(pixel_at(0, 0) == 0xFFF5F5F5);
+    EASSERT(damage_frame(9, 100, &rects) == 0);
+    EASSERT(pixel_at(0, 0) == 0xFFF5F5F5);
+    renderer_invalidate();
+    EASSERT(damage_frame(1, 100, &rects) == 1);
+    EASSERT(rects[0].width == TILES_WIDTH && rects[0].height == TILES_HEIGHT && pixel_at(0, 0) == 0xFFF5F5F5);
+
+    // a flush during the frame draws everything
+    erender_target target = { .pixels = target_pixels, .width = TILES_WIDTH, .height = TILES_HEIGHT, .stride = TILES_STRIDE, .age = 1 };
+    target_pixels[0] = SENTINEL;
+    renderer_set_target(&target);
+    EASSERT(renderer_clear());
+    renderer_flush();
+    EASSERT(renderer_draw_image(&damage_sprite, 100, 70, 20, 20));
+    renderer_set_target(0);
+    EASSERT(renderer_damage(&rects) == 0);
+    EASSERT(pixel_at(0, 0) == 0xFFF5F5F5);
+
+    // a tile out of two changed on a long row: too many rectangles
+    u32 width = sizeof(target_pixels) / sizeof(u32) / 15;
+    target = (erender_target){ .pixels = target_pixels, .width = width, .height = 15, .stride = width, .age = 1 };
+    renderer_set_target(&target);
+    renderer_set_target(0);
+    renderer_set_target(&target);
+    for(u32 x = 0; x < width; x += 2 * ERENDER_TILE_SIZE) {
+        EASSERT(renderer_draw_image(&damage_sprite, x, 0, 1, 1));
+    }
+    renderer_set_target(0);
+    EASSERT((width + 2 * ERENDER_TILE_SIZE - 1) / (2 * ERENDER_TILE_SIZE) > ERENDER_MAX_DAMAGE_RECTS);
+    EASSERT(renderer_damage(&rects) == 1);
+    EASSERT(rects[0].x == 0 && rects[0].width == (i32)width && rects[0].height == 15);
+}
+
+static void write_file(const char *path, const void *data, u64 size) {
+    FILE *file = fopen(path, "wb");
+    EASSERT(file != 0);
+    EASSERT(fwrite(data, 1, size, file) == size);
+    fclose(file);
+}
+
+static void renderer_test_assets() {
+    // 2x1 RGBA, the second pixel half transparent
+    const char pam[] = "P7\nWIDTH 2\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n"
+        "\xFF\x80\x00\xFF" "\xFF\xFF\xFF\x80";
+    write_file("build/test_image.pam", pam, sizeof(pam) - 1);
+    // 1x2 RGB with a comment, maxval 15
+    const char ppm[] = "P6\n# comment\n1 2\n15\n" "\x0F\x00\x00" "\x00\x0F\x0F";
+    write_file("build/test_image.ppm", ppm, sizeof(ppm) - 1);
+    write_file("build/test_image.bad", "P3\n1 1\n255\n0 0 0\n", 18);
+
+    u32 pam_id = asset_register("build/test_image.pam", ASSET_TEXTURE);
+    u32 ppm_id = asset_register("build/test_image.ppm", ASSET_IMAGE);
+    u32 bad_id = asset_register("build/test_image.bad", ASSET_IMAGE);
+    asset_load(pam_id);
+    asset_load(ppm_id);
+    EINFO("*** following error is expected, do not take into account");
+    asset_load(bad_id);
+
+    eimage *image = asset_get_data(pam_id);
+    EASSERT(image && image->width == 2 && image->height == 1 && !image->opaque);
+    EASSERT(image->pixels[0] == 0xFFFF8000);
+    EASSERT(image->pixels[1] == 0x80808080);
+
+    image = asset_get_data(ppm_id);
+    EASSERT(image && image->width == 1 && image->height == 2 && image->opaque);
+    EASSERT(image->pixels[0] == 0xFFFF0000);
+    EASSERT(image->pixels[1] == 0xFF00FFFF);
+
+    image = asset_get_data(bad_id);
+    EASSERT(image && image->pixels == 0);
+
+    set_target(4, 4, 4);
+    EASSERT(renderer_draw_asset(ppm_id, 0, 0, 4, 4));
+    renderer_flush();
+    EASSERT(target_pixels[0] == 0xFFFF0000 && target_pixels[15] == 0xFF00FFFF);
+    EASSERT(!renderer_draw_asset(bad_id, 0, 0, 4, 4));
+    EASSERT(!renderer_draw_asset(4096, 0, 0, 4, 4));
+    renderer_set_target(0);
+
+    asset_unload(pam_id);
+    asset_unload(ppm_id);
+    EASSERT(((eimage *)asset_get_data(pam_id))->pixels == 0);
+}
+
+// too big for the stack
+static escene scene;
+
+// sprites created before the first tick advance, drawn through the BVH
+static void renderer_test_scene_bvh() {
+    scene = (escene){0};
+    ecs_register_components(&scene);
+    ebvh tree;
+    EASSERT(ebvh_create(16, 0, &tree));
+    scene.bvh = &tree;
+    // no background
+    scene.bg_asset_id = 4096;
+    u32 red_cyan = asset_register("build/test_image.ppm", ASSET_IMAGE);
+    asset_load(red_cyan);
+
+    u32 visible = ecs_entity_create(&scene, 0);
+    ecs_entity_add_component(&scene, visible, ECS_ID(sprite_c));
+    ECS_MUT(&scene, sprite_c, visible)->asset_id = red_cyan;
+    u32 hidden = ecs_entity_create(&scene, 0);
+    ecs_entity_add_component(&scene, hidden, ECS_ID(sprite_c));
+    ecs_entity_add_component(&scene, hidden, ECS_ID(position_c));
+    ECS_MUT(&scene, sprite_c, hidden)->asset_id = red_cyan;
+    *ECS_MUT(&scene, position_c, hidden) = (position_c){ .x = 1000, .y = 1000 };
+    EASSERT(scene.tick == 0);
+
+    set_target(128, 128, 128);
+    scene_render(&scene, 128, 128);
+    renderer_flush();
+    EASSERT(ebvh_query(&tree, (collision_box){ .x1 = -2000, .x2 = 2000, .y1 = -2000, .y2 = 2000 }, scene.query_buffer, 2) == 2);
+    // the top half of the sprite is red, the bottom half cyan, the rest untouched
+    EASSERT(target_pixels[10 * 128 + 10] == 0xFFFF0000 && target_pixels[50 * 128 + 10] == 0xFF00FFFF);
+    EASSERT(target_pixels[10 * 128 + 100] == SENTINEL);
+
+    // later syncs only follow the changes
+    ecs_advance_tick(&scene);
+    *ECS_MUT(&scene, position_c, hidden) = (position_c){ .x = 64, .y = 0 };
+    set_target(128, 128, 128);
+    scene_render(&scene, 128, 128);
+    renderer_flush();
+    EASSERT(target_pixels[10 * 128 + 10] == 0xFFFF0000 && target_pixels[10 * 128 + 100] == 0xFFFF0000);
+    renderer_set_target(0);
+
+    asset_unload(red_cyan);
+    ebvh_destroy(&tree);
+    ecs_scene_release(&scene);
+}
+
+void renderer_tests() {
+    EINFO("-- renderer_tests");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+
+    renderer_test_blend();
+    renderer_test_clip();
+    renderer_test_scaling();
+    renderer_test_assets();
+    renderer_test_scene_bvh();
+    renderer_test_tiles();
+    renderer_test_damage();
+
+    renderer_shutdown();
+    ememory_uninit();
+}
@@ -0,0 +1,6 @@
+#ifndef RENDERER_TESTS_H
+#define RENDERER_TESTS_H
+
+void renderer_tests();
+
+#endif // RENDERER_TESTS_H
@@ -0,0 +1,162 @@
+#include "scheduler.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/memory.h"
+#include "../src/scheduler.h"
+
+#define FRAME_COUNT 1000
+
+// too big for the stack
+static ejobs jobs;
+static ecs_scheduler scheduler;
+static escene scene;
+
+static u32 runs[ECS_MAX_SYSTEMS];
+static u32 order[ECS_MAX_SYSTEMS];
+static u32 next_order;
+
+static void count_run(escene *scene, u32 *entities, u32 count, void *user) {
+    u32 system = (u32)(u64)user;
+    __atomic_add_fetch(&runs[system], 1, __ATOMIC_RELAXED);
+    order[system] = __atomic_add_fetch(&next_order, 1, __ATOMIC_RELAXED);
+}
+
+static u32 add_system(u64 reads, u64 writes) {
+    ecs_system_desc desc = { .reads = reads, .writes = writes, .run = count_run, .user = (void *)(u64)scheduler.system_count };
+    return ecs_system_register(&scheduler, &desc);
+}
+
+static void scheduler_test_submit_once() {
+    scene = (escene){0};
+    ecs_scheduler_create(&jobs, &scheduler);
+    // the dependent comes after many roots, so the writer is usually done
+    // and has released it before the root loop gets there
+    add_system(0, ECS_BIT(0));
+    for(u32 i = 0; i < 30; ++i) {
+        add_system(ECS_BIT(1), 0);
+    }
+    u32 dependent = add_system(ECS_BIT(0), 0);
+
+    for(u32 frame = 0; frame < FRAME_COUNT; ++frame) {
+        for(u32 i = 0; i < scheduler.system_count; ++i) {
+            runs[i] = 0;
+        }
+        ecs_scheduler_run(&scheduler, &scene);
+        for(u32 i = 0; i < scheduler.system_count; ++i) {
+            EASSERT_MSG(runs[i] == 1, "system %u ran %u times", i, runs[i]);
+        }
+        EASSERT(scheduler.systems[dependent].remaining == 0);
+    }
+
+    ecs_scheduler_destroy(&scheduler);
+    ecs_scene_release(&scene);
+}
+
+static void scheduler_test_order() {
+    scene = (escene){0};
+    ecs_scheduler_create(&jobs, &scheduler);
+    // 0 -> 1 -> 2 through conflicting accesses, 3 conflicts with nothing
+    u32 write_a = add_system(0, ECS_BIT(0));
+    u32 read_a_write_b = add_system(ECS_BIT(0), ECS_BIT(1));
+    u32 read_b = add_system(ECS_BIT(1), 0);
+    u32 unrelated = add_system(ECS_BIT(2), 0);
+    // two readers of the same component don't depend on each other
+    u32 other_read_b = add_system(ECS_BIT(1), 0);
+
+    for(u32 frame = 0; frame < FRAME_COUNT; ++frame) {
+        ecs_scheduler_run(&scheduler, &scene);
+        EASSERT(order[write_a] < order[read_a_write_b]);
+        EASSERT(order[read_a_write_b] < order[read_b]);
+        EASSERT(order[read_a_write_b] < order[other_read_b]);
+    }
+    EASSERT(scheduler.systems[unrelated].dependencies == 0);
+    EASSERT(scheduler.systems[read_b].dependencies == ECS_BIT(read_a_write_b));
+    EASSERT(scheduler.systems[other_read_b].dependencies == ECS_BIT(read_a_write_b));
+
+    ecs_scheduler_destroy(&scheduler);
+    ecs_scene_release(&scene);
+}
+
+static u32 seen[ECS_MAX_SYSTEMS];
+
+static void count_seen(escene *scene, u32 *entities, u32 count, void *user) {
+    __atomic_add_fetch(&seen[(u64)user], count, __ATOMIC_RELAXED);
+}
+
+static void write_third(escene *scene, u32 *entities, u32 count, void *user) {
+    *(u32 *)ecs_get_component_mut(scene, 3, 0, sizeof(u32)) += 1;
+}
+
+static void write_seen(escene *scene, u32 *entities, u32 count, void *user) {
+    count_seen(scene, entities, count, user);
+    for(u32 i = 0; i < count; ++i) {
+        *(u32 *)ecs_get_component_mut(scene, entities[i], 0, sizeof(u32)) += 1;
+    }
+}
+
+static void scheduler_test_changed() {
+    scene = (escene){0};
+    ecs_component_create(&scene, 0, sizeof(u32), _Alignof(u32));
+    // added before the first tick advance
+    for(u32 i = 0; i < 10; ++i) {
+        ecs_entity_add_component(&scene, ecs_entity_create(&scene, 0), 0);
+    }
+
+    ecs_scheduler_create(&jobs, &scheduler);
+    // runs in this order: every system conflicts with the previous one
+    ecs_system_desc early = { .query = ECS_BIT(0), .changed = ECS_BIT(0), .run = count_seen, .user = (void *)0 };
+    ecs_system_desc writer = { .writes = ECS_BIT(0), .run = write_third };
+    ecs_system_desc self = { .query = ECS_BIT(0), .changed = ECS_BIT(0), .writes = ECS_BIT(0), .run = write_seen, .user = (void *)2 };
+    ecs_system_desc late = { .query = ECS_BIT(0), .changed = ECS_BIT(0), .run = count_seen, .user = (void *)3 };
+    ecs_system_register(&scheduler, &early);
+    ecs_system_register(&scheduler, &writer);
+    ecs_system_register(&scheduler, &self);
+    ecs_system_register(&scheduler, &late);
+
+    // early, self, late: 1 changed entity per frame unless noted
+    u32 expected[][3] = {
+        // first runs see everything
+        { 10, 10, 10 },
+        // self wrote everything after early ran
+        { 10, 1, 1 },
+        { 1, 1, 1 },
+        // entity 7 written between the runs
+        { 2, 2, 2 },
+        { 2, 1, 1 },
+        { 1, 1, 1 },
+    };
+    for(u32 frame = 0; frame < sizeof(expected) / sizeof(expected[0]); ++frame) {
+        if(frame == 3) {
+            *(u32 *)ecs_get_component_mut(&scene, 7, 0, sizeof(u32)) += 1;
+        }
+        seen[0] = seen[2] = seen[3] = 0;
+        ecs_scheduler_run(&scheduler, &scene);
+        EASSERT_MSG(seen[0] == expected[frame][0] && seen[2] == expected[frame][1] && seen[3] == expected[frame][2],
+                    "frame %u: seen %u %u %u", frame, seen[0], seen[2], seen[3]);
+    }
+
+    // a disabled system sees what it missed once enabled again
+    ecs_system_set_enabled(&scheduler, 3, false);
+    ecs_scheduler_run(&scheduler, &scene);
+    ecs_scheduler_run(&scheduler, &scene);
+    ecs_system_set_enabled(&scheduler, 3, true);
+    seen[3] = 0;
+    ecs_scheduler_run(&scheduler, &scene);
+    EASSERT(seen[3] == 1);
+
+    ecs_scheduler_destroy(&scheduler);
+    ecs_scene_release(&scene);
+}
+
+void scheduler_tests() {
+    EINFO("-- scheduler_tests");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+    EASSERT(ejobs_create(3, &jobs));
+    scheduler_test_submit_once();
+    scheduler_test_order();
+    scheduler_test_changed();
+    ejobs_destroy(&jobs);
+    ememory_uninit();
+}
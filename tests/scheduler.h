@@ -0,0 +1,6 @@
+#ifndef SCHEDULER_TESTS_H
+#define SCHEDULER_TESTS_H
+
+void scheduler_tests();
+
+#endif // SCHEDULER_TESTS_H
@@ -0,0 +1,115 @@
+#include "spatial_hash.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/spatial_hash.h"
+#include "../src/memory.h"
+
+#include <stdlib.h>
+
+#define BOX_COUNT 512
+
+static collision_box boxes[BOX_COUNT];
+static espatial_pair pairs[BOX_COUNT * BOX_COUNT / 2];
+
+static collision_box random_box(i32 world, i32 max_size) {
+    i32 x = rand() % world - world / 4;
+    i32 y = rand() % world - world / 4;
+    return (collision_box){ .x1 = x, .x2 = x + 1 + rand() % max_size, .y1 = y, .y2 = y + 1 + rand() % max_size };
+}
+
+static u32 brute_force_pairs() {
+    u32 count = 0;
+    for(u32 a = 0; a < BOX_COUNT; ++a) {
+        for(u32 b = a + 1; b < BOX_COUNT; ++b) {
+            count += collision_box_overlap(&boxes[a], &boxes[b]);
+        }
+    }
+    return count;
+}
+
+static void spatial_hash_test_overlap() {
+    collision_box a = { .x1 = 0, .x2 = 10, .y1 = 0, .y2 = 10 };
+    collision_box b = { .x1 = 10, .x2 = 20, .y1 = 0, .y2 = 10 };
+    collision_box c = { .x1 = 9, .x2 = 20, .y1 = 9, .y2 = 10 };
+    // touching edges don't overlap
+    EASSERT(!collision_box_overlap(&a, &b));
+    EASSERT(collision_box_overlap(&a, &c));
+}
+
+static void spatial_hash_test_pairs() {
+    espatial_hash hash;
+    EASSERT(espatial_hash_create(32, 1024, BOX_COUNT, &hash));
+
+    srand(46);
+    for(u32 i = 0; i < BOX_COUNT; ++i) {
+        boxes[i] = random_box(1024, 80);
+        espatial_hash_insert(&hash, i, boxes[i]);
+    }
+    u32 expected = brute_force_pairs();
+    EASSERT(expected > 0);
+    u32 count = espatial_hash_pairs(&hash, pairs, sizeof(pairs) / sizeof(pairs[0]));
+    EASSERT_MSG(count == expected, "found %u pairs, expected %u", count, expected);
+    for(u32 i = 0; i < count; ++i) {
+        EASSERT(pairs[i].a < pairs[i].b);
+        EASSERT(collision_box_overlap(&boxes[pairs[i].a], &boxes[pairs[i].b]));
+    }
+
+    // move a few boxes by small and big steps
+    for(u32 frame = 0; frame < 8; ++frame) {
+        for(u32 i = 0; i < BOX_COUNT; i += 3) {
+            i32 dx = rand() % 9 - 4, dy = rand() % 9 - 4;
+            if(i % 7 == 0) {
+                dx *= 50;
+            }
+            boxes[i].x1 += dx; boxes[i].x2 += dx;
+            boxes[i].y1 += dy; boxes[i].y2 += dy;
+            espatial_hash_update(&hash, i, boxes[i]);
+        }
+        EASSERT(espatial_hash_pairs(&hash, pairs, sizeof(pairs) / sizeof(pairs[0])) == brute_force_pairs());
+    }
+
+    // removed boxes don't collide anymore
+    espatial_hash_remove(&hash, 0);
+    boxes[0] = (collision_box){ .x1 = 1 << 20, .x2 = (1 << 20) + 1, .y1 = 0, .y2 = 1 };
+    EASSERT(espatial_hash_pairs(&hash, pairs, sizeof(pairs) / sizeof(pairs[0])) == brute_force_pairs());
+
+    espatial_hash_destroy(&hash);
+}
+
+static void spatial_hash_test_query() {
+    espatial_hash hash;
+    espatial_hash_create(64, 256, BOX_COUNT, &hash);
+
+    srand(47);
+    for(u32 i = 0; i < BOX_COUNT; ++i) {
+        boxes[i] = random_box(2048, 200);
+        espatial_hash_insert(&hash, i, boxes[i]);
+    }
+
+    u32 found[BOX_COUNT];
+    for(u32 q = 0; q < 32; ++q) {
+        collision_box region = random_box(2048, 600);
+        u32 expected = 0;
+        for(u32 i = 0; i < BOX_COUNT; ++i) {
+            expected += collision_box_overlap(&region, &boxes[i]);
+        }
+        u32 count = espatial_hash_query(&hash, region, found, BOX_COUNT);
+        EASSERT_MSG(count == expected, "found %u boxes, expected %u", count, expected);
+        for(u32 i = 0; i < count; ++i) {
+            EASSERT(collision_box_overlap(&region, &boxes[found[i]]));
+        }
+    }
+
+    espatial_hash_destroy(&hash);
+}
+
+void spatial_hash_tests() {
+    EINFO("-- spatial_hash_tests");
+    eheap heap = {0};
+    ememory_init(16 * 1024 * 1024, &heap);
+    spatial_hash_test_overlap();
+    spatial_hash_test_pairs();
+    spatial_hash_test_query();
+    ememory_uninit();
+}
@@ -0,0 +1,6 @@
+#ifndef SPATIAL_HASH_TESTS_H
+#define SPATIAL_HASH_TESTS_H
+
+void spatial_hash_tests();
+
+#endif // SPATIAL_HASH_TESTS_H
@@ -0,0 +1,96 @@
+#include "swapchain.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/logger.h"
+#include "../src/swapchain.h"
+
+// handles like wl_buffer ids
+static void add_buffers(eswapchain *swapchain, u32 count) {
+    for(u32 i = 0; i < count; ++i) {
+        u32 index;
+        EASSERT(eswapchain_add(swapchain, 100 + i, &index));
+        EASSERT(index == i);
+    }
+}
+
+static void swapchain_test_cycle() {
+    eswapchain swapchain;
+    eswapchain_init(64, ESWAP_DROP, &swapchain);
+    add_buffers(&swapchain, 2);
+    EASSERT(eswapchain_offset(&swapchain, 1) == 64);
+
+    u32 first, second, index;
+    EASSERT(eswapchain_acquire(&swapchain, &first) == ESWAPCHAIN_ACQUIRED);
+    eswapchain_submit(&swapchain, first);
+    EASSERT(eswapchain_acquire(&swapchain, &second) == ESWAPCHAIN_ACQUIRED);
+    EASSERT(second != first);
+    eswapchain_submit(&swapchain, second);
+
+    // both held by the compositor
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_DROP);
+    EASSERT(swapchain.dropped == 1);
+
+    // presented 2 then 1 frames ago
+    EASSERT(eswapchain_age(&swapchain, first) == 2 && eswapchain_age(&swapchain, second) == 1);
+
+    // the last released comes back first
+    EASSERT(eswapchain_release(&swapchain, swapchain.buffers[first].handle));
+    EASSERT(eswapchain_release(&swapchain, swapchain.buffers[second].handle));
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_ACQUIRED && index == second);
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_ACQUIRED && index == first);
+    EASSERT(swapchain.frames == 4);
+
+    // unknown handles aren't ours, a second release doesn't free twice
+    EASSERT(!eswapchain_release(&swapchain, 42));
+    eswapchain_submit(&swapchain, first);
+    EASSERT(eswapchain_release(&swapchain, swapchain.buffers[first].handle));
+    EASSERT(eswapchain_release(&swapchain, swapchain.buffers[first].handle));
+    EASSERT(swapchain.free_count == 1);
+}
+
+static void swapchain_test_policies() {
+    eswapchain swapchain;
+    u32 index;
+
+    eswapchain_init(64, ESWAP_BLOCK, &swapchain);
+    add_buffers(&swapchain, 1);
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_ACQUIRED);
+    eswapchain_submit(&swapchain, index);
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_WAIT);
+    EASSERT(swapchain.waits == 1 && swapchain.dropped == 0);
+
+    // never drawn
+    eswapchain_init(64, ESWAP_BLOCK, &swapchain);
+    add_buffers(&swapchain, 1);
+    EASSERT(eswapchain_age(&swapchain, 0) == 0);
+
+    // cleared, not a frame: still nothing the renderer can reuse
+    eswapchain_init(64, ESWAP_BLOCK, &swapchain);
+    add_buffers(&swapchain, 2);
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_ACQUIRED);
+    eswapchain_submit(&swapchain, index);
+    u32 drawn = index;
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_ACQUIRED);
+    eswapchain_submit_blank(&swapchain, index);
+    EASSERT(eswapchain_release(&swapchain, 100) && eswapchain_release(&swapchain, 101));
+    EASSERT(eswapchain_age(&swapchain, index) == 0 && eswapchain_age(&swapchain, drawn) == 1);
+
+    // allocates until the pool is full, then drops
+    eswapchain_init(64, ESWAP_ALLOCATE, &swapchain);
+    for(u32 i = 0; i < ESWAPCHAIN_MAX_BUFFERS; ++i) {
+        EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_ALLOCATE);
+        EASSERT(eswapchain_add(&swapchain, 100 + i, &index));
+        EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_ACQUIRED && index == i);
+        eswapchain_submit(&swapchain, index);
+    }
+    EASSERT(!eswapchain_add(&swapchain, 200, &index));
+    EASSERT(eswapchain_acquire(&swapchain, &index) == ESWAPCHAIN_DROP);
+    EASSERT(swapchain.count == ESWAPCHAIN_MAX_BUFFERS && swapchain.dropped == 1);
+}
+
+void swapchain_tests() {
+    EINFO("-- swapchain_tests");
+    swapchain_test_cycle();
+    swapchain_test_policies();
+}
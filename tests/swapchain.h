@@ -0,0 +1,6 @@
+#ifndef SWAPCHAIN_TESTS_H
+#define SWAPCHAIN_TESTS_H
+
+void swapchain_tests();
+
+#endif // SWAPCHAIN_TESTS_H
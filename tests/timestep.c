@@ -0,0 +1,76 @@
+#include "timestep.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/clock.h"
+#include "../src/timestep.h"
+
+#define MS 1000000ull
+
+static void timestep_test_accumulator() {
+    etimestep_config config = { .step_ns = 10 * MS, .max_steps = 4 };
+    etimestep timestep;
+    etimestep_init(&config, 1000 * MS, &timestep);
+    EASSERT(timestep.config.frame_ns == 10 * MS);
+
+    // not a whole step yet
+    EASSERT(etimestep_advance(&timestep, 1004 * MS) == 0);
+    EASSERT(timestep.alpha > 0.39f && timestep.alpha < 0.41f);
+    // leftover carried over
+    EASSERT(etimestep_advance(&timestep, 1027 * MS) == 2);
+    EASSERT(timestep.accumulator_ns == 7 * MS);
+
+    // long stall: capped, the rest is dropped but the fraction is kept
+    EASSERT(etimestep_advance(&timestep, 1133 * MS) == 4);
+    EASSERT(timestep.dropped_ns == 7 * 10 * MS);
+    EASSERT(timestep.accumulator_ns == 3 * MS);
+    EASSERT(etimestep_advance(&timestep, 1135 * MS) == 0);
+    EASSERT(timestep.steps == 6 && timestep.frames == 4);
+}
+
+static void timestep_test_defaults() {
+    etimestep timestep;
+    etimestep_init(0, 0, &timestep);
+    EASSERT(timestep.config.step_ns == ETIMESTEP_DEFAULT_STEP_NS);
+    EASSERT(timestep.config.max_steps == ETIMESTEP_DEFAULT_MAX_STEPS);
+    EASSERT(timestep.config.spin_ns == ETIMESTEP_DEFAULT_SPIN_NS);
+}
+
+static void timestep_test_pace() {
+    etimestep_config config = { .step_ns = 2 * MS };
+    etimestep timestep;
+    u64 start = eclock_now_ns();
+    etimestep_init(&config, start, &timestep);
+    for(u32 i = 0; i < 5; ++i) {
+        etimestep_pace(&timestep);
+    }
+    // waits for each frame deadline, never returns early
+    EASSERT(eclock_now_ns() - start >= 10 * MS);
+    EASSERT(timestep.next_frame_ns == start + 12 * MS);
+
+    // events are waited for until the spin
+    u64 spin = timestep.config.spin_ns;
+    EASSERT(etimestep_wait_ns(&timestep, start + 10 * MS) == 2 * MS - spin);
+    EASSERT(etimestep_wait_ns(&timestep, start + 12 * MS - spin) == 0);
+    EASSERT(etimestep_wait_ns(&timestep, start + 13 * MS) == 0);
+    timestep.config.uncapped = true;
+    EASSERT(etimestep_wait_ns(&timestep, start + 10 * MS) == 0);
+}
+
+static void timestep_test_no_spin() {
+    etimestep_config config = { .step_ns = 2 * MS, .spin_ns = 0, .spin_set = true };
+    etimestep timestep;
+    etimestep_init(&config, 0, &timestep);
+    EASSERT(timestep.config.spin_ns == 0);
+    // the whole wait is spent sleeping on events
+    EASSERT(etimestep_wait_ns(&timestep, 0) == 2 * MS);
+    EASSERT(etimestep_wait_ns(&timestep, 2 * MS - 1) == 1);
+}
+
+void timestep_tests() {
+    EINFO("-- timestep_tests");
+    timestep_test_accumulator();
+    timestep_test_defaults();
+    timestep_test_pace();
+    timestep_test_no_spin();
+}
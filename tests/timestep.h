@@ -0,0 +1,6 @@
+#ifndef TIMESTEP_TESTS_H
+#define TIMESTEP_TESTS_H
+
+void timestep_tests();
+
+#endif // TIMESTEP_TESTS_H
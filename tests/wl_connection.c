@@ -0,0 +1,301 @@
+#include "wl_connection.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/logger.h"
+#include "../src/wl_connection.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// a 16 bytes request with a recognizable body
+static void make_request(u32 i, u8 *msg) {
+    u32 words[4] = { 3, (16 << 16) | 1, i, ~i };
+    memcpy(msg, words, sizeof(words));
+}
+
+// what the compositor side got, and the fds that came with it
+static u64 read_all(i32 fd, u8 *data, u64 capacity, i32 *fds, u32 *fd_count) {
+    u64 total = 0;
+    for(;;) {
+        char cmsg_buf[CMSG_SPACE(EWL_MAX_FDS * sizeof(i32))];
+        struct iovec iov = { .iov_base = data + total, .iov_len = capacity - total };
+        struct msghdr msghdr = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = cmsg_buf, .msg_controllen = sizeof(cmsg_buf) };
+        i64 n = recvmsg(fd, &msghdr, MSG_DONTWAIT);
+        if(n <= 0) {
+            return total;
+        }
+        for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr); cmsg; cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
+            u32 count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(i32);
+            memcpy(fds + *fd_count, CMSG_DATA(cmsg), count * sizeof(i32));
+            *fd_count += count;
+        }
+        total += n;
+    }
+}
+
+static void expect_requests(const u8 *data, u32 first, u32 count) {
+    for(u32 i = 0; i < count; ++i) {
+        u8 msg[16];
+        make_request(first + i, msg);
+        EASSERT(memcmp(data + i * 16, msg, 16) == 0);
+    }
+}
+
+static void wl_connection_test_batching() {
+    i32 sockets[2];
+    EASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+    static ewl_connection connection;
+    ewl_connection_init(sockets[0], &connection);
+
+    // a frame: attach, damage, frame, commit
+    u8 msg[16];
+    for(u32 i = 0; i < 4; ++i) {
+        make_request(i, msg);
+        EASSERT(ewl_connection_queue(&connection, msg, sizeof(msg), -1));
+    }
+    EASSERT(connection.sends == 0 && ewl_connection_pending(&connection));
+    EASSERT(ewl_connection_flush(&connection, false));
+    EASSERT(connection.sends == 1 && !ewl_connection_pending(&connection));
+    EASSERT(ewl_connection_flush(&connection, false) && connection.sends == 1);
+
+    static u8 data[64 * 1024];
+    i32 fds[EWL_MAX_FDS];
+    u32 fd_count = 0;
+    EASSERT(read_all(sockets[1], data, sizeof(data), fds, &fd_count) == 64);
+    expect_requests(data, 0, 4);
+
+    // fds arrive with the bytes, still usable on the other side
+    i32 pipe_fds[2];
+    EASSERT(pipe(pipe_fds) == 0);
+    make_request(4, msg);
+    EASSERT(ewl_connection_queue(&connection, msg, sizeof(msg), pipe_fds[1]));
+    EASSERT(ewl_connection_flush(&connection, false));
+    EASSERT(read_all(sockets[1], data, sizeof(data), fds, &fd_count) == 16 && fd_count == 1);
+    EASSERT(write(fds[0], "egg", 3) == 3);
+    char egg[3];
+    EASSERT(read(pipe_fds[0], egg, 3) == 3 && memcmp(egg, "egg", 3) == 0);
+    close(fds[0]);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    // a full buffer is flushed before queuing more
+    u32 count = EWL_OUT_SIZE / 16 + 10;
+    for(u32 i = 0; i < count; ++i) {
+        make_request(100 + i, msg);
+        EASSERT(ewl_connection_queue(&connection, msg, sizeof(msg), -1));
+    }
+    EASSERT(connection.sends == 3 && connection.out_used == 10 * 16);
+    EASSERT(ewl_connection_flush(&connection, true));
+    EASSERT(read_all(sockets[1], data, sizeof(data), fds, &fd_count) == count * 16);
+    expect_requests(data, 100, count);
+    EASSERT(connection.requests == 5 + count);
+
+    ewl_connection_destroy(&connection);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+// the socket can't take everything: the rest waits for the next flush
+static void wl_connection_test_partial() {
+    i32 sockets[2];
+    EASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+    i32 size = 4096;
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(sockets[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    static ewl_connection connection;
+    ewl_connection_init(sockets[0], &connection);
+
+    static u8 data[256 * 1024];
+    i32 fds[EWL_MAX_FDS];
+    u32 fd_count = 0;
+    u64 received = 0;
+    u32 queued = 0;
+    u32 partial = 0;
+    // without blocking, whatever the socket takes per flush, read slower than written
+    for(u32 round = 0; round < 64; ++round) {
+        u32 room = (EWL_OUT_SIZE - connection.out_used) / 16;
+        for(u32 i = 0; i < room; ++i, ++queued) {
+            u8 msg[16];
+            make_request(queued, msg);
+            EASSERT(ewl_connection_queue(&connection, msg, sizeof(msg), -1));
+        }
+        EASSERT(ewl_connection_flush(&connection, false));
+        partial += ewl_connection_pending(&connection);
+        if(round % 8 == 7) {
+            received += read_all(sockets[1], data + received, sizeof(data) - received, fds, &fd_count);
+        }
+    }
+    EASSERT(partial > 0);
+    EASSERT(ewl_connection_flush(&connection, false));
+    received += read_all(sockets[1], data + received, sizeof(data) - received, fds, &fd_count);
+    EASSERT(!ewl_connection_pending(&connection));
+    EASSERT(received == (u64)queued * 16);
+    expect_requests(data, 0, queued);
+
+    // the peer gone
+    close(sockets[1]);
+    u8 msg[16];
+    make_request(0, msg);
+    EASSERT(ewl_connection_queue(&connection, msg, sizeof(msg), -1));
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!ewl_connection_flush(&connection, false) && connection.failed);
+    EASSERT(!ewl_connection_queue(&connection, msg, sizeof(msg), -1));
+    ewl_connection_destroy(&connection);
+    close(sockets[0]);
+}
+
+static u32 next_random(u32 *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// event i: random size, its bytes derived from i, every 7th one carries an fd
+static u16 event_size(u32 i) {
+    u32 state = i * 2654435761u + 1;
+    return EWL_HEADER_SIZE + (next_random(&state) % 1024) * 4;
+}
+
+static u32 write_event(u32 i, u8 *at) {
+    u16 size = event_size(i);
+    u32 words[2] = { i, ((u32)size << 16) | (i & 0xFFFF) };
+    memcpy(at, words, sizeof(words));
+    for(u32 j = EWL_HEADER_SIZE; j < size; ++j) {
+        at[j] = (u8)(i * 31 + j);
+    }
+    return size;
+}
+
+// what the compositor sends, cut anywhere, fds with the piece holding their event start
+static void wl_connection_test_fragmented() {
+    i32 sockets[2];
+    EASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+    static ewl_connection connection;
+    EASSERT(ewl_connection_init(sockets[0], &connection));
+    i32 pipe_fds[2];
+    EASSERT(pipe(pipe_fds) == 0);
+    struct stat pipe_stat;
+    EASSERT(fstat(pipe_fds[1], &pipe_stat) == 0);
+
+    const u32 count = 3000;
+    static u8 stream[3000 * (EWL_HEADER_SIZE + 4096)];
+    static u32 starts[3000 + 1];
+    u64 stream_size = 0;
+    for(u32 i = 0; i < count; ++i) {
+        starts[i] = stream_size;
+        stream_size += write_event(i, stream + stream_size);
+    }
+    starts[count] = stream_size;
+
+    u32 random = 0x5eed;
+    u64 sent = 0;
+    u32 next_fd_event = 0;
+    u32 parsed = 0;
+    u32 wrapped = 0;
+    u32 fds_taken = 0;
+    while(parsed < count) {
+        if(sent < stream_size) {
+            u64 piece = 1 + next_random(&random) % 3000;
+            if(piece > stream_size - sent) {
+                piece = stream_size - sent;
+            }
+            // the fds of the events starting in this piece
+            i32 fds[EWL_MAX_FDS];
+            u32 fd_count = 0;
+            while(next_fd_event < count && starts[next_fd_event] < sent + piece) {
+                if(next_fd_event % 7 == 0) {
+                    fds[fd_count++] = pipe_fds[1];
+                }
+                ++next_fd_event;
+            }
+            char cmsg_buf[CMSG_SPACE(EWL_MAX_FDS * sizeof(i32))] = {0};
+            struct iovec iov = { .iov_base = stream + sent, .iov_len = piece };
+            struct msghdr msghdr = { .msg_iov = &iov, .msg_iovlen = 1 };
+            if(fd_count) {
+                msghdr.msg_control = cmsg_buf;
+                msghdr.msg_controllen = CMSG_SPACE(fd_count * sizeof(i32));
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(fd_count * sizeof(i32));
+                memcpy(CMSG_DATA(cmsg), fds, fd_count * sizeof(i32));
+            }
+            EASSERT(sendmsg(sockets[1], &msghdr, 0) == (i64)piece);
+            sent += piece;
+        }
+        // read now and then, always before the socket could fill up
+        if(sent == stream_size || sent - connection.bytes_in > 32 * 1024 || next_random(&random) % 4 == 0) {
+            EASSERT(ewl_connection_read(&connection) >= 0);
+            ewl_message message;
+            while(ewl_connection_next(&connection, &message)) {
+                u32 i = parsed++;
+                EASSERT(message.object_id == i && message.opcode == (i & 0xFFFF) && message.size == event_size(i));
+                // in the ring, where it was read
+                EASSERT(message.args >= connection.in && message.args + message.size <= connection.in + 2 * EWL_IN_SIZE);
+                EASSERT(memcmp(message.args, stream + starts[i] + EWL_HEADER_SIZE, message.size - EWL_HEADER_SIZE) == 0);
+                wrapped += (message.args - connection.in) + message.size - EWL_HEADER_SIZE > EWL_IN_SIZE;
+                if(i % 7 == 0) {
+                    i32 fd;
+                    struct stat fd_stat;
+                    EASSERT(ewl_connection_take_fd(&connection, &fd));
+                    EASSERT(fstat(fd, &fd_stat) == 0 && fd_stat.st_ino == pipe_stat.st_ino);
+                    close(fd);
+                    ++fds_taken;
+                }
+            }
+            EASSERT(!connection.failed);
+        }
+    }
+    EASSERT(connection.bytes_in == stream_size && connection.in_head == connection.in_tail);
+    EASSERT(fds_taken == (count + 6) / 7);
+    EASSERT(wrapped > 0);
+
+    // half a header waits, with its fd, which nothing takes: closed with the connection
+    u32 bad[2] = { 1, 6 << 16 };
+    char cmsg_buf[CMSG_SPACE(sizeof(i32))] = {0};
+    struct iovec iov = { .iov_base = bad, .iov_len = 4 };
+    struct msghdr msghdr = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = cmsg_buf, .msg_controllen = sizeof(cmsg_buf) };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(i32));
+    memcpy(CMSG_DATA(cmsg), &pipe_fds[1], sizeof(i32));
+    EASSERT(sendmsg(sockets[1], &msghdr, 0) == 4);
+    EASSERT(ewl_connection_read(&connection) == 4);
+    ewl_message message;
+    EASSERT(!ewl_connection_next(&connection, &message) && !connection.failed);
+    EASSERT(connection.in_fd_tail - connection.in_fd_head == 1);
+
+    // the rest of a header that can't be an event
+    EASSERT(write(sockets[1], &bad[1], 4) == 4);
+    EASSERT(ewl_connection_read(&connection) == 4);
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!ewl_connection_next(&connection, &message) && connection.failed);
+
+    // the peer gone
+    static ewl_connection closed;
+    EASSERT(ewl_connection_init(sockets[0], &closed));
+    EASSERT(ewl_connection_read(&closed) == 0);
+    close(sockets[1]);
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(ewl_connection_read(&closed) == -1 && closed.failed);
+
+    ewl_connection_destroy(&closed);
+    ewl_connection_destroy(&connection);
+    EASSERT(connection.in_fd_tail == connection.in_fd_head && !connection.in);
+    close(sockets[0]);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
+void wl_connection_tests() {
+    EINFO("-- wl_connection_tests");
+    wl_connection_test_batching();
+    wl_connection_test_partial();
+    wl_connection_test_fragmented();
+}
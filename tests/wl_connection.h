@@ -0,0 +1,6 @@
+#ifndef WL_CONNECTION_TESTS_H
+#define WL_CONNECTION_TESTS_H
+
+void wl_connection_tests();
+
+#endif // WL_CONNECTION_TESTS_H
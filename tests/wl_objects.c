@@ -0,0 +1,100 @@
+#include "wl_objects.h"
+
+#include "../src/defines.h"
+#include "../src/assert.h"
+#include "../src/logger.h"
+#include "../src/memory.h"
+#include "../src/wl_objects.h"
+
+typedef struct test_owner {
+    u32 calls;
+    u32 last_object;
+    u32 last_arg;
+} test_owner;
+
+static u8 test_first(void *owner, const ewl_message *message) {
+    test_owner *test = owner;
+    ++test->calls;
+    test->last_object = message->object_id;
+    test->last_arg = *(u32 *)message->args;
+    return true;
+}
+
+static u8 test_failing(void *owner, const ewl_message *message) {
+    return false;
+}
+
+// opcode 1 isn't handled
+static const ewl_event_handler test_events[] = { test_first, 0, test_failing };
+static const ewl_interface test_interface = { "test", test_events, 3 };
+static const ewl_interface empty_interface = { "empty", 0, 0 };
+
+static u8 dispatch(ewl_objects *objects, u32 id, u16 opcode, u32 arg) {
+    u32 msg[3] = { id, (12 << 16) | opcode, arg };
+    ewl_message message = { .object_id = id, .opcode = opcode, .size = sizeof(msg), .args = (u8 *)(msg + 2) };
+    return ewl_objects_dispatch(objects, &message);
+}
+
+static void wl_objects_test_dispatch() {
+    ewl_objects objects;
+    ewl_objects_init(&objects);
+    test_owner first = {0}, second = {0};
+
+    EASSERT(ewl_objects_add(&objects, &empty_interface, 0) == 1);
+    u32 a = ewl_objects_add(&objects, &test_interface, &first);
+    u32 b = ewl_objects_add(&objects, &test_interface, &second);
+    EASSERT(a == 2 && b == 3 && objects.live == 3);
+    EASSERT(ewl_objects_get(&objects, 0) == 0 && ewl_objects_get(&objects, 4) == 0);
+
+    // to the owner of the object
+    EASSERT(dispatch(&objects, b, 0, 42));
+    EASSERT(second.calls == 1 && second.last_object == b && second.last_arg == 42 && first.calls == 0);
+    EASSERT(dispatch(&objects, a, 0, 7) && first.calls == 1 && first.last_arg == 7);
+    EASSERT(!dispatch(&objects, a, 2, 0));
+
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!dispatch(&objects, a, 1, 0));
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!dispatch(&objects, a, 3, 0));
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!dispatch(&objects, 1, 0, 0));
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!dispatch(&objects, 9, 0, 0));
+
+    // events sent before the compositor got the destroy request are dropped
+    ewl_objects_destroyed(&objects, a);
+    EASSERT(dispatch(&objects, a, 0, 1) && first.calls == 1 && objects.dropped == 1);
+    EASSERT(ewl_objects_get(&objects, a)->owner == &first);
+
+    // ids come back after delete_id, last freed first
+    ewl_objects_remove(&objects, a);
+    EASSERT(ewl_objects_get(&objects, a) == 0 && objects.live == 2);
+    EINFO("*** following error is expected, do not take into account");
+    EASSERT(!dispatch(&objects, a, 0, 1));
+    ewl_objects_remove(&objects, b);
+    EASSERT(ewl_objects_add(&objects, &test_interface, &first) == b);
+    EASSERT(ewl_objects_add(&objects, &test_interface, &second) == a);
+    EASSERT(ewl_objects_add(&objects, &test_interface, &second) == 4);
+    EASSERT(dispatch(&objects, b, 0, 5) && first.calls == 2 && first.last_object == b);
+    EASSERT(!ewl_objects_get(&objects, a)->destroyed);
+
+    // a frame callback per frame doesn't grow the table
+    for(u32 frame = 0; frame < 1000; ++frame) {
+        u32 callback = ewl_objects_add(&objects, &test_interface, &first);
+        EASSERT(dispatch(&objects, callback, 0, frame));
+        ewl_objects_remove(&objects, callback);
+    }
+    EASSERT(objects.count == 6 && first.calls == 1002);
+
+    ewl_objects_destroy(&objects);
+}
+
+void wl_objects_tests() {
+    EINFO("-- wl_objects_tests");
+    eheap heap = {0};
+    ememory_init(1024 * 1024, &heap);
+
+    wl_objects_test_dispatch();
+
+    ememory_uninit();
+}
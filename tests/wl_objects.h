@@ -0,0 +1,6 @@
+#ifndef WL_OBJECTS_TESTS_H
+#define WL_OBJECTS_TESTS_H
+
+void wl_objects_tests();
+
+#endif // WL_OBJECTS_TESTS_H
@@ -0,0 +1,123 @@
+// Turns a binary log written by elog_binary_open back into text:
+//   build/elog_decode egg.blog > egg.log
+
+#include "../src/defines.h"
+#include "../src/log_binary.h"
+#include "../src/log_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct site {
+    const char *file;
+    const char *format;
+    i32 line;
+    u32 level;
+} site;
+
+static u8 *read_file(const char *path, u64 *size) {
+    FILE *file = fopen(path, "rb");
+    if(!file) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8 *data = length > 0 ? malloc(length) : 0;
+    if(!data || fread(data, 1, length, file) != (u64)length) {
+        free(data);
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    *size = length;
+    return data;
+}
+
+// next record at offset, 0 at the end or on a corrupt size
+static const elog_binary_record *next_record(const u8 *data, u64 end, u64 offset) {
+    if(offset + sizeof(elog_binary_record) > end) {
+        return 0;
+    }
+    const elog_binary_record *record = (const elog_binary_record *)(data + offset);
+    if(record->size < sizeof(elog_binary_record) || record->size % 8 || offset + record->size > end) {
+        return 0;
+    }
+    return record;
+}
+
+int main(int argc, char **argv) {
+    if(argc != 2) {
+        fprintf(stderr, "usage: %s <binary log>\n", argv[0]);
+        return 1;
+    }
+    u64 size;
+    u8 *data = read_file(argv[1], &size);
+    if(!data) {
+        fprintf(stderr, "couldn't read %s\n", argv[1]);
+        return 1;
+    }
+    const elog_binary_header *header = (const elog_binary_header *)data;
+    if(size < sizeof(elog_binary_header) || memcmp(header->magic, "EGGBLOG", 8) != 0 || header->version != ELOG_BINARY_VERSION) {
+        fprintf(stderr, "%s is not a version %u binary log\n", argv[1], ELOG_BINARY_VERSION);
+        free(data);
+        return 1;
+    }
+    u64 end = size;
+    if(header->used && header->header_size + header->used < end) {
+        end = header->header_size + header->used;
+    }
+
+    // sites first, a thread can write a record before the site it uses is defined
+    u32 site_capacity = 256;
+    site *sites = calloc(site_capacity, sizeof(site));
+    const elog_binary_record *record;
+    for(u64 offset = header->header_size; (record = next_record(data, end, offset)); offset += record->size) {
+        if(!(record->id & ELOG_BINARY_SITE)) {
+            continue;
+        }
+        const elog_binary_site_record *definition = (const elog_binary_site_record *)record;
+        u32 id = definition->id & ELOG_BINARY_ID_MASK;
+        if(sizeof(*definition) + definition->file_length + definition->format_length + 2 > definition->size) {
+            continue;
+        }
+        while(id >= site_capacity) {
+            sites = realloc(sites, 2 * site_capacity * sizeof(site));
+            memset(sites + site_capacity, 0, site_capacity * sizeof(site));
+            site_capacity *= 2;
+        }
+        const char *strings = (const char *)(definition + 1);
+        sites[id].file = strings;
+        sites[id].format = strings + definition->file_length + 1;
+        sites[id].line = definition->line;
+        sites[id].level = definition->level <= LOG_LEVEL_DEBUG ? definition->level : LOG_LEVEL_DEBUG;
+    }
+
+    u64 count = 0;
+    char line[ELOG_MAX_LINE];
+    for(u64 offset = header->header_size; (record = next_record(data, end, offset)); offset += record->size) {
+        if(record->id & ELOG_BINARY_SITE) {
+            continue;
+        }
+        u32 id = record->id & ELOG_BINARY_ID_MASK;
+        if(id >= site_capacity || !sites[id].format) {
+            printf("[%12.6f] unknown site %u\n", record->time_ns / 1e9, id);
+            continue;
+        }
+        const site *s = &sites[id];
+        u64 length = elog_format_prefix(s->level, s->file, s->line, line, sizeof(line));
+        if(record->id & ELOG_BINARY_TRUNCATED) {
+            snprintf(line + length, sizeof(line) - length, "%s [arguments too large]", s->format);
+        } else {
+            elog_format_args(s->format, (const u8 *)(record + 1), record->size - sizeof(elog_binary_record), line + length, sizeof(line) - length);
+        }
+        printf("[%12.6f] %s\n", record->time_ns / 1e9, line);
+        ++count;
+    }
+    fprintf(stderr, "%llu records\n", count);
+
+    free(sites);
+    free(data);
+    return 0;
+}